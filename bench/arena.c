@@ -0,0 +1,115 @@
+/*
+** Time spent parsing large inputs with values from the input's arena,
+** against the same parses with every value left to malloc.
+**
+**   cc -O2 -I.. arena.c ../mpc.c -o arena
+**   cc -O2 -I.. -DMPC_NO_ARENA arena.c ../mpc.c -o arena_malloc
+**   ./arena [kilobytes] [runs]; ./arena_malloc [kilobytes] [runs]
+**
+** Each parse is run the given number of times and the fastest is
+** reported. The Lisp grammar builds a tree, so most of its values
+** are nodes and only leaf strings pass through the arena. The word
+** list hands every word to a fold of its own, so each one is copied
+** out of the arena before the fold frees it.
+*/
+
+#include "mpc.h"
+#include <time.h>
+
+static double bench_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static char *bench_source(const char *line, size_t size) {
+  size_t len = strlen(line), k, n = size / len + 1;
+  char *s = malloc(len * n + 1);
+  for (k = 0; k < n; k++) { memcpy(s + k * len, line, len); }
+  s[len * n] = '\0';
+  return s;
+}
+
+static mpc_val_t *bench_count(int n, mpc_val_t **xs) {
+  int k;
+  long *c = malloc(sizeof(long));
+  for (k = 0; k < n; k++) { free(xs[k]); }
+  *c = n;
+  return c;
+}
+
+/* Fastest of runs parses of source, in milliseconds */
+static double bench_parse(mpc_parser_t *p, const char *source, int runs, int ast) {
+
+  int k;
+  double t, best = -1;
+  mpc_result_t r;
+
+  for (k = 0; k < runs; k++) {
+    t = bench_now();
+    if (mpc_parse("<bench>", source, p, &r)) {
+      if (ast) { mpc_ast_delete(r.output); } else { free(r.output); }
+    } else {
+      mpc_err_print(r.error);
+      mpc_err_delete(r.error);
+      return -1;
+    }
+    t = bench_now() - t;
+    if (best < 0 || t < best) { best = t; }
+  }
+
+  return best * 1000.0;
+}
+
+int main(int argc, char **argv) {
+
+  size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 4096) * 1024;
+  int runs = argc > 2 ? atoi(argv[2]) : 5;
+  char *source;
+  mpc_err_t *err;
+  mpc_parser_t *Words;
+
+  mpc_parser_t *Number = mpc_new("number");
+  mpc_parser_t *Symbol = mpc_new("symbol");
+  mpc_parser_t *Sexpr  = mpc_new("sexpr");
+  mpc_parser_t *Qexpr  = mpc_new("qexpr");
+  mpc_parser_t *Expr   = mpc_new("expr");
+  mpc_parser_t *Lispy  = mpc_new("lispy");
+
+  err = mpca_lang(MPCA_LANG_DEFAULT,
+    " number : /-?[0-9]+/ ;                                     "
+    " symbol : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;               "
+    " sexpr  : '(' <expr>* ')' ;                                "
+    " qexpr  : '{' <expr>* '}' ;                                "
+    " expr   : <number> | <symbol> | <sexpr> | <qexpr> ;        "
+    " lispy  : /^/ <expr>* /$/ ;                                ",
+    Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  if (err != NULL) {
+    mpc_err_print(err);
+    mpc_err_delete(err);
+    mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+    return 1;
+  }
+
+  Words = mpc_total(mpc_many(bench_count, mpc_tok(mpc_ident())), free);
+
+#ifdef MPC_NO_ARENA
+  printf("values from malloc, %lu KB inputs\n", (unsigned long)(size / 1024));
+#else
+  printf("values from the arena, %lu KB inputs\n", (unsigned long)(size / 1024));
+#endif
+
+  source = bench_source("(def {f} (\\ {x y} {+ x (* y 2)})) ", size);
+  printf("lisp:  %10.1f ms\n", bench_parse(Lispy, source, runs, 1));
+  free(source);
+
+  source = bench_source("alpha beta_2 gamma delta epsilon ", size);
+  printf("words: %10.1f ms\n", bench_parse(Words, source, runs, 0));
+  free(source);
+
+  mpc_delete(Words);
+  mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+** Parse throughput of one shared grammar across threads.
+**
+**   cc -O2 -pthread -I.. bench.c ../mpc.c -o bench
+**   ./bench [max_threads] [mpca_lang flags] [iterations]
+**
+** The thread count doubles from 1 up to max_threads and each
+** thread parses the same source iterations times.
+*/
+
+#include "mpc.h"
+#include <pthread.h>
+#include <time.h>
+
+#define BENCH_THREADS_MAX 64
+
+static mpc_parser_t *Lispy;
+static char *source;
+static int iterations;
+
+static void *bench_work(void *u) {
+  int k;
+  mpc_result_t r;
+  (void)u;
+  for (k = 0; k < iterations; k++) {
+    if (mpc_parse("<bench>", source, Lispy, &r)) {
+      mpc_ast_delete(r.output);
+    } else {
+      mpc_err_delete(r.error);
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+
+  int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+  int flags = argc > 2 ? atoi(argv[2]) : MPCA_LANG_DEFAULT;
+  const char *line = "(def {f} (\\ {x y} {+ x (* y 2)})) ";
+  pthread_t threads[BENCH_THREADS_MAX];
+  struct timespec start, end;
+  double secs;
+  size_t len;
+  int j, k, n;
+  mpc_err_t *err;
+
+  mpc_parser_t *Number = mpc_new("number");
+  mpc_parser_t *Symbol = mpc_new("symbol");
+  mpc_parser_t *Sexpr  = mpc_new("sexpr");
+  mpc_parser_t *Qexpr  = mpc_new("qexpr");
+  mpc_parser_t *Expr   = mpc_new("expr");
+  Lispy = mpc_new("lispy");
+
+  iterations = argc > 3 ? atoi(argv[3]) : 200;
+  if (max_threads > BENCH_THREADS_MAX) { max_threads = BENCH_THREADS_MAX; }
+
+  err = mpca_lang(flags,
+    " number : /-?[0-9]+/ ;                                     "
+    " symbol : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;               "
+    " sexpr  : '(' <expr>* ')' ;                                "
+    " qexpr  : '{' <expr>* '}' ;                                "
+    " expr   : <number> | <symbol> | <sexpr> | <qexpr> ;        "
+    " lispy  : /^/ <expr>* /$/ ;                                ",
+    Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  if (err != NULL) {
+    mpc_err_print(err);
+    mpc_err_delete(err);
+    mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+    return 1;
+  }
+
+  len = strlen(line);
+  source = malloc(len * 2000 + 1);
+  for (k = 0; k < 2000; k++) { memcpy(source + k * len, line, len); }
+  source[len * 2000] = '\0';
+
+  for (n = 1; n <= max_threads; n *= 2) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < n; j++) { pthread_create(&threads[j], NULL, bench_work, NULL); }
+    for (j = 0; j < n; j++) { pthread_join(threads[j], NULL); }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("threads %2d: %8.1f MB/s\n", n, (double)n * iterations * (double)(len * 2000) / secs / 1e6);
+  }
+
+  free(source);
+  mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  return 0;
+}
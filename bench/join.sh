@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+#
+# Times the join builtin over lists of 10 to a million elements, from
+# the top of the tree:
+#
+#   bash bench/join.sh ./keii
+#
+# For each size keii reads a script on its standard input that builds a
+# list and joins it to itself over and over, so that a few million
+# elements go through join in all. The same script with the join
+# replaced by the list itself is timed too and taken away, leaving the
+# time join took. Each script is run three times and the run that took
+# the least CPU time is kept. The result is given in nanoseconds per
+# element, which stays flat as the lists grow when join runs in linear
+# time.
+#
+
+keii=${1:-./keii}
+tmp=${TMPDIR:-/tmp}/keii-bench.$$
+TIMEFORMAT="%U %S"
+
+mkdir -p "$tmp" || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# Seconds of CPU taken by keii to run the given script, fastest of three
+run() {
+  local k t best=
+  printf '%s\n' "$1" > "$tmp/bench.lspy"
+  for k in 1 2 3; do
+    t=$({ time "$keii" < "$tmp/bench.lspy" > /dev/null 2>&1; } 2>&1)
+    best=$(echo $t | awk -v a="$best" '{ b = $1 + $2; print (a == "" || b < a) ? b : a }')
+  done
+  echo "$best"
+}
+
+# Lisp defining the vector $1 as 0 to $2 - 1, built by doubling a list
+# with vector arithmetic and cutting it to length, so it costs little
+iota() {
+  local s="(def {p} {0})" k=1
+  while [ "$k" -lt "$2" ]; do
+    s="$s (def {p} (join p (vec-list (+ (vec p) $k))))"
+    k=$(( k * 2 ))
+  done
+  echo "$s (def {$1} (vec-slice (vec p) 0 $2))"
+}
+
+for n in 10 100 1000 10000 100000 1000000; do
+  reps=$(( 4000000 / (2 * n) ))
+  setup="$(iota v $n) (def {a} (vec-list v)) $(iota r $reps) (def {r} (vec-list r))"
+  with=$(run "$setup (foldl (\\ {acc x} {len (join a a)}) 0 r)")
+  without=$(run "$setup (foldl (\\ {acc x} {len a}) 0 r)")
+  awk -v n="$n" -v r="$reps" -v w="$with" -v wo="$without" \
+    'BEGIN { printf "join %9d elements %8.3f s %9.1f ns/element\n", n, w - wo, (w - wo) * 1e9 / (2 * n * r) }'
+done
@@ -0,0 +1,112 @@
+/*
+** Time taken by mpc_parse on wide and on nested input, to compare the
+** parse loop against the recursive engine mpc started from. Only the
+** API the original mpc.c has is used, so this builds against either.
+**
+**   cc -O2 -I.. parse.c ../mpc.c -o parse
+**   git show d1903e9:mpc.c > /tmp/mpc.c; git show d1903e9:mpc.h > /tmp/mpc.h
+**   cc -O2 -I/tmp parse.c /tmp/mpc.c -o parse_base
+**   ./parse [runs]; ./parse_base [runs]
+**
+** The nested input stays below the depth at which the original engine
+** gives up. Each parse is run the given number of times and the
+** fastest is reported.
+*/
+
+#include "mpc.h"
+#include <time.h>
+
+#define BENCH_DEPTH 100
+
+static double bench_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static char *bench_repeat(const char *line, int n) {
+  size_t len = strlen(line);
+  char *s = malloc(len * n + 1);
+  int k;
+  for (k = 0; k < n; k++) { memcpy(s + k * len, line, len); }
+  s[len * n] = '\0';
+  return s;
+}
+
+/* Forms nested depth deep, each holding a number, n times over */
+static char *bench_nested(int depth, int n) {
+  char *s = malloc((size_t)(depth * 4 + 2) * n + 1), *t = s;
+  int k, d;
+  for (k = 0; k < n; k++) {
+    for (d = 0; d < depth; d++) { memcpy(t, "(1 ", 3); t += 3; }
+    for (d = 0; d < depth; d++) { *t++ = ')'; }
+    *t++ = ' ';
+  }
+  *t = '\0';
+  return s;
+}
+
+/* Fastest of runs parses of source, in milliseconds */
+static double bench_parse(mpc_parser_t *p, const char *source, int runs) {
+
+  int k;
+  double t, best = -1;
+  mpc_result_t r;
+
+  for (k = 0; k < runs; k++) {
+    t = bench_now();
+    if (mpc_parse("<bench>", source, p, &r)) {
+      mpc_ast_delete(r.output);
+    } else {
+      mpc_err_print(r.error);
+      mpc_err_delete(r.error);
+      return -1;
+    }
+    t = bench_now() - t;
+    if (best < 0 || t < best) { best = t; }
+  }
+
+  return best * 1000.0;
+}
+
+int main(int argc, char **argv) {
+
+  int runs = argc > 1 ? atoi(argv[1]) : 5;
+  char *source;
+  mpc_err_t *err;
+
+  mpc_parser_t *Number = mpc_new("number");
+  mpc_parser_t *Symbol = mpc_new("symbol");
+  mpc_parser_t *Sexpr  = mpc_new("sexpr");
+  mpc_parser_t *Qexpr  = mpc_new("qexpr");
+  mpc_parser_t *Expr   = mpc_new("expr");
+  mpc_parser_t *Lispy  = mpc_new("lispy");
+
+  err = mpca_lang(MPCA_LANG_DEFAULT,
+    " number : /-?[0-9]+/ ;                                     "
+    " symbol : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;               "
+    " sexpr  : '(' <expr>* ')' ;                                "
+    " qexpr  : '{' <expr>* '}' ;                                "
+    " expr   : <number> | <symbol> | <sexpr> | <qexpr> ;        "
+    " lispy  : /^/ <expr>* /$/ ;                                ",
+    Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  if (err != NULL) {
+    mpc_err_print(err);
+    mpc_err_delete(err);
+    mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+    return 1;
+  }
+
+  source = bench_repeat("(def {f} (\\ {x y} {+ x (* y 2)})) ", 20000);
+  printf("wide:   %10.1f ms\n", bench_parse(Lispy, source, runs));
+  free(source);
+
+  source = bench_nested(BENCH_DEPTH, 2000);
+  printf("nested: %10.1f ms\n", bench_parse(Lispy, source, runs));
+  free(source);
+
+  mpc_cleanup(6, Number, Symbol, Sexpr, Qexpr, Expr, Lispy);
+
+  return 0;
+}
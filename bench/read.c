@@ -0,0 +1,109 @@
+/*
+** Rate at which Keii source is read into lvals by the direct reader,
+** against mpc_parse followed by lval_read, which the REPL used before
+** and still falls back to on input the direct reader rejects.
+**
+**   cc -std=gnu11 -O2 -I.. read.c ../mpc.c -o read -lm -ledit
+**   ./read [kilobytes] [runs]
+**
+** parser.c is included with its main renamed, so both readers are the
+** ones keii runs, and the grammar below is the one keii's main builds.
+** Each read is run the given number of times and the fastest is
+** reported.
+*/
+
+#define main keii_main
+#include "../parser.c"
+#undef main
+
+#include <time.h>
+
+static double bench_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static char *bench_source(const char *line, size_t size) {
+  size_t len = strlen(line), k, n = size / len + 1;
+  char *s = malloc(len * n + 1);
+  for (k = 0; k < n; k++) { memcpy(s + k * len, line, len); }
+  s[len * n] = '\0';
+  return s;
+}
+
+/* Fastest of runs reads of source, in seconds, or -1 if it is rejected */
+static double bench_read(mpc_parser_t *p, const char *source, int runs) {
+
+  int k;
+  double t, best = -1;
+  mpc_result_t r;
+  lval *x;
+
+  for (k = 0; k < runs; k++) {
+    t = bench_now();
+    if (p == NULL) {
+      x = lval_read_input(source);
+    } else if (mpc_parse("<bench>", source, p, &r)) {
+      x = lval_read(r.output);
+      mpc_ast_delete(r.output);
+    } else {
+      mpc_err_print(r.error);
+      mpc_err_delete(r.error);
+      x = NULL;
+    }
+    if (x == NULL) { return -1; }
+    lval_del(x);
+    t = bench_now() - t;
+    if (best < 0 || t < best) { best = t; }
+  }
+
+  return best;
+}
+
+int main(int argc, char **argv) {
+
+  size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 4096) * 1024;
+  int runs = argc > 2 ? atoi(argv[2]) : 5;
+  double mb = (double)size / (1024 * 1024);
+  char *source;
+
+  mpc_parser_t *number = mpc_new("number");
+  mpc_parser_t *string = mpc_new("string");
+  mpc_parser_t *symbol = mpc_new("symbol");
+  mpc_parser_t *sexpr  = mpc_new("sexpr");
+  mpc_parser_t *qexpr  = mpc_new("qexpr");
+  mpc_parser_t *expr   = mpc_new("expr");
+  mpc_parser_t *lispy  = mpc_new("lispy");
+
+  mpc_define(string, mpc_tok(mpc_apply(
+    mpc_apply(mpc_string_lit(), mpcf_unescape), mpcf_str_ast)));
+
+  mpca_lang(MPCA_LANG_ARENA,
+    " number : /-?[0-9]+(\\.[0-9]+)?([eE][-+]?[0-9]+)?/ ;       "
+    " symbol : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;               "
+    " sexpr  : '(' <expr>* ')' ;                                "
+    " qexpr  : '{' <expr>* '}' ;                                "
+    " expr   : <number> | <string> | <symbol>                   "
+    "        | <sexpr> | <qexpr> ;                              "
+    " lispy  : /^/ <expr>* /$/ ;                                ",
+    number, string, symbol, sexpr, qexpr, expr, lispy);
+
+  lrules[LRULE_NUMBER] = mpca_rule_bit(number);
+  lrules[LRULE_STRING] = mpca_rule_bit(string);
+  lrules[LRULE_SYMBOL] = mpca_rule_bit(symbol);
+  lrules[LRULE_SEXPR]  = mpca_rule_bit(sexpr);
+  lrules[LRULE_QEXPR]  = mpca_rule_bit(qexpr);
+
+  source = bench_source(
+    "(def {f} (\\ {x y} {+ x (* y 2.5)})) (print \"x\\ty\\n\" -12 3e4) ", size);
+
+  printf("%lu KB of input\n", (unsigned long)(size / 1024));
+  printf("direct:          %8.1f MB/s\n", mb / bench_read(NULL, source, runs));
+  printf("mpc + lval_read: %8.1f MB/s\n", mb / bench_read(lispy, source, runs));
+
+  free(source);
+  mpc_cleanup(7, number, string, symbol, sexpr, qexpr, expr, lispy);
+
+  return 0;
+}
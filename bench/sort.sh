@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+#
+# Times the sort builtin over lists of a thousand to ten million
+# elements, from the top of the tree:
+#
+#   bash bench/sort.sh ./keii
+#
+# For each size keii reads a script on its standard input that builds a
+# scattered list and sorts it over and over, so that a few million
+# elements go through sort in all, or a few hundred thousand when sort
+# calls back into a lambda, and at least three sorts are run. The same script with the sort
+# replaced by the list itself is timed too and taken away, leaving the
+# time sort took. Each script is run three times and the run that took
+# the least CPU time is kept. The result is given in nanoseconds per
+# element, which grows with the log of the size for a comparison sort
+# and stays flat for a radix sort.
+#
+
+keii=${1:-./keii}
+tmp=${TMPDIR:-/tmp}/keii-bench.$$
+TIMEFORMAT="%U %S"
+
+mkdir -p "$tmp" || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# Seconds of CPU taken by keii to run the given script, fastest of three
+run() {
+  local k t best=
+  printf '%s\n' "$1" > "$tmp/bench.lspy"
+  for k in 1 2 3; do
+    t=$({ time "$keii" < "$tmp/bench.lspy" > /dev/null 2>&1; } 2>&1)
+    best=$(echo $t | awk -v a="$best" '{ b = $1 + $2; print (a == "" || b < a) ? b : a }')
+  done
+  echo "$best"
+}
+
+# Lisp defining the vector $1 as 0 to $2 - 1, built by doubling a list
+# with vector arithmetic and cutting it to length, so it costs little
+iota() {
+  local s="(def {p} {0})" k=1
+  while [ "$k" -lt "$2" ]; do
+    s="$s (def {p} (join p (vec-list (+ (vec p) $k))))"
+    k=$(( k * 2 ))
+  done
+  echo "$s (def {$1} (vec-slice (vec p) 0 $2))"
+}
+
+# bench <label> <elements in all> <setup defining a from v> <expression on a> <sizes...>
+bench() {
+  local label=$1 total=$2 build=$3 expr=$4 n reps setup with without
+  shift 4
+  for n in "$@"; do
+    reps=$(( total / n > 3 ? total / n : 3 ))
+    setup="$(iota v $n) $build $(iota r $reps) (def {r} (vec-list r))"
+    with=$(run "$setup (foldl (\\ {acc x} {len $expr}) 0 r)")
+    without=$(run "$setup (foldl (\\ {acc x} {len a}) 0 r)")
+    awk -v l="$label" -v n="$n" -v r="$reps" -v w="$with" -v wo="$without" \
+      'BEGIN { printf "%-12s %9d elements %8.3f s %9.1f ns/element\n", l, n, w - wo, (w - wo) * 1e9 / (n * r) }'
+  done
+}
+
+# Integers scattered by a multiplicative hash, and the same as Doubles,
+# built with vector arithmetic so that the setup stays small beside sort
+hash="(- (* v 7919) (* 1000003 (/ (* v 7919) 1000003)))"
+ints="(def {a} (vec-list $hash))"
+dbls="(def {a} (vec-list (* 0.5 $hash)))"
+
+bench "sort ints" 4000000 "$ints" "(sort a)" \
+  1000 10000 100000 1000000 10000000
+bench "sort doubles" 4000000 "$dbls" "(sort a)" \
+  1000 10000 100000 1000000 10000000
+bench "sort lambda" 200000 "$ints" "(sort a (\\ {x y} {- x y}))" \
+  1000 10000 100000
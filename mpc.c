@@ -1,4068 +1,6555 @@
-#include "mpc.h"
-
-/*
-** State Type
-*/
-
-static mpc_state_t mpc_state_invalid(void) {
-  mpc_state_t s;
-  s.pos = -1;
-  s.row = -1;
-  s.col = -1;
-  s.term = 0;
-  return s;
-}
-
-static mpc_state_t mpc_state_new(void) {
-  mpc_state_t s;
-  s.pos = 0;
-  s.row = 0;
-  s.col = 0;
-  s.term = 0;
-  return s;
-}
-
-/*
-** Input Type
-*/
-
-/*
-** In mpc the input type has three modes of
-** operation: String, File and Pipe.
-**
-** String is easy. The whole contents are
-** loaded into a buffer and scanned through.
-** The cursor can jump around at will making
-** backtracking easy.
-**
-** The second is a File which is also somewhat
-** easy. The contents are never loaded into
-** memory but backtracking can still be achieved
-** by seeking in the file at different positions.
-**
-** The final mode is Pipe. This is the difficult
-** one. As we assume pipes cannot be seeked - and
-** only support a single character lookahead at
-** any point, when the input is marked for a
-** potential backtracking we start buffering any
-** input.
-**
-** This means that if we are requested to seek
-** back we can simply start reading from the
-** buffer instead of the input.
-**
-** Of course using `mpc_predictive` will disable
-** backtracking and make LL(1) grammars easy
-** to parse for all input methods.
-**
-*/
-
-enum {
-  MPC_INPUT_STRING = 0,
-  MPC_INPUT_FILE   = 1,
-  MPC_INPUT_PIPE   = 2
-};
-
-enum {
-  MPC_INPUT_MARKS_MIN = 32
-};
-
-enum {
-  MPC_INPUT_MEM_NUM = 512
-};
-
-typedef struct {
-  char mem[64];
-} mpc_mem_t;
-
-typedef struct {
-
-  int type;
-  char *filename;
-  mpc_state_t state;
-
-  char *string;
-  char *buffer;
-  FILE *file;
-
-  int suppress;
-  int backtrack;
-  int marks_slots;
-  int marks_num;
-  mpc_state_t *marks;
-
-  char *lasts;
-  char last;
-
-  size_t mem_index;
-  char mem_full[MPC_INPUT_MEM_NUM];
-  mpc_mem_t mem[MPC_INPUT_MEM_NUM];
-
-} mpc_input_t;
-
-static mpc_input_t *mpc_input_new_string(const char *filename, const char *string) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_STRING;
-
-  i->state = mpc_state_new();
-
-  i->string = malloc(strlen(string) + 1);
-  strcpy(i->string, string);
-  i->buffer = NULL;
-  i->file = NULL;
-
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-
-  return i;
-}
-
-static mpc_input_t *mpc_input_new_nstring(const char *filename, const char *string, size_t length) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_STRING;
-
-  i->state = mpc_state_new();
-
-  i->string = malloc(length + 1);
-  strncpy(i->string, string, length);
-  i->string[length] = '\0';
-  i->buffer = NULL;
-  i->file = NULL;
-
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-
-  return i;
-
-}
-
-static mpc_input_t *mpc_input_new_pipe(const char *filename, FILE *pipe) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-
-  i->type = MPC_INPUT_PIPE;
-  i->state = mpc_state_new();
-
-  i->string = NULL;
-  i->buffer = NULL;
-  i->file = pipe;
-
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-
-  return i;
-
-}
-
-static mpc_input_t *mpc_input_new_file(const char *filename, FILE *file) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_FILE;
-  i->state = mpc_state_new();
-
-  i->string = NULL;
-  i->buffer = NULL;
-  i->file = file;
-
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-
-  return i;
-}
-
-static void mpc_input_delete(mpc_input_t *i) {
-
-  free(i->filename);
-
-  if (i->type == MPC_INPUT_STRING) { free(i->string); }
-  if (i->type == MPC_INPUT_PIPE) { free(i->buffer); }
-
-  free(i->marks);
-  free(i->lasts);
-  free(i);
-}
-
-static int mpc_mem_ptr(mpc_input_t *i, void *p) {
-  return
-    (char*)p >= (char*)(i->mem) &&
-    (char*)p <  (char*)(i->mem) + (MPC_INPUT_MEM_NUM * sizeof(mpc_mem_t));
-}
-
-static void *mpc_malloc(mpc_input_t *i, size_t n) {
-  size_t j;
-  char *p;
-
-  if (n > sizeof(mpc_mem_t)) { return malloc(n); }
-
-  j = i->mem_index;
-  do {
-    if (!i->mem_full[i->mem_index]) {
-      p = (void*)(i->mem + i->mem_index);
-      i->mem_full[i->mem_index] = 1;
-      i->mem_index = (i->mem_index+1) % MPC_INPUT_MEM_NUM;
-      return p;
-    }
-    i->mem_index = (i->mem_index+1) % MPC_INPUT_MEM_NUM;
-  } while (j != i->mem_index);
-
-  return malloc(n);
-}
-
-static void *mpc_calloc(mpc_input_t *i, size_t n, size_t m) {
-  char *x = mpc_malloc(i, n * m);
-  memset(x, 0, n * m);
-  return x;
-}
-
-static void mpc_free(mpc_input_t *i, void *p) {
-  size_t j;
-  if (!mpc_mem_ptr(i, p)) { free(p); return; }
-  j = ((size_t)(((char*)p) - ((char*)i->mem))) / sizeof(mpc_mem_t);
-  i->mem_full[j] = 0;
-}
-
-static void *mpc_realloc(mpc_input_t *i, void *p, size_t n) {
-
-  char *q = NULL;
-
-  if (!mpc_mem_ptr(i, p)) { return realloc(p, n); }
-
-  if (n > sizeof(mpc_mem_t)) {
-    q = malloc(n);
-    memcpy(q, p, sizeof(mpc_mem_t));
-    mpc_free(i, p);
-    return q;
-  }
-
-  return p;
-}
-
-static void *mpc_export(mpc_input_t *i, void *p) {
-  char *q = NULL;
-  if (!mpc_mem_ptr(i, p)) { return p; }
-  q = malloc(sizeof(mpc_mem_t));
-  memcpy(q, p, sizeof(mpc_mem_t));
-  mpc_free(i, p);
-  return q;
-}
-
-static void mpc_input_backtrack_disable(mpc_input_t *i) { i->backtrack--; }
-static void mpc_input_backtrack_enable(mpc_input_t *i) { i->backtrack++; }
-
-static void mpc_input_suppress_disable(mpc_input_t *i) { i->suppress--; }
-static void mpc_input_suppress_enable(mpc_input_t *i) { i->suppress++; }
-
-static void mpc_input_mark(mpc_input_t *i) {
-
-  if (i->backtrack < 1) { return; }
-
-  i->marks_num++;
-
-  if (i->marks_num > i->marks_slots) {
-    i->marks_slots = i->marks_num + i->marks_num / 2;
-    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
-    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
-  }
-
-  i->marks[i->marks_num-1] = i->state;
-  i->lasts[i->marks_num-1] = i->last;
-
-  if (i->type == MPC_INPUT_PIPE && i->marks_num == 1) {
-    i->buffer = calloc(1, 1);
-  }
-
-}
-
-static void mpc_input_unmark(mpc_input_t *i) {
-  int j;
-
-  if (i->backtrack < 1) { return; }
-
-  i->marks_num--;
-
-  if (i->marks_slots > i->marks_num + i->marks_num / 2
-  &&  i->marks_slots > MPC_INPUT_MARKS_MIN) {
-    i->marks_slots =
-      i->marks_num > MPC_INPUT_MARKS_MIN ?
-      i->marks_num : MPC_INPUT_MARKS_MIN;
-    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
-    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
-  }
-
-  if (i->type == MPC_INPUT_PIPE && i->marks_num == 0) {
-    for (j = strlen(i->buffer) - 1; j >= 0; j--)
-      ungetc(i->buffer[j], i->file);
-
-    free(i->buffer);
-    i->buffer = NULL;
-  }
-
-}
-
-static void mpc_input_rewind(mpc_input_t *i) {
-
-  if (i->backtrack < 1) { return; }
-
-  i->state = i->marks[i->marks_num-1];
-  i->last  = i->lasts[i->marks_num-1];
-
-  if (i->type == MPC_INPUT_FILE) {
-    fseek(i->file, i->state.pos, SEEK_SET);
-  }
-
-  mpc_input_unmark(i);
-}
-
-static int mpc_input_buffer_in_range(mpc_input_t *i) {
-  return i->state.pos < (long)(strlen(i->buffer) + i->marks[0].pos);
-}
-
-static char mpc_input_buffer_get(mpc_input_t *i) {
-  return i->buffer[i->state.pos - i->marks[0].pos];
-}
-
-static char mpc_input_getc(mpc_input_t *i) {
-
-  char c = '\0';
-
-  switch (i->type) {
-
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
-    case MPC_INPUT_FILE: c = fgetc(i->file); return c;
-    case MPC_INPUT_PIPE:
-
-      if (!i->buffer) { c = getc(i->file); return c; }
-
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        c = mpc_input_buffer_get(i);
-        return c;
-      } else {
-        c = getc(i->file);
-        return c;
-      }
-
-    default: return c;
-  }
-}
-
-static char mpc_input_peekc(mpc_input_t *i) {
-
-  char c = '\0';
-
-  switch (i->type) {
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
-    case MPC_INPUT_FILE:
-
-      c = fgetc(i->file);
-      if (feof(i->file)) { return '\0'; }
-
-      fseek(i->file, -1, SEEK_CUR);
-      return c;
-
-    case MPC_INPUT_PIPE:
-
-      if (!i->buffer) {
-        c = getc(i->file);
-        if (feof(i->file)) { return '\0'; }
-        ungetc(c, i->file);
-        return c;
-      }
-
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        return mpc_input_buffer_get(i);
-      } else {
-        c = getc(i->file);
-        if (feof(i->file)) { return '\0'; }
-        ungetc(c, i->file);
-        return c;
-      }
-
-    default: return c;
-  }
-
-}
-
-static int mpc_input_terminated(mpc_input_t *i) {
-  return mpc_input_peekc(i) == '\0';
-}
-
-static int mpc_input_failure(mpc_input_t *i, char c) {
-
-  switch (i->type) {
-    case MPC_INPUT_STRING: { break; }
-    case MPC_INPUT_FILE: fseek(i->file, -1, SEEK_CUR); { break; }
-    case MPC_INPUT_PIPE: {
-
-      if (!i->buffer) { ungetc(c, i->file); break; }
-
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        break;
-      } else {
-        ungetc(c, i->file);
-      }
-    }
-    default: { break; }
-  }
-  return 0;
-}
-
-static int mpc_input_success(mpc_input_t *i, char c, char **o) {
-
-  if (i->type == MPC_INPUT_PIPE
-  &&  i->buffer && !mpc_input_buffer_in_range(i)) {
-    i->buffer = realloc(i->buffer, strlen(i->buffer) + 2);
-    i->buffer[strlen(i->buffer) + 1] = '\0';
-    i->buffer[strlen(i->buffer) + 0] = c;
-  }
-
-  i->last = c;
-  i->state.pos++;
-  i->state.col++;
-
-  if (c == '\n') {
-    i->state.col = 0;
-    i->state.row++;
-  }
-
-  if (o) {
-    (*o) = mpc_malloc(i, 2);
-    (*o)[0] = c;
-    (*o)[1] = '\0';
-  }
-
-  return 1;
-}
-
-static int mpc_input_any(mpc_input_t *i, char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return mpc_input_success(i, x, o);
-}
-
-static int mpc_input_char(mpc_input_t *i, char c, char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return x == c ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_range(mpc_input_t *i, char c, char d, char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return x >= c && x <= d ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_oneof(mpc_input_t *i, const char *c, char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return strchr(c, x) != 0 ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_noneof(mpc_input_t *i, const char *c, char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return strchr(c, x) == 0 ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_satisfy(mpc_input_t *i, int(*cond)(char), char **o) {
-  char x;
-  if (mpc_input_terminated(i)) { return 0; }
-  x = mpc_input_getc(i);
-  return cond(x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_string(mpc_input_t *i, const char *c, char **o) {
-
-  const char *x = c;
-
-  mpc_input_mark(i);
-  while (*x) {
-    if (!mpc_input_char(i, *x, NULL)) {
-      mpc_input_rewind(i);
-      return 0;
-    }
-    x++;
-  }
-  mpc_input_unmark(i);
-
-  *o = mpc_malloc(i, strlen(c) + 1);
-  strcpy(*o, c);
-  return 1;
-}
-
-static int mpc_input_anchor(mpc_input_t* i, int(*f)(char,char), char **o) {
-  *o = NULL;
-  return f(i->last, mpc_input_peekc(i));
-}
-
-static int mpc_input_soi(mpc_input_t* i, char **o) {
-  *o = NULL;
-  return i->last == '\0';
-}
-
-static int mpc_input_eoi(mpc_input_t* i, char **o) {
-  *o = NULL;
-  if (i->state.term) {
-    return 0;
-  } else if (mpc_input_terminated(i)) {
-    i->state.term = 1;
-    return 1;
-  } else {
-    return 0;
-  }
-}
-
-static mpc_state_t *mpc_input_state_copy(mpc_input_t *i) {
-  mpc_state_t *r = mpc_malloc(i, sizeof(mpc_state_t));
-  memcpy(r, &i->state, sizeof(mpc_state_t));
-  return r;
-}
-
-/*
-** Error Type
-*/
-
-void mpc_err_delete(mpc_err_t *x) {
-  int i;
-  for (i = 0; i < x->expected_num; i++) { free(x->expected[i]); }
-  free(x->expected);
-  free(x->filename);
-  free(x->failure);
-  free(x);
-}
-
-void mpc_err_print(mpc_err_t *x) {
-  mpc_err_print_to(x, stdout);
-}
-
-void mpc_err_print_to(mpc_err_t *x, FILE *f) {
-  char *str = mpc_err_string(x);
-  fprintf(f, "%s", str);
-  free(str);
-}
-
-static void mpc_err_string_cat(char *buffer, int *pos, int *max, char const *fmt, ...) {
-  /* TODO: Error Checking on Length */
-  int left = ((*max) - (*pos));
-  va_list va;
-  va_start(va, fmt);
-  if (left < 0) { left = 0;}
-  (*pos) += vsprintf(buffer + (*pos), fmt, va);
-  va_end(va);
-}
-
-static char char_unescape_buffer[4];
-
-static const char *mpc_err_char_unescape(char c) {
-
-  char_unescape_buffer[0] = '\'';
-  char_unescape_buffer[1] = ' ';
-  char_unescape_buffer[2] = '\'';
-  char_unescape_buffer[3] = '\0';
-
-  switch (c) {
-    case '\a': return "bell";
-    case '\b': return "backspace";
-    case '\f': return "formfeed";
-    case '\r': return "carriage return";
-    case '\v': return "vertical tab";
-    case '\0': return "end of input";
-    case '\n': return "newline";
-    case '\t': return "tab";
-    case ' ' : return "space";
-    default:
-      char_unescape_buffer[1] = c;
-      return char_unescape_buffer;
-  }
-
-}
-
-char *mpc_err_string(mpc_err_t *x) {
-
-  int i;
-  int pos = 0;
-  int max = 1023;
-  char *buffer = calloc(1, 1024);
-
-  if (x->failure) {
-    mpc_err_string_cat(buffer, &pos, &max,
-    "%s: error: %s\n", x->filename, x->failure);
-    return buffer;
-  }
-
-  mpc_err_string_cat(buffer, &pos, &max,
-    "%s:%li:%li: error: expected ", x->filename, x->state.row+1, x->state.col+1);
-
-  if (x->expected_num == 0) { mpc_err_string_cat(buffer, &pos, &max, "ERROR: NOTHING EXPECTED"); }
-  if (x->expected_num == 1) { mpc_err_string_cat(buffer, &pos, &max, "%s", x->expected[0]); }
-  if (x->expected_num >= 2) {
-
-    for (i = 0; i < x->expected_num-2; i++) {
-      mpc_err_string_cat(buffer, &pos, &max, "%s, ", x->expected[i]);
-    }
-
-    mpc_err_string_cat(buffer, &pos, &max, "%s or %s",
-      x->expected[x->expected_num-2],
-      x->expected[x->expected_num-1]);
-  }
-
-  mpc_err_string_cat(buffer, &pos, &max, " at ");
-  mpc_err_string_cat(buffer, &pos, &max, mpc_err_char_unescape(x->received));
-  mpc_err_string_cat(buffer, &pos, &max, "\n");
-
-  return realloc(buffer, strlen(buffer) + 1);
-}
-
-static mpc_err_t *mpc_err_new(mpc_input_t *i, const char *expected) {
-  mpc_err_t *x;
-  if (i->suppress) { return NULL; }
-  x = mpc_malloc(i, sizeof(mpc_err_t));
-  x->filename = mpc_malloc(i, strlen(i->filename) + 1);
-  strcpy(x->filename, i->filename);
-  x->state = i->state;
-  x->expected_num = 1;
-  x->expected = mpc_malloc(i, sizeof(char*));
-  x->expected[0] = mpc_malloc(i, strlen(expected) + 1);
-  strcpy(x->expected[0], expected);
-  x->failure = NULL;
-  x->received = mpc_input_peekc(i);
-  return x;
-}
-
-static mpc_err_t *mpc_err_fail(mpc_input_t *i, const char *failure) {
-  mpc_err_t *x;
-  if (i->suppress) { return NULL; }
-  x = mpc_malloc(i, sizeof(mpc_err_t));
-  x->filename = mpc_malloc(i, strlen(i->filename) + 1);
-  strcpy(x->filename, i->filename);
-  x->state = i->state;
-  x->expected_num = 0;
-  x->expected = NULL;
-  x->failure = mpc_malloc(i, strlen(failure) + 1);
-  strcpy(x->failure, failure);
-  x->received = ' ';
-  return x;
-}
-
-static mpc_err_t *mpc_err_file(const char *filename, const char *failure) {
-  mpc_err_t *x;
-  x = malloc(sizeof(mpc_err_t));
-  x->filename = malloc(strlen(filename) + 1);
-  strcpy(x->filename, filename);
-  x->state = mpc_state_new();
-  x->expected_num = 0;
-  x->expected = NULL;
-  x->failure = malloc(strlen(failure) + 1);
-  strcpy(x->failure, failure);
-  x->received = ' ';
-  return x;
-}
-
-static void mpc_err_delete_internal(mpc_input_t *i, mpc_err_t *x) {
-  int j;
-  if (x == NULL) { return; }
-  for (j = 0; j < x->expected_num; j++) { mpc_free(i, x->expected[j]); }
-  mpc_free(i, x->expected);
-  mpc_free(i, x->filename);
-  mpc_free(i, x->failure);
-  mpc_free(i, x);
-}
-
-static mpc_err_t *mpc_err_export(mpc_input_t *i, mpc_err_t *x) {
-  int j;
-  for (j = 0; j < x->expected_num; j++) {
-    x->expected[j] = mpc_export(i, x->expected[j]);
-  }
-  x->expected = mpc_export(i, x->expected);
-  x->filename = mpc_export(i, x->filename);
-  x->failure = mpc_export(i, x->failure);
-  return mpc_export(i, x);
-}
-
-static int mpc_err_contains_expected(mpc_input_t *i, mpc_err_t *x, char *expected) {
-  int j;
-  (void)i;
-  for (j = 0; j < x->expected_num; j++) {
-    if (strcmp(x->expected[j], expected) == 0) { return 1; }
-  }
-  return 0;
-}
-
-static void mpc_err_add_expected(mpc_input_t *i, mpc_err_t *x, char *expected) {
-  (void)i;
-  x->expected_num++;
-  x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-  x->expected[x->expected_num-1] = mpc_malloc(i, strlen(expected) + 1);
-  strcpy(x->expected[x->expected_num-1], expected);
-}
-
-static mpc_err_t *mpc_err_or(mpc_input_t *i, mpc_err_t** x, int n) {
-
-  int j, k, fst;
-  mpc_err_t *e;
-
-  fst = -1;
-  for (j = 0; j < n; j++) {
-    if (x[j] != NULL) { fst = j; }
-  }
-
-  if (fst == -1) { return NULL; }
-
-  e = mpc_malloc(i, sizeof(mpc_err_t));
-  e->state = mpc_state_invalid();
-  e->expected_num = 0;
-  e->expected = NULL;
-  e->failure = NULL;
-  e->filename = mpc_malloc(i, strlen(x[fst]->filename)+1);
-  strcpy(e->filename, x[fst]->filename);
-
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    if (x[j]->state.pos > e->state.pos) { e->state = x[j]->state; }
-  }
-
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    if (x[j]->state.pos < e->state.pos) { continue; }
-
-    if (x[j]->failure) {
-      e->failure = mpc_malloc(i, strlen(x[j]->failure)+1);
-      strcpy(e->failure, x[j]->failure);
-      break;
-    }
-
-    e->received = x[j]->received;
-
-    for (k = 0; k < x[j]->expected_num; k++) {
-      if (!mpc_err_contains_expected(i, e, x[j]->expected[k])) {
-        mpc_err_add_expected(i, e, x[j]->expected[k]);
-      }
-    }
-  }
-
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    mpc_err_delete_internal(i, x[j]);
-  }
-
-  return e;
-}
-
-static mpc_err_t *mpc_err_repeat(mpc_input_t *i, mpc_err_t *x, const char *prefix) {
-
-  int j = 0;
-  size_t l = 0;
-  char *expect = NULL;
-
-  if (x == NULL) { return NULL; }
-
-  if (x->expected_num == 0) {
-    expect = mpc_calloc(i, 1, 1);
-    x->expected_num = 1;
-    x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-    x->expected[0] = expect;
-    return x;
-  }
-
-  else if (x->expected_num == 1) {
-    expect = mpc_malloc(i, strlen(prefix) + strlen(x->expected[0]) + 1);
-    strcpy(expect, prefix);
-    strcat(expect, x->expected[0]);
-    mpc_free(i, x->expected[0]);
-    x->expected[0] = expect;
-    return x;
-  }
-
-  else if (x->expected_num > 1) {
-
-    l += strlen(prefix);
-    for (j = 0; j < x->expected_num-2; j++) {
-      l += strlen(x->expected[j]) + strlen(", ");
-    }
-    l += strlen(x->expected[x->expected_num-2]);
-    l += strlen(" or ");
-    l += strlen(x->expected[x->expected_num-1]);
-
-    expect = mpc_malloc(i, l + 1);
-
-    strcpy(expect, prefix);
-    for (j = 0; j < x->expected_num-2; j++) {
-      strcat(expect, x->expected[j]); strcat(expect, ", ");
-    }
-    strcat(expect, x->expected[x->expected_num-2]);
-    strcat(expect, " or ");
-    strcat(expect, x->expected[x->expected_num-1]);
-
-    for (j = 0; j < x->expected_num; j++) { mpc_free(i, x->expected[j]); }
-
-    x->expected_num = 1;
-    x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-    x->expected[0] = expect;
-    return x;
-  }
-
-  return NULL;
-}
-
-static mpc_err_t *mpc_err_many1(mpc_input_t *i, mpc_err_t *x) {
-  return mpc_err_repeat(i, x, "one or more of ");
-}
-
-static mpc_err_t *mpc_err_count(mpc_input_t *i, mpc_err_t *x, int n) {
-  mpc_err_t *y;
-  int digits = n/10 + 1;
-  char *prefix;
-  prefix = mpc_malloc(i, digits + strlen(" of ") + 1);
-  sprintf(prefix, "%i of ", n);
-  y = mpc_err_repeat(i, x, prefix);
-  mpc_free(i, prefix);
-  return y;
-}
-
-static mpc_err_t *mpc_err_merge(mpc_input_t *i, mpc_err_t *x, mpc_err_t *y) {
-  mpc_err_t *errs[2];
-  errs[0] = x;
-  errs[1] = y;
-  return mpc_err_or(i, errs, 2);
-}
-
-/*
-** Parser Type
-*/
-
-enum {
-  MPC_TYPE_UNDEFINED  = 0,
-  MPC_TYPE_PASS       = 1,
-  MPC_TYPE_FAIL       = 2,
-  MPC_TYPE_LIFT       = 3,
-  MPC_TYPE_LIFT_VAL   = 4,
-  MPC_TYPE_EXPECT     = 5,
-  MPC_TYPE_ANCHOR     = 6,
-  MPC_TYPE_STATE      = 7,
-
-  MPC_TYPE_ANY        = 8,
-  MPC_TYPE_SINGLE     = 9,
-  MPC_TYPE_ONEOF      = 10,
-  MPC_TYPE_NONEOF     = 11,
-  MPC_TYPE_RANGE      = 12,
-  MPC_TYPE_SATISFY    = 13,
-  MPC_TYPE_STRING     = 14,
-
-  MPC_TYPE_APPLY      = 15,
-  MPC_TYPE_APPLY_TO   = 16,
-  MPC_TYPE_PREDICT    = 17,
-  MPC_TYPE_NOT        = 18,
-  MPC_TYPE_MAYBE      = 19,
-  MPC_TYPE_MANY       = 20,
-  MPC_TYPE_MANY1      = 21,
-  MPC_TYPE_COUNT      = 22,
-
-  MPC_TYPE_OR         = 23,
-  MPC_TYPE_AND        = 24,
-
-  MPC_TYPE_CHECK      = 25,
-  MPC_TYPE_CHECK_WITH = 26,
-
-  MPC_TYPE_SOI        = 27,
-  MPC_TYPE_EOI        = 28
-};
-
-typedef struct { char *m; } mpc_pdata_fail_t;
-typedef struct { mpc_ctor_t lf; void *x; } mpc_pdata_lift_t;
-typedef struct { mpc_parser_t *x; char *m; } mpc_pdata_expect_t;
-typedef struct { int(*f)(char,char); } mpc_pdata_anchor_t;
-typedef struct { char x; } mpc_pdata_single_t;
-typedef struct { char x; char y; } mpc_pdata_range_t;
-typedef struct { int(*f)(char); } mpc_pdata_satisfy_t;
-typedef struct { char *x; } mpc_pdata_string_t;
-typedef struct { mpc_parser_t *x; mpc_apply_t f; } mpc_pdata_apply_t;
-typedef struct { mpc_parser_t *x; mpc_apply_to_t f; void *d; } mpc_pdata_apply_to_t;
-typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_check_t f; char *e; } mpc_pdata_check_t;
-typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_check_with_t f; void *d; char *e; } mpc_pdata_check_with_t;
-typedef struct { mpc_parser_t *x; } mpc_pdata_predict_t;
-typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_ctor_t lf; } mpc_pdata_not_t;
-typedef struct { int n; mpc_fold_t f; mpc_parser_t *x; mpc_dtor_t dx; } mpc_pdata_repeat_t;
-typedef struct { int n; mpc_parser_t **xs; } mpc_pdata_or_t;
-typedef struct { int n; mpc_fold_t f; mpc_parser_t **xs; mpc_dtor_t *dxs;  } mpc_pdata_and_t;
-
-typedef union {
-  mpc_pdata_fail_t fail;
-  mpc_pdata_lift_t lift;
-  mpc_pdata_expect_t expect;
-  mpc_pdata_anchor_t anchor;
-  mpc_pdata_single_t single;
-  mpc_pdata_range_t range;
-  mpc_pdata_satisfy_t satisfy;
-  mpc_pdata_string_t string;
-  mpc_pdata_apply_t apply;
-  mpc_pdata_apply_to_t apply_to;
-  mpc_pdata_check_t check;
-  mpc_pdata_check_with_t check_with;
-  mpc_pdata_predict_t predict;
-  mpc_pdata_not_t not;
-  mpc_pdata_repeat_t repeat;
-  mpc_pdata_and_t and;
-  mpc_pdata_or_t or;
-} mpc_pdata_t;
-
-struct mpc_parser_t {
-  char *name;
-  mpc_pdata_t data;
-  char type;
-  char retained;
-};
-
-static mpc_val_t *mpcf_input_nth_free(mpc_input_t *i, int n, mpc_val_t **xs, int x) {
-  int j;
-  for (j = 0; j < n; j++) { if (j != x) { mpc_free(i, xs[j]); } }
-  return xs[x];
-}
-
-static mpc_val_t *mpcf_input_fst_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 0); }
-static mpc_val_t *mpcf_input_snd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 1); }
-static mpc_val_t *mpcf_input_trd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 2); }
-
-static mpc_val_t *mpcf_input_strfold(mpc_input_t *i, int n, mpc_val_t **xs) {
-  int j;
-  size_t l = 0;
-  if (n == 0) { return mpc_calloc(i, 1, 1); }
-  for (j = 0; j < n; j++) { l += strlen(xs[j]); }
-  xs[0] = mpc_realloc(i, xs[0], l + 1);
-  for (j = 1; j < n; j++) { strcat(xs[0], xs[j]); mpc_free(i, xs[j]); }
-  return xs[0];
-}
-
-static mpc_val_t *mpcf_input_state_ast(mpc_input_t *i, int n, mpc_val_t **xs) {
-  mpc_state_t *s = ((mpc_state_t**)xs)[0];
-  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
-  a = mpc_ast_state(a, *s);
-  mpc_free(i, s);
-  (void) n;
-  return a;
-}
-
-static mpc_val_t *mpc_parse_fold(mpc_input_t *i, mpc_fold_t f, int n, mpc_val_t **xs) {
-  int j;
-  if (f == mpcf_null)      { return mpcf_null(n, xs); }
-  if (f == mpcf_fst)       { return mpcf_fst(n, xs); }
-  if (f == mpcf_snd)       { return mpcf_snd(n, xs); }
-  if (f == mpcf_trd)       { return mpcf_trd(n, xs); }
-  if (f == mpcf_fst_free)  { return mpcf_input_fst_free(i, n, xs); }
-  if (f == mpcf_snd_free)  { return mpcf_input_snd_free(i, n, xs); }
-  if (f == mpcf_trd_free)  { return mpcf_input_trd_free(i, n, xs); }
-  if (f == mpcf_strfold)   { return mpcf_input_strfold(i, n, xs); }
-  if (f == mpcf_state_ast) { return mpcf_input_state_ast(i, n, xs); }
-  for (j = 0; j < n; j++) { xs[j] = mpc_export(i, xs[j]); }
-  return f(j, xs);
-}
-
-static mpc_val_t *mpcf_input_free(mpc_input_t *i, mpc_val_t *x) {
-  mpc_free(i, x);
-  return NULL;
-}
-
-static mpc_val_t *mpcf_input_str_ast(mpc_input_t *i, mpc_val_t *c) {
-  mpc_ast_t *a = mpc_ast_new("", c);
-  mpc_free(i, c);
-  return a;
-}
-
-static mpc_val_t *mpc_parse_apply(mpc_input_t *i, mpc_apply_t f, mpc_val_t *x) {
-  if (f == mpcf_free)     { return mpcf_input_free(i, x); }
-  if (f == mpcf_str_ast)  { return mpcf_input_str_ast(i, x); }
-  return f(mpc_export(i, x));
-}
-
-static mpc_val_t *mpc_parse_apply_to(mpc_input_t *i, mpc_apply_to_t f, mpc_val_t *x, mpc_val_t *d) {
-  return f(mpc_export(i, x), d);
-}
-
-static void mpc_parse_dtor(mpc_input_t *i, mpc_dtor_t d, mpc_val_t *x) {
-  if (d == free) { mpc_free(i, x); return; }
-  d(mpc_export(i, x));
-}
-
-enum {
-  MPC_PARSE_STACK_MIN = 4
-};
-
-#define MPC_SUCCESS(x) r->output = x; return 1
-#define MPC_FAILURE(x) r->error = x; return 0
-#define MPC_PRIMITIVE(x) \
-  if (x) { MPC_SUCCESS(r->output); } \
-  else { MPC_FAILURE(NULL); }
-
-#define MPC_MAX_RECURSION_DEPTH 1000
-
-static int mpc_parse_run(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r, mpc_err_t **e, int depth) {
-
-  int j = 0, k = 0;
-  mpc_result_t results_stk[MPC_PARSE_STACK_MIN];
-  mpc_result_t *results;
-  int results_slots = MPC_PARSE_STACK_MIN;
-
-  if (depth == MPC_MAX_RECURSION_DEPTH)
-  {
-    MPC_FAILURE(mpc_err_fail(i, "Maximum recursion depth exceeded!"));
-  }
-
-  switch (p->type) {
-
-    /* Basic Parsers */
-
-    case MPC_TYPE_ANY:     MPC_PRIMITIVE(mpc_input_any(i, (char**)&r->output));
-    case MPC_TYPE_SINGLE:  MPC_PRIMITIVE(mpc_input_char(i, p->data.single.x, (char**)&r->output));
-    case MPC_TYPE_RANGE:   MPC_PRIMITIVE(mpc_input_range(i, p->data.range.x, p->data.range.y, (char**)&r->output));
-    case MPC_TYPE_ONEOF:   MPC_PRIMITIVE(mpc_input_oneof(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_NONEOF:  MPC_PRIMITIVE(mpc_input_noneof(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_SATISFY: MPC_PRIMITIVE(mpc_input_satisfy(i, p->data.satisfy.f, (char**)&r->output));
-    case MPC_TYPE_STRING:  MPC_PRIMITIVE(mpc_input_string(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_ANCHOR:  MPC_PRIMITIVE(mpc_input_anchor(i, p->data.anchor.f, (char**)&r->output));
-    case MPC_TYPE_SOI:     MPC_PRIMITIVE(mpc_input_soi(i, (char**)&r->output));
-    case MPC_TYPE_EOI:     MPC_PRIMITIVE(mpc_input_eoi(i, (char**)&r->output));
-
-    /* Other parsers */
-
-    case MPC_TYPE_UNDEFINED: MPC_FAILURE(mpc_err_fail(i, "Parser Undefined!"));
-    case MPC_TYPE_PASS:      MPC_SUCCESS(NULL);
-    case MPC_TYPE_FAIL:      MPC_FAILURE(mpc_err_fail(i, p->data.fail.m));
-    case MPC_TYPE_LIFT:      MPC_SUCCESS(p->data.lift.lf());
-    case MPC_TYPE_LIFT_VAL:  MPC_SUCCESS(p->data.lift.x);
-    case MPC_TYPE_STATE:     MPC_SUCCESS(mpc_input_state_copy(i));
-
-    /* Application Parsers */
-
-    case MPC_TYPE_APPLY:
-      if (mpc_parse_run(i, p->data.apply.x, r, e, depth+1)) {
-        MPC_SUCCESS(mpc_parse_apply(i, p->data.apply.f, r->output));
-      } else {
-        MPC_FAILURE(r->output);
-      }
-
-    case MPC_TYPE_APPLY_TO:
-      if (mpc_parse_run(i, p->data.apply_to.x, r, e, depth+1)) {
-        MPC_SUCCESS(mpc_parse_apply_to(i, p->data.apply_to.f, r->output, p->data.apply_to.d));
-      } else {
-        MPC_FAILURE(r->error);
-      }
-
-    case MPC_TYPE_CHECK:
-      if (mpc_parse_run(i, p->data.check.x, r, e, depth+1)) {
-        if (p->data.check.f(&r->output)) {
-          MPC_SUCCESS(r->output);
-        } else {
-          mpc_parse_dtor(i, p->data.check.dx, r->output);
-          MPC_FAILURE(mpc_err_fail(i, p->data.check.e));
-        }
-      } else {
-        MPC_FAILURE(r->error);
-      }
-
-    case MPC_TYPE_CHECK_WITH:
-      if (mpc_parse_run(i, p->data.check_with.x, r, e, depth+1)) {
-        if (p->data.check_with.f(&r->output, p->data.check_with.d)) {
-          MPC_SUCCESS(r->output);
-        } else {
-          mpc_parse_dtor(i, p->data.check.dx, r->output);
-          MPC_FAILURE(mpc_err_fail(i, p->data.check_with.e));
-        }
-      } else {
-        MPC_FAILURE(r->error);
-      }
-
-    case MPC_TYPE_EXPECT:
-      mpc_input_suppress_enable(i);
-      if (mpc_parse_run(i, p->data.expect.x, r, e, depth+1)) {
-        mpc_input_suppress_disable(i);
-        MPC_SUCCESS(r->output);
-      } else {
-        mpc_input_suppress_disable(i);
-        MPC_FAILURE(mpc_err_new(i, p->data.expect.m));
-      }
-
-    case MPC_TYPE_PREDICT:
-      mpc_input_backtrack_disable(i);
-      if (mpc_parse_run(i, p->data.predict.x, r, e, depth+1)) {
-        mpc_input_backtrack_enable(i);
-        MPC_SUCCESS(r->output);
-      } else {
-        mpc_input_backtrack_enable(i);
-        MPC_FAILURE(r->error);
-      }
-
-    /* Optional Parsers */
-
-    /* TODO: Update Not Error Message */
-
-    case MPC_TYPE_NOT:
-      mpc_input_mark(i);
-      mpc_input_suppress_enable(i);
-      if (mpc_parse_run(i, p->data.not.x, r, e, depth+1)) {
-        mpc_input_rewind(i);
-        mpc_input_suppress_disable(i);
-        mpc_parse_dtor(i, p->data.not.dx, r->output);
-        MPC_FAILURE(mpc_err_new(i, "opposite"));
-      } else {
-        mpc_input_unmark(i);
-        mpc_input_suppress_disable(i);
-        MPC_SUCCESS(p->data.not.lf());
-      }
-
-    case MPC_TYPE_MAYBE:
-      if (mpc_parse_run(i, p->data.not.x, r, e, depth+1)) {
-        MPC_SUCCESS(r->output);
-      } else {
-        *e = mpc_err_merge(i, *e, r->error);
-        MPC_SUCCESS(p->data.not.lf());
-      }
-
-    /* Repeat Parsers */
-
-    case MPC_TYPE_MANY:
-
-      results = results_stk;
-
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e, depth+1)) {
-        j++;
-        if (j == MPC_PARSE_STACK_MIN) {
-          results_slots = j + j / 2;
-          results = mpc_malloc(i, sizeof(mpc_result_t) * results_slots);
-          memcpy(results, results_stk, sizeof(mpc_result_t) * MPC_PARSE_STACK_MIN);
-        } else if (j >= results_slots) {
-          results_slots = j + j / 2;
-          results = mpc_realloc(i, results, sizeof(mpc_result_t) * results_slots);
-        }
-      }
-
-      *e = mpc_err_merge(i, *e, results[j].error);
-
-      MPC_SUCCESS(
-        mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-        if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-
-    case MPC_TYPE_MANY1:
-
-      results = results_stk;
-
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e, depth+1)) {
-        j++;
-        if (j == MPC_PARSE_STACK_MIN) {
-          results_slots = j + j / 2;
-          results = mpc_malloc(i, sizeof(mpc_result_t) * results_slots);
-          memcpy(results, results_stk, sizeof(mpc_result_t) * MPC_PARSE_STACK_MIN);
-        } else if (j >= results_slots) {
-          results_slots = j + j / 2;
-          results = mpc_realloc(i, results, sizeof(mpc_result_t) * results_slots);
-        }
-      }
-
-      if (j == 0) {
-        MPC_FAILURE(
-          mpc_err_many1(i, results[j].error);
-          if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      } else {
-
-        *e = mpc_err_merge(i, *e, results[j].error);
-
-        MPC_SUCCESS(
-          mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-          if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      }
-
-    case MPC_TYPE_COUNT:
-
-      results = p->data.repeat.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.repeat.n)
-        : results_stk;
-
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e, depth+1)) {
-        j++;
-        if (j == p->data.repeat.n) { break; }
-      }
-
-      if (j == p->data.repeat.n) {
-        MPC_SUCCESS(
-          mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-          if (p->data.repeat.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      } else {
-        for (k = 0; k < j; k++) {
-          mpc_parse_dtor(i, p->data.repeat.dx, results[k].output);
-        }
-        MPC_FAILURE(
-          mpc_err_count(i, results[j].error, p->data.repeat.n);
-          if (p->data.repeat.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      }
-
-    /* Combinatory Parsers */
-
-    case MPC_TYPE_OR:
-
-      if (p->data.or.n == 0) { MPC_SUCCESS(NULL); }
-
-      results = p->data.or.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.or.n)
-        : results_stk;
-
-      for (j = 0; j < p->data.or.n; j++) {
-        if (mpc_parse_run(i, p->data.or.xs[j], &results[j], e, depth+1)) {
-          MPC_SUCCESS(results[j].output;
-            if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-        } else {
-          *e = mpc_err_merge(i, *e, results[j].error);
-        }
-      }
-
-      MPC_FAILURE(NULL;
-        if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-
-    case MPC_TYPE_AND:
-
-      if (p->data.and.n == 0) { MPC_SUCCESS(NULL); }
-
-      results = p->data.or.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.or.n)
-        : results_stk;
-
-      mpc_input_mark(i);
-      for (j = 0; j < p->data.and.n; j++) {
-        if (!mpc_parse_run(i, p->data.and.xs[j], &results[j], e, depth+1)) {
-          mpc_input_rewind(i);
-          for (k = 0; k < j; k++) {
-            mpc_parse_dtor(i, p->data.and.dxs[k], results[k].output);
-          }
-          MPC_FAILURE(results[j].error;
-            if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-        }
-      }
-      mpc_input_unmark(i);
-      MPC_SUCCESS(
-        mpc_parse_fold(i, p->data.and.f, j, (mpc_val_t**)results);
-        if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-
-    /* End */
-
-    default:
-
-      MPC_FAILURE(mpc_err_fail(i, "Unknown Parser Type Id!"));
-  }
-
-  return 0;
-
-}
-
-#undef MPC_SUCCESS
-#undef MPC_FAILURE
-#undef MPC_PRIMITIVE
-
-int mpc_parse_input(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_err_t *e = mpc_err_fail(i, "Unknown Error");
-  e->state = mpc_state_invalid();
-  x = mpc_parse_run(i, p, r, &e, 0);
-  if (x) {
-    mpc_err_delete_internal(i, e);
-    r->output = mpc_export(i, r->output);
-  } else {
-    r->error = mpc_err_export(i, mpc_err_merge(i, e, r->error));
-  }
-  return x;
-}
-
-int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_string(filename, string);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_nstring(filename, string, length);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_file(filename, file);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_pipe(filename, pipe);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
-
-  FILE *f = fopen(filename, "rb");
-  int res;
-
-  if (f == NULL) {
-    r->output = NULL;
-    r->error = mpc_err_file(filename, "Unable to open file!");
-    return 0;
-  }
-
-  res = mpc_parse_file(filename, f, p, r);
-  fclose(f);
-  return res;
-}
-
-/*
-** Building a Parser
-*/
-
-static void mpc_undefine_unretained(mpc_parser_t *p, int force);
-
-static void mpc_undefine_or(mpc_parser_t *p) {
-
-  int i;
-  for (i = 0; i < p->data.or.n; i++) {
-    mpc_undefine_unretained(p->data.or.xs[i], 0);
-  }
-  free(p->data.or.xs);
-
-}
-
-static void mpc_undefine_and(mpc_parser_t *p) {
-
-  int i;
-  for (i = 0; i < p->data.and.n; i++) {
-    mpc_undefine_unretained(p->data.and.xs[i], 0);
-  }
-  free(p->data.and.xs);
-  free(p->data.and.dxs);
-
-}
-
-static void mpc_undefine_unretained(mpc_parser_t *p, int force) {
-
-  if (p->retained && !force) { return; }
-
-  switch (p->type) {
-
-    case MPC_TYPE_FAIL: free(p->data.fail.m); break;
-
-    case MPC_TYPE_ONEOF:
-    case MPC_TYPE_NONEOF:
-    case MPC_TYPE_STRING:
-      free(p->data.string.x);
-      break;
-
-    case MPC_TYPE_APPLY:    mpc_undefine_unretained(p->data.apply.x, 0);    break;
-    case MPC_TYPE_APPLY_TO: mpc_undefine_unretained(p->data.apply_to.x, 0); break;
-    case MPC_TYPE_PREDICT:  mpc_undefine_unretained(p->data.predict.x, 0);  break;
-
-    case MPC_TYPE_MAYBE:
-    case MPC_TYPE_NOT:
-      mpc_undefine_unretained(p->data.not.x, 0);
-      break;
-
-    case MPC_TYPE_EXPECT:
-      mpc_undefine_unretained(p->data.expect.x, 0);
-      free(p->data.expect.m);
-      break;
-
-    case MPC_TYPE_MANY:
-    case MPC_TYPE_MANY1:
-    case MPC_TYPE_COUNT:
-      mpc_undefine_unretained(p->data.repeat.x, 0);
-      break;
-
-    case MPC_TYPE_OR:  mpc_undefine_or(p);  break;
-    case MPC_TYPE_AND: mpc_undefine_and(p); break;
-
-    case MPC_TYPE_CHECK:
-      mpc_undefine_unretained(p->data.check.x, 0);
-      free(p->data.check.e);
-      break;
-
-    case MPC_TYPE_CHECK_WITH:
-      mpc_undefine_unretained(p->data.check_with.x, 0);
-      free(p->data.check_with.e);
-      break;
-
-    default: break;
-  }
-
-  if (!force) {
-    free(p->name);
-    free(p);
-  }
-
-}
-
-void mpc_delete(mpc_parser_t *p) {
-  if (p->retained) {
-
-    if (p->type != MPC_TYPE_UNDEFINED) {
-      mpc_undefine_unretained(p, 0);
-    }
-
-    free(p->name);
-    free(p);
-
-  } else {
-    mpc_undefine_unretained(p, 0);
-  }
-}
-
-static void mpc_soft_delete(mpc_val_t *x) {
-  mpc_undefine_unretained(x, 0);
-}
-
-static mpc_parser_t *mpc_undefined(void) {
-  mpc_parser_t *p = calloc(1, sizeof(mpc_parser_t));
-  p->retained = 0;
-  p->type = MPC_TYPE_UNDEFINED;
-  p->name = NULL;
-  return p;
-}
-
-mpc_parser_t *mpc_new(const char *name) {
-  mpc_parser_t *p = mpc_undefined();
-  p->retained = 1;
-  p->name = realloc(p->name, strlen(name) + 1);
-  strcpy(p->name, name);
-  return p;
-}
-
-mpc_parser_t *mpc_copy(mpc_parser_t *a) {
-  int i = 0;
-  mpc_parser_t *p;
-
-  if (a->retained) { return a; }
-
-  p = mpc_undefined();
-  p->retained = a->retained;
-  p->type = a->type;
-  p->data = a->data;
-
-  if (a->name) {
-    p->name = malloc(strlen(a->name)+1);
-    strcpy(p->name, a->name);
-  }
-
-  switch (a->type) {
-
-    case MPC_TYPE_FAIL:
-      p->data.fail.m = malloc(strlen(a->data.fail.m)+1);
-      strcpy(p->data.fail.m, a->data.fail.m);
-    break;
-
-    case MPC_TYPE_ONEOF:
-    case MPC_TYPE_NONEOF:
-    case MPC_TYPE_STRING:
-      p->data.string.x = malloc(strlen(a->data.string.x)+1);
-      strcpy(p->data.string.x, a->data.string.x);
-      break;
-
-    case MPC_TYPE_APPLY:    p->data.apply.x    = mpc_copy(a->data.apply.x);    break;
-    case MPC_TYPE_APPLY_TO: p->data.apply_to.x = mpc_copy(a->data.apply_to.x); break;
-    case MPC_TYPE_PREDICT:  p->data.predict.x  = mpc_copy(a->data.predict.x);  break;
-
-    case MPC_TYPE_MAYBE:
-    case MPC_TYPE_NOT:
-      p->data.not.x = mpc_copy(a->data.not.x);
-      break;
-
-    case MPC_TYPE_EXPECT:
-      p->data.expect.x = mpc_copy(a->data.expect.x);
-      p->data.expect.m = malloc(strlen(a->data.expect.m)+1);
-      strcpy(p->data.expect.m, a->data.expect.m);
-      break;
-
-    case MPC_TYPE_MANY:
-    case MPC_TYPE_MANY1:
-    case MPC_TYPE_COUNT:
-      p->data.repeat.x = mpc_copy(a->data.repeat.x);
-      break;
-
-    case MPC_TYPE_OR:
-      p->data.or.xs = malloc(a->data.or.n * sizeof(mpc_parser_t*));
-      for (i = 0; i < a->data.or.n; i++) {
-        p->data.or.xs[i] = mpc_copy(a->data.or.xs[i]);
-      }
-    break;
-    case MPC_TYPE_AND:
-      p->data.and.xs = malloc(a->data.and.n * sizeof(mpc_parser_t*));
-      for (i = 0; i < a->data.and.n; i++) {
-        p->data.and.xs[i] = mpc_copy(a->data.and.xs[i]);
-      }
-      p->data.and.dxs = malloc((a->data.and.n-1) * sizeof(mpc_dtor_t));
-      for (i = 0; i < a->data.and.n-1; i++) {
-        p->data.and.dxs[i] = a->data.and.dxs[i];
-      }
-    break;
-
-    case MPC_TYPE_CHECK:
-      p->data.check.x      = mpc_copy(a->data.check.x);
-      p->data.check.e      = malloc(strlen(a->data.check.e)+1);
-      strcpy(p->data.check.e, a->data.check.e);
-      break;
-    case MPC_TYPE_CHECK_WITH:
-      p->data.check_with.x = mpc_copy(a->data.check_with.x);
-      p->data.check_with.e = malloc(strlen(a->data.check_with.e)+1);
-      strcpy(p->data.check_with.e, a->data.check_with.e);
-      break;
-
-    default: break;
-  }
-
-
-  return p;
-}
-
-mpc_parser_t *mpc_undefine(mpc_parser_t *p) {
-  mpc_undefine_unretained(p, 1);
-  p->type = MPC_TYPE_UNDEFINED;
-  return p;
-}
-
-mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a) {
-
-  if (p->retained) {
-    p->type = a->type;
-    p->data = a->data;
-  } else {
-    mpc_parser_t *a2 = mpc_failf("Attempt to assign to Unretained Parser!");
-    p->type = a2->type;
-    p->data = a2->data;
-    free(a2);
-  }
-
-  free(a);
-  return p;
-}
-
-void mpc_cleanup(int n, ...) {
-  int i;
-  mpc_parser_t **list = malloc(sizeof(mpc_parser_t*) * n);
-
-  va_list va;
-  va_start(va, n);
-  for (i = 0; i < n; i++) { list[i] = va_arg(va, mpc_parser_t*); }
-  for (i = 0; i < n; i++) { mpc_undefine(list[i]); }
-  for (i = 0; i < n; i++) { mpc_delete(list[i]); }
-  va_end(va);
-
-  free(list);
-}
-
-mpc_parser_t *mpc_pass(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_PASS;
-  return p;
-}
-
-mpc_parser_t *mpc_fail(const char *m) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_FAIL;
-  p->data.fail.m = malloc(strlen(m) + 1);
-  strcpy(p->data.fail.m, m);
-  return p;
-}
-
-/*
-** As `snprintf` is not ANSI standard this
-** function `mpc_failf` should be considered
-** unsafe.
-**
-** You have a few options if this is going to be
-** trouble.
-**
-** - Ensure the format string does not exceed
-**   the buffer length using precision specifiers
-**   such as `%.512s`.
-**
-** - Patch this function in your code base to
-**   use `snprintf` or whatever variant your
-**   system supports.
-**
-** - Avoid it altogether.
-**
-*/
-
-mpc_parser_t *mpc_failf(const char *fmt, ...) {
-
-  va_list va;
-  char *buffer;
-
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_FAIL;
-
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-
-  buffer = realloc(buffer, strlen(buffer) + 1);
-  p->data.fail.m = buffer;
-  return p;
-
-}
-
-mpc_parser_t *mpc_lift_val(mpc_val_t *x) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_LIFT_VAL;
-  p->data.lift.x = x;
-  return p;
-}
-
-mpc_parser_t *mpc_lift(mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_LIFT;
-  p->data.lift.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_anchor(int(*f)(char,char)) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ANCHOR;
-  p->data.anchor.f = f;
-  return mpc_expect(p, "anchor");
-}
-
-mpc_parser_t *mpc_state(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_STATE;
-  return p;
-}
-
-mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *expected) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_EXPECT;
-  p->data.expect.x = a;
-  p->data.expect.m = malloc(strlen(expected) + 1);
-  strcpy(p->data.expect.m, expected);
-  return p;
-}
-
-/*
-** As `snprintf` is not ANSI standard this
-** function `mpc_expectf` should be considered
-** unsafe.
-**
-** You have a few options if this is going to be
-** trouble.
-**
-** - Ensure the format string does not exceed
-**   the buffer length using precision specifiers
-**   such as `%.512s`.
-**
-** - Patch this function in your code base to
-**   use `snprintf` or whatever variant your
-**   system supports.
-**
-** - Avoid it altogether.
-**
-*/
-
-mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...) {
-  va_list va;
-  char *buffer;
-
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_EXPECT;
-
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-
-  buffer = realloc(buffer, strlen(buffer) + 1);
-  p->data.expect.x = a;
-  p->data.expect.m = buffer;
-  return p;
-}
-
-/*
-** Basic Parsers
-*/
-
-mpc_parser_t *mpc_any(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ANY;
-  return mpc_expect(p, "any character");
-}
-
-mpc_parser_t *mpc_char(char c) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_SINGLE;
-  p->data.single.x = c;
-  return mpc_expectf(p, "'%c'", c);
-}
-
-mpc_parser_t *mpc_range(char s, char e) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_RANGE;
-  p->data.range.x = s;
-  p->data.range.y = e;
-  return mpc_expectf(p, "character between '%c' and '%c'", s, e);
-}
-
-mpc_parser_t *mpc_oneof(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ONEOF;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "one of '%s'", s);
-}
-
-mpc_parser_t *mpc_noneof(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_NONEOF;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "none of '%s'", s);
-
-}
-
-mpc_parser_t *mpc_satisfy(int(*f)(char)) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_SATISFY;
-  p->data.satisfy.f = f;
-  return mpc_expectf(p, "character satisfying function %p", f);
-}
-
-mpc_parser_t *mpc_string(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_STRING;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "\"%s\"", s);
-}
-
-/*
-** Core Parsers
-*/
-
-mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_APPLY;
-  p->data.apply.x = a;
-  p->data.apply.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_APPLY_TO;
-  p->data.apply_to.x = a;
-  p->data.apply_to.f = f;
-  p->data.apply_to.d = x;
-  return p;
-}
-
-mpc_parser_t *mpc_check(mpc_parser_t *a, mpc_dtor_t da, mpc_check_t f, const char *e) {
-  mpc_parser_t  *p = mpc_undefined();
-  p->type = MPC_TYPE_CHECK;
-  p->data.check.x = a;
-  p->data.check.dx = da;
-  p->data.check.f = f;
-  p->data.check.e = malloc(strlen(e) + 1);
-  strcpy(p->data.check.e, e);
-  return p;
-}
-
-mpc_parser_t *mpc_check_with(mpc_parser_t *a, mpc_dtor_t da, mpc_check_with_t f, void *x, const char *e) {
-  mpc_parser_t  *p = mpc_undefined();
-  p->type = MPC_TYPE_CHECK_WITH;
-  p->data.check_with.x = a;
-  p->data.check_with.dx = da;
-  p->data.check_with.f = f;
-  p->data.check_with.d = x;
-  p->data.check_with.e = malloc(strlen(e) + 1);
-  strcpy(p->data.check_with.e, e);
-  return p;
-}
-
-mpc_parser_t *mpc_checkf(mpc_parser_t *a, mpc_dtor_t da, mpc_check_t f, const char *fmt, ...) {
-  va_list va;
-  char *buffer;
-  mpc_parser_t *p;
-
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-
-  p = mpc_check(a, da, f, buffer);
-  free(buffer);
-
-  return p;
-}
-
-mpc_parser_t *mpc_check_withf(mpc_parser_t *a, mpc_dtor_t da, mpc_check_with_t f, void *x, const char *fmt, ...) {
-  va_list va;
-  char *buffer;
-  mpc_parser_t *p;
-
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-
-  p = mpc_check_with(a, da, f, x, buffer);
-  free(buffer);
-
-  return p;
-}
-
-mpc_parser_t *mpc_predictive(mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_PREDICT;
-  p->data.predict.x = a;
-  return p;
-}
-
-mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_NOT;
-  p->data.not.x = a;
-  p->data.not.dx = da;
-  p->data.not.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da) {
-  return mpc_not_lift(a, da, mpcf_ctor_null);
-}
-
-mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MAYBE;
-  p->data.not.x = a;
-  p->data.not.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_maybe(mpc_parser_t *a) {
-  return mpc_maybe_lift(a, mpcf_ctor_null);
-}
-
-mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MANY;
-  p->data.repeat.x = a;
-  p->data.repeat.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MANY1;
-  p->data.repeat.x = a;
-  p->data.repeat.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_COUNT;
-  p->data.repeat.n = n;
-  p->data.repeat.f = f;
-  p->data.repeat.x = a;
-  p->data.repeat.dx = da;
-  return p;
-}
-
-mpc_parser_t *mpc_or(int n, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-
-  p->type = MPC_TYPE_OR;
-  p->data.or.n = n;
-  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
-
-  va_start(va, n);
-  for (i = 0; i < n; i++) {
-    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  va_end(va);
-
-  return p;
-}
-
-mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-
-  p->type = MPC_TYPE_AND;
-  p->data.and.n = n;
-  p->data.and.f = f;
-  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
-  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
-
-  va_start(va, f);
-  for (i = 0; i < n; i++) {
-    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  for (i = 0; i < (n-1); i++) {
-    p->data.and.dxs[i] = va_arg(va, mpc_dtor_t);
-  }
-  va_end(va);
-
-  return p;
-}
-
-/*
-** Common Parsers
-*/
-
-mpc_parser_t *mpc_soi(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_SOI;
-  return mpc_expect(p, "start of input");
-}
-
-mpc_parser_t *mpc_eoi(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_EOI;
-  return mpc_expect(p, "end of input");
-}
-
-static int mpc_boundary_anchor(char prev, char next) {
-  const char* word = "abcdefghijklmnopqrstuvwxyz"
-                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                     "0123456789_";
-  if ( strchr(word, next) &&  prev == '\0') { return 1; }
-  if ( strchr(word, prev) &&  next == '\0') { return 1; }
-  if ( strchr(word, next) && !strchr(word, prev)) { return 1; }
-  if (!strchr(word, next) &&  strchr(word, prev)) { return 1; }
-  return 0;
-}
-
-static int mpc_boundary_newline_anchor(char prev, char next) {
-  (void)next;
-  return prev == '\n';
-}
-
-mpc_parser_t *mpc_boundary(void) { return mpc_expect(mpc_anchor(mpc_boundary_anchor), "word boundary"); }
-mpc_parser_t *mpc_boundary_newline(void) { return mpc_expect(mpc_anchor(mpc_boundary_newline_anchor), "start of newline"); }
-
-mpc_parser_t *mpc_whitespace(void) { return mpc_expect(mpc_oneof(" \f\n\r\t\v"), "whitespace"); }
-mpc_parser_t *mpc_whitespaces(void) { return mpc_expect(mpc_many(mpcf_strfold, mpc_whitespace()), "spaces"); }
-mpc_parser_t *mpc_blank(void) { return mpc_expect(mpc_apply(mpc_whitespaces(), mpcf_free), "whitespace"); }
-
-mpc_parser_t *mpc_newline(void) { return mpc_expect(mpc_char('\n'), "newline"); }
-mpc_parser_t *mpc_tab(void) { return mpc_expect(mpc_char('\t'), "tab"); }
-mpc_parser_t *mpc_escape(void) { return mpc_and(2, mpcf_strfold, mpc_char('\\'), mpc_any(), free); }
-
-mpc_parser_t *mpc_digit(void) { return mpc_expect(mpc_oneof("0123456789"), "digit"); }
-mpc_parser_t *mpc_hexdigit(void) { return mpc_expect(mpc_oneof("0123456789ABCDEFabcdef"), "hex digit"); }
-mpc_parser_t *mpc_octdigit(void) { return mpc_expect(mpc_oneof("01234567"), "oct digit"); }
-mpc_parser_t *mpc_digits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_digit()), "digits"); }
-mpc_parser_t *mpc_hexdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_hexdigit()), "hex digits"); }
-mpc_parser_t *mpc_octdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_octdigit()), "oct digits"); }
-
-mpc_parser_t *mpc_lower(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyz"), "lowercase letter"); }
-mpc_parser_t *mpc_upper(void) { return mpc_expect(mpc_oneof("ABCDEFGHIJKLMNOPQRSTUVWXYZ"), "uppercase letter"); }
-mpc_parser_t *mpc_alpha(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"), "letter"); }
-mpc_parser_t *mpc_underscore(void) { return mpc_expect(mpc_char('_'), "underscore"); }
-mpc_parser_t *mpc_alphanum(void) { return mpc_expect(mpc_or(3, mpc_alpha(), mpc_digit(), mpc_underscore()), "alphanumeric"); }
-
-mpc_parser_t *mpc_int(void) { return mpc_expect(mpc_apply(mpc_digits(), mpcf_int), "integer"); }
-mpc_parser_t *mpc_hex(void) { return mpc_expect(mpc_apply(mpc_hexdigits(), mpcf_hex), "hexadecimal"); }
-mpc_parser_t *mpc_oct(void) { return mpc_expect(mpc_apply(mpc_octdigits(), mpcf_oct), "octadecimal"); }
-mpc_parser_t *mpc_number(void) { return mpc_expect(mpc_or(3, mpc_int(), mpc_hex(), mpc_oct()), "number"); }
-
-mpc_parser_t *mpc_real(void) {
-
-  /* [+-]?\d+(\.\d+)?([eE][+-]?[0-9]+)? */
-
-  mpc_parser_t *p0, *p1, *p2, *p30, *p31, *p32, *p3;
-
-  p0 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
-  p1 = mpc_digits();
-  p2 = mpc_maybe_lift(mpc_and(2, mpcf_strfold, mpc_char('.'), mpc_digits(), free), mpcf_ctor_str);
-  p30 = mpc_oneof("eE");
-  p31 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
-  p32 = mpc_digits();
-  p3 = mpc_maybe_lift(mpc_and(3, mpcf_strfold, p30, p31, p32, free, free), mpcf_ctor_str);
-
-  return mpc_expect(mpc_and(4, mpcf_strfold, p0, p1, p2, p3, free, free, free), "real");
-
-}
-
-mpc_parser_t *mpc_float(void) {
-  return mpc_expect(mpc_apply(mpc_real(), mpcf_float), "float");
-}
-
-mpc_parser_t *mpc_char_lit(void) {
-  return mpc_expect(mpc_between(mpc_or(2, mpc_escape(), mpc_any()), free, "'", "'"), "char");
-}
-
-mpc_parser_t *mpc_string_lit(void) {
-  mpc_parser_t *strchar = mpc_or(2, mpc_escape(), mpc_noneof("\""));
-  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, strchar), free, "\"", "\""), "string");
-}
-
-mpc_parser_t *mpc_regex_lit(void) {
-  mpc_parser_t *regexchar = mpc_or(2, mpc_escape(), mpc_noneof("/"));
-  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, regexchar), free, "/", "/"), "regex");
-}
-
-mpc_parser_t *mpc_ident(void) {
-  mpc_parser_t *p0, *p1;
-  p0 = mpc_or(2, mpc_alpha(), mpc_underscore());
-  p1 = mpc_many(mpcf_strfold, mpc_alphanum());
-  return mpc_and(2, mpcf_strfold, p0, p1, free);
-}
-
-/*
-** Useful Parsers
-*/
-
-mpc_parser_t *mpc_startwith(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_soi(), a, mpcf_dtor_null); }
-mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(2, mpcf_fst, a, mpc_eoi(), da); }
-mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(3, mpcf_snd, mpc_soi(), a, mpc_eoi(), mpcf_dtor_null, da); }
-
-mpc_parser_t *mpc_stripl(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_blank(), a, mpcf_dtor_null); }
-mpc_parser_t *mpc_stripr(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
-mpc_parser_t *mpc_strip(mpc_parser_t *a) { return mpc_and(3, mpcf_snd, mpc_blank(), a, mpc_blank(), mpcf_dtor_null, mpcf_dtor_null); }
-mpc_parser_t *mpc_tok(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
-mpc_parser_t *mpc_sym(const char *s) { return mpc_tok(mpc_string(s)); }
-
-mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da) { return mpc_whole(mpc_strip(a), da); }
-
-mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
-  return mpc_and(3, mpcf_snd_free,
-    mpc_string(o), a, mpc_string(c),
-    free, ad);
-}
-
-mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "(", ")"); }
-mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "<", ">"); }
-mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_between(a, ad, "{", "}"); }
-mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_between(a, ad, "[", "]"); }
-
-mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
-  return mpc_and(3, mpcf_snd_free,
-    mpc_sym(o), mpc_tok(a), mpc_sym(c),
-    free, ad);
-}
-
-mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "(", ")"); }
-mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "<", ">"); }
-mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_tok_between(a, ad, "{", "}"); }
-mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_tok_between(a, ad, "[", "]"); }
-
-/*
-** Regular Expression Parsers
-*/
-
-/*
-** So here is a cute bootstrapping.
-**
-** I'm using the previously defined
-** mpc constructs and functions to
-** parse the user regex string and
-** construct a parser from it.
-**
-** As it turns out lots of the standard
-** mpc functions look a lot like `fold`
-** functions and so can be used indirectly
-** by many of the parsing functions to build
-** a parser directly - as we are parsing.
-**
-** This is certainly something that
-** would be less elegant/interesting
-** in a two-phase parser which first
-** builds an AST and then traverses it
-** to generate the object.
-**
-** This whole thing acts as a great
-** case study for how trivial it can be
-** to write a great parser in a few
-** lines of code using mpc.
-*/
-
-/*
-**
-**  ### Regular Expression Grammar
-**
-**      <regex> : <term> | (<term> "|" <regex>)
-**
-**      <term> : <factor>*
-**
-**      <factor> : <base>
-**               | <base> "*"
-**               | <base> "+"
-**               | <base> "?"
-**               | <base> "{" <digits> "}"
-**
-**      <base> : <char>
-**             | "\" <char>
-**             | "(" <regex> ")"
-**             | "[" <range> "]"
-*/
-
-static mpc_val_t *mpcf_re_or(int n, mpc_val_t **xs) {
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  else { return mpc_or(2, xs[0], xs[1]); }
-}
-
-static mpc_val_t *mpcf_re_and(int n, mpc_val_t **xs) {
-  int i;
-  mpc_parser_t *p = mpc_lift(mpcf_ctor_str);
-  for (i = 0; i < n; i++) {
-    p = mpc_and(2, mpcf_strfold, p, xs[i], free);
-  }
-  return p;
-}
-
-static mpc_val_t *mpcf_re_repeat(int n, mpc_val_t **xs) {
-  int num;
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { free(xs[1]); return mpc_many(mpcf_strfold, xs[0]); }; break;
-    case '+': { free(xs[1]); return mpc_many1(mpcf_strfold, xs[0]); }; break;
-    case '?': { free(xs[1]); return mpc_maybe_lift(xs[0], mpcf_ctor_str); }; break;
-    default:
-      num = *(int*)xs[1];
-      free(xs[1]);
-  }
-
-  return mpc_count(num, mpcf_strfold, xs[0], free);
-}
-
-static mpc_parser_t *mpc_re_escape_char(char c) {
-  switch (c) {
-    case 'a': return mpc_char('\a');
-    case 'f': return mpc_char('\f');
-    case 'n': return mpc_char('\n');
-    case 'r': return mpc_char('\r');
-    case 't': return mpc_char('\t');
-    case 'v': return mpc_char('\v');
-    case 'b': return mpc_and(2, mpcf_snd, mpc_boundary(), mpc_lift(mpcf_ctor_str), free);
-    case 'B': return mpc_not_lift(mpc_boundary(), free, mpcf_ctor_str);
-    case 'A': return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
-    case 'Z': return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free);
-    case 'd': return mpc_digit();
-    case 'D': return mpc_not_lift(mpc_digit(), free, mpcf_ctor_str);
-    case 's': return mpc_whitespace();
-    case 'S': return mpc_not_lift(mpc_whitespace(), free, mpcf_ctor_str);
-    case 'w': return mpc_alphanum();
-    case 'W': return mpc_not_lift(mpc_alphanum(), free, mpcf_ctor_str);
-    default: return NULL;
-  }
-}
-
-static mpc_val_t *mpcf_re_escape(mpc_val_t *x, void* data) {
-
-  int mode = *((int*)data);
-  char *s = x;
-  mpc_parser_t *p;
-
-  /* Any Character */
-  if (s[0] == '.') {
-    free(s);
-    if (mode & MPC_RE_DOTALL) {
-      return mpc_any();
-    } else {
-      return mpc_expect(mpc_noneof("\n"), "any character except a newline");
-    }
-  }
-
-  /* Start of Input */
-  if (s[0] == '^') {
-    free(s);
-    if (mode & MPC_RE_MULTILINE) {
-      return mpc_and(2, mpcf_snd, mpc_or(2, mpc_soi(), mpc_boundary_newline()), mpc_lift(mpcf_ctor_str), free);
-    } else {
-      return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
-    }
-  }
-
-  /* End of Input */
-  if (s[0] == '$') {
-    free(s);
-    if (mode & MPC_RE_MULTILINE) {
-      return mpc_or(2,
-        mpc_newline(),
-        mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free));
-    } else {
-      return mpc_or(2,
-        mpc_and(2, mpcf_fst, mpc_newline(), mpc_eoi(), free),
-        mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free));
-    }
-  }
-
-  /* Regex Escape */
-  if (s[0] == '\\') {
-    p = mpc_re_escape_char(s[1]);
-    p = (p == NULL) ? mpc_char(s[1]) : p;
-    free(s);
-    return p;
-  }
-
-  /* Regex Standard */
-  p = mpc_char(s[0]);
-  free(s);
-  return p;
-}
-
-static const char *mpc_re_range_escape_char(char c) {
-  switch (c) {
-    case '-': return "-";
-    case 'a': return "\a";
-    case 'f': return "\f";
-    case 'n': return "\n";
-    case 'r': return "\r";
-    case 't': return "\t";
-    case 'v': return "\v";
-    case 'b': return "\b";
-    case 'd': return "0123456789";
-    case 's': return " \f\n\r\t\v";
-    case 'w': return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
-    default: return NULL;
-  }
-}
-
-static mpc_val_t *mpcf_re_range(mpc_val_t *x) {
-
-  mpc_parser_t *out;
-  size_t i, j;
-  size_t start, end;
-  const char *tmp = NULL;
-  const char *s = x;
-  int comp = s[0] == '^' ? 1 : 0;
-  char *range = calloc(1,1);
-
-  if (s[0] == '\0') { free(range); free(x); return mpc_fail("Invalid Regex Range Expression"); }
-  if (s[0] == '^' &&
-      s[1] == '\0') { free(range); free(x); return mpc_fail("Invalid Regex Range Expression"); }
-
-  for (i = comp; i < strlen(s); i++){
-
-    /* Regex Range Escape */
-    if (s[i] == '\\') {
-      tmp = mpc_re_range_escape_char(s[i+1]);
-      if (tmp != NULL) {
-        range = realloc(range, strlen(range) + strlen(tmp) + 1);
-        strcat(range, tmp);
-      } else {
-        range = realloc(range, strlen(range) + 1 + 1);
-        range[strlen(range) + 1] = '\0';
-        range[strlen(range) + 0] = s[i+1];
-      }
-      i++;
-    }
-
-    /* Regex Range...Range */
-    else if (s[i] == '-') {
-      if (s[i+1] == '\0' || i == 0) {
-          range = realloc(range, strlen(range) + strlen("-") + 1);
-          strcat(range, "-");
-      } else {
-        start = s[i-1]+1;
-        end = s[i+1]-1;
-        for (j = start; j <= end; j++) {
-          range = realloc(range, strlen(range) + 1 + 1 + 1);
-          range[strlen(range) + 1] = '\0';
-          range[strlen(range) + 0] = (char)j;
-        }
-      }
-    }
-
-    /* Regex Range Normal */
-    else {
-      range = realloc(range, strlen(range) + 1 + 1);
-      range[strlen(range) + 1] = '\0';
-      range[strlen(range) + 0] = s[i];
-    }
-
-  }
-
-  out = comp == 1 ? mpc_noneof(range) : mpc_oneof(range);
-
-  free(x);
-  free(range);
-
-  return out;
-}
-
-mpc_parser_t *mpc_re(const char *re) {
-  return mpc_re_mode(re, MPC_RE_DEFAULT);
-}
-
-mpc_parser_t *mpc_re_mode(const char *re, int mode) {
-
-  char *err_msg;
-  mpc_parser_t *err_out;
-  mpc_result_t r;
-  mpc_parser_t *Regex, *Term, *Factor, *Base, *Range, *RegexEnclose;
-
-  Regex  = mpc_new("regex");
-  Term   = mpc_new("term");
-  Factor = mpc_new("factor");
-  Base   = mpc_new("base");
-  Range  = mpc_new("range");
-
-  mpc_define(Regex, mpc_and(2, mpcf_re_or,
-    Term,
-    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_char('|'), Regex, free)),
-    (mpc_dtor_t)mpc_delete
-  ));
-
-  mpc_define(Term, mpc_many(mpcf_re_and, Factor));
-
-  mpc_define(Factor, mpc_and(2, mpcf_re_repeat,
-    Base,
-    mpc_or(5,
-      mpc_char('*'), mpc_char('+'), mpc_char('?'),
-      mpc_brackets(mpc_int(), free),
-      mpc_pass()),
-    (mpc_dtor_t)mpc_delete
-  ));
-
-  mpc_define(Base, mpc_or(4,
-    mpc_parens(Regex, (mpc_dtor_t)mpc_delete),
-    mpc_squares(Range, (mpc_dtor_t)mpc_delete),
-    mpc_apply_to(mpc_escape(), mpcf_re_escape, &mode),
-    mpc_apply_to(mpc_noneof(")|"), mpcf_re_escape, &mode)
-  ));
-
-  mpc_define(Range, mpc_apply(
-    mpc_many(mpcf_strfold, mpc_or(2, mpc_escape(), mpc_noneof("]"))),
-    mpcf_re_range
-  ));
-
-  RegexEnclose = mpc_whole(mpc_predictive(Regex), (mpc_dtor_t)mpc_delete);
-
-  mpc_optimise(RegexEnclose);
-  mpc_optimise(Regex);
-  mpc_optimise(Term);
-  mpc_optimise(Factor);
-  mpc_optimise(Base);
-  mpc_optimise(Range);
-
-  if(!mpc_parse("<mpc_re_compiler>", re, RegexEnclose, &r)) {
-    err_msg = mpc_err_string(r.error);
-    err_out = mpc_failf("Invalid Regex: %s", err_msg);
-    mpc_err_delete(r.error);
-    free(err_msg);
-    r.output = err_out;
-  }
-
-  mpc_cleanup(6, RegexEnclose, Regex, Term, Factor, Base, Range);
-
-  mpc_optimise(r.output);
-
-  return r.output;
-
-}
-
-/*
-** Common Fold Functions
-*/
-
-void mpcf_dtor_null(mpc_val_t *x) { (void) x; return; }
-
-mpc_val_t *mpcf_ctor_null(void) { return NULL; }
-mpc_val_t *mpcf_ctor_str(void) { return calloc(1, 1); }
-mpc_val_t *mpcf_free(mpc_val_t *x) { free(x); return NULL; }
-
-mpc_val_t *mpcf_int(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 10);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_hex(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 16);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_oct(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 8);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_float(mpc_val_t *x) {
-  float *y = malloc(sizeof(float));
-  *y = strtod(x, NULL);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_strtriml(mpc_val_t *x) {
-  char *s = x;
-  while (isspace((unsigned char)*s)) {
-    memmove(s, s+1, strlen(s));
-  }
-  return s;
-}
-
-mpc_val_t *mpcf_strtrimr(mpc_val_t *x) {
-  char *s = x;
-  size_t l = strlen(s);
-  while (l > 0 && isspace((unsigned char)s[l-1])) {
-    s[l-1] = '\0'; l--;
-  }
-  return s;
-}
-
-mpc_val_t *mpcf_strtrim(mpc_val_t *x) {
-  return mpcf_strtriml(mpcf_strtrimr(x));
-}
-
-static const char mpc_escape_input_c[]  = {
-  '\a', '\b', '\f', '\n', '\r',
-  '\t', '\v', '\\', '\'', '\"', '\0'};
-
-static const char *mpc_escape_output_c[] = {
-  "\\a", "\\b", "\\f", "\\n", "\\r", "\\t",
-  "\\v", "\\\\", "\\'", "\\\"", "\\0", NULL};
-
-static const char mpc_escape_input_raw_re[] = { '/' };
-static const char *mpc_escape_output_raw_re[] = { "\\/", NULL };
-
-static const char mpc_escape_input_raw_cstr[] = { '"' };
-static const char *mpc_escape_output_raw_cstr[] = { "\\\"", NULL };
-
-static const char mpc_escape_input_raw_cchar[] = { '\'' };
-static const char *mpc_escape_output_raw_cchar[] = { "\\'", NULL };
-
-static mpc_val_t *mpcf_escape_new(mpc_val_t *x, const char *input, const char **output) {
-
-  int i;
-  int found;
-  char buff[2];
-  char *s = x;
-  char *y = calloc(1, 1);
-
-  while (*s) {
-
-    i = 0;
-    found = 0;
-
-    while (output[i]) {
-      if (*s == input[i]) {
-        y = realloc(y, strlen(y) + strlen(output[i]) + 1);
-        strcat(y, output[i]);
-        found = 1;
-        break;
-      }
-      i++;
-    }
-
-    if (!found) {
-      y = realloc(y, strlen(y) + 2);
-      buff[0] = *s; buff[1] = '\0';
-      strcat(y, buff);
-    }
-
-    s++;
-  }
-
-
-  return y;
-}
-
-static mpc_val_t *mpcf_unescape_new(mpc_val_t *x, const char *input, const char **output) {
-
-  int i;
-  int found = 0;
-  char buff[2];
-  char *s = x;
-  char *y = calloc(1, 1);
-
-  while (*s) {
-
-    i = 0;
-    found = 0;
-
-    while (output[i]) {
-      if ((*(s+0)) == output[i][0] &&
-          (*(s+1)) == output[i][1]) {
-        y = realloc(y, strlen(y) + 1 + 1);
-        buff[0] = input[i]; buff[1] = '\0';
-        strcat(y, buff);
-        found = 1;
-        s++;
-        break;
-      }
-      i++;
-    }
-
-    if (!found) {
-      y = realloc(y, strlen(y) + 1 + 1);
-      buff[0] = *s; buff[1] = '\0';
-      strcat(y, buff);
-    }
-
-    if (*s == '\0') { break; }
-    else { s++; }
-  }
-
-  return y;
-
-}
-
-mpc_val_t *mpcf_escape(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_c, mpc_escape_output_c);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_c, mpc_escape_output_c);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_escape_regex(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape_regex(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_null(int n, mpc_val_t** xs) { (void) n; (void) xs; return NULL; }
-mpc_val_t *mpcf_fst(int n, mpc_val_t **xs) { (void) n; return xs[0]; }
-mpc_val_t *mpcf_snd(int n, mpc_val_t **xs) { (void) n; return xs[1]; }
-mpc_val_t *mpcf_trd(int n, mpc_val_t **xs) { (void) n; return xs[2]; }
-
-static mpc_val_t *mpcf_nth_free(int n, mpc_val_t **xs, int x) {
-  int i;
-  for (i = 0; i < n; i++) {
-    if (i != x) { free(xs[i]); }
-  }
-  return xs[x];
-}
-
-mpc_val_t *mpcf_fst_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 0); }
-mpc_val_t *mpcf_snd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 1); }
-mpc_val_t *mpcf_trd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 2); }
-
-mpc_val_t *mpcf_freefold(int n, mpc_val_t **xs) {
-  int i;
-  for (i = 0; i < n; i++) {
-    free(xs[i]);
-  }
-  return NULL;
-}
-
-mpc_val_t *mpcf_strfold(int n, mpc_val_t **xs) {
-  int i;
-  size_t l = 0;
-
-  if (n == 0) { return calloc(1, 1); }
-
-  for (i = 0; i < n; i++) { l += strlen(xs[i]); }
-
-  xs[0] = realloc(xs[0], l + 1);
-
-  for (i = 1; i < n; i++) {
-    strcat(xs[0], xs[i]); free(xs[i]);
-  }
-
-  return xs[0];
-}
-
-mpc_val_t *mpcf_maths(int n, mpc_val_t **xs) {
-  int **vs = (int**)xs;
-  (void) n;
-
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { *vs[0] *= *vs[2]; }; break;
-    case '/': { *vs[0] /= *vs[2]; }; break;
-    case '%': { *vs[0] %= *vs[2]; }; break;
-    case '+': { *vs[0] += *vs[2]; }; break;
-    case '-': { *vs[0] -= *vs[2]; }; break;
-    default: break;
-  }
-
-  free(xs[1]); free(xs[2]);
-
-  return xs[0];
-}
-
-/*
-** Printing
-*/
-
-static void mpc_print_unretained(mpc_parser_t *p, int force) {
-
-  /* TODO: Print Everything Escaped */
-
-  int i;
-  char *s, *e;
-  char buff[2];
-
-  if (p->retained && !force) {;
-    if (p->name) { printf("<%s>", p->name); }
-    else { printf("<anon>"); }
-    return;
-  }
-
-  if (p->type == MPC_TYPE_UNDEFINED) { printf("<?>"); }
-  if (p->type == MPC_TYPE_PASS)   { printf("<:>"); }
-  if (p->type == MPC_TYPE_FAIL)   { printf("<!>"); }
-  if (p->type == MPC_TYPE_LIFT)   { printf("<#>"); }
-  if (p->type == MPC_TYPE_STATE)  { printf("<S>"); }
-  if (p->type == MPC_TYPE_ANCHOR) { printf("<@>"); }
-  if (p->type == MPC_TYPE_EXPECT) {
-    printf("%s", p->data.expect.m);
-    /*mpc_print_unretained(p->data.expect.x, 0);*/
-  }
-
-  if (p->type == MPC_TYPE_ANY) { printf("<.>"); }
-  if (p->type == MPC_TYPE_SATISFY) { printf("<f>"); }
-
-  if (p->type == MPC_TYPE_SINGLE) {
-    buff[0] = p->data.single.x; buff[1] = '\0';
-    s = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("'%s'", s);
-    free(s);
-  }
-
-  if (p->type == MPC_TYPE_RANGE) {
-    buff[0] = p->data.range.x; buff[1] = '\0';
-    s = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    buff[0] = p->data.range.y; buff[1] = '\0';
-    e = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[%s-%s]", s, e);
-    free(s);
-    free(e);
-  }
-
-  if (p->type == MPC_TYPE_ONEOF) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[%s]", s);
-    free(s);
-  }
-
-  if (p->type == MPC_TYPE_NONEOF) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[^%s]", s);
-    free(s);
-  }
-
-  if (p->type == MPC_TYPE_STRING) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("\"%s\"", s);
-    free(s);
-  }
-
-  if (p->type == MPC_TYPE_APPLY)    { mpc_print_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO) { mpc_print_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)  { mpc_print_unretained(p->data.predict.x, 0); }
-
-  if (p->type == MPC_TYPE_NOT)   { mpc_print_unretained(p->data.not.x, 0); printf("!"); }
-  if (p->type == MPC_TYPE_MAYBE) { mpc_print_unretained(p->data.not.x, 0); printf("?"); }
-
-  if (p->type == MPC_TYPE_MANY)  { mpc_print_unretained(p->data.repeat.x, 0); printf("*"); }
-  if (p->type == MPC_TYPE_MANY1) { mpc_print_unretained(p->data.repeat.x, 0); printf("+"); }
-  if (p->type == MPC_TYPE_COUNT) { mpc_print_unretained(p->data.repeat.x, 0); printf("{%i}", p->data.repeat.n); }
-
-  if (p->type == MPC_TYPE_OR) {
-    printf("(");
-    for(i = 0; i < p->data.or.n-1; i++) {
-      mpc_print_unretained(p->data.or.xs[i], 0);
-      printf(" | ");
-    }
-    mpc_print_unretained(p->data.or.xs[p->data.or.n-1], 0);
-    printf(")");
-  }
-
-  if (p->type == MPC_TYPE_AND) {
-    printf("(");
-    for(i = 0; i < p->data.and.n-1; i++) {
-      mpc_print_unretained(p->data.and.xs[i], 0);
-      printf(" ");
-    }
-    mpc_print_unretained(p->data.and.xs[p->data.and.n-1], 0);
-    printf(")");
-  }
-
-  if (p->type == MPC_TYPE_CHECK) {
-    mpc_print_unretained(p->data.check.x, 0);
-    printf("->?");
-  }
-  if (p->type == MPC_TYPE_CHECK_WITH) {
-    mpc_print_unretained(p->data.check_with.x, 0);
-    printf("->?");
-  }
-
-}
-
-void mpc_print(mpc_parser_t *p) {
-  mpc_print_unretained(p, 1);
-  printf("\n");
-}
-
-/*
-** Testing
-*/
-
-/*
-** These functions are slightly unwieldy and
-** also the whole of the testing suite for mpc
-** mpc is pretty shaky.
-**
-** It could do with a lot more tests and more
-** precision. Currently I am only really testing
-** changes off of the examples.
-**
-*/
-
-int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*),
-  mpc_dtor_t destructor,
-  void(*printer)(const void*)) {
-  mpc_result_t r;
-  (void) printer;
-  if (mpc_parse("<test>", s, p, &r)) {
-
-    if (tester(r.output, d)) {
-      destructor(r.output);
-      return 0;
-    } else {
-      destructor(r.output);
-      return 1;
-    }
-
-  } else {
-    mpc_err_delete(r.error);
-    return 1;
-  }
-
-}
-
-int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*),
-  mpc_dtor_t destructor,
-  void(*printer)(const void*)) {
-
-  mpc_result_t r;
-  if (mpc_parse("<test>", s, p, &r)) {
-
-    if (tester(r.output, d)) {
-      destructor(r.output);
-      return 1;
-    } else {
-      printf("Got "); printer(r.output); printf("\n");
-      printf("Expected "); printer(d); printf("\n");
-      destructor(r.output);
-      return 0;
-    }
-
-  } else {
-    mpc_err_print(r.error);
-    mpc_err_delete(r.error);
-    return 0;
-
-  }
-
-}
-
-
-/*
-** AST
-*/
-
-void mpc_ast_delete(mpc_ast_t *a) {
-
-  int i;
-
-  if (a == NULL) { return; }
-
-  for (i = 0; i < a->children_num; i++) {
-    mpc_ast_delete(a->children[i]);
-  }
-
-  free(a->children);
-  free(a->tag);
-  free(a->contents);
-  free(a);
-
-}
-
-static void mpc_ast_delete_no_children(mpc_ast_t *a) {
-  free(a->children);
-  free(a->tag);
-  free(a->contents);
-  free(a);
-}
-
-mpc_ast_t *mpc_ast_new(const char *tag, const char *contents) {
-
-  mpc_ast_t *a = malloc(sizeof(mpc_ast_t));
-
-  a->tag = malloc(strlen(tag) + 1);
-  strcpy(a->tag, tag);
-
-  a->contents = malloc(strlen(contents) + 1);
-  strcpy(a->contents, contents);
-
-  a->state = mpc_state_new();
-
-  a->children_num = 0;
-  a->children = NULL;
-  return a;
-
-}
-
-mpc_ast_t *mpc_ast_build(int n, const char *tag, ...) {
-
-  mpc_ast_t *a = mpc_ast_new(tag, "");
-
-  int i;
-  va_list va;
-  va_start(va, tag);
-
-  for (i = 0; i < n; i++) {
-    mpc_ast_add_child(a, va_arg(va, mpc_ast_t*));
-  }
-
-  va_end(va);
-
-  return a;
-
-}
-
-mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a) {
-
-  mpc_ast_t *r;
-
-  if (a == NULL) { return a; }
-  if (a->children_num == 0) { return a; }
-  if (a->children_num == 1) { return a; }
-
-  r = mpc_ast_new(">", "");
-  mpc_ast_add_child(r, a);
-  return r;
-}
-
-int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b) {
-
-  int i;
-
-  if (strcmp(a->tag, b->tag) != 0) { return 0; }
-  if (strcmp(a->contents, b->contents) != 0) { return 0; }
-  if (a->children_num != b->children_num) { return 0; }
-
-  for (i = 0; i < a->children_num; i++) {
-    if (!mpc_ast_eq(a->children[i], b->children[i])) { return 0; }
-  }
-
-  return 1;
-}
-
-mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a) {
-  r->children_num++;
-  r->children = realloc(r->children, sizeof(mpc_ast_t*) * r->children_num);
-  r->children[r->children_num-1] = a;
-  return r;
-}
-
-mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t) {
-  if (a == NULL) { return a; }
-  a->tag = realloc(a->tag, strlen(t) + 1 + strlen(a->tag) + 1);
-  memmove(a->tag + strlen(t) + 1, a->tag, strlen(a->tag)+1);
-  memmove(a->tag, t, strlen(t));
-  memmove(a->tag + strlen(t), "|", 1);
-  return a;
-}
-
-mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t) {
-  if (a == NULL) { return a; }
-  a->tag = realloc(a->tag, (strlen(t)-1) + strlen(a->tag) + 1);
-  memmove(a->tag + (strlen(t)-1), a->tag, strlen(a->tag)+1);
-  memmove(a->tag, t, (strlen(t)-1));
-  return a;
-}
-
-mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t) {
-  a->tag = realloc(a->tag, strlen(t) + 1);
-  strcpy(a->tag, t);
-  return a;
-}
-
-mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s) {
-  if (a == NULL) { return a; }
-  a->state = s;
-  return a;
-}
-
-static void mpc_ast_print_depth(mpc_ast_t *a, int d, FILE *fp) {
-
-  int i;
-
-  if (a == NULL) {
-    fprintf(fp, "NULL\n");
-    return;
-  }
-
-  for (i = 0; i < d; i++) { fprintf(fp, "  "); }
-
-  if (strlen(a->contents)) {
-    fprintf(fp, "%s:%lu:%lu '%s'\n", a->tag,
-      (long unsigned int)(a->state.row+1),
-      (long unsigned int)(a->state.col+1),
-      a->contents);
-  } else {
-    fprintf(fp, "%s \n", a->tag);
-  }
-
-  for (i = 0; i < a->children_num; i++) {
-    mpc_ast_print_depth(a->children[i], d+1, fp);
-  }
-
-}
-
-void mpc_ast_print(mpc_ast_t *a) {
-  mpc_ast_print_depth(a, 0, stdout);
-}
-
-void mpc_ast_print_to(mpc_ast_t *a, FILE *fp) {
-  mpc_ast_print_depth(a, 0, fp);
-}
-
-int mpc_ast_get_index(mpc_ast_t *ast, const char *tag) {
-  return mpc_ast_get_index_lb(ast, tag, 0);
-}
-
-int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb) {
-  int i;
-
-  for(i=lb; i<ast->children_num; i++) {
-    if(strcmp(ast->children[i]->tag, tag) == 0) {
-      return i;
-    }
-  }
-
-  return -1;
-}
-
-mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag) {
-  return mpc_ast_get_child_lb(ast, tag, 0);
-}
-
-mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb) {
-  int i;
-
-  for(i=lb; i<ast->children_num; i++) {
-    if(strcmp(ast->children[i]->tag, tag) == 0) {
-      return ast->children[i];
-    }
-  }
-
-  return NULL;
-}
-
-mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
-                                       mpc_ast_trav_order_t order)
-{
-  mpc_ast_trav_t *trav, *n_trav;
-  mpc_ast_t *cnode = ast;
-
-  /* Create the traversal structure */
-  trav = malloc(sizeof(mpc_ast_trav_t));
-  trav->curr_node = cnode;
-  trav->parent = NULL;
-  trav->curr_child = 0;
-  trav->order = order;
-
-  /* Get start node */
-  switch(order) {
-    case mpc_ast_trav_order_pre:
-      /* Nothing else is needed for pre order start */
-      break;
-
-    case mpc_ast_trav_order_post:
-      while(cnode->children_num > 0) {
-        cnode = cnode->children[0];
-
-        n_trav = malloc(sizeof(mpc_ast_trav_t));
-        n_trav->curr_node = cnode;
-        n_trav->parent = trav;
-        n_trav->curr_child = 0;
-        n_trav->order = order;
-
-        trav = n_trav;
-      }
-
-      break;
-
-    default:
-      /* Unreachable, but compiler complaints */
-      break;
-  }
-
-  return trav;
-}
-
-mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav) {
-  mpc_ast_trav_t *n_trav, *to_free;
-  mpc_ast_t *ret = NULL;
-  int cchild;
-
-  /* The end of traversal was reached */
-  if(*trav == NULL) return NULL;
-
-  switch((*trav)->order) {
-    case mpc_ast_trav_order_pre:
-      ret = (*trav)->curr_node;
-
-      /* If there aren't any more children, go up */
-      while(*trav != NULL &&
-        (*trav)->curr_child >= (*trav)->curr_node->children_num)
-      {
-        to_free = *trav;
-        *trav = (*trav)->parent;
-        free(to_free);
-      }
-
-      /* If trav is NULL, the end was reached */
-      if(*trav == NULL) {
-        break;
-      }
-
-      /* Go to next child */
-      n_trav = malloc(sizeof(mpc_ast_trav_t));
-
-      cchild = (*trav)->curr_child;
-      n_trav->curr_node = (*trav)->curr_node->children[cchild];
-      n_trav->parent = *trav;
-      n_trav->curr_child = 0;
-      n_trav->order = (*trav)->order;
-
-      (*trav)->curr_child++;
-      *trav = n_trav;
-
-      break;
-
-    case mpc_ast_trav_order_post:
-      ret = (*trav)->curr_node;
-
-      /* Move up tree to the parent If the parent doesn't have any more nodes,
-       * then this is the current node. If it does, move down to its left most
-       * child. Also, free the previous traversal node */
-      to_free = *trav;
-      *trav = (*trav)->parent;
-      free(to_free);
-
-      if(*trav == NULL)
-        break;
-
-      /* Next child */
-      (*trav)->curr_child++;
-
-      /* If there aren't any more children, this is the next node */
-      if((*trav)->curr_child >= (*trav)->curr_node->children_num) {
-        break;
-      }
-
-      /* If there are still more children, find the leftmost child from this
-       * node */
-      while((*trav)->curr_node->children_num > 0) {
-        n_trav = malloc(sizeof(mpc_ast_trav_t));
-
-        cchild = (*trav)->curr_child;
-        n_trav->curr_node = (*trav)->curr_node->children[cchild];
-        n_trav->parent = *trav;
-        n_trav->curr_child = 0;
-        n_trav->order = (*trav)->order;
-
-        *trav = n_trav;
-      }
-
-    default:
-      /* Unreachable, but compiler complaints */
-      break;
-  }
-
-  return ret;
-}
-
-void mpc_ast_traverse_free(mpc_ast_trav_t **trav) {
-  mpc_ast_trav_t *n_trav;
-
-  /* Go through parents until all are free */
-  while(*trav != NULL) {
-      n_trav = (*trav)->parent;
-      free(*trav);
-      *trav = n_trav;
-  }
-}
-
-mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **xs) {
-
-  int i, j;
-  mpc_ast_t** as = (mpc_ast_t**)xs;
-  mpc_ast_t *r;
-
-  if (n == 0) { return NULL; }
-  if (n == 1) { return xs[0]; }
-  if (n == 2 && xs[1] == NULL) { return xs[0]; }
-  if (n == 2 && xs[0] == NULL) { return xs[1]; }
-
-  r = mpc_ast_new(">", "");
-
-  for (i = 0; i < n; i++) {
-
-    if (as[i] == NULL) { continue; }
-
-    if        (as[i] && as[i]->children_num == 0) {
-      mpc_ast_add_child(r, as[i]);
-    } else if (as[i] && as[i]->children_num == 1) {
-      mpc_ast_add_child(r, mpc_ast_add_root_tag(as[i]->children[0], as[i]->tag));
-      mpc_ast_delete_no_children(as[i]);
-    } else if (as[i] && as[i]->children_num >= 2) {
-      for (j = 0; j < as[i]->children_num; j++) {
-        mpc_ast_add_child(r, as[i]->children[j]);
-      }
-      mpc_ast_delete_no_children(as[i]);
-    }
-
-  }
-
-  if (r->children_num) {
-    r->state = r->children[0]->state;
-  }
-
-  return r;
-}
-
-mpc_val_t *mpcf_str_ast(mpc_val_t *c) {
-  mpc_ast_t *a = mpc_ast_new("", c);
-  free(c);
-  return a;
-}
-
-mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs) {
-  mpc_state_t *s = ((mpc_state_t**)xs)[0];
-  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
-  (void)n;
-  a = mpc_ast_state(a, *s);
-  free(s);
-  return a;
-}
-
-mpc_parser_t *mpca_state(mpc_parser_t *a) {
-  return mpc_and(2, mpcf_state_ast, mpc_state(), a, free);
-}
-
-mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t) {
-  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_tag, (void*)t);
-}
-
-mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t) {
-  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_add_tag, (void*)t);
-}
-
-mpc_parser_t *mpca_root(mpc_parser_t *a) {
-  return mpc_apply(a, (mpc_apply_t)mpc_ast_add_root);
-}
-
-mpc_parser_t *mpca_not(mpc_parser_t *a) { return mpc_not(a, (mpc_dtor_t)mpc_ast_delete); }
-mpc_parser_t *mpca_maybe(mpc_parser_t *a) { return mpc_maybe(a); }
-mpc_parser_t *mpca_many(mpc_parser_t *a) { return mpc_many(mpcf_fold_ast, a); }
-mpc_parser_t *mpca_many1(mpc_parser_t *a) { return mpc_many1(mpcf_fold_ast, a); }
-mpc_parser_t *mpca_count(int n, mpc_parser_t *a) { return mpc_count(n, mpcf_fold_ast, a, (mpc_dtor_t)mpc_ast_delete); }
-
-mpc_parser_t *mpca_or(int n, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-
-  p->type = MPC_TYPE_OR;
-  p->data.or.n = n;
-  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
-
-  va_start(va, n);
-  for (i = 0; i < n; i++) {
-    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  va_end(va);
-
-  return p;
-
-}
-
-mpc_parser_t *mpca_and(int n, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-
-  p->type = MPC_TYPE_AND;
-  p->data.and.n = n;
-  p->data.and.f = mpcf_fold_ast;
-  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
-  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
-
-  va_start(va, n);
-  for (i = 0; i < n; i++) {
-    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  for (i = 0; i < (n-1); i++) {
-    p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete;
-  }
-  va_end(va);
-
-  return p;
-}
-
-mpc_parser_t *mpca_total(mpc_parser_t *a) { return mpc_total(a, (mpc_dtor_t)mpc_ast_delete); }
-
-/*
-** Grammar Parser
-*/
-
-/*
-** This is another interesting bootstrapping.
-**
-** Having a general purpose AST type allows
-** users to specify the grammar alone and
-** let all fold rules be automatically taken
-** care of by existing functions.
-**
-** You don't get to control the type spat
-** out but this means you can make a nice
-** parser to take in some grammar in nice
-** syntax and spit out a parser that works.
-**
-** The grammar for this looks surprisingly
-** like regex but the main difference is that
-** it is now whitespace insensitive and the
-** base type takes literals of some form.
-*/
-
-/*
-**
-**  ### Grammar Grammar
-**
-**      <grammar> : (<term> "|" <grammar>) | <term>
-**
-**      <term> : <factor>*
-**
-**      <factor> : <base>
-**               | <base> "*"
-**               | <base> "+"
-**               | <base> "?"
-**               | <base> "{" <digits> "}"
-**
-**      <base> : "<" (<digits> | <ident>) ">"
-**             | <string_lit>
-**             | <char_lit>
-**             | <regex_lit> <regex_mode>
-**             | "(" <grammar> ")"
-*/
-
-typedef struct {
-  va_list *va;
-  int parsers_num;
-  mpc_parser_t **parsers;
-  int flags;
-} mpca_grammar_st_t;
-
-static mpc_val_t *mpcaf_grammar_or(int n, mpc_val_t **xs) {
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  else { return mpca_or(2, xs[0], xs[1]); }
-}
-
-static mpc_val_t *mpcaf_grammar_and(int n, mpc_val_t **xs) {
-  int i;
-  mpc_parser_t *p = mpc_pass();
-  for (i = 0; i < n; i++) {
-    if (xs[i] != NULL) { p = mpca_and(2, p, xs[i]); }
-  }
-  return p;
-}
-
-static mpc_val_t *mpcaf_grammar_repeat(int n, mpc_val_t **xs) {
-  int num;
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { free(xs[1]); return mpca_many(xs[0]); }; break;
-    case '+': { free(xs[1]); return mpca_many1(xs[0]); }; break;
-    case '?': { free(xs[1]); return mpca_maybe(xs[0]); }; break;
-    case '!': { free(xs[1]); return mpca_not(xs[0]); }; break;
-    default:
-      num = *((int*)xs[1]);
-      free(xs[1]);
-  }
-  return mpca_count(num, xs[0]);
-}
-
-static mpc_val_t *mpcaf_grammar_string(mpc_val_t *x, void *s) {
-  mpca_grammar_st_t *st = s;
-  char *y = mpcf_unescape(x);
-  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_string(y) : mpc_tok(mpc_string(y));
-  free(y);
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "string"));
-}
-
-static mpc_val_t *mpcaf_grammar_char(mpc_val_t *x, void *s) {
-  mpca_grammar_st_t *st = s;
-  char *y = mpcf_unescape(x);
-  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_char(y[0]) : mpc_tok(mpc_char(y[0]));
-  free(y);
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "char"));
-}
-
-static mpc_val_t *mpcaf_fold_regex(int n, mpc_val_t **xs) {
-  char *y = xs[0];
-  char *m = xs[1];
-  mpca_grammar_st_t *st = xs[2];
-  mpc_parser_t *p;
-  int mode = MPC_RE_DEFAULT;
-
-  (void)n;
-  if (strchr(m, 'm')) { mode |= MPC_RE_MULTILINE; }
-  if (strchr(m, 's')) { mode |= MPC_RE_DOTALL; }
-  y = mpcf_unescape_regex(y);
-  p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_re_mode(y, mode) : mpc_tok(mpc_re_mode(y, mode));
-  free(y);
-  free(m);
-
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "regex"));
-}
-
-/* Should this just use `isdigit` instead? */
-static int is_number(const char* s) {
-  size_t i;
-  for (i = 0; i < strlen(s); i++) { if (!strchr("0123456789", s[i])) { return 0; } }
-  return 1;
-}
-
-static mpc_parser_t *mpca_grammar_find_parser(char *x, mpca_grammar_st_t *st) {
-
-  int i;
-  mpc_parser_t *p;
-
-  /* Case of Number */
-  if (is_number(x)) {
-
-    i = strtol(x, NULL, 10);
-
-    while (st->parsers_num <= i) {
-      st->parsers_num++;
-      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
-      st->parsers[st->parsers_num-1] = va_arg(*st->va, mpc_parser_t*);
-      if (st->parsers[st->parsers_num-1] == NULL) {
-        return mpc_failf("No Parser in position %i! Only supplied %i Parsers!", i, st->parsers_num);
-      }
-    }
-
-    return st->parsers[st->parsers_num-1];
-
-  /* Case of Identifier */
-  } else {
-
-    /* Search Existing Parsers */
-    for (i = 0; i < st->parsers_num; i++) {
-      mpc_parser_t *q = st->parsers[i];
-      if (q == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
-      if (q->name && strcmp(q->name, x) == 0) { return q; }
-    }
-
-    /* Search New Parsers */
-    while (1) {
-
-      p = va_arg(*st->va, mpc_parser_t*);
-
-      st->parsers_num++;
-      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
-      st->parsers[st->parsers_num-1] = p;
-
-      if (p == NULL || p->name == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
-      if (p->name && strcmp(p->name, x) == 0) { return p; }
-
-    }
-
-  }
-
-}
-
-static mpc_val_t *mpcaf_grammar_id(mpc_val_t *x, void *s) {
-
-  mpca_grammar_st_t *st = s;
-  mpc_parser_t *p = mpca_grammar_find_parser(x, st);
-  free(x);
-
-  if (p->name) {
-    return mpca_state(mpca_root(mpca_add_tag(p, p->name)));
-  } else {
-    return mpca_state(mpca_root(p));
-  }
-}
-
-mpc_parser_t *mpca_grammar_st(const char *grammar, mpca_grammar_st_t *st) {
-
-  char *err_msg;
-  mpc_parser_t *err_out;
-  mpc_result_t r;
-  mpc_parser_t *GrammarTotal, *Grammar, *Term, *Factor, *Base;
-
-  GrammarTotal = mpc_new("grammar_total");
-  Grammar = mpc_new("grammar");
-  Term = mpc_new("term");
-  Factor = mpc_new("factor");
-  Base = mpc_new("base");
-
-  mpc_define(GrammarTotal,
-    mpc_predictive(mpc_total(Grammar, mpc_soft_delete))
-  );
-
-  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
-    Term,
-    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
-    mpc_soft_delete
-  ));
-
-  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
-
-  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
-    Base,
-      mpc_or(6,
-        mpc_sym("*"),
-        mpc_sym("+"),
-        mpc_sym("?"),
-        mpc_sym("!"),
-        mpc_tok_brackets(mpc_int(), free),
-        mpc_pass()),
-    mpc_soft_delete
-  ));
-
-  mpc_define(Base, mpc_or(5,
-    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
-    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
-    mpc_tok(mpc_and(3, mpcaf_fold_regex, mpc_regex_lit(), mpc_many(mpcf_strfold, mpc_oneof("ms")), mpc_lift_val(st), free, free)),
-    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
-    mpc_tok_parens(Grammar, mpc_soft_delete)
-  ));
-
-  mpc_optimise(GrammarTotal);
-  mpc_optimise(Grammar);
-  mpc_optimise(Factor);
-  mpc_optimise(Term);
-  mpc_optimise(Base);
-
-  if(!mpc_parse("<mpc_grammar_compiler>", grammar, GrammarTotal, &r)) {
-    err_msg = mpc_err_string(r.error);
-    err_out = mpc_failf("Invalid Grammar: %s", err_msg);
-    mpc_err_delete(r.error);
-    free(err_msg);
-    r.output = err_out;
-  }
-
-  mpc_cleanup(5, GrammarTotal, Grammar, Term, Factor, Base);
-
-  mpc_optimise(r.output);
-
-  return (st->flags & MPCA_LANG_PREDICTIVE) ? mpc_predictive(r.output) : r.output;
-
-}
-
-mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...) {
-  mpca_grammar_st_t st;
-  mpc_parser_t *res;
-  va_list va;
-  va_start(va, grammar);
-
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-
-  res = mpca_grammar_st(grammar, &st);
-  free(st.parsers);
-  va_end(va);
-  return res;
-}
-
-typedef struct {
-  char *ident;
-  char *name;
-  mpc_parser_t *grammar;
-} mpca_stmt_t;
-
-static mpc_val_t *mpca_stmt_afold(int n, mpc_val_t **xs) {
-  mpca_stmt_t *stmt = malloc(sizeof(mpca_stmt_t));
-  stmt->ident = ((char**)xs)[0];
-  stmt->name = ((char**)xs)[1];
-  stmt->grammar = ((mpc_parser_t**)xs)[3];
-  (void) n;
-  free(((char**)xs)[2]);
-  free(((char**)xs)[4]);
-
-  return stmt;
-}
-
-static mpc_val_t *mpca_stmt_fold(int n, mpc_val_t **xs) {
-
-  int i;
-  mpca_stmt_t **stmts = malloc(sizeof(mpca_stmt_t*) * (n+1));
-
-  for (i = 0; i < n; i++) {
-    stmts[i] = xs[i];
-  }
-  stmts[n] = NULL;
-
-  return stmts;
-}
-
-static void mpca_stmt_list_delete(mpc_val_t *x) {
-
-  mpca_stmt_t **stmts = x;
-
-  while(*stmts) {
-    mpca_stmt_t *stmt = *stmts;
-    free(stmt->ident);
-    free(stmt->name);
-    mpc_soft_delete(stmt->grammar);
-    free(stmt);
-    stmts++;
-  }
-  free(x);
-
-}
-
-static mpc_val_t *mpca_stmt_list_apply_to(mpc_val_t *x, void *s) {
-
-  mpca_grammar_st_t *st = s;
-  mpca_stmt_t *stmt;
-  mpca_stmt_t **stmts = x;
-  mpc_parser_t *left;
-
-  while(*stmts) {
-    stmt = *stmts;
-    left = mpca_grammar_find_parser(stmt->ident, st);
-    if (st->flags & MPCA_LANG_PREDICTIVE) { stmt->grammar = mpc_predictive(stmt->grammar); }
-    if (stmt->name) { stmt->grammar = mpc_expect(stmt->grammar, stmt->name); }
-    mpc_optimise(stmt->grammar);
-    mpc_define(left, stmt->grammar);
-    free(stmt->ident);
-    free(stmt->name);
-    free(stmt);
-    stmts++;
-  }
-
-  free(x);
-
-  return NULL;
-}
-
-static mpc_err_t *mpca_lang_st(mpc_input_t *i, mpca_grammar_st_t *st) {
-
-  mpc_result_t r;
-  mpc_err_t *e;
-  mpc_parser_t *Lang, *Stmt, *Grammar, *Term, *Factor, *Base;
-
-  Lang    = mpc_new("lang");
-  Stmt    = mpc_new("stmt");
-  Grammar = mpc_new("grammar");
-  Term    = mpc_new("term");
-  Factor  = mpc_new("factor");
-  Base    = mpc_new("base");
-
-  mpc_define(Lang, mpc_apply_to(
-    mpc_total(mpc_predictive(mpc_many(mpca_stmt_fold, Stmt)), mpca_stmt_list_delete),
-    mpca_stmt_list_apply_to, st
-  ));
-
-  mpc_define(Stmt, mpc_and(5, mpca_stmt_afold,
-    mpc_tok(mpc_ident()), mpc_maybe(mpc_tok(mpc_string_lit())), mpc_sym(":"), Grammar, mpc_sym(";"),
-    free, free, free, mpc_soft_delete
-  ));
-
-  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
-      Term,
-      mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
-      mpc_soft_delete
-  ));
-
-  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
-
-  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
-    Base,
-      mpc_or(6,
-        mpc_sym("*"),
-        mpc_sym("+"),
-        mpc_sym("?"),
-        mpc_sym("!"),
-        mpc_tok_brackets(mpc_int(), free),
-        mpc_pass()),
-    mpc_soft_delete
-  ));
-
-  mpc_define(Base, mpc_or(5,
-    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
-    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
-    mpc_tok(mpc_and(3, mpcaf_fold_regex, mpc_regex_lit(), mpc_many(mpcf_strfold, mpc_oneof("ms")), mpc_lift_val(st), free, free)),
-    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
-    mpc_tok_parens(Grammar, mpc_soft_delete)
-  ));
-
-  mpc_optimise(Lang);
-  mpc_optimise(Stmt);
-  mpc_optimise(Grammar);
-  mpc_optimise(Term);
-  mpc_optimise(Factor);
-  mpc_optimise(Base);
-
-  if (!mpc_parse_input(i, Lang, &r)) {
-    e = r.error;
-  } else {
-    e = NULL;
-  }
-
-  mpc_cleanup(6, Lang, Stmt, Grammar, Term, Factor, Base);
-
-  return e;
-}
-
-mpc_err_t *mpca_lang_file(int flags, FILE *f, ...) {
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;
-  va_start(va, f);
-
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-
-  i = mpc_input_new_file("<mpca_lang_file>", f);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang_pipe(int flags, FILE *p, ...) {
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;
-  va_start(va, p);
-
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-
-  i = mpc_input_new_pipe("<mpca_lang_pipe>", p);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang(int flags, const char *language, ...) {
-
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;
-  va_start(va, language);
-
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-
-  i = mpc_input_new_string("<mpca_lang>", language);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...) {
-
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;
-
-  FILE *f = fopen(filename, "rb");
-
-  if (f == NULL) {
-    err = mpc_err_file(filename, "Unable to open file!");
-    return err;
-  }
-
-  va_start(va, filename);
-
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-
-  i = mpc_input_new_file(filename, f);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-
-  free(st.parsers);
-  va_end(va);
-
-  fclose(f);
-
-  return err;
-}
-
-static int mpc_nodecount_unretained(mpc_parser_t* p, int force) {
-
-  int i, total;
-
-  if (p->retained && !force) { return 0; }
-
-  if (p->type == MPC_TYPE_EXPECT) { return 1 + mpc_nodecount_unretained(p->data.expect.x, 0); }
-
-  if (p->type == MPC_TYPE_APPLY)    { return 1 + mpc_nodecount_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO) { return 1 + mpc_nodecount_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)  { return 1 + mpc_nodecount_unretained(p->data.predict.x, 0); }
-
-  if (p->type == MPC_TYPE_CHECK)    { return 1 + mpc_nodecount_unretained(p->data.check.x, 0); }
-  if (p->type == MPC_TYPE_CHECK_WITH) { return 1 + mpc_nodecount_unretained(p->data.check_with.x, 0); }
-
-  if (p->type == MPC_TYPE_NOT)   { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MAYBE) { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
-
-  if (p->type == MPC_TYPE_MANY)  { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_MANY1) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_COUNT) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-
-  if (p->type == MPC_TYPE_OR) {
-    total = 1;
-    for(i = 0; i < p->data.or.n; i++) {
-      total += mpc_nodecount_unretained(p->data.or.xs[i], 0);
-    }
-    return total;
-  }
-
-  if (p->type == MPC_TYPE_AND) {
-    total = 1;
-    for(i = 0; i < p->data.and.n; i++) {
-      total += mpc_nodecount_unretained(p->data.and.xs[i], 0);
-    }
-    return total;
-  }
-
-  return 1;
-
-}
-
-void mpc_stats(mpc_parser_t* p) {
-  printf("Stats\n");
-  printf("=====\n");
-  printf("Node Count: %i\n", mpc_nodecount_unretained(p, 1));
-}
-
-static void mpc_optimise_unretained(mpc_parser_t *p, int force) {
-
-  int i, n, m;
-  mpc_parser_t *t;
-
-  if (p->retained && !force) { return; }
-
-  /* Optimise Subexpressions */
-
-  if (p->type == MPC_TYPE_EXPECT)     { mpc_optimise_unretained(p->data.expect.x, 0); }
-  if (p->type == MPC_TYPE_APPLY)      { mpc_optimise_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO)   { mpc_optimise_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_CHECK)      { mpc_optimise_unretained(p->data.check.x, 0); }
-  if (p->type == MPC_TYPE_CHECK_WITH) { mpc_optimise_unretained(p->data.check_with.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)    { mpc_optimise_unretained(p->data.predict.x, 0); }
-  if (p->type == MPC_TYPE_NOT)        { mpc_optimise_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MAYBE)      { mpc_optimise_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MANY)       { mpc_optimise_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_MANY1)      { mpc_optimise_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_COUNT)      { mpc_optimise_unretained(p->data.repeat.x, 0); }
-
-  if (p->type == MPC_TYPE_OR) {
-    for(i = 0; i < p->data.or.n; i++) {
-      mpc_optimise_unretained(p->data.or.xs[i], 0);
-    }
-  }
-
-  if (p->type == MPC_TYPE_AND) {
-    for(i = 0; i < p->data.and.n; i++) {
-      mpc_optimise_unretained(p->data.and.xs[i], 0);
-    }
-  }
-
-  /* Perform optimisations */
-
-  while (1) {
-
-    /* Merge rhs `or` */
-    if (p->type == MPC_TYPE_OR
-    &&  p->data.or.xs[p->data.or.n-1]->type == MPC_TYPE_OR
-    && !p->data.or.xs[p->data.or.n-1]->retained) {
-      t = p->data.or.xs[p->data.or.n-1];
-      n = p->data.or.n; m = t->data.or.n;
-      p->data.or.n = n + m - 1;
-      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      memmove(p->data.or.xs + n - 1, t->data.or.xs, m * sizeof(mpc_parser_t*));
-      free(t->data.or.xs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Merge lhs `or` */
-    if (p->type == MPC_TYPE_OR
-    &&  p->data.or.xs[0]->type == MPC_TYPE_OR
-    && !p->data.or.xs[0]->retained) {
-      t = p->data.or.xs[0];
-      n = p->data.or.n; m = t->data.or.n;
-      p->data.or.n = n + m - 1;
-      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      memmove(p->data.or.xs + m, p->data.or.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
-      memmove(p->data.or.xs, t->data.or.xs, m * sizeof(mpc_parser_t*));
-      free(t->data.or.xs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Remove ast `pass` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.n == 2
-    &&  p->data.and.xs[0]->type == MPC_TYPE_PASS
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[1];
-      mpc_delete(p->data.and.xs[0]);
-      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
-      memcpy(p, t, sizeof(mpc_parser_t));
-      free(t);
-      continue;
-    }
-
-    /* Merge ast lhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_fold_ast
-    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.xs[0]->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[0];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
-      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Merge ast rhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_fold_ast
-    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
-    && !p->data.and.xs[p->data.and.n-1]->retained
-    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[p->data.and.n-1];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Remove re `lift` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.n == 2
-    &&  p->data.and.xs[0]->type == MPC_TYPE_LIFT
-    &&  p->data.and.xs[0]->data.lift.lf == mpcf_ctor_str
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[1];
-      mpc_delete(p->data.and.xs[0]);
-      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
-      memcpy(p, t, sizeof(mpc_parser_t));
-      free(t);
-      continue;
-    }
-
-    /* Merge re lhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_strfold
-    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.xs[0]->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[0];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
-      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Merge re rhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_strfold
-    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
-    && !p->data.and.xs[p->data.and.n-1]->retained
-    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[p->data.and.n-1];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
-      continue;
-    }
-
-    return;
-
-  }
-
-}
-
-void mpc_optimise(mpc_parser_t *p) {
-  mpc_optimise_unretained(p, 1);
-}
-
+/* fileno and mmap are POSIX, so ask for them before any header is included */
+#if !defined(MPC_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define MPC_USE_MMAP
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+#endif
+
+#include "mpc.h"
+#include <stddef.h>
+#include <time.h>
+
+#ifdef MPC_USE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#if !defined(MPC_NO_SSE2) && defined(__SSE2__)
+#define MPC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__GNUC__)
+#include <intrin.h>
+#endif
+
+/*
+** State Type
+*/
+
+static mpc_state_t mpc_state_invalid(void) {
+  mpc_state_t s;
+  s.pos = -1;
+  s.row = -1;
+  s.col = -1;
+  s.term = 0;
+  return s;
+}
+
+static mpc_state_t mpc_state_new(void) {
+  mpc_state_t s;
+  s.pos = 0;
+  s.row = 0;
+  s.col = 0;
+  s.term = 0;
+  return s;
+}
+
+/*
+** Input Type
+*/
+
+/*
+** In mpc the input type has three modes of
+** operation: String, File and Pipe.
+**
+** String is easy. The whole contents are
+** loaded into a buffer and scanned through.
+** The cursor can jump around at will making
+** backtracking easy.
+**
+** The second is a File which is also somewhat
+** easy. The contents are never loaded into
+** memory but backtracking can still be achieved
+** by seeking in the file at different positions.
+**
+** The final mode is Pipe. This is the difficult
+** one. As we assume pipes cannot be seeked, the
+** input is read in chunks into a buffer and all
+** characters are taken from there. The buffer
+** keeps everything from the earliest mark, so
+** if we are requested to seek back we can simply
+** start reading from an earlier point in it. Any
+** input before the earliest mark (or the cursor
+** when there are no marks) is dropped when the
+** buffer is next refilled, unless a failure noted
+** for later still has to be run over it.
+**
+** Of course using `mpc_predictive` will disable
+** backtracking and make LL(1) grammars easy
+** to parse for all input methods.
+**
+** Seekable files are not actually read through
+** the File mode. Instead they use a fourth mode,
+** Map, in which the rest of the file is mapped
+** into memory read-only and scanned just like a
+** String, with no copy and no calls into stdio.
+** Where mapping is not possible the rest of the
+** file is read into one buffer instead. Either
+** way the file is left positioned just after the
+** input that was consumed. Files which can't be
+** seeked at all are read in the Pipe mode.
+**
+*/
+
+enum {
+  MPC_INPUT_STRING = 0,
+  MPC_INPUT_FILE   = 1,
+  MPC_INPUT_PIPE   = 2,
+  MPC_INPUT_MAP    = 3
+};
+
+enum {
+  MPC_INPUT_MARKS_MIN = 32
+};
+
+enum {
+  MPC_INPUT_PIPE_CHUNK = 4096
+};
+
+enum {
+  MPC_INPUT_MEMO_NUM = 4096
+};
+
+/*
+** Values made while parsing come from a bump arena
+** owned by the input. Freed blocks go on a free list
+** for their size class, 16 to 256 bytes, and are
+** reused before the arena grows. Larger values are
+** left to malloc, as are all values when built with
+** MPC_NO_ARENA, which bench/arena.c compares against.
+*/
+
+enum {
+  MPC_ARENA_CLASSES = 5,
+#ifdef MPC_NO_ARENA
+  MPC_ARENA_MAX = 0,
+#else
+  MPC_ARENA_MAX = 256,
+#endif
+  MPC_ARENA_CHUNK_MIN = 16384
+};
+
+typedef union {
+  int cls;
+  void *p;
+  long l;
+  double d;
+} mpc_block_t;
+
+typedef struct mpc_chunk_t {
+  struct mpc_chunk_t *next;
+  size_t size;
+  size_t used;
+} mpc_chunk_t;
+
+/*
+** Trees built by a parse intern their tags in a bump
+** arena made for it. Heap nodes each hold a reference
+** to the arena and the last one deleted frees it. In
+** arena mode the nodes and their contents come from
+** the arena too. Nothing in it is freed on its own,
+** and deleting the root frees the whole arena.
+*/
+
+enum {
+  MPC_AST_TAGS_NUM = 256
+};
+
+typedef struct mpc_ast_arena_t {
+  mpc_chunk_t *chunks;
+  mpc_ast_t *root;
+  long refs;
+  int nodes;
+  struct mpc_tag_t *tags[MPC_AST_TAGS_NUM];
+} mpc_ast_arena_t;
+
+/*
+** A memo entry records the result of a packrat
+** parser at one position: either the output and
+** the state it ended in, or the error it failed
+** with. Entries live in a fixed size table and
+** an entry is simply replaced when another
+** result hashes to the same slot.
+*/
+
+struct mpc_parser_t;
+
+typedef struct {
+  struct mpc_parser_t *parser;
+  long pos;
+  int flags;
+  int success;
+  mpc_state_t state;
+  char last;
+  void *value;
+} mpc_memo_t;
+
+typedef struct {
+
+  int type;
+  char *filename;
+  mpc_state_t state;
+
+  char *string;
+  char *buffer;
+  FILE *file;
+
+  size_t buffer_len;
+  size_t buffer_slots;
+  long buffer_pos;
+
+  size_t length;
+  long offset;
+  void *map;
+  size_t map_length;
+
+  int suppress;
+  int backtrack;
+  int dispatch;
+  int profile;
+  int tallies_num;
+  int tallies_slots;
+  struct mpc_tally_t *tallies;
+  long rewinds;
+  int marks_slots;
+  int marks_num;
+  mpc_state_t *marks;
+
+  char *lasts;
+  char last;
+
+  mpc_chunk_t *chunks;
+  void *blocks[MPC_ARENA_CLASSES];
+
+  mpc_memo_t *memo;
+  mpc_ast_arena_t *ast;
+
+  struct mpc_fail_t *fails;
+  int fails_num;
+  int fails_slots;
+  int fails_defers;
+  long fails_floor;
+  long fails_keep;
+
+} mpc_input_t;
+
+/* Read when an input is made, so a parse already running is unaffected */
+static int mpc_profiling = 0;
+
+void mpc_profile(int on) {
+  mpc_profiling = on;
+}
+
+static mpc_input_t *mpc_input_new_string(const char *filename, const char *string) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  i->type = MPC_INPUT_STRING;
+
+  i->state = mpc_state_new();
+
+  i->string = malloc(strlen(string) + 1);
+  strcpy(i->string, string);
+  i->length = strlen(i->string);
+  i->buffer = NULL;
+  i->file = NULL;
+
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->dispatch = 1;
+  i->profile = mpc_profiling;
+  i->tallies_num = 0;
+  i->tallies_slots = 0;
+  i->tallies = NULL;
+  i->ast = NULL;
+  i->rewinds = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+
+  i->chunks = NULL;
+  memset(i->blocks, 0, sizeof(i->blocks));
+
+  i->memo = NULL;
+
+  i->fails = NULL;
+  i->fails_num = 0;
+  i->fails_slots = 0;
+  i->fails_defers = 0;
+  i->fails_floor = 0;
+  i->fails_keep = -1;
+
+  return i;
+}
+
+static mpc_input_t *mpc_input_new_nstring(const char *filename, const char *string, size_t length) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  i->type = MPC_INPUT_STRING;
+
+  i->state = mpc_state_new();
+
+  i->string = malloc(length + 1);
+  strncpy(i->string, string, length);
+  i->string[length] = '\0';
+  i->length = strlen(i->string);
+  i->buffer = NULL;
+  i->file = NULL;
+
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->dispatch = 1;
+  i->profile = mpc_profiling;
+  i->tallies_num = 0;
+  i->tallies_slots = 0;
+  i->tallies = NULL;
+  i->ast = NULL;
+  i->rewinds = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+
+  i->chunks = NULL;
+  memset(i->blocks, 0, sizeof(i->blocks));
+
+  i->memo = NULL;
+
+  i->fails = NULL;
+  i->fails_num = 0;
+  i->fails_slots = 0;
+  i->fails_defers = 0;
+  i->fails_floor = 0;
+  i->fails_keep = -1;
+
+  return i;
+
+}
+
+static mpc_input_t *mpc_input_new_pipe(const char *filename, FILE *pipe) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+
+  i->type = MPC_INPUT_PIPE;
+  i->state = mpc_state_new();
+
+  i->string = NULL;
+  i->buffer = malloc(MPC_INPUT_PIPE_CHUNK);
+  i->buffer_len = 0;
+  i->buffer_slots = MPC_INPUT_PIPE_CHUNK;
+  i->buffer_pos = 0;
+  i->file = pipe;
+
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->dispatch = 1;
+  i->profile = mpc_profiling;
+  i->tallies_num = 0;
+  i->tallies_slots = 0;
+  i->tallies = NULL;
+  i->ast = NULL;
+  i->rewinds = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+
+  i->chunks = NULL;
+  memset(i->blocks, 0, sizeof(i->blocks));
+
+  i->memo = NULL;
+
+  i->fails = NULL;
+  i->fails_num = 0;
+  i->fails_slots = 0;
+  i->fails_defers = 0;
+  i->fails_floor = 0;
+  i->fails_keep = -1;
+
+  return i;
+
+}
+
+static mpc_input_t *mpc_input_new_file(const char *filename, FILE *file) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  i->type = MPC_INPUT_FILE;
+  i->state = mpc_state_new();
+
+  i->string = NULL;
+  i->buffer = NULL;
+  i->file = file;
+
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->dispatch = 0;
+  i->profile = mpc_profiling;
+  i->tallies_num = 0;
+  i->tallies_slots = 0;
+  i->tallies = NULL;
+  i->ast = NULL;
+  i->rewinds = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+
+  i->chunks = NULL;
+  memset(i->blocks, 0, sizeof(i->blocks));
+
+  i->memo = NULL;
+
+  i->fails = NULL;
+  i->fails_num = 0;
+  i->fails_slots = 0;
+  i->fails_defers = 0;
+  i->fails_floor = 0;
+  i->fails_keep = -1;
+
+  return i;
+}
+
+static char *mpc_input_read_rest(FILE *file, size_t *length) {
+
+  size_t slots = 65536, n;
+  char *buffer = malloc(slots);
+
+  *length = 0;
+  while ((n = fread(buffer + *length, 1, slots - *length, file)) > 0) {
+    *length += n;
+    if (*length == slots) {
+      slots *= 2;
+      buffer = realloc(buffer, slots);
+    }
+  }
+
+  return buffer;
+}
+
+static mpc_input_t *mpc_input_new_map(const char *filename, FILE *file) {
+
+  mpc_input_t *i;
+  long offset = ftell(file);
+#ifdef MPC_USE_MMAP
+  struct stat st;
+#endif
+
+  /* Unseekable streams are read like pipes */
+  if (offset < 0) { return mpc_input_new_pipe(filename, file); }
+
+  i = mpc_input_new_file(filename, file);
+  i->type = MPC_INPUT_MAP;
+  i->dispatch = 1;
+  i->offset = offset;
+  i->map = NULL;
+  i->map_length = 0;
+
+#ifdef MPC_USE_MMAP
+  if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset) {
+    i->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (i->map == MAP_FAILED) {
+      i->map = NULL;
+    } else {
+      i->map_length = st.st_size;
+      i->string = (char*)i->map + offset;
+      i->length = st.st_size - offset;
+    }
+  }
+#endif
+
+  if (i->map == NULL) {
+    i->string = mpc_input_read_rest(file, &i->length);
+  }
+
+  return i;
+}
+
+static void mpc_input_memo_delete(mpc_input_t *i);
+static void mpc_input_fails_delete(mpc_input_t *i);
+static void mpc_input_tallies_delete(mpc_input_t *i);
+static void mpc_ast_arena_release(mpc_ast_arena_t *m);
+
+static void mpc_input_delete(mpc_input_t *i) {
+
+  mpc_chunk_t *k;
+
+  free(i->filename);
+
+  if (i->type == MPC_INPUT_STRING) { free(i->string); }
+  if (i->type == MPC_INPUT_PIPE) { free(i->buffer); }
+
+  if (i->type == MPC_INPUT_MAP) {
+#ifdef MPC_USE_MMAP
+    if (i->map) { munmap(i->map, i->map_length); }
+#endif
+    if (!i->map) { free(i->string); }
+    fseek(i->file, i->offset + i->state.pos, SEEK_SET);
+  }
+
+  mpc_input_memo_delete(i);
+  mpc_input_fails_delete(i);
+  mpc_input_tallies_delete(i);
+
+  /* The input lets go of its arena, unless it handed the arena to a root */
+  if (i->ast && !i->ast->root) { mpc_ast_arena_release(i->ast); }
+
+  while (i->chunks) {
+    k = i->chunks->next;
+    free(i->chunks);
+    i->chunks = k;
+  }
+
+  free(i->marks);
+  free(i->lasts);
+  free(i);
+}
+
+/* Chunks double in size so there are only ever a few to look through */
+static int mpc_mem_ptr(mpc_input_t *i, void *p) {
+  mpc_chunk_t *k;
+  for (k = i->chunks; k; k = k->next) {
+    if ((char*)p >= (char*)(k + 1) && (char*)p < (char*)(k + 1) + k->used) { return 1; }
+  }
+  return 0;
+}
+
+static size_t mpc_mem_size(void *p) {
+  return (size_t)16 << ((mpc_block_t*)p - 1)->cls;
+}
+
+static void *mpc_malloc(mpc_input_t *i, size_t n) {
+
+  int c;
+  size_t m, s;
+  void *p;
+  mpc_chunk_t *k;
+  mpc_block_t *b;
+
+  if (n > MPC_ARENA_MAX) { return malloc(n); }
+
+  c = n <= 16 ? 0 : n <= 32 ? 1 : n <= 64 ? 2 : n <= 128 ? 3 : 4;
+
+  if (i->blocks[c]) {
+    p = i->blocks[c];
+    i->blocks[c] = *(void**)p;
+    return p;
+  }
+
+  m = sizeof(mpc_block_t) + ((size_t)16 << c);
+  k = i->chunks;
+
+  if (k == NULL || k->used + m > k->size) {
+    s = k ? k->size * 2 : MPC_ARENA_CHUNK_MIN;
+    k = malloc(sizeof(mpc_chunk_t) + s);
+    k->next = i->chunks;
+    k->size = s;
+    k->used = 0;
+    i->chunks = k;
+  }
+
+  b = (mpc_block_t*)((char*)(k + 1) + k->used);
+  b->cls = c;
+  k->used += m;
+  return b + 1;
+}
+
+static void *mpc_calloc(mpc_input_t *i, size_t n, size_t m) {
+  char *x = mpc_malloc(i, n * m);
+  memset(x, 0, n * m);
+  return x;
+}
+
+static void mpc_mem_release(mpc_input_t *i, void *p) {
+  int c = ((mpc_block_t*)p - 1)->cls;
+  *(void**)p = i->blocks[c];
+  i->blocks[c] = p;
+}
+
+static void mpc_free(mpc_input_t *i, void *p) {
+  if (!mpc_mem_ptr(i, p)) { free(p); return; }
+  mpc_mem_release(i, p);
+}
+
+static void *mpc_realloc(mpc_input_t *i, void *p, size_t n) {
+
+  char *q = NULL;
+  size_t s;
+
+  if (!mpc_mem_ptr(i, p)) { return realloc(p, n); }
+
+  s = mpc_mem_size(p);
+  if (n <= s) { return p; }
+
+  q = mpc_malloc(i, n);
+  memcpy(q, p, s);
+  mpc_mem_release(i, p);
+  return q;
+}
+
+/* Values given to the user must be theirs to free */
+static void *mpc_export(mpc_input_t *i, void *p) {
+  char *q = NULL;
+  size_t s;
+  if (!mpc_mem_ptr(i, p)) { return p; }
+  s = mpc_mem_size(p);
+  q = malloc(s);
+  memcpy(q, p, s);
+  mpc_mem_release(i, p);
+  return q;
+}
+
+static void mpc_input_backtrack_disable(mpc_input_t *i) { i->backtrack--; }
+static void mpc_input_backtrack_enable(mpc_input_t *i) { i->backtrack++; }
+
+static void mpc_input_suppress_disable(mpc_input_t *i) { i->suppress--; }
+static void mpc_input_suppress_enable(mpc_input_t *i) { i->suppress++; }
+
+static void mpc_input_mark(mpc_input_t *i) {
+
+  if (i->backtrack < 1) { return; }
+
+  i->marks_num++;
+
+  if (i->marks_num > i->marks_slots) {
+    i->marks_slots = i->marks_num + i->marks_num / 2;
+    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
+    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
+  }
+
+  i->marks[i->marks_num-1] = i->state;
+  i->lasts[i->marks_num-1] = i->last;
+
+}
+
+static void mpc_input_unmark(mpc_input_t *i) {
+
+  if (i->backtrack < 1) { return; }
+
+  i->marks_num--;
+
+  if (i->marks_slots > i->marks_num + i->marks_num / 2
+  &&  i->marks_slots > MPC_INPUT_MARKS_MIN) {
+    i->marks_slots =
+      i->marks_num > MPC_INPUT_MARKS_MIN ?
+      i->marks_num : MPC_INPUT_MARKS_MIN;
+    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
+    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
+  }
+
+}
+
+static void mpc_input_rewind(mpc_input_t *i) {
+
+  if (i->backtrack < 1) { return; }
+
+  i->rewinds++;
+  i->state = i->marks[i->marks_num-1];
+  i->last  = i->lasts[i->marks_num-1];
+
+  if (i->type == MPC_INPUT_FILE) {
+    fseek(i->file, i->state.pos, SEEK_SET);
+  }
+
+  mpc_input_unmark(i);
+}
+
+static int mpc_input_pipe_fill(mpc_input_t *i) {
+
+  size_t n;
+  long keep = i->marks_num > 0 ? i->marks[0].pos : i->state.pos;
+
+  /* Nothing before the earliest mark or deferred failure can be read again */
+  if (i->fails_keep >= 0 && i->fails_keep < keep) { keep = i->fails_keep; }
+  if (keep > i->buffer_pos) {
+    n = keep - i->buffer_pos;
+    memmove(i->buffer, i->buffer + n, i->buffer_len - n);
+    i->buffer_len -= n;
+    i->buffer_pos = keep;
+  }
+
+  if (i->buffer_len + MPC_INPUT_PIPE_CHUNK > i->buffer_slots) {
+    i->buffer_slots = i->buffer_slots * 2 > i->buffer_len + MPC_INPUT_PIPE_CHUNK
+      ? i->buffer_slots * 2 : i->buffer_len + MPC_INPUT_PIPE_CHUNK;
+    i->buffer = realloc(i->buffer, i->buffer_slots);
+  }
+
+  n = fread(i->buffer + i->buffer_len, 1, MPC_INPUT_PIPE_CHUNK, i->file);
+  i->buffer_len += n;
+  return n > 0;
+}
+
+static char mpc_input_pipe_get(mpc_input_t *i) {
+  if (i->state.pos - i->buffer_pos >= (long)i->buffer_len
+  &&  !mpc_input_pipe_fill(i)) { return '\0'; }
+  return i->buffer[i->state.pos - i->buffer_pos];
+}
+
+static char mpc_input_map_get(mpc_input_t *i) {
+  return (size_t)i->state.pos < i->length ? i->string[i->state.pos] : '\0';
+}
+
+static char mpc_input_getc(mpc_input_t *i) {
+
+  char c = '\0';
+
+  switch (i->type) {
+
+    case MPC_INPUT_STRING: return i->string[i->state.pos];
+    case MPC_INPUT_MAP: return mpc_input_map_get(i);
+    case MPC_INPUT_FILE: c = fgetc(i->file); return c;
+    case MPC_INPUT_PIPE: return mpc_input_pipe_get(i);
+    default: return c;
+  }
+}
+
+static char mpc_input_peekc(mpc_input_t *i) {
+
+  char c = '\0';
+
+  switch (i->type) {
+    case MPC_INPUT_STRING: return i->string[i->state.pos];
+    case MPC_INPUT_MAP: return mpc_input_map_get(i);
+    case MPC_INPUT_FILE:
+
+      c = fgetc(i->file);
+      if (feof(i->file)) { return '\0'; }
+
+      fseek(i->file, -1, SEEK_CUR);
+      return c;
+
+    case MPC_INPUT_PIPE: return mpc_input_pipe_get(i);
+    default: return c;
+  }
+
+}
+
+static int mpc_input_terminated(mpc_input_t *i) {
+  return mpc_input_peekc(i) == '\0';
+}
+
+static int mpc_input_failure(mpc_input_t *i, char c) {
+
+  (void)c;
+
+  switch (i->type) {
+    case MPC_INPUT_STRING: { break; }
+    case MPC_INPUT_FILE: fseek(i->file, -1, SEEK_CUR); { break; }
+    default: { break; }
+  }
+  return 0;
+}
+
+static int mpc_input_success(mpc_input_t *i, char c, char **o) {
+
+  i->last = c;
+  i->state.pos++;
+  i->state.col++;
+
+  if (c == '\n') {
+    i->state.col = 0;
+    i->state.row++;
+  }
+
+  if (o) {
+    (*o) = mpc_malloc(i, 2);
+    (*o)[0] = c;
+    (*o)[1] = '\0';
+  }
+
+  return 1;
+}
+
+/*
+** Sets of bytes are 256 bit bitmaps. The same
+** functions serve for larger bitmaps too.
+*/
+
+static void mpc_set_add(unsigned char *a, int c) {
+  a[c / 8] |= (unsigned char)(1 << (c % 8));
+}
+
+static int mpc_set_has(const unsigned char *a, int c) {
+  return (a[c / 8] >> (c % 8)) & 1;
+}
+
+static void mpc_set_union(unsigned char *a, const unsigned char *b) {
+  int j;
+  for (j = 0; j < 32; j++) { a[j] |= b[j]; }
+}
+
+static int mpc_set_disjoint(const unsigned char *a, const unsigned char *b) {
+  int j;
+  for (j = 0; j < 32; j++) { if (a[j] & b[j]) { return 0; } }
+  return 1;
+}
+
+static int mpc_input_any(mpc_input_t *i, char **o) {
+  char x;
+  if (mpc_input_terminated(i)) { return 0; }
+  x = mpc_input_getc(i);
+  return mpc_input_success(i, x, o);
+}
+
+static int mpc_input_char(mpc_input_t *i, char c, char **o) {
+  char x;
+  if (mpc_input_terminated(i)) { return 0; }
+  x = mpc_input_getc(i);
+  return x == c ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_range(mpc_input_t *i, char c, char d, char **o) {
+  char x;
+  if (mpc_input_terminated(i)) { return 0; }
+  x = mpc_input_getc(i);
+  return x >= c && x <= d ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_class(mpc_input_t *i, const unsigned char *set, char **o) {
+  char x;
+  if (mpc_input_terminated(i)) { return 0; }
+  x = mpc_input_getc(i);
+  return mpc_set_has(set, (unsigned char)x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_satisfy(mpc_input_t *i, int(*cond)(char), char **o) {
+  char x;
+  if (mpc_input_terminated(i)) { return 0; }
+  x = mpc_input_getc(i);
+  return cond(x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_string(mpc_input_t *i, const char *c, char **o) {
+
+  const char *x = c;
+
+  mpc_input_mark(i);
+  while (*x) {
+    if (!mpc_input_char(i, *x, NULL)) {
+      mpc_input_rewind(i);
+      return 0;
+    }
+    x++;
+  }
+  mpc_input_unmark(i);
+
+  *o = mpc_malloc(i, strlen(c) + 1);
+  strcpy(*o, c);
+  return 1;
+}
+
+static int mpc_input_anchor(mpc_input_t* i, int(*f)(char,char), char **o) {
+  *o = NULL;
+  return f(i->last, mpc_input_peekc(i));
+}
+
+static int mpc_input_soi(mpc_input_t* i, char **o) {
+  *o = NULL;
+  return i->last == '\0';
+}
+
+static int mpc_input_eoi(mpc_input_t* i, char **o) {
+  *o = NULL;
+  if (i->state.term) {
+    return 0;
+  } else if (mpc_input_terminated(i)) {
+    i->state.term = 1;
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+static mpc_state_t *mpc_input_state_copy(mpc_input_t *i) {
+  mpc_state_t *r = mpc_malloc(i, sizeof(mpc_state_t));
+  memcpy(r, &i->state, sizeof(mpc_state_t));
+  return r;
+}
+
+/*
+** Error Type
+*/
+
+void mpc_err_delete(mpc_err_t *x) {
+  int i;
+  for (i = 0; i < x->expected_num; i++) { free(x->expected[i]); }
+  free(x->expected);
+  free(x->filename);
+  free(x->failure);
+  free(x);
+}
+
+void mpc_err_print(mpc_err_t *x) {
+  mpc_err_print_to(x, stdout);
+}
+
+void mpc_err_print_to(mpc_err_t *x, FILE *f) {
+  char *str = mpc_err_string(x);
+  fprintf(f, "%s", str);
+  free(str);
+}
+
+static void mpc_err_string_cat(char *buffer, int *pos, int *max, char const *fmt, ...) {
+  /* TODO: Error Checking on Length */
+  int left = ((*max) - (*pos));
+  va_list va;
+  va_start(va, fmt);
+  if (left < 0) { left = 0;}
+  (*pos) += vsprintf(buffer + (*pos), fmt, va);
+  va_end(va);
+}
+
+static const char *mpc_err_char_unescape(char c, char *buffer) {
+
+  buffer[0] = '\'';
+  buffer[1] = ' ';
+  buffer[2] = '\'';
+  buffer[3] = '\0';
+
+  switch (c) {
+    case '\a': return "bell";
+    case '\b': return "backspace";
+    case '\f': return "formfeed";
+    case '\r': return "carriage return";
+    case '\v': return "vertical tab";
+    case '\0': return "end of input";
+    case '\n': return "newline";
+    case '\t': return "tab";
+    case ' ' : return "space";
+    default:
+      buffer[1] = c;
+      return buffer;
+  }
+
+}
+
+char *mpc_err_string(mpc_err_t *x) {
+
+  int i;
+  int pos = 0;
+  int max = 1023;
+  char *buffer = calloc(1, 1024);
+  char received[4];
+
+  if (x->failure) {
+    mpc_err_string_cat(buffer, &pos, &max,
+    "%s: error: %s\n", x->filename, x->failure);
+    return buffer;
+  }
+
+  mpc_err_string_cat(buffer, &pos, &max,
+    "%s:%li:%li: error: expected ", x->filename, x->state.row+1, x->state.col+1);
+
+  if (x->expected_num == 0) { mpc_err_string_cat(buffer, &pos, &max, "ERROR: NOTHING EXPECTED"); }
+  if (x->expected_num == 1) { mpc_err_string_cat(buffer, &pos, &max, "%s", x->expected[0]); }
+  if (x->expected_num >= 2) {
+
+    for (i = 0; i < x->expected_num-2; i++) {
+      mpc_err_string_cat(buffer, &pos, &max, "%s, ", x->expected[i]);
+    }
+
+    mpc_err_string_cat(buffer, &pos, &max, "%s or %s",
+      x->expected[x->expected_num-2],
+      x->expected[x->expected_num-1]);
+  }
+
+  mpc_err_string_cat(buffer, &pos, &max, " at ");
+  mpc_err_string_cat(buffer, &pos, &max, mpc_err_char_unescape(x->received, received));
+  mpc_err_string_cat(buffer, &pos, &max, "\n");
+
+  return realloc(buffer, strlen(buffer) + 1);
+}
+
+/*
+** A parse doesn't build errors as it goes. It notes
+** its failures in a log on the input instead, each
+** either the message of an expect, fail or check at
+** the state it failed in, or a parser one of the fast
+** paths of the optimiser went past, to be run later
+** without them from where it started. Only failures
+** at the furthest position end up in the error, so
+** once a failure is certain at some position entries
+** which can't reach it are dropped. If the parse fails
+** the error is built from the log, see mpc_err_build,
+** and comes out just as if built along the way.
+**
+** The error of a failed result is NULL or points at
+** `mpc_err_last`, standing for the last log entry.
+*/
+
+enum {
+  MPC_FAILS_MIN = 16,
+  MPC_FAILS_DEFERS_MAX = 1024
+};
+
+typedef struct mpc_fail_t {
+  struct mpc_parser_t *p;
+  int lo, hi;
+  int backtrack;
+  const char *m;
+  int failure;
+  char *prefix;
+  mpc_state_t state;
+  long reach;
+  char received;
+  char last;
+} mpc_fail_t;
+
+static mpc_err_t mpc_err_last;
+
+static void mpc_fail_settle(mpc_input_t *i);
+
+static void mpc_fail_init(mpc_input_t *i, mpc_fail_t *x) {
+  x->p = NULL;
+  x->lo = 0;
+  x->hi = 0;
+  x->backtrack = i->backtrack;
+  x->m = NULL;
+  x->failure = 0;
+  x->prefix = NULL;
+  x->state = i->state;
+  x->reach = i->state.pos;
+  x->received = ' ';
+  x->last = i->last;
+}
+
+/* Drops the entries which can't reach floor */
+static void mpc_fail_floor(mpc_input_t *i, long floor) {
+
+  int j, k = 0;
+  mpc_fail_t *x;
+
+  i->fails_floor = floor;
+  i->fails_defers = 0;
+
+  /* While the log is settled the entries being run still need their input */
+  if (i->dispatch) { i->fails_keep = -1; }
+
+  for (j = 0; j < i->fails_num; j++) {
+    x = &i->fails[j];
+    if (x->reach < floor) { mpc_free(i, x->prefix); continue; }
+    if (x->p) {
+      i->fails_defers++;
+      if (i->fails_keep < 0 || x->state.pos < i->fails_keep) { i->fails_keep = x->state.pos; }
+    }
+    i->fails[k++] = *x;
+  }
+
+  i->fails_num = k;
+}
+
+/* Adds x to the log, given a position it is certain to fail at or -1 */
+static mpc_fail_t *mpc_fail_push(mpc_input_t *i, const mpc_fail_t *x, long certain) {
+
+  if (i->suppress || x->reach < i->fails_floor) { return NULL; }
+  if (certain > i->fails_floor) { mpc_fail_floor(i, certain); }
+
+  if (i->fails_num == i->fails_slots) {
+    i->fails_slots = i->fails_slots ? i->fails_slots * 2 : MPC_FAILS_MIN;
+    i->fails = realloc(i->fails, sizeof(mpc_fail_t) * i->fails_slots);
+  }
+
+  i->fails[i->fails_num] = *x;
+  if (x->p) {
+    i->fails_defers++;
+    if (i->fails_keep < 0 || x->state.pos < i->fails_keep) { i->fails_keep = x->state.pos; }
+  }
+  return &i->fails[i->fails_num++];
+}
+
+static void mpc_input_fails_delete(mpc_input_t *i) {
+  int j;
+  for (j = 0; j < i->fails_num; j++) { mpc_free(i, i->fails[j].prefix); }
+  free(i->fails);
+}
+
+/* The packrat memo keeps its own copy of a failure */
+static mpc_fail_t *mpc_fail_copy(mpc_input_t *i, const mpc_fail_t *x) {
+  mpc_fail_t *y = mpc_malloc(i, sizeof(mpc_fail_t));
+  *y = *x;
+  if (x->prefix) {
+    y->prefix = mpc_malloc(i, strlen(x->prefix) + 1);
+    strcpy(y->prefix, x->prefix);
+  }
+  return y;
+}
+
+static void mpc_fail_delete(mpc_input_t *i, mpc_fail_t *x) {
+  if (x == NULL) { return; }
+  mpc_free(i, x->prefix);
+  mpc_free(i, x);
+}
+
+static mpc_err_t *mpc_err_new(mpc_input_t *i, const char *expected) {
+  mpc_fail_t x;
+  if (i->suppress) { return NULL; }
+  mpc_fail_init(i, &x);
+  x.m = expected;
+  x.received = mpc_input_peekc(i);
+  return mpc_fail_push(i, &x, x.state.pos) ? &mpc_err_last : NULL;
+}
+
+static mpc_err_t *mpc_err_fail(mpc_input_t *i, const char *failure) {
+  mpc_fail_t x;
+  if (i->suppress) { return NULL; }
+  mpc_fail_init(i, &x);
+  x.m = failure;
+  x.failure = 1;
+  return mpc_fail_push(i, &x, x.state.pos) ? &mpc_err_last : NULL;
+}
+
+/*
+** Notes that a fast path went past p at state s and
+** that what it would have noted can reach no further
+** than reach. When certain it would have noted some
+** failure at s or after.
+*/
+
+static mpc_err_t *mpc_err_defer(mpc_input_t *i, mpc_parser_t *p, mpc_state_t s, char last, long reach, int certain) {
+
+  mpc_fail_t x;
+
+  if (i->suppress || reach < i->fails_floor) { return NULL; }
+
+  /* Too many waiting, as nothing certain has come up for a while */
+  if (i->fails_defers >= MPC_FAILS_DEFERS_MAX) { mpc_fail_settle(i); }
+
+  mpc_fail_init(i, &x);
+  x.p = p;
+  x.state = s;
+  x.last = last;
+  x.reach = reach;
+  return mpc_fail_push(i, &x, certain ? s.pos : -1) ? &mpc_err_last : NULL;
+}
+
+static mpc_err_t *mpc_err_recall(mpc_input_t *i, const mpc_fail_t *x) {
+  mpc_fail_t *y;
+  if (x == NULL) { return NULL; }
+  y = mpc_fail_push(i, x, x->p ? -1 : x->state.pos);
+  if (y == NULL) { return NULL; }
+  if (x->prefix) {
+    y->prefix = mpc_malloc(i, strlen(x->prefix) + 1);
+    strcpy(y->prefix, x->prefix);
+  }
+  return &mpc_err_last;
+}
+
+static mpc_err_t *mpc_err_file(const char *filename, const char *failure) {
+  mpc_err_t *x;
+  x = malloc(sizeof(mpc_err_t));
+  x->filename = malloc(strlen(filename) + 1);
+  strcpy(x->filename, filename);
+  x->state = mpc_state_new();
+  x->expected_num = 0;
+  x->expected = NULL;
+  x->failure = malloc(strlen(failure) + 1);
+  strcpy(x->failure, failure);
+  x->received = ' ';
+  return x;
+}
+
+static int mpc_err_contains_expected(mpc_err_t *x, const char *expected) {
+  int j;
+  for (j = 0; j < x->expected_num; j++) {
+    if (strcmp(x->expected[j], expected) == 0) { return 1; }
+  }
+  return 0;
+}
+
+static void mpc_err_add_expected(mpc_err_t *x, char *expected) {
+  x->expected_num++;
+  x->expected = realloc(x->expected, sizeof(char*) * x->expected_num);
+  x->expected[x->expected_num-1] = expected;
+}
+
+/*
+** Merges a failure into an error. Only the furthest
+** failures count, the first failure message among
+** them wins, and otherwise what each one expected is
+** listed once in the order they failed in.
+*/
+
+static void mpc_err_fold(mpc_err_t *e, const mpc_fail_t *x) {
+
+  int j;
+  char *expect;
+
+  if (x->state.pos < e->state.pos) { return; }
+
+  if (x->state.pos > e->state.pos) {
+    for (j = 0; j < e->expected_num; j++) { free(e->expected[j]); }
+    free(e->expected);
+    free(e->failure);
+    e->expected_num = 0;
+    e->expected = NULL;
+    e->failure = NULL;
+    e->state = x->state;
+  }
+
+  if (e->failure) { return; }
+
+  if (x->failure) {
+    e->failure = malloc(strlen(x->m) + 1);
+    strcpy(e->failure, x->m);
+    return;
+  }
+
+  e->received = x->received;
+
+  expect = malloc((x->prefix ? strlen(x->prefix) : 0) + strlen(x->m) + 1);
+  strcpy(expect, x->prefix ? x->prefix : "");
+  strcat(expect, x->m);
+
+  if (mpc_err_contains_expected(e, expect)) { free(expect); return; }
+  mpc_err_add_expected(e, expect);
+}
+
+/* Repeats prefix what the last failure expected, "one or more of" it say */
+static mpc_err_t *mpc_err_repeat(mpc_input_t *i, mpc_err_t *x, const char *prefix) {
+
+  mpc_fail_t *f;
+  char *expect;
+
+  if (x == NULL) { return NULL; }
+
+  f = &i->fails[i->fails_num-1];
+  expect = mpc_malloc(i, strlen(prefix) + (f->prefix ? strlen(f->prefix) : 0) + 1);
+  strcpy(expect, prefix);
+  if (f->prefix) {
+    strcat(expect, f->prefix);
+    mpc_free(i, f->prefix);
+  }
+  f->prefix = expect;
+  return x;
+}
+
+static mpc_err_t *mpc_err_many1(mpc_input_t *i, mpc_err_t *x) {
+  return mpc_err_repeat(i, x, "one or more of ");
+}
+
+static mpc_err_t *mpc_err_count(mpc_input_t *i, mpc_err_t *x, int n) {
+  mpc_err_t *y;
+  int digits = n/10 + 1;
+  char *prefix;
+  if (x == NULL) { return NULL; }
+  prefix = mpc_malloc(i, digits + strlen(" of ") + 1);
+  sprintf(prefix, "%i of ", n);
+  y = mpc_err_repeat(i, x, prefix);
+  mpc_free(i, prefix);
+  return y;
+}
+
+/*
+** Parser Type
+*/
+
+enum {
+  MPC_TYPE_UNDEFINED  = 0,
+  MPC_TYPE_PASS       = 1,
+  MPC_TYPE_FAIL       = 2,
+  MPC_TYPE_LIFT       = 3,
+  MPC_TYPE_LIFT_VAL   = 4,
+  MPC_TYPE_EXPECT     = 5,
+  MPC_TYPE_ANCHOR     = 6,
+  MPC_TYPE_STATE      = 7,
+
+  MPC_TYPE_ANY        = 8,
+  MPC_TYPE_SINGLE     = 9,
+  MPC_TYPE_ONEOF      = 10,
+  MPC_TYPE_NONEOF     = 11,
+  MPC_TYPE_RANGE      = 12,
+  MPC_TYPE_SATISFY    = 13,
+  MPC_TYPE_STRING     = 14,
+
+  MPC_TYPE_APPLY      = 15,
+  MPC_TYPE_APPLY_TO   = 16,
+  MPC_TYPE_PREDICT    = 17,
+  MPC_TYPE_NOT        = 18,
+  MPC_TYPE_MAYBE      = 19,
+  MPC_TYPE_MANY       = 20,
+  MPC_TYPE_MANY1      = 21,
+  MPC_TYPE_COUNT      = 22,
+
+  MPC_TYPE_OR         = 23,
+  MPC_TYPE_AND        = 24,
+
+  MPC_TYPE_CHECK      = 25,
+  MPC_TYPE_CHECK_WITH = 26,
+
+  MPC_TYPE_SOI        = 27,
+  MPC_TYPE_EOI        = 28,
+
+  MPC_TYPE_PACKRAT    = 29,
+  MPC_TYPE_DFA        = 30,
+  MPC_TYPE_CLASS      = 31,
+  MPC_TYPE_SPAN       = 32
+};
+
+/*
+** A DFA built from a regular expression. Bytes are
+** first mapped to one of `classes` classes, and the
+** transition table has a row of those per state.
+** State 0 is dead and state 1 is the start.
+*/
+
+typedef struct {
+  int num;
+  int classes;
+  unsigned char cls[256];
+  unsigned short *trans;
+  char *accept;
+} mpc_dfa_t;
+
+static void mpc_dfa_delete(mpc_dfa_t *d) {
+  free(d->trans);
+  free(d->accept);
+  free(d);
+}
+
+static mpc_dfa_t *mpc_dfa_copy(mpc_dfa_t *a) {
+  mpc_dfa_t *d = malloc(sizeof(mpc_dfa_t));
+  memcpy(d, a, sizeof(mpc_dfa_t));
+  d->trans = malloc(sizeof(unsigned short) * a->num * a->classes);
+  memcpy(d->trans, a->trans, sizeof(unsigned short) * a->num * a->classes);
+  d->accept = malloc(a->num);
+  memcpy(d->accept, a->accept, a->num);
+  return d;
+}
+
+typedef struct { char *m; } mpc_pdata_fail_t;
+typedef struct { mpc_ctor_t lf; void *x; } mpc_pdata_lift_t;
+typedef struct { mpc_parser_t *x; char *m; } mpc_pdata_expect_t;
+typedef struct { int(*f)(char,char); } mpc_pdata_anchor_t;
+typedef struct { char x; } mpc_pdata_single_t;
+typedef struct { char x; char y; } mpc_pdata_range_t;
+typedef struct { int(*f)(char); } mpc_pdata_satisfy_t;
+typedef struct { char *x; unsigned char set[32]; } mpc_pdata_string_t;
+typedef struct { mpc_parser_t *x; mpc_apply_t f; } mpc_pdata_apply_t;
+typedef struct { mpc_parser_t *x; mpc_apply_to_t f; void *d; } mpc_pdata_apply_to_t;
+typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_check_t f; char *e; } mpc_pdata_check_t;
+typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_check_with_t f; void *d; char *e; } mpc_pdata_check_with_t;
+typedef struct { mpc_parser_t *x; } mpc_pdata_predict_t;
+typedef struct { mpc_parser_t *x; mpc_copy_t cx; mpc_dtor_t dx; long hits; long misses; } mpc_pdata_packrat_t;
+typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_ctor_t lf; } mpc_pdata_not_t;
+typedef struct { int n; mpc_fold_t f; mpc_parser_t *x; mpc_dtor_t dx; } mpc_pdata_repeat_t;
+typedef struct { int n; mpc_parser_t **xs; unsigned long *dispatch; unsigned long errs; } mpc_pdata_or_t;
+typedef struct { mpc_parser_t *x; mpc_dfa_t *d; int errs; } mpc_pdata_dfa_t;
+typedef struct { mpc_parser_t *x; unsigned char set[32]; int errs; } mpc_pdata_class_t;
+typedef struct { mpc_parser_t *x; unsigned char set[32]; int n; unsigned char lo[4], hi[4]; int errs; } mpc_pdata_span_t;
+typedef struct { int n; mpc_fold_t f; mpc_parser_t **xs; mpc_dtor_t *dxs;  } mpc_pdata_and_t;
+
+typedef union {
+  mpc_pdata_fail_t fail;
+  mpc_pdata_lift_t lift;
+  mpc_pdata_expect_t expect;
+  mpc_pdata_anchor_t anchor;
+  mpc_pdata_single_t single;
+  mpc_pdata_range_t range;
+  mpc_pdata_satisfy_t satisfy;
+  mpc_pdata_string_t string;
+  mpc_pdata_apply_t apply;
+  mpc_pdata_apply_to_t apply_to;
+  mpc_pdata_check_t check;
+  mpc_pdata_check_with_t check_with;
+  mpc_pdata_predict_t predict;
+  mpc_pdata_packrat_t packrat;
+  mpc_pdata_not_t not;
+  mpc_pdata_repeat_t repeat;
+  mpc_pdata_and_t and;
+  mpc_pdata_or_t or;
+  mpc_pdata_dfa_t dfa;
+  mpc_pdata_class_t cls;
+  mpc_pdata_span_t span;
+} mpc_pdata_t;
+
+/*
+** Profile counters of a named parser. Bytes, rewinds
+** and time include everything the parser called, and
+** time is process CPU time in clock ticks. For a rule
+** that recurses into itself they are only taken from
+** its outermost call, so nested calls are not counted
+** twice.
+*/
+
+typedef struct {
+  long calls;
+  long successes;
+  long failures;
+  long bytes;
+  long rewinds;
+  long ticks;
+} mpc_prof_t;
+
+struct mpc_parser_t {
+  char *name;
+  mpc_pdata_t data;
+  char type;
+  char retained;
+  char frozen;
+  char arena;
+  int id;
+  mpc_prof_t *prof;
+};
+
+static mpc_ast_arena_t *mpc_input_ast(mpc_input_t *i);
+static mpc_ast_t *mpc_ast_new_in(mpc_ast_arena_t *m, const char *tag, const char *contents);
+static mpc_val_t *mpc_ast_fold(mpc_ast_arena_t *m, int n, mpc_val_t **xs);
+
+static mpc_val_t *mpcf_input_nth_free(mpc_input_t *i, int n, mpc_val_t **xs, int x) {
+  int j;
+  for (j = 0; j < n; j++) { if (j != x) { mpc_free(i, xs[j]); } }
+  return xs[x];
+}
+
+static mpc_val_t *mpcf_input_fst_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 0); }
+static mpc_val_t *mpcf_input_snd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 1); }
+static mpc_val_t *mpcf_input_trd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 2); }
+
+static mpc_val_t *mpcf_input_strfold(mpc_input_t *i, int n, mpc_val_t **xs) {
+  int j;
+  size_t l = 0;
+  if (n == 0) { return mpc_calloc(i, 1, 1); }
+  for (j = 0; j < n; j++) { l += strlen(xs[j]); }
+  xs[0] = mpc_realloc(i, xs[0], l + 1);
+  for (j = 1; j < n; j++) { strcat(xs[0], xs[j]); mpc_free(i, xs[j]); }
+  return xs[0];
+}
+
+static mpc_val_t *mpcf_input_state_ast(mpc_input_t *i, int n, mpc_val_t **xs) {
+  mpc_state_t *s = ((mpc_state_t**)xs)[0];
+  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
+  a = mpc_ast_state(a, *s);
+  mpc_free(i, s);
+  (void) n;
+  return a;
+}
+
+static mpc_val_t *mpc_parse_fold(mpc_input_t *i, mpc_fold_t f, int n, mpc_val_t **xs) {
+  int j;
+  if (f == mpcf_null)      { return mpcf_null(n, xs); }
+  if (f == mpcf_fst)       { return mpcf_fst(n, xs); }
+  if (f == mpcf_snd)       { return mpcf_snd(n, xs); }
+  if (f == mpcf_trd)       { return mpcf_trd(n, xs); }
+  if (f == mpcf_fst_free)  { return mpcf_input_fst_free(i, n, xs); }
+  if (f == mpcf_snd_free)  { return mpcf_input_snd_free(i, n, xs); }
+  if (f == mpcf_trd_free)  { return mpcf_input_trd_free(i, n, xs); }
+  if (f == mpcf_strfold)   { return mpcf_input_strfold(i, n, xs); }
+  if (f == mpcf_state_ast) { return mpcf_input_state_ast(i, n, xs); }
+  for (j = 0; j < n; j++) { xs[j] = mpc_export(i, xs[j]); }
+  if (f == mpcf_fold_ast)  { return mpc_ast_fold(mpc_input_ast(i), n, xs); }
+  return f(j, xs);
+}
+
+static mpc_val_t *mpcf_input_free(mpc_input_t *i, mpc_val_t *x) {
+  mpc_free(i, x);
+  return NULL;
+}
+
+static mpc_val_t *mpcf_input_str_ast(mpc_input_t *i, mpc_val_t *c) {
+  mpc_ast_t *a = mpc_ast_new_in(mpc_input_ast(i), "", c);
+  mpc_free(i, c);
+  return a;
+}
+
+static mpc_val_t *mpc_parse_apply(mpc_input_t *i, mpc_apply_t f, mpc_val_t *x) {
+  if (f == mpcf_free)     { return mpcf_input_free(i, x); }
+  if (f == mpcf_str_ast)  { return mpcf_input_str_ast(i, x); }
+  return f(mpc_export(i, x));
+}
+
+static mpc_val_t *mpc_parse_apply_to(mpc_input_t *i, mpc_apply_to_t f, mpc_val_t *x, mpc_val_t *d) {
+  return f(mpc_export(i, x), d);
+}
+
+static void mpc_parse_dtor(mpc_input_t *i, mpc_dtor_t d, mpc_val_t *x) {
+  if (d == free) { mpc_free(i, x); return; }
+  d(mpc_export(i, x));
+}
+
+/*
+** Packrat Memo
+*/
+
+/*
+** Memo and profile counters are shared by every
+** thread parsing with the same grammar, and tag
+** arenas by nodes which may be freed on any thread,
+** so they are only ever added to atomically. Without
+** a way to do that mpc can only be built for a
+** single thread, by defining MPC_NO_THREADS.
+*/
+
+#if defined(__GNUC__)
+static long mpc_atomic_add(long *x, long n) { return __atomic_add_fetch(x, n, __ATOMIC_ACQ_REL); }
+#elif defined(_MSC_VER)
+static long mpc_atomic_add(long *x, long n) { return _InterlockedExchangeAdd(x, n) + n; }
+#elif defined(MPC_NO_THREADS)
+static long mpc_atomic_add(long *x, long n) { return (*x) += n; }
+#else
+#error "mpc has no atomic add for this compiler, define MPC_NO_THREADS to build it for a single thread"
+#endif
+
+/*
+** While parsing, memo and profile counts are kept
+** by the input in a table of the parsers it has
+** counted for, and only added to the parsers' own
+** counters once the parse is done, so threads that
+** share a grammar don't contend on it every call.
+*/
+
+enum { MPC_INPUT_TALLIES_MIN = 32 };
+
+typedef struct mpc_tally_t {
+  mpc_parser_t *p;
+  int open;
+  long hits;
+  long misses;
+  mpc_prof_t prof;
+} mpc_tally_t;
+
+static mpc_tally_t *mpc_input_tally(mpc_input_t *i, mpc_parser_t *p) {
+
+  mpc_tally_t *old = i->tallies;
+  unsigned long h;
+  int k, n = i->tallies_slots;
+
+  if (i->tallies_num * 2 >= i->tallies_slots) {
+    i->tallies_slots = n ? n * 2 : MPC_INPUT_TALLIES_MIN;
+    i->tallies = calloc(i->tallies_slots, sizeof(mpc_tally_t));
+    i->tallies_num = 0;
+    for (k = 0; k < n; k++) {
+      if (old[k].p) { *mpc_input_tally(i, old[k].p) = old[k]; }
+    }
+    free(old);
+  }
+
+  h = (unsigned long)((size_t)p / sizeof(mpc_parser_t)) * 2654435761ul;
+  k = (int)((h >> 8) & (unsigned long)(i->tallies_slots - 1));
+  while (i->tallies[k].p && i->tallies[k].p != p) {
+    k = (k + 1) & (i->tallies_slots - 1);
+  }
+
+  if (i->tallies[k].p == NULL) {
+    i->tallies[k].p = p;
+    i->tallies_num++;
+  }
+
+  return &i->tallies[k];
+}
+
+/* Adds what a parse has counted to the parsers, which may be deleted before the input is */
+static void mpc_input_tallies_merge(mpc_input_t *i) {
+
+  mpc_tally_t *y;
+  int k;
+
+  for (k = 0; k < i->tallies_slots; k++) {
+    y = &i->tallies[k];
+    if (y->p == NULL) { continue; }
+    if (y->p->type == MPC_TYPE_PACKRAT) {
+      if (y->hits) { mpc_atomic_add(&y->p->data.packrat.hits, y->hits); }
+      if (y->misses) { mpc_atomic_add(&y->p->data.packrat.misses, y->misses); }
+    }
+    if (y->p->prof && y->prof.calls) {
+      mpc_atomic_add(&y->p->prof->calls, y->prof.calls);
+      mpc_atomic_add(&y->p->prof->successes, y->prof.successes);
+      mpc_atomic_add(&y->p->prof->failures, y->prof.failures);
+      mpc_atomic_add(&y->p->prof->bytes, y->prof.bytes);
+      mpc_atomic_add(&y->p->prof->rewinds, y->prof.rewinds);
+      mpc_atomic_add(&y->p->prof->ticks, y->prof.ticks);
+    }
+  }
+
+  if (i->tallies) { memset(i->tallies, 0, sizeof(mpc_tally_t) * i->tallies_slots); }
+  i->tallies_num = 0;
+}
+
+static void mpc_input_tallies_delete(mpc_input_t *i) {
+  free(i->tallies);
+}
+
+/* Results depend on whether errors are suppressed, backtracking and dispatch are on */
+static int mpc_input_memo_flags(mpc_input_t *i) {
+  return (i->suppress > 0) | ((i->backtrack > 0) << 1) | ((i->dispatch > 0) << 2);
+}
+
+static mpc_memo_t *mpc_input_memo_slot(mpc_input_t *i, mpc_parser_t *p, long pos) {
+  unsigned long h;
+  if (i->memo == NULL) { i->memo = calloc(MPC_INPUT_MEMO_NUM, sizeof(mpc_memo_t)); }
+  h = (unsigned long)((size_t)p / sizeof(mpc_parser_t));
+  h = (h ^ (unsigned long)pos) * 2654435761ul;
+  return &i->memo[(h >> 8) % MPC_INPUT_MEMO_NUM];
+}
+
+static void mpc_input_memo_release(mpc_input_t *i, mpc_memo_t *m) {
+  if (m->parser == NULL) { return; }
+  if (m->success && m->value) { m->parser->data.packrat.dx(m->value); }
+  if (!m->success) { mpc_fail_delete(i, m->value); }
+  m->parser = NULL;
+}
+
+static void mpc_input_memo_delete(mpc_input_t *i) {
+  int j;
+  if (i->memo == NULL) { return; }
+  for (j = 0; j < MPC_INPUT_MEMO_NUM; j++) {
+    mpc_input_memo_release(i, &i->memo[j]);
+  }
+  free(i->memo);
+}
+
+static void mpc_input_jump(mpc_input_t *i, mpc_state_t s, char last) {
+  i->state = s;
+  i->last = last;
+  if (i->type == MPC_INPUT_FILE) {
+    fseek(i->file, i->state.pos, SEEK_SET);
+  }
+}
+
+/* Trees, on the heap or in an arena, are shared with the memo rather than copied, see mpc_ast_own */
+static mpc_val_t *mpc_input_memo_copy(mpc_copy_t cx, mpc_val_t *x) {
+  if (cx == (mpc_copy_t)mpc_ast_copy) {
+    ((mpc_ast_t*)x)->refs++;
+    return x;
+  }
+  return cx(x);
+}
+
+/*
+** Looks up the memo for a packrat parser at the
+** current position. Returns -1 on a miss, or
+** whether the remembered result was a success,
+** in which case a copy of it is written to r.
+*/
+
+static int mpc_input_memo_recall(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
+
+  mpc_pdata_packrat_t *d = &p->data.packrat;
+  mpc_memo_t *m = mpc_input_memo_slot(i, p, i->state.pos);
+
+  if (m->parser != p || m->pos != i->state.pos || m->flags != mpc_input_memo_flags(i)) {
+    mpc_input_tally(i, p)->misses++;
+    return -1;
+  }
+
+  mpc_input_tally(i, p)->hits++;
+  if (m->success) {
+    mpc_input_jump(i, m->state, m->last);
+    r->output = m->value ? mpc_input_memo_copy(d->cx, m->value) : NULL;
+    return 1;
+  }
+  r->error = mpc_err_recall(i, m->value);
+  return 0;
+}
+
+static void mpc_input_memo_store(mpc_input_t *i, mpc_parser_t *p, long pos, int flags, int x, mpc_result_t *r) {
+
+  mpc_pdata_packrat_t *d = &p->data.packrat;
+  mpc_memo_t *m = mpc_input_memo_slot(i, p, pos);
+
+  mpc_input_memo_release(i, m);
+
+  if (x) {
+    r->output = mpc_export(i, r->output);
+    m->state = i->state;
+    m->last = i->last;
+    m->value = r->output ? mpc_input_memo_copy(d->cx, r->output) : NULL;
+  } else {
+    m->value = r->error ? mpc_fail_copy(i, &i->fails[i->fails_num-1]) : NULL;
+  }
+
+  m->parser = p;
+  m->pos = pos;
+  m->flags = flags;
+  m->success = x;
+}
+
+/*
+** The parser runs as a loop over an explicit stack
+** of frames rather than by recursion, so nesting
+** is only limited by memory. A frame is entered
+** once, when `j` is still -1. After that it is
+** resumed each time a child it pushed returns,
+** with the child's result in `x` and `res`. For
+** repeats and sequences `j` counts the results
+** collected so far, and for choices it is the
+** alternative being tried.
+*/
+
+enum {
+  MPC_PARSE_STACK_MIN = 4,
+  MPC_PARSE_FRAMES_MIN = 64
+};
+
+typedef struct {
+  mpc_parser_t *p;
+  int j;
+  int slots;
+  mpc_result_t *results;
+  mpc_result_t results_stk[MPC_PARSE_STACK_MIN];
+  long pos;
+  int flags;
+  long start;
+  long rewinds;
+  clock_t clock;
+} mpc_frame_t;
+
+typedef struct {
+  int num;
+  int slots;
+  mpc_frame_t *frames;
+} mpc_stack_t;
+
+static mpc_frame_t *mpc_stack_push(mpc_stack_t *s, mpc_parser_t *p) {
+  mpc_frame_t *f;
+  if (s->num == s->slots) {
+    s->slots *= 2;
+    s->frames = realloc(s->frames, sizeof(mpc_frame_t) * s->slots);
+  }
+  f = &s->frames[s->num++];
+  f->p = p;
+  f->j = -1;
+  f->results = NULL;
+  return f;
+}
+
+/* Results live in the frame until there are too many */
+static mpc_result_t *mpc_frame_results(mpc_frame_t *f) {
+  return f->results ? f->results : f->results_stk;
+}
+
+static void mpc_frame_results_free(mpc_input_t *i, mpc_frame_t *f) {
+  if (f->results) { mpc_free(i, f->results); }
+}
+
+/* Make room for one more result in a repeat frame */
+static void mpc_frame_results_grow(mpc_input_t *i, mpc_frame_t *f) {
+  if (f->j < MPC_PARSE_STACK_MIN) { return; }
+  if (f->j == MPC_PARSE_STACK_MIN) {
+    f->slots = f->j + f->j / 2;
+    f->results = mpc_malloc(i, sizeof(mpc_result_t) * f->slots);
+    memcpy(f->results, f->results_stk, sizeof(mpc_result_t) * MPC_PARSE_STACK_MIN);
+  } else if (f->j >= f->slots) {
+    f->slots = f->j + f->j / 2;
+    f->results = mpc_realloc(i, f->results, sizeof(mpc_result_t) * f->slots);
+  }
+}
+
+/*
+** The first alternative of an `or` from j which
+** may match the next byte, or n if there is none.
+** Those skipped could only have failed right here,
+** so the `or` is noted to run them should it matter.
+*/
+
+static void mpc_err_skip(mpc_input_t *i, mpc_parser_t *p, int j, int k) {
+
+  int m, certain = 0;
+  mpc_fail_t *x;
+
+  if (i->suppress) { return; }
+
+  for (m = j; m < k; m++) { certain = certain || ((p->data.or.errs >> m) & 1); }
+
+  if (mpc_err_defer(i, p, i->state, i->last, i->state.pos, certain)) {
+    x = &i->fails[i->fails_num-1];
+    x->lo = j;
+    x->hi = k;
+  }
+}
+
+static int mpc_input_dispatch(mpc_input_t *i, mpc_parser_t *p, int j) {
+
+  unsigned long m;
+  int k = j;
+
+  if (!i->dispatch || !p->data.or.dispatch || j >= p->data.or.n) { return j; }
+
+  m = p->data.or.dispatch[(unsigned char)mpc_input_peekc(i)] >> j;
+  while (m && !(m & 1)) { m >>= 1; k++; }
+  if (!m) { k = p->data.or.n; }
+  if (k > j) { mpc_err_skip(i, p, j, k); }
+  return k;
+}
+
+/*
+** The fast paths below read straight from the bytes
+** an input holds, which for a pipe is its buffer.
+** A file is read a byte at a time instead.
+*/
+
+static int mpc_input_held(mpc_input_t *i) {
+  return i->type != MPC_INPUT_FILE;
+}
+
+/* Returns where the current position is held and how many bytes follow it */
+static const char *mpc_input_bytes(mpc_input_t *i, long *n) {
+  if (i->type == MPC_INPUT_PIPE) {
+    *n = (long)i->buffer_len - (i->state.pos - i->buffer_pos);
+    return i->buffer + (i->state.pos - i->buffer_pos);
+  }
+  *n = (long)i->length - i->state.pos;
+  return i->string + i->state.pos;
+}
+
+/*
+** Reads another chunk into a pipe once the bytes
+** held run out. The buffer may move even if none
+** are read, so s and n are always found again.
+*/
+
+static int mpc_input_more(mpc_input_t *i, const char **s, long *n) {
+  int x;
+  if (i->type != MPC_INPUT_PIPE) { return 0; }
+  x = mpc_input_pipe_fill(i);
+  *s = mpc_input_bytes(i, n);
+  return x;
+}
+
+/*
+** Runs a DFA over the bytes an input holds and
+** takes the longest match, as the combinators it
+** was built from would have. Like them it stops
+** at a null byte. The position of the byte it
+** stopped at is written to reach.
+*/
+
+static int mpc_input_dfa(mpc_input_t *i, mpc_dfa_t *d, char **o, long *reach) {
+
+  long n, k, best = d->accept[1] ? 0 : -1;
+  const char *s = mpc_input_bytes(i, &n);
+  int st = 1;
+
+  for (k = 0; ; k++) {
+    if (k == n && !mpc_input_more(i, &s, &n)) { break; }
+    if (s[k] == '\0') { break; }
+    st = d->trans[st * d->classes + d->cls[(unsigned char)s[k]]];
+    if (st == 0) { break; }
+    if (d->accept[st]) { best = k + 1; }
+  }
+
+  *reach = i->state.pos + k;
+  if (best < 0) { return 0; }
+
+  for (k = 0; k < best; k++) {
+    i->state.col++;
+    if (s[k] == '\n') {
+      i->state.col = 0;
+      i->state.row++;
+    }
+  }
+
+  i->state.pos += best;
+  if (best > 0) { i->last = s[best-1]; }
+
+  *o = mpc_malloc(i, best + 1);
+  memcpy(*o, s, best);
+  (*o)[best] = '\0';
+  return 1;
+}
+
+/*
+** Returns how far from k the run of bytes in a
+** class goes in s. When the class is a few ranges
+** sixteen bytes are tested at a time.
+*/
+
+static long mpc_span_scan(mpc_pdata_span_t *d, const unsigned char *s, long k, long n) {
+#ifdef MPC_USE_SSE2
+  __m128i v, m, t;
+  int b;
+
+  while (d->n > 0 && k + 16 <= n) {
+    v = _mm_loadu_si128((const __m128i*)(s + k));
+    m = _mm_setzero_si128();
+    for (b = 0; b < d->n; b++) {
+      t = _mm_sub_epi8(v, _mm_set1_epi8((char)d->lo[b]));
+      t = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8((char)(d->hi[b] - d->lo[b]))), t);
+      m = _mm_or_si128(m, t);
+    }
+    if (_mm_movemask_epi8(m) != 0xFFFF) { break; }
+    k += 16;
+  }
+#endif
+
+  while (k < n && mpc_set_has(d->set, s[k])) { k++; }
+  return k;
+}
+
+/* Takes the run of bytes in a class from the bytes an input holds */
+static int mpc_input_span(mpc_input_t *i, mpc_pdata_span_t *d, int min, char **o) {
+
+  long n, k, j;
+  const char *t = mpc_input_bytes(i, &n);
+  const unsigned char *s = (const unsigned char*)t;
+
+  k = mpc_span_scan(d, s, 0, n);
+  while (k == n && mpc_input_more(i, &t, &n)) {
+    s = (const unsigned char*)t;
+    k = mpc_span_scan(d, s, k, n);
+  }
+  s = (const unsigned char*)t;
+
+  if (k < min) { return 0; }
+
+  if (mpc_set_has(d->set, '\n')) {
+    for (j = 0; j < k; j++) {
+      i->state.col++;
+      if (s[j] == '\n') {
+        i->state.col = 0;
+        i->state.row++;
+      }
+    }
+  } else {
+    i->state.col += k;
+  }
+
+  i->state.pos += k;
+  if (k > 0) { i->last = (char)s[k-1]; }
+
+  *o = mpc_malloc(i, k + 1);
+  memcpy(*o, s, k);
+  (*o)[k] = '\0';
+  return 1;
+}
+
+/*
+** Leaf parsers are run straight away rather than
+** given a frame. Returns -1 if p is not a leaf.
+*/
+
+static int mpc_parse_leaf(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
+
+  int x;
+  long reach;
+  mpc_state_t s = i->state;
+  char last = i->last;
+  mpc_err_t *e;
+
+  switch (p->type) {
+
+    /* Basic Parsers */
+
+    case MPC_TYPE_ANY:     x = mpc_input_any(i, (char**)&r->output); break;
+    case MPC_TYPE_SINGLE:  x = mpc_input_char(i, p->data.single.x, (char**)&r->output); break;
+    case MPC_TYPE_RANGE:   x = mpc_input_range(i, p->data.range.x, p->data.range.y, (char**)&r->output); break;
+    case MPC_TYPE_ONEOF:   x = mpc_input_class(i, p->data.string.set, (char**)&r->output); break;
+    case MPC_TYPE_NONEOF:  x = mpc_input_class(i, p->data.string.set, (char**)&r->output); break;
+    case MPC_TYPE_SATISFY: x = mpc_input_satisfy(i, p->data.satisfy.f, (char**)&r->output); break;
+    case MPC_TYPE_STRING:  x = mpc_input_string(i, p->data.string.x, (char**)&r->output); break;
+    case MPC_TYPE_ANCHOR:  x = mpc_input_anchor(i, p->data.anchor.f, (char**)&r->output); break;
+    case MPC_TYPE_SOI:     x = mpc_input_soi(i, (char**)&r->output); break;
+    case MPC_TYPE_EOI:     x = mpc_input_eoi(i, (char**)&r->output); break;
+
+    /* Other parsers */
+
+    case MPC_TYPE_UNDEFINED: r->error = mpc_err_fail(i, "Parser Undefined!"); return 0;
+    case MPC_TYPE_PASS:      r->output = NULL; return 1;
+    case MPC_TYPE_FAIL:      r->error = mpc_err_fail(i, p->data.fail.m); return 0;
+    case MPC_TYPE_LIFT:      r->output = p->data.lift.lf(); return 1;
+    case MPC_TYPE_LIFT_VAL:  r->output = p->data.lift.x; return 1;
+    case MPC_TYPE_STATE:     r->output = mpc_input_state_copy(i); return 1;
+
+    /*
+    ** The fast paths note the combinators they replace
+    ** as failures to run later, since those would have
+    ** noted failures of their own. A DFA only matches
+    ** them while backtracking is on. A span notes the
+    ** byte parser at the end of the run, as that would
+    ** have failed there, further than anything before.
+    */
+
+    case MPC_TYPE_DFA:
+      if (!i->dispatch || i->backtrack < 1 || !mpc_input_held(i)) { return -1; }
+      x = mpc_input_dfa(i, p->data.dfa.d, (char**)&r->output, &reach);
+      e = mpc_err_defer(i, p->data.dfa.x, s, last, reach, !x && p->data.dfa.errs);
+      if (!x) { r->error = e; }
+      return x;
+
+    case MPC_TYPE_CLASS:
+      if (!i->dispatch) { return -1; }
+      x = mpc_input_class(i, p->data.cls.set, (char**)&r->output);
+      e = mpc_err_defer(i, p->data.cls.x, s, last, s.pos, !x && p->data.cls.errs);
+      if (!x) { r->error = e; }
+      return x;
+
+    case MPC_TYPE_SPAN:
+      if (!i->dispatch || !mpc_input_held(i)) { return -1; }
+      x = mpc_input_span(i, &p->data.span, p->data.span.x->type == MPC_TYPE_MANY1, (char**)&r->output);
+      e = mpc_err_defer(i, p->data.span.x->data.repeat.x, i->state, i->last, i->state.pos, p->data.span.errs);
+      if (!x) { r->error = mpc_err_many1(i, e); }
+      return x;
+
+    default: return -1;
+  }
+
+  if (!x) { r->error = NULL; }
+  return x;
+}
+
+/*
+** In profiling mode every call of a named parser,
+** leaf or frame, notes where it started and adds
+** its outcome to the parser's counters on return.
+**
+** The input's tally counts how many calls of each
+** profiled parser are open, so only the outermost
+** one adds its bytes, rewinds and time.
+*/
+
+static void mpc_profile_enter(mpc_input_t *i, mpc_parser_t *p) {
+  mpc_input_tally(i, p)->open++;
+}
+
+static void mpc_profile_add(mpc_input_t *i, mpc_parser_t *p, int x, long start, long rewinds, clock_t t) {
+  mpc_tally_t *y = mpc_input_tally(i, p);
+  y->prof.calls++;
+  if (x) { y->prof.successes++; } else { y->prof.failures++; }
+  if (--y->open > 0) { return; }
+  if (x) { y->prof.bytes += i->state.pos - start; }
+  y->prof.rewinds += i->rewinds - rewinds;
+  y->prof.ticks += (long)(clock() - t);
+}
+
+#define MPC_RETURN(v) { \
+  x = (v); \
+  if (i->profile && p->prof) { mpc_profile_add(i, p, x, f->start, f->rewinds, f->clock); } \
+  s.num--; continue; }
+#define MPC_SUCCESS(v) { res.output = (v); MPC_RETURN(1) }
+#define MPC_FAILURE(v) { res.error = (v); MPC_RETURN(0) }
+#define MPC_CALL(q) { c = (q); break; }
+
+static int mpc_parse_run(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
+
+  int x = 0, k;
+  long start = 0, rewinds = 0;
+  clock_t t = 0;
+  mpc_result_t res;
+  mpc_result_t *results;
+  mpc_parser_t *c = NULL;
+  mpc_frame_t *f;
+  mpc_stack_t s;
+
+  s.num = 0;
+  s.slots = MPC_PARSE_FRAMES_MIN;
+  s.frames = malloc(sizeof(mpc_frame_t) * s.slots);
+  res.output = NULL;
+  c = p;
+
+  while (c != NULL) {
+
+    /* Calling a child */
+
+    if (i->profile && c->prof) {
+      mpc_profile_enter(i, c);
+      start = i->state.pos;
+      rewinds = i->rewinds;
+      t = clock();
+    }
+
+    if ((x = mpc_parse_leaf(i, c, &res)) == -1) {
+      f = mpc_stack_push(&s, c);
+      f->start = start;
+      f->rewinds = rewinds;
+      f->clock = t;
+    } else if (i->profile && c->prof) {
+      mpc_profile_add(i, c, x, start, rewinds, t);
+    }
+
+    c = NULL;
+
+    while (c == NULL && s.num > 0) {
+
+      f = &s.frames[s.num-1];
+      p = f->p;
+
+      /* Entering a frame */
+
+      if (f->j == -1) {
+
+        f->j = 0;
+
+        switch (p->type) {
+
+          /* Application Parsers */
+
+          case MPC_TYPE_APPLY:      MPC_CALL(p->data.apply.x);
+          case MPC_TYPE_APPLY_TO:   MPC_CALL(p->data.apply_to.x);
+          case MPC_TYPE_CHECK:      MPC_CALL(p->data.check.x);
+          case MPC_TYPE_CHECK_WITH: MPC_CALL(p->data.check_with.x);
+
+          case MPC_TYPE_EXPECT:
+            mpc_input_suppress_enable(i);
+            MPC_CALL(p->data.expect.x);
+
+          case MPC_TYPE_PREDICT:
+            mpc_input_backtrack_disable(i);
+            MPC_CALL(p->data.predict.x);
+
+          case MPC_TYPE_DFA: MPC_CALL(p->data.dfa.x);
+          case MPC_TYPE_CLASS: MPC_CALL(p->data.cls.x);
+          case MPC_TYPE_SPAN: MPC_CALL(p->data.span.x);
+
+          case MPC_TYPE_PACKRAT:
+            k = mpc_input_memo_recall(i, p, &res);
+            if (k != -1) { MPC_RETURN(k); }
+            f->pos = i->state.pos;
+            f->flags = mpc_input_memo_flags(i);
+            MPC_CALL(p->data.packrat.x);
+
+          /* Optional Parsers */
+
+          case MPC_TYPE_NOT:
+            mpc_input_mark(i);
+            mpc_input_suppress_enable(i);
+            MPC_CALL(p->data.not.x);
+
+          case MPC_TYPE_MAYBE: MPC_CALL(p->data.not.x);
+
+          /* Repeat Parsers */
+
+          case MPC_TYPE_MANY:
+          case MPC_TYPE_MANY1:
+            MPC_CALL(p->data.repeat.x);
+
+          case MPC_TYPE_COUNT:
+            if (p->data.repeat.n > MPC_PARSE_STACK_MIN) {
+              f->results = mpc_malloc(i, sizeof(mpc_result_t) * p->data.repeat.n);
+            }
+            MPC_CALL(p->data.repeat.x);
+
+          /* Combinatory Parsers */
+
+          case MPC_TYPE_OR:
+            if (p->data.or.n == 0) { MPC_SUCCESS(NULL); }
+            f->j = mpc_input_dispatch(i, p, 0);
+            if (f->j == p->data.or.n) { MPC_FAILURE(NULL); }
+            MPC_CALL(p->data.or.xs[f->j]);
+
+          case MPC_TYPE_AND:
+            if (p->data.and.n == 0) { MPC_SUCCESS(NULL); }
+            if (p->data.and.n > MPC_PARSE_STACK_MIN) {
+              f->results = mpc_malloc(i, sizeof(mpc_result_t) * p->data.and.n);
+            }
+            mpc_input_mark(i);
+            MPC_CALL(p->data.and.xs[0]);
+
+          /* Leaves and End */
+
+          default:
+            MPC_FAILURE(mpc_err_fail(i, "Unknown Parser Type Id!"));
+        }
+
+      } else {
+
+        /* Resuming a frame with the result of its child */
+
+        switch (p->type) {
+
+          case MPC_TYPE_APPLY:
+            if (x) { MPC_SUCCESS(mpc_parse_apply(i, p->data.apply.f, res.output)); }
+            MPC_RETURN(0);
+
+          case MPC_TYPE_APPLY_TO:
+            if (x) { MPC_SUCCESS(mpc_parse_apply_to(i, p->data.apply_to.f, res.output, p->data.apply_to.d)); }
+            MPC_RETURN(0);
+
+          case MPC_TYPE_CHECK:
+            if (x && !p->data.check.f(&res.output)) {
+              mpc_parse_dtor(i, p->data.check.dx, res.output);
+              MPC_FAILURE(mpc_err_fail(i, p->data.check.e));
+            }
+            MPC_RETURN(x);
+
+          case MPC_TYPE_CHECK_WITH:
+            if (x && !p->data.check_with.f(&res.output, p->data.check_with.d)) {
+              mpc_parse_dtor(i, p->data.check_with.dx, res.output);
+              MPC_FAILURE(mpc_err_fail(i, p->data.check_with.e));
+            }
+            MPC_RETURN(x);
+
+          case MPC_TYPE_EXPECT:
+            mpc_input_suppress_disable(i);
+            if (x) { MPC_RETURN(1); }
+            MPC_FAILURE(mpc_err_new(i, p->data.expect.m));
+
+          case MPC_TYPE_PREDICT:
+            mpc_input_backtrack_enable(i);
+            MPC_RETURN(x);
+
+          case MPC_TYPE_PACKRAT:
+            mpc_input_memo_store(i, p, f->pos, f->flags, x, &res);
+            MPC_RETURN(x);
+
+          /* TODO: Update Not Error Message */
+
+          case MPC_TYPE_NOT:
+            if (x) {
+              mpc_input_rewind(i);
+              mpc_input_suppress_disable(i);
+              mpc_parse_dtor(i, p->data.not.dx, res.output);
+              MPC_FAILURE(mpc_err_new(i, "opposite"));
+            }
+            mpc_input_unmark(i);
+            mpc_input_suppress_disable(i);
+            MPC_SUCCESS(p->data.not.lf());
+
+          case MPC_TYPE_MAYBE:
+            if (x) { MPC_RETURN(1); }
+            MPC_SUCCESS(p->data.not.lf());
+
+          case MPC_TYPE_MANY:
+          case MPC_TYPE_MANY1:
+
+            if (x) {
+              mpc_frame_results_grow(i, f);
+              mpc_frame_results(f)[f->j++] = res;
+              MPC_CALL(p->data.repeat.x);
+            }
+
+            if (p->type == MPC_TYPE_MANY1 && f->j == 0) {
+              MPC_FAILURE(mpc_err_many1(i, res.error));
+            }
+
+            res.output = mpc_parse_fold(i, p->data.repeat.f, f->j, (mpc_val_t**)mpc_frame_results(f));
+            mpc_frame_results_free(i, f);
+            MPC_RETURN(1);
+
+          case MPC_TYPE_COUNT:
+
+            results = mpc_frame_results(f);
+
+            if (x) {
+              results[f->j++] = res;
+              if (f->j < p->data.repeat.n) { MPC_CALL(p->data.repeat.x); }
+            }
+
+            if (f->j == p->data.repeat.n) {
+              res.output = mpc_parse_fold(i, p->data.repeat.f, f->j, (mpc_val_t**)results);
+              mpc_frame_results_free(i, f);
+              MPC_RETURN(1);
+            }
+
+            for (k = 0; k < f->j; k++) {
+              mpc_parse_dtor(i, p->data.repeat.dx, results[k].output);
+            }
+            res.error = mpc_err_count(i, res.error, p->data.repeat.n);
+            mpc_frame_results_free(i, f);
+            MPC_RETURN(0);
+
+          case MPC_TYPE_OR:
+
+            if (x) { MPC_RETURN(1); }
+
+            f->j = mpc_input_dispatch(i, p, f->j + 1);
+            if (f->j < p->data.or.n) { MPC_CALL(p->data.or.xs[f->j]); }
+            MPC_FAILURE(NULL);
+
+          case MPC_TYPE_AND:
+
+            results = mpc_frame_results(f);
+
+            if (x) {
+              results[f->j++] = res;
+              if (f->j < p->data.and.n) { MPC_CALL(p->data.and.xs[f->j]); }
+              mpc_input_unmark(i);
+              res.output = mpc_parse_fold(i, p->data.and.f, f->j, (mpc_val_t**)results);
+              mpc_frame_results_free(i, f);
+              MPC_RETURN(1);
+            }
+
+            mpc_input_rewind(i);
+            for (k = 0; k < f->j; k++) {
+              mpc_parse_dtor(i, p->data.and.dxs[k], results[k].output);
+            }
+            mpc_frame_results_free(i, f);
+            MPC_RETURN(0);
+
+          default: MPC_RETURN(x);
+        }
+      }
+    }
+  }
+
+  free(s.frames);
+  *r = res;
+  return x;
+
+}
+
+#undef MPC_RETURN
+#undef MPC_SUCCESS
+#undef MPC_FAILURE
+#undef MPC_CALL
+
+/*
+** Runs the parsers noted in the log without the fast
+** paths, each from where it was noted, so the log is
+** left with the failures they would have noted in
+** their place. The input is put back as it was.
+*/
+
+static void mpc_fail_settle(mpc_input_t *i) {
+
+  int j, k, n = i->fails_num;
+  int backtrack = i->backtrack, dispatch = i->dispatch, profile = i->profile;
+  long rewinds = i->rewinds;
+  mpc_state_t state = i->state;
+  char last = i->last;
+  mpc_fail_t *fails = i->fails, *d;
+  mpc_result_t r;
+
+  i->fails = NULL;
+  i->fails_num = 0;
+  i->fails_slots = 0;
+  i->fails_defers = 0;
+  i->dispatch = 0;
+  i->profile = 0;
+
+  for (j = 0; j < n; j++) {
+
+    d = &fails[j];
+
+    if (d->p == NULL) {
+      if (!mpc_fail_push(i, d, d->state.pos)) { mpc_free(i, d->prefix); }
+      continue;
+    }
+
+    i->backtrack = d->backtrack;
+
+    if (d->lo < d->hi) {
+      for (k = d->lo; k < d->hi; k++) {
+        mpc_input_jump(i, d->state, d->last);
+        mpc_parse_run(i, d->p->data.or.xs[k], &r);
+      }
+    } else {
+      mpc_input_jump(i, d->state, d->last);
+      if (mpc_parse_run(i, d->p, &r)) {
+        mpc_free(i, r.output);
+      } else if (d->prefix) {
+        mpc_err_repeat(i, r.error, d->prefix);
+      }
+    }
+
+    mpc_free(i, d->prefix);
+  }
+
+  free(fails);
+
+  i->backtrack = backtrack;
+  i->dispatch = dispatch;
+  i->profile = profile;
+  i->rewinds = rewinds;
+  mpc_input_jump(i, state, last);
+  mpc_fail_floor(i, i->fails_floor);
+}
+
+static mpc_err_t *mpc_err_build(mpc_input_t *i) {
+
+  int j;
+  mpc_err_t *e = malloc(sizeof(mpc_err_t));
+
+  e->filename = malloc(strlen(i->filename) + 1);
+  strcpy(e->filename, i->filename);
+  e->state = mpc_state_invalid();
+  e->expected_num = 0;
+  e->expected = NULL;
+  e->failure = malloc(strlen("Unknown Error") + 1);
+  strcpy(e->failure, "Unknown Error");
+  e->received = ' ';
+
+  mpc_fail_settle(i);
+  for (j = 0; j < i->fails_num; j++) { mpc_err_fold(e, &i->fails[j]); }
+  return e;
+}
+
+int mpc_parse_input(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
+
+  int x;
+
+  if (p->arena) { mpc_input_ast(i)->nodes = 1; }
+
+  x = mpc_parse_run(i, p, r);
+
+  if (x) {
+    r->output = mpc_export(i, r->output);
+    if (i->ast && i->ast->nodes) { i->ast->root = r->output; }
+  } else {
+    r->error = mpc_err_build(i);
+  }
+
+  mpc_input_tallies_merge(i);
+  return x;
+}
+
+int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_string(filename, string);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_nstring(filename, string, length);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_map(filename, file);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_pipe(filename, pipe);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
+
+  FILE *f = fopen(filename, "rb");
+  int res;
+
+  if (f == NULL) {
+    r->output = NULL;
+    r->error = mpc_err_file(filename, "Unable to open file!");
+    return 0;
+  }
+
+  res = mpc_parse_file(filename, f, p, r);
+  fclose(f);
+  return res;
+}
+
+/*
+** Building a Parser
+*/
+
+static void mpc_undefine_unretained(mpc_parser_t *p, int force);
+
+static void mpc_undefine_or(mpc_parser_t *p) {
+
+  int i;
+  for (i = 0; i < p->data.or.n; i++) {
+    mpc_undefine_unretained(p->data.or.xs[i], 0);
+  }
+  free(p->data.or.xs);
+  free(p->data.or.dispatch);
+
+}
+
+static void mpc_undefine_and(mpc_parser_t *p) {
+
+  int i;
+  for (i = 0; i < p->data.and.n; i++) {
+    mpc_undefine_unretained(p->data.and.xs[i], 0);
+  }
+  free(p->data.and.xs);
+  free(p->data.and.dxs);
+
+}
+
+static void mpc_undefine_unretained(mpc_parser_t *p, int force) {
+
+  if (p->retained && !force) { return; }
+
+  switch (p->type) {
+
+    case MPC_TYPE_FAIL: free(p->data.fail.m); break;
+
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_STRING:
+      free(p->data.string.x);
+      break;
+
+    case MPC_TYPE_APPLY:    mpc_undefine_unretained(p->data.apply.x, 0);    break;
+    case MPC_TYPE_APPLY_TO: mpc_undefine_unretained(p->data.apply_to.x, 0); break;
+    case MPC_TYPE_PREDICT:  mpc_undefine_unretained(p->data.predict.x, 0);  break;
+    case MPC_TYPE_PACKRAT:  mpc_undefine_unretained(p->data.packrat.x, 0);  break;
+
+    case MPC_TYPE_DFA:
+      mpc_undefine_unretained(p->data.dfa.x, 0);
+      mpc_dfa_delete(p->data.dfa.d);
+      break;
+
+    case MPC_TYPE_CLASS: mpc_undefine_unretained(p->data.cls.x, 0); break;
+    case MPC_TYPE_SPAN: mpc_undefine_unretained(p->data.span.x, 0); break;
+
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_NOT:
+      mpc_undefine_unretained(p->data.not.x, 0);
+      break;
+
+    case MPC_TYPE_EXPECT:
+      mpc_undefine_unretained(p->data.expect.x, 0);
+      free(p->data.expect.m);
+      break;
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      mpc_undefine_unretained(p->data.repeat.x, 0);
+      break;
+
+    case MPC_TYPE_OR:  mpc_undefine_or(p);  break;
+    case MPC_TYPE_AND: mpc_undefine_and(p); break;
+
+    case MPC_TYPE_CHECK:
+      mpc_undefine_unretained(p->data.check.x, 0);
+      free(p->data.check.e);
+      break;
+
+    case MPC_TYPE_CHECK_WITH:
+      mpc_undefine_unretained(p->data.check_with.x, 0);
+      free(p->data.check_with.e);
+      break;
+
+    default: break;
+  }
+
+  if (!force) {
+    free(p->name);
+    free(p);
+  }
+
+}
+
+void mpc_delete(mpc_parser_t *p) {
+  if (p->retained) {
+
+    if (p->type != MPC_TYPE_UNDEFINED) {
+      mpc_undefine_unretained(p, 0);
+    }
+
+    free(p->name);
+    free(p->prof);
+    free(p);
+
+  } else {
+    mpc_undefine_unretained(p, 0);
+  }
+}
+
+static void mpc_soft_delete(mpc_val_t *x) {
+  mpc_undefine_unretained(x, 0);
+}
+
+static mpc_parser_t *mpc_undefined(void) {
+  mpc_parser_t *p = calloc(1, sizeof(mpc_parser_t));
+  p->retained = 0;
+  p->frozen = 0;
+  p->arena = 0;
+  p->type = MPC_TYPE_UNDEFINED;
+  p->name = NULL;
+  p->prof = NULL;
+  p->id = -1;
+  return p;
+}
+
+mpc_parser_t *mpc_new(const char *name) {
+  mpc_parser_t *p = mpc_undefined();
+  p->retained = 1;
+  p->name = realloc(p->name, strlen(name) + 1);
+  strcpy(p->name, name);
+  p->prof = calloc(1, sizeof(mpc_prof_t));
+  return p;
+}
+
+mpc_parser_t *mpc_copy(mpc_parser_t *a) {
+  int i = 0;
+  mpc_parser_t *p;
+
+  if (a->retained) { return a; }
+
+  p = mpc_undefined();
+  p->retained = a->retained;
+  p->type = a->type;
+  p->data = a->data;
+
+  if (a->name) {
+    p->name = malloc(strlen(a->name)+1);
+    strcpy(p->name, a->name);
+  }
+
+  switch (a->type) {
+
+    case MPC_TYPE_FAIL:
+      p->data.fail.m = malloc(strlen(a->data.fail.m)+1);
+      strcpy(p->data.fail.m, a->data.fail.m);
+    break;
+
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_STRING:
+      p->data.string.x = malloc(strlen(a->data.string.x)+1);
+      strcpy(p->data.string.x, a->data.string.x);
+      break;
+
+    case MPC_TYPE_APPLY:    p->data.apply.x    = mpc_copy(a->data.apply.x);    break;
+    case MPC_TYPE_APPLY_TO: p->data.apply_to.x = mpc_copy(a->data.apply_to.x); break;
+    case MPC_TYPE_PREDICT:  p->data.predict.x  = mpc_copy(a->data.predict.x);  break;
+
+    case MPC_TYPE_PACKRAT:
+      p->data.packrat.x = mpc_copy(a->data.packrat.x);
+      p->data.packrat.hits = 0;
+      p->data.packrat.misses = 0;
+      break;
+
+    case MPC_TYPE_DFA:
+      p->data.dfa.x = mpc_copy(a->data.dfa.x);
+      p->data.dfa.d = mpc_dfa_copy(a->data.dfa.d);
+      break;
+
+    case MPC_TYPE_CLASS: p->data.cls.x = mpc_copy(a->data.cls.x); break;
+    case MPC_TYPE_SPAN: p->data.span.x = mpc_copy(a->data.span.x); break;
+
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_NOT:
+      p->data.not.x = mpc_copy(a->data.not.x);
+      break;
+
+    case MPC_TYPE_EXPECT:
+      p->data.expect.x = mpc_copy(a->data.expect.x);
+      p->data.expect.m = malloc(strlen(a->data.expect.m)+1);
+      strcpy(p->data.expect.m, a->data.expect.m);
+      break;
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      p->data.repeat.x = mpc_copy(a->data.repeat.x);
+      break;
+
+    case MPC_TYPE_OR:
+      p->data.or.xs = malloc(a->data.or.n * sizeof(mpc_parser_t*));
+      for (i = 0; i < a->data.or.n; i++) {
+        p->data.or.xs[i] = mpc_copy(a->data.or.xs[i]);
+      }
+      if (a->data.or.dispatch) {
+        p->data.or.dispatch = malloc(256 * sizeof(unsigned long));
+        memcpy(p->data.or.dispatch, a->data.or.dispatch, 256 * sizeof(unsigned long));
+      }
+    break;
+    case MPC_TYPE_AND:
+      p->data.and.xs = malloc(a->data.and.n * sizeof(mpc_parser_t*));
+      for (i = 0; i < a->data.and.n; i++) {
+        p->data.and.xs[i] = mpc_copy(a->data.and.xs[i]);
+      }
+      p->data.and.dxs = malloc((a->data.and.n-1) * sizeof(mpc_dtor_t));
+      for (i = 0; i < a->data.and.n-1; i++) {
+        p->data.and.dxs[i] = a->data.and.dxs[i];
+      }
+    break;
+
+    case MPC_TYPE_CHECK:
+      p->data.check.x      = mpc_copy(a->data.check.x);
+      p->data.check.e      = malloc(strlen(a->data.check.e)+1);
+      strcpy(p->data.check.e, a->data.check.e);
+      break;
+    case MPC_TYPE_CHECK_WITH:
+      p->data.check_with.x = mpc_copy(a->data.check_with.x);
+      p->data.check_with.e = malloc(strlen(a->data.check_with.e)+1);
+      strcpy(p->data.check_with.e, a->data.check_with.e);
+      break;
+
+    default: break;
+  }
+
+
+  return p;
+}
+
+mpc_parser_t *mpc_undefine(mpc_parser_t *p) {
+  mpc_undefine_unretained(p, 1);
+  p->type = MPC_TYPE_UNDEFINED;
+  p->frozen = 0;
+  return p;
+}
+
+mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a) {
+
+  if (p->frozen) {
+    fprintf(stderr, "Attempt to define Frozen Parser '%s'!\n", p->name ? p->name : "<unnamed>");
+    mpc_delete(a);
+    return NULL;
+  }
+
+  if (p->retained) {
+    p->type = a->type;
+    p->data = a->data;
+  } else {
+    mpc_parser_t *a2 = mpc_failf("Attempt to assign to Unretained Parser!");
+    p->type = a2->type;
+    p->data = a2->data;
+    free(a2);
+  }
+
+  free(a);
+  return p;
+}
+
+void mpc_cleanup(int n, ...) {
+  int i;
+  mpc_parser_t **list = malloc(sizeof(mpc_parser_t*) * n);
+
+  va_list va;
+  va_start(va, n);
+  for (i = 0; i < n; i++) { list[i] = va_arg(va, mpc_parser_t*); }
+  for (i = 0; i < n; i++) { mpc_undefine(list[i]); }
+  for (i = 0; i < n; i++) { mpc_delete(list[i]); }
+  va_end(va);
+
+  free(list);
+}
+
+mpc_parser_t *mpc_pass(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_PASS;
+  return p;
+}
+
+mpc_parser_t *mpc_fail(const char *m) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_FAIL;
+  p->data.fail.m = malloc(strlen(m) + 1);
+  strcpy(p->data.fail.m, m);
+  return p;
+}
+
+/*
+** As `snprintf` is not ANSI standard this
+** function `mpc_failf` should be considered
+** unsafe.
+**
+** You have a few options if this is going to be
+** trouble.
+**
+** - Ensure the format string does not exceed
+**   the buffer length using precision specifiers
+**   such as `%.512s`.
+**
+** - Patch this function in your code base to
+**   use `snprintf` or whatever variant your
+**   system supports.
+**
+** - Avoid it altogether.
+**
+*/
+
+mpc_parser_t *mpc_failf(const char *fmt, ...) {
+
+  va_list va;
+  char *buffer;
+
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_FAIL;
+
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+
+  buffer = realloc(buffer, strlen(buffer) + 1);
+  p->data.fail.m = buffer;
+  return p;
+
+}
+
+mpc_parser_t *mpc_lift_val(mpc_val_t *x) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_LIFT_VAL;
+  p->data.lift.x = x;
+  return p;
+}
+
+mpc_parser_t *mpc_lift(mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_LIFT;
+  p->data.lift.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_anchor(int(*f)(char,char)) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ANCHOR;
+  p->data.anchor.f = f;
+  return mpc_expect(p, "anchor");
+}
+
+mpc_parser_t *mpc_state(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_STATE;
+  return p;
+}
+
+mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *expected) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_EXPECT;
+  p->data.expect.x = a;
+  p->data.expect.m = malloc(strlen(expected) + 1);
+  strcpy(p->data.expect.m, expected);
+  return p;
+}
+
+/*
+** As `snprintf` is not ANSI standard this
+** function `mpc_expectf` should be considered
+** unsafe.
+**
+** You have a few options if this is going to be
+** trouble.
+**
+** - Ensure the format string does not exceed
+**   the buffer length using precision specifiers
+**   such as `%.512s`.
+**
+** - Patch this function in your code base to
+**   use `snprintf` or whatever variant your
+**   system supports.
+**
+** - Avoid it altogether.
+**
+*/
+
+mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...) {
+  va_list va;
+  char *buffer;
+
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_EXPECT;
+
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+
+  buffer = realloc(buffer, strlen(buffer) + 1);
+  p->data.expect.x = a;
+  p->data.expect.m = buffer;
+  return p;
+}
+
+/*
+** Basic Parsers
+*/
+
+mpc_parser_t *mpc_any(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ANY;
+  return mpc_expect(p, "any character");
+}
+
+mpc_parser_t *mpc_char(char c) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SINGLE;
+  p->data.single.x = c;
+  return mpc_expectf(p, "'%c'", c);
+}
+
+mpc_parser_t *mpc_range(char s, char e) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_RANGE;
+  p->data.range.x = s;
+  p->data.range.y = e;
+  return mpc_expectf(p, "character between '%c' and '%c'", s, e);
+}
+
+mpc_parser_t *mpc_oneof(const char *s) {
+  const char *c;
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ONEOF;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  memset(p->data.string.set, 0, 32);
+  for (c = s; *c; c++) { mpc_set_add(p->data.string.set, (unsigned char)*c); }
+  return mpc_expectf(p, "one of '%s'", s);
+}
+
+mpc_parser_t *mpc_noneof(const char *s) {
+  int j;
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_NONEOF;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  memset(p->data.string.set, 0, 32);
+  for (j = 1; j < 256; j++) {
+    if (strchr(s, (char)j) == 0) { mpc_set_add(p->data.string.set, j); }
+  }
+  return mpc_expectf(p, "none of '%s'", s);
+
+}
+
+mpc_parser_t *mpc_satisfy(int(*f)(char)) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SATISFY;
+  p->data.satisfy.f = f;
+  return mpc_expectf(p, "character satisfying function %p", f);
+}
+
+mpc_parser_t *mpc_string(const char *s) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_STRING;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  return mpc_expectf(p, "\"%s\"", s);
+}
+
+/*
+** Core Parsers
+*/
+
+mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_APPLY;
+  p->data.apply.x = a;
+  p->data.apply.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_APPLY_TO;
+  p->data.apply_to.x = a;
+  p->data.apply_to.f = f;
+  p->data.apply_to.d = x;
+  return p;
+}
+
+mpc_parser_t *mpc_check(mpc_parser_t *a, mpc_dtor_t da, mpc_check_t f, const char *e) {
+  mpc_parser_t  *p = mpc_undefined();
+  p->type = MPC_TYPE_CHECK;
+  p->data.check.x = a;
+  p->data.check.dx = da;
+  p->data.check.f = f;
+  p->data.check.e = malloc(strlen(e) + 1);
+  strcpy(p->data.check.e, e);
+  return p;
+}
+
+mpc_parser_t *mpc_check_with(mpc_parser_t *a, mpc_dtor_t da, mpc_check_with_t f, void *x, const char *e) {
+  mpc_parser_t  *p = mpc_undefined();
+  p->type = MPC_TYPE_CHECK_WITH;
+  p->data.check_with.x = a;
+  p->data.check_with.dx = da;
+  p->data.check_with.f = f;
+  p->data.check_with.d = x;
+  p->data.check_with.e = malloc(strlen(e) + 1);
+  strcpy(p->data.check_with.e, e);
+  return p;
+}
+
+mpc_parser_t *mpc_checkf(mpc_parser_t *a, mpc_dtor_t da, mpc_check_t f, const char *fmt, ...) {
+  va_list va;
+  char *buffer;
+  mpc_parser_t *p;
+
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+
+  p = mpc_check(a, da, f, buffer);
+  free(buffer);
+
+  return p;
+}
+
+mpc_parser_t *mpc_check_withf(mpc_parser_t *a, mpc_dtor_t da, mpc_check_with_t f, void *x, const char *fmt, ...) {
+  va_list va;
+  char *buffer;
+  mpc_parser_t *p;
+
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+
+  p = mpc_check_with(a, da, f, x, buffer);
+  free(buffer);
+
+  return p;
+}
+
+mpc_parser_t *mpc_predictive(mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_PREDICT;
+  p->data.predict.x = a;
+  return p;
+}
+
+mpc_parser_t *mpc_packrat(mpc_parser_t *a, mpc_copy_t ca, mpc_dtor_t da) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_PACKRAT;
+  p->data.packrat.x = a;
+  p->data.packrat.cx = ca;
+  p->data.packrat.dx = da;
+  p->data.packrat.hits = 0;
+  p->data.packrat.misses = 0;
+  return p;
+}
+
+mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_NOT;
+  p->data.not.x = a;
+  p->data.not.dx = da;
+  p->data.not.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da) {
+  return mpc_not_lift(a, da, mpcf_ctor_null);
+}
+
+mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MAYBE;
+  p->data.not.x = a;
+  p->data.not.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_maybe(mpc_parser_t *a) {
+  return mpc_maybe_lift(a, mpcf_ctor_null);
+}
+
+mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MANY;
+  p->data.repeat.x = a;
+  p->data.repeat.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MANY1;
+  p->data.repeat.x = a;
+  p->data.repeat.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_COUNT;
+  p->data.repeat.n = n;
+  p->data.repeat.f = f;
+  p->data.repeat.x = a;
+  p->data.repeat.dx = da;
+  return p;
+}
+
+mpc_parser_t *mpc_or(int n, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+
+  p->type = MPC_TYPE_OR;
+  p->data.or.n = n;
+  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.or.dispatch = NULL;
+
+  va_start(va, n);
+  for (i = 0; i < n; i++) {
+    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  va_end(va);
+
+  return p;
+}
+
+mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+
+  p->type = MPC_TYPE_AND;
+  p->data.and.n = n;
+  p->data.and.f = f;
+  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
+
+  va_start(va, f);
+  for (i = 0; i < n; i++) {
+    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  for (i = 0; i < (n-1); i++) {
+    p->data.and.dxs[i] = va_arg(va, mpc_dtor_t);
+  }
+  va_end(va);
+
+  return p;
+}
+
+/*
+** Common Parsers
+*/
+
+mpc_parser_t *mpc_soi(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SOI;
+  return mpc_expect(p, "start of input");
+}
+
+mpc_parser_t *mpc_eoi(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_EOI;
+  return mpc_expect(p, "end of input");
+}
+
+static int mpc_boundary_anchor(char prev, char next) {
+  const char* word = "abcdefghijklmnopqrstuvwxyz"
+                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                     "0123456789_";
+  if ( strchr(word, next) &&  prev == '\0') { return 1; }
+  if ( strchr(word, prev) &&  next == '\0') { return 1; }
+  if ( strchr(word, next) && !strchr(word, prev)) { return 1; }
+  if (!strchr(word, next) &&  strchr(word, prev)) { return 1; }
+  return 0;
+}
+
+static int mpc_boundary_newline_anchor(char prev, char next) {
+  (void)next;
+  return prev == '\n';
+}
+
+mpc_parser_t *mpc_boundary(void) { return mpc_expect(mpc_anchor(mpc_boundary_anchor), "word boundary"); }
+mpc_parser_t *mpc_boundary_newline(void) { return mpc_expect(mpc_anchor(mpc_boundary_newline_anchor), "start of newline"); }
+
+mpc_parser_t *mpc_whitespace(void) { return mpc_expect(mpc_oneof(" \f\n\r\t\v"), "whitespace"); }
+mpc_parser_t *mpc_whitespaces(void) { return mpc_expect(mpc_many(mpcf_strfold, mpc_whitespace()), "spaces"); }
+mpc_parser_t *mpc_blank(void) { return mpc_expect(mpc_apply(mpc_whitespaces(), mpcf_free), "whitespace"); }
+
+mpc_parser_t *mpc_newline(void) { return mpc_expect(mpc_char('\n'), "newline"); }
+mpc_parser_t *mpc_tab(void) { return mpc_expect(mpc_char('\t'), "tab"); }
+mpc_parser_t *mpc_escape(void) { return mpc_and(2, mpcf_strfold, mpc_char('\\'), mpc_any(), free); }
+
+mpc_parser_t *mpc_digit(void) { return mpc_expect(mpc_oneof("0123456789"), "digit"); }
+mpc_parser_t *mpc_hexdigit(void) { return mpc_expect(mpc_oneof("0123456789ABCDEFabcdef"), "hex digit"); }
+mpc_parser_t *mpc_octdigit(void) { return mpc_expect(mpc_oneof("01234567"), "oct digit"); }
+mpc_parser_t *mpc_digits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_digit()), "digits"); }
+mpc_parser_t *mpc_hexdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_hexdigit()), "hex digits"); }
+mpc_parser_t *mpc_octdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_octdigit()), "oct digits"); }
+
+mpc_parser_t *mpc_lower(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyz"), "lowercase letter"); }
+mpc_parser_t *mpc_upper(void) { return mpc_expect(mpc_oneof("ABCDEFGHIJKLMNOPQRSTUVWXYZ"), "uppercase letter"); }
+mpc_parser_t *mpc_alpha(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"), "letter"); }
+mpc_parser_t *mpc_underscore(void) { return mpc_expect(mpc_char('_'), "underscore"); }
+mpc_parser_t *mpc_alphanum(void) { return mpc_expect(mpc_or(3, mpc_alpha(), mpc_digit(), mpc_underscore()), "alphanumeric"); }
+
+mpc_parser_t *mpc_int(void) { return mpc_expect(mpc_apply(mpc_digits(), mpcf_int), "integer"); }
+mpc_parser_t *mpc_hex(void) { return mpc_expect(mpc_apply(mpc_hexdigits(), mpcf_hex), "hexadecimal"); }
+mpc_parser_t *mpc_oct(void) { return mpc_expect(mpc_apply(mpc_octdigits(), mpcf_oct), "octadecimal"); }
+mpc_parser_t *mpc_number(void) { return mpc_expect(mpc_or(3, mpc_int(), mpc_hex(), mpc_oct()), "number"); }
+
+mpc_parser_t *mpc_real(void) {
+
+  /* [+-]?\d+(\.\d+)?([eE][+-]?[0-9]+)? */
+
+  mpc_parser_t *p0, *p1, *p2, *p30, *p31, *p32, *p3;
+
+  p0 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
+  p1 = mpc_digits();
+  p2 = mpc_maybe_lift(mpc_and(2, mpcf_strfold, mpc_char('.'), mpc_digits(), free), mpcf_ctor_str);
+  p30 = mpc_oneof("eE");
+  p31 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
+  p32 = mpc_digits();
+  p3 = mpc_maybe_lift(mpc_and(3, mpcf_strfold, p30, p31, p32, free, free), mpcf_ctor_str);
+
+  return mpc_expect(mpc_and(4, mpcf_strfold, p0, p1, p2, p3, free, free, free), "real");
+
+}
+
+mpc_parser_t *mpc_float(void) {
+  return mpc_expect(mpc_apply(mpc_real(), mpcf_float), "float");
+}
+
+mpc_parser_t *mpc_char_lit(void) {
+  return mpc_expect(mpc_between(mpc_or(2, mpc_escape(), mpc_any()), free, "'", "'"), "char");
+}
+
+mpc_parser_t *mpc_string_lit(void) {
+  mpc_parser_t *strchar = mpc_or(2, mpc_escape(), mpc_noneof("\""));
+  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, strchar), free, "\"", "\""), "string");
+}
+
+mpc_parser_t *mpc_regex_lit(void) {
+  mpc_parser_t *regexchar = mpc_or(2, mpc_escape(), mpc_noneof("/"));
+  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, regexchar), free, "/", "/"), "regex");
+}
+
+mpc_parser_t *mpc_ident(void) {
+  mpc_parser_t *p0, *p1;
+  p0 = mpc_or(2, mpc_alpha(), mpc_underscore());
+  p1 = mpc_many(mpcf_strfold, mpc_alphanum());
+  return mpc_and(2, mpcf_strfold, p0, p1, free);
+}
+
+/*
+** Useful Parsers
+*/
+
+mpc_parser_t *mpc_startwith(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_soi(), a, mpcf_dtor_null); }
+mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(2, mpcf_fst, a, mpc_eoi(), da); }
+mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(3, mpcf_snd, mpc_soi(), a, mpc_eoi(), mpcf_dtor_null, da); }
+
+mpc_parser_t *mpc_stripl(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_blank(), a, mpcf_dtor_null); }
+mpc_parser_t *mpc_stripr(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
+mpc_parser_t *mpc_strip(mpc_parser_t *a) { return mpc_and(3, mpcf_snd, mpc_blank(), a, mpc_blank(), mpcf_dtor_null, mpcf_dtor_null); }
+mpc_parser_t *mpc_tok(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
+mpc_parser_t *mpc_sym(const char *s) { return mpc_tok(mpc_string(s)); }
+
+mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da) { return mpc_whole(mpc_strip(a), da); }
+
+mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
+  return mpc_and(3, mpcf_snd_free,
+    mpc_string(o), a, mpc_string(c),
+    free, ad);
+}
+
+mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "(", ")"); }
+mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "<", ">"); }
+mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_between(a, ad, "{", "}"); }
+mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_between(a, ad, "[", "]"); }
+
+mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
+  return mpc_and(3, mpcf_snd_free,
+    mpc_sym(o), mpc_tok(a), mpc_sym(c),
+    free, ad);
+}
+
+mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "(", ")"); }
+mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "<", ">"); }
+mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_tok_between(a, ad, "{", "}"); }
+mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_tok_between(a, ad, "[", "]"); }
+
+/*
+** Regular Expression Parsers
+*/
+
+/*
+** So here is a cute bootstrapping.
+**
+** I'm using the previously defined
+** mpc constructs and functions to
+** parse the user regex string and
+** construct a parser from it.
+**
+** As it turns out lots of the standard
+** mpc functions look a lot like `fold`
+** functions and so can be used indirectly
+** by many of the parsing functions to build
+** a parser directly - as we are parsing.
+**
+** This is certainly something that
+** would be less elegant/interesting
+** in a two-phase parser which first
+** builds an AST and then traverses it
+** to generate the object.
+**
+** This whole thing acts as a great
+** case study for how trivial it can be
+** to write a great parser in a few
+** lines of code using mpc.
+*/
+
+/*
+**
+**  ### Regular Expression Grammar
+**
+**      <regex> : <term> | (<term> "|" <regex>)
+**
+**      <term> : <factor>*
+**
+**      <factor> : <base>
+**               | <base> "*"
+**               | <base> "+"
+**               | <base> "?"
+**               | <base> "{" <digits> "}"
+**
+**      <base> : <char>
+**             | "\" <char>
+**             | "(" <regex> ")"
+**             | "[" <range> "]"
+*/
+
+static mpc_val_t *mpcf_re_or(int n, mpc_val_t **xs) {
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  else { return mpc_or(2, xs[0], xs[1]); }
+}
+
+static mpc_val_t *mpcf_re_and(int n, mpc_val_t **xs) {
+  int i;
+  mpc_parser_t *p = mpc_lift(mpcf_ctor_str);
+  for (i = 0; i < n; i++) {
+    p = mpc_and(2, mpcf_strfold, p, xs[i], free);
+  }
+  return p;
+}
+
+static mpc_val_t *mpcf_re_repeat(int n, mpc_val_t **xs) {
+  int num;
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { free(xs[1]); return mpc_many(mpcf_strfold, xs[0]); }; break;
+    case '+': { free(xs[1]); return mpc_many1(mpcf_strfold, xs[0]); }; break;
+    case '?': { free(xs[1]); return mpc_maybe_lift(xs[0], mpcf_ctor_str); }; break;
+    default:
+      num = *(int*)xs[1];
+      free(xs[1]);
+  }
+
+  return mpc_count(num, mpcf_strfold, xs[0], free);
+}
+
+static mpc_parser_t *mpc_re_escape_char(char c) {
+  switch (c) {
+    case 'a': return mpc_char('\a');
+    case 'f': return mpc_char('\f');
+    case 'n': return mpc_char('\n');
+    case 'r': return mpc_char('\r');
+    case 't': return mpc_char('\t');
+    case 'v': return mpc_char('\v');
+    case 'b': return mpc_and(2, mpcf_snd, mpc_boundary(), mpc_lift(mpcf_ctor_str), free);
+    case 'B': return mpc_not_lift(mpc_boundary(), free, mpcf_ctor_str);
+    case 'A': return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
+    case 'Z': return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free);
+    case 'd': return mpc_digit();
+    case 'D': return mpc_not_lift(mpc_digit(), free, mpcf_ctor_str);
+    case 's': return mpc_whitespace();
+    case 'S': return mpc_not_lift(mpc_whitespace(), free, mpcf_ctor_str);
+    case 'w': return mpc_alphanum();
+    case 'W': return mpc_not_lift(mpc_alphanum(), free, mpcf_ctor_str);
+    default: return NULL;
+  }
+}
+
+static mpc_val_t *mpcf_re_escape(mpc_val_t *x, void* data) {
+
+  int mode = *((int*)data);
+  char *s = x;
+  mpc_parser_t *p;
+
+  /* Any Character */
+  if (s[0] == '.') {
+    free(s);
+    if (mode & MPC_RE_DOTALL) {
+      return mpc_any();
+    } else {
+      return mpc_expect(mpc_noneof("\n"), "any character except a newline");
+    }
+  }
+
+  /* Start of Input */
+  if (s[0] == '^') {
+    free(s);
+    if (mode & MPC_RE_MULTILINE) {
+      return mpc_and(2, mpcf_snd, mpc_or(2, mpc_soi(), mpc_boundary_newline()), mpc_lift(mpcf_ctor_str), free);
+    } else {
+      return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
+    }
+  }
+
+  /* End of Input */
+  if (s[0] == '$') {
+    free(s);
+    if (mode & MPC_RE_MULTILINE) {
+      return mpc_or(2,
+        mpc_newline(),
+        mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free));
+    } else {
+      return mpc_or(2,
+        mpc_and(2, mpcf_fst, mpc_newline(), mpc_eoi(), free),
+        mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free));
+    }
+  }
+
+  /* Regex Escape */
+  if (s[0] == '\\') {
+    p = mpc_re_escape_char(s[1]);
+    p = (p == NULL) ? mpc_char(s[1]) : p;
+    free(s);
+    return p;
+  }
+
+  /* Regex Standard */
+  p = mpc_char(s[0]);
+  free(s);
+  return p;
+}
+
+static const char *mpc_re_range_escape_char(char c) {
+  switch (c) {
+    case '-': return "-";
+    case 'a': return "\a";
+    case 'f': return "\f";
+    case 'n': return "\n";
+    case 'r': return "\r";
+    case 't': return "\t";
+    case 'v': return "\v";
+    case 'b': return "\b";
+    case 'd': return "0123456789";
+    case 's': return " \f\n\r\t\v";
+    case 'w': return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    default: return NULL;
+  }
+}
+
+static mpc_val_t *mpcf_re_range(mpc_val_t *x) {
+
+  mpc_parser_t *out;
+  size_t i, j;
+  size_t start, end;
+  const char *tmp = NULL;
+  const char *s = x;
+  int comp = s[0] == '^' ? 1 : 0;
+  char *range = calloc(1,1);
+
+  if (s[0] == '\0') { free(range); free(x); return mpc_fail("Invalid Regex Range Expression"); }
+  if (s[0] == '^' &&
+      s[1] == '\0') { free(range); free(x); return mpc_fail("Invalid Regex Range Expression"); }
+
+  for (i = comp; i < strlen(s); i++){
+
+    /* Regex Range Escape */
+    if (s[i] == '\\') {
+      tmp = mpc_re_range_escape_char(s[i+1]);
+      if (tmp != NULL) {
+        range = realloc(range, strlen(range) + strlen(tmp) + 1);
+        strcat(range, tmp);
+      } else {
+        range = realloc(range, strlen(range) + 1 + 1);
+        range[strlen(range) + 1] = '\0';
+        range[strlen(range) + 0] = s[i+1];
+      }
+      i++;
+    }
+
+    /* Regex Range...Range */
+    else if (s[i] == '-') {
+      if (s[i+1] == '\0' || i == 0) {
+          range = realloc(range, strlen(range) + strlen("-") + 1);
+          strcat(range, "-");
+      } else {
+        start = s[i-1]+1;
+        end = s[i+1]-1;
+        for (j = start; j <= end; j++) {
+          range = realloc(range, strlen(range) + 1 + 1 + 1);
+          range[strlen(range) + 1] = '\0';
+          range[strlen(range) + 0] = (char)j;
+        }
+      }
+    }
+
+    /* Regex Range Normal */
+    else {
+      range = realloc(range, strlen(range) + 1 + 1);
+      range[strlen(range) + 1] = '\0';
+      range[strlen(range) + 0] = s[i];
+    }
+
+  }
+
+  out = comp == 1 ? mpc_noneof(range) : mpc_oneof(range);
+
+  free(x);
+  free(range);
+
+  return out;
+}
+
+static void mpc_re_dfa(mpc_parser_t *p);
+
+mpc_parser_t *mpc_re(const char *re) {
+  return mpc_re_mode(re, MPC_RE_DEFAULT);
+}
+
+mpc_parser_t *mpc_re_mode(const char *re, int mode) {
+
+  char *err_msg;
+  mpc_parser_t *err_out;
+  mpc_result_t r;
+  mpc_parser_t *Regex, *Term, *Factor, *Base, *Range, *RegexEnclose;
+
+  Regex  = mpc_new("regex");
+  Term   = mpc_new("term");
+  Factor = mpc_new("factor");
+  Base   = mpc_new("base");
+  Range  = mpc_new("range");
+
+  mpc_define(Regex, mpc_and(2, mpcf_re_or,
+    Term,
+    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_char('|'), Regex, free)),
+    (mpc_dtor_t)mpc_delete
+  ));
+
+  mpc_define(Term, mpc_many(mpcf_re_and, Factor));
+
+  mpc_define(Factor, mpc_and(2, mpcf_re_repeat,
+    Base,
+    mpc_or(5,
+      mpc_char('*'), mpc_char('+'), mpc_char('?'),
+      mpc_brackets(mpc_int(), free),
+      mpc_pass()),
+    (mpc_dtor_t)mpc_delete
+  ));
+
+  mpc_define(Base, mpc_or(4,
+    mpc_parens(Regex, (mpc_dtor_t)mpc_delete),
+    mpc_squares(Range, (mpc_dtor_t)mpc_delete),
+    mpc_apply_to(mpc_escape(), mpcf_re_escape, &mode),
+    mpc_apply_to(mpc_noneof(")|"), mpcf_re_escape, &mode)
+  ));
+
+  mpc_define(Range, mpc_apply(
+    mpc_many(mpcf_strfold, mpc_or(2, mpc_escape(), mpc_noneof("]"))),
+    mpcf_re_range
+  ));
+
+  RegexEnclose = mpc_whole(mpc_predictive(Regex), (mpc_dtor_t)mpc_delete);
+
+  mpc_optimise(RegexEnclose);
+  mpc_optimise(Regex);
+  mpc_optimise(Term);
+  mpc_optimise(Factor);
+  mpc_optimise(Base);
+  mpc_optimise(Range);
+
+  if(!mpc_parse("<mpc_re_compiler>", re, RegexEnclose, &r)) {
+    err_msg = mpc_err_string(r.error);
+    err_out = mpc_failf("Invalid Regex: %s", err_msg);
+    mpc_err_delete(r.error);
+    free(err_msg);
+    r.output = err_out;
+  }
+
+  mpc_cleanup(6, RegexEnclose, Regex, Term, Factor, Base, Range);
+
+  mpc_optimise(r.output);
+  mpc_re_dfa(r.output);
+
+  return r.output;
+
+}
+
+/*
+** Common Fold Functions
+*/
+
+void mpcf_dtor_null(mpc_val_t *x) { (void) x; return; }
+
+mpc_val_t *mpcf_ctor_null(void) { return NULL; }
+mpc_val_t *mpcf_ctor_str(void) { return calloc(1, 1); }
+mpc_val_t *mpcf_free(mpc_val_t *x) { free(x); return NULL; }
+
+mpc_val_t *mpcf_int(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 10);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_hex(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 16);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_oct(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 8);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_float(mpc_val_t *x) {
+  float *y = malloc(sizeof(float));
+  *y = strtod(x, NULL);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_strtriml(mpc_val_t *x) {
+  char *s = x;
+  while (isspace((unsigned char)*s)) {
+    memmove(s, s+1, strlen(s));
+  }
+  return s;
+}
+
+mpc_val_t *mpcf_strtrimr(mpc_val_t *x) {
+  char *s = x;
+  size_t l = strlen(s);
+  while (l > 0 && isspace((unsigned char)s[l-1])) {
+    s[l-1] = '\0'; l--;
+  }
+  return s;
+}
+
+mpc_val_t *mpcf_strtrim(mpc_val_t *x) {
+  return mpcf_strtriml(mpcf_strtrimr(x));
+}
+
+static const char mpc_escape_input_c[]  = {
+  '\a', '\b', '\f', '\n', '\r',
+  '\t', '\v', '\\', '\'', '\"', '\0'};
+
+static const char *mpc_escape_output_c[] = {
+  "\\a", "\\b", "\\f", "\\n", "\\r", "\\t",
+  "\\v", "\\\\", "\\'", "\\\"", "\\0", NULL};
+
+static const char mpc_escape_input_raw_re[] = { '/' };
+static const char *mpc_escape_output_raw_re[] = { "\\/", NULL };
+
+static const char mpc_escape_input_raw_cstr[] = { '"' };
+static const char *mpc_escape_output_raw_cstr[] = { "\\\"", NULL };
+
+static const char mpc_escape_input_raw_cchar[] = { '\'' };
+static const char *mpc_escape_output_raw_cchar[] = { "\\'", NULL };
+
+static mpc_val_t *mpcf_escape_new(mpc_val_t *x, const char *input, const char **output) {
+
+  int i;
+  int found;
+  char buff[2];
+  char *s = x;
+  char *y = calloc(1, 1);
+
+  while (*s) {
+
+    i = 0;
+    found = 0;
+
+    while (output[i]) {
+      if (*s == input[i]) {
+        y = realloc(y, strlen(y) + strlen(output[i]) + 1);
+        strcat(y, output[i]);
+        found = 1;
+        break;
+      }
+      i++;
+    }
+
+    if (!found) {
+      y = realloc(y, strlen(y) + 2);
+      buff[0] = *s; buff[1] = '\0';
+      strcat(y, buff);
+    }
+
+    s++;
+  }
+
+
+  return y;
+}
+
+static mpc_val_t *mpcf_unescape_new(mpc_val_t *x, const char *input, const char **output) {
+
+  int i;
+  int found = 0;
+  char buff[2];
+  char *s = x;
+  char *y = calloc(1, 1);
+
+  while (*s) {
+
+    i = 0;
+    found = 0;
+
+    while (output[i]) {
+      if ((*(s+0)) == output[i][0] &&
+          (*(s+1)) == output[i][1]) {
+        y = realloc(y, strlen(y) + 1 + 1);
+        buff[0] = input[i]; buff[1] = '\0';
+        strcat(y, buff);
+        found = 1;
+        s++;
+        break;
+      }
+      i++;
+    }
+
+    if (!found) {
+      y = realloc(y, strlen(y) + 1 + 1);
+      buff[0] = *s; buff[1] = '\0';
+      strcat(y, buff);
+    }
+
+    if (*s == '\0') { break; }
+    else { s++; }
+  }
+
+  return y;
+
+}
+
+mpc_val_t *mpcf_escape(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_c, mpc_escape_output_c);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_c, mpc_escape_output_c);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_escape_regex(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape_regex(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_null(int n, mpc_val_t** xs) { (void) n; (void) xs; return NULL; }
+mpc_val_t *mpcf_fst(int n, mpc_val_t **xs) { (void) n; return xs[0]; }
+mpc_val_t *mpcf_snd(int n, mpc_val_t **xs) { (void) n; return xs[1]; }
+mpc_val_t *mpcf_trd(int n, mpc_val_t **xs) { (void) n; return xs[2]; }
+
+static mpc_val_t *mpcf_nth_free(int n, mpc_val_t **xs, int x) {
+  int i;
+  for (i = 0; i < n; i++) {
+    if (i != x) { free(xs[i]); }
+  }
+  return xs[x];
+}
+
+mpc_val_t *mpcf_fst_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 0); }
+mpc_val_t *mpcf_snd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 1); }
+mpc_val_t *mpcf_trd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 2); }
+
+mpc_val_t *mpcf_freefold(int n, mpc_val_t **xs) {
+  int i;
+  for (i = 0; i < n; i++) {
+    free(xs[i]);
+  }
+  return NULL;
+}
+
+mpc_val_t *mpcf_strfold(int n, mpc_val_t **xs) {
+  int i;
+  size_t l = 0;
+
+  if (n == 0) { return calloc(1, 1); }
+
+  for (i = 0; i < n; i++) { l += strlen(xs[i]); }
+
+  xs[0] = realloc(xs[0], l + 1);
+
+  for (i = 1; i < n; i++) {
+    strcat(xs[0], xs[i]); free(xs[i]);
+  }
+
+  return xs[0];
+}
+
+mpc_val_t *mpcf_maths(int n, mpc_val_t **xs) {
+  int **vs = (int**)xs;
+  (void) n;
+
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { *vs[0] *= *vs[2]; }; break;
+    case '/': { *vs[0] /= *vs[2]; }; break;
+    case '%': { *vs[0] %= *vs[2]; }; break;
+    case '+': { *vs[0] += *vs[2]; }; break;
+    case '-': { *vs[0] -= *vs[2]; }; break;
+    default: break;
+  }
+
+  free(xs[1]); free(xs[2]);
+
+  return xs[0];
+}
+
+/*
+** Printing
+*/
+
+static void mpc_print_unretained(mpc_parser_t *p, int force) {
+
+  /* TODO: Print Everything Escaped */
+
+  int i;
+  char *s, *e;
+  char buff[2];
+
+  if (p->retained && !force) {;
+    if (p->name) { printf("<%s>", p->name); }
+    else { printf("<anon>"); }
+    return;
+  }
+
+  if (p->type == MPC_TYPE_UNDEFINED) { printf("<?>"); }
+  if (p->type == MPC_TYPE_PASS)   { printf("<:>"); }
+  if (p->type == MPC_TYPE_FAIL)   { printf("<!>"); }
+  if (p->type == MPC_TYPE_LIFT)   { printf("<#>"); }
+  if (p->type == MPC_TYPE_STATE)  { printf("<S>"); }
+  if (p->type == MPC_TYPE_ANCHOR) { printf("<@>"); }
+  if (p->type == MPC_TYPE_EXPECT) {
+    printf("%s", p->data.expect.m);
+    /*mpc_print_unretained(p->data.expect.x, 0);*/
+  }
+
+  if (p->type == MPC_TYPE_ANY) { printf("<.>"); }
+  if (p->type == MPC_TYPE_SATISFY) { printf("<f>"); }
+
+  if (p->type == MPC_TYPE_SINGLE) {
+    buff[0] = p->data.single.x; buff[1] = '\0';
+    s = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("'%s'", s);
+    free(s);
+  }
+
+  if (p->type == MPC_TYPE_RANGE) {
+    buff[0] = p->data.range.x; buff[1] = '\0';
+    s = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    buff[0] = p->data.range.y; buff[1] = '\0';
+    e = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[%s-%s]", s, e);
+    free(s);
+    free(e);
+  }
+
+  if (p->type == MPC_TYPE_ONEOF) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[%s]", s);
+    free(s);
+  }
+
+  if (p->type == MPC_TYPE_NONEOF) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[^%s]", s);
+    free(s);
+  }
+
+  if (p->type == MPC_TYPE_STRING) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("\"%s\"", s);
+    free(s);
+  }
+
+  if (p->type == MPC_TYPE_APPLY)    { mpc_print_unretained(p->data.apply.x, 0); }
+  if (p->type == MPC_TYPE_APPLY_TO) { mpc_print_unretained(p->data.apply_to.x, 0); }
+  if (p->type == MPC_TYPE_PREDICT)  { mpc_print_unretained(p->data.predict.x, 0); }
+  if (p->type == MPC_TYPE_PACKRAT)  { mpc_print_unretained(p->data.packrat.x, 0); }
+  if (p->type == MPC_TYPE_DFA)      { mpc_print_unretained(p->data.dfa.x, 0); }
+  if (p->type == MPC_TYPE_CLASS)    { mpc_print_unretained(p->data.cls.x, 0); }
+  if (p->type == MPC_TYPE_SPAN)     { mpc_print_unretained(p->data.span.x, 0); }
+
+  if (p->type == MPC_TYPE_NOT)   { mpc_print_unretained(p->data.not.x, 0); printf("!"); }
+  if (p->type == MPC_TYPE_MAYBE) { mpc_print_unretained(p->data.not.x, 0); printf("?"); }
+
+  if (p->type == MPC_TYPE_MANY)  { mpc_print_unretained(p->data.repeat.x, 0); printf("*"); }
+  if (p->type == MPC_TYPE_MANY1) { mpc_print_unretained(p->data.repeat.x, 0); printf("+"); }
+  if (p->type == MPC_TYPE_COUNT) { mpc_print_unretained(p->data.repeat.x, 0); printf("{%i}", p->data.repeat.n); }
+
+  if (p->type == MPC_TYPE_OR) {
+    printf("(");
+    for(i = 0; i < p->data.or.n-1; i++) {
+      mpc_print_unretained(p->data.or.xs[i], 0);
+      printf(" | ");
+    }
+    mpc_print_unretained(p->data.or.xs[p->data.or.n-1], 0);
+    printf(")");
+  }
+
+  if (p->type == MPC_TYPE_AND) {
+    printf("(");
+    for(i = 0; i < p->data.and.n-1; i++) {
+      mpc_print_unretained(p->data.and.xs[i], 0);
+      printf(" ");
+    }
+    mpc_print_unretained(p->data.and.xs[p->data.and.n-1], 0);
+    printf(")");
+  }
+
+  if (p->type == MPC_TYPE_CHECK) {
+    mpc_print_unretained(p->data.check.x, 0);
+    printf("->?");
+  }
+  if (p->type == MPC_TYPE_CHECK_WITH) {
+    mpc_print_unretained(p->data.check_with.x, 0);
+    printf("->?");
+  }
+
+}
+
+void mpc_print(mpc_parser_t *p) {
+  mpc_print_unretained(p, 1);
+  printf("\n");
+}
+
+/*
+** Testing
+*/
+
+/*
+** These functions are slightly unwieldy and
+** also the whole of the testing suite for mpc
+** mpc is pretty shaky.
+**
+** It could do with a lot more tests and more
+** precision. Currently I am only really testing
+** changes off of the examples.
+**
+*/
+
+int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*),
+  mpc_dtor_t destructor,
+  void(*printer)(const void*)) {
+  mpc_result_t r;
+  (void) printer;
+  if (mpc_parse("<test>", s, p, &r)) {
+
+    if (tester(r.output, d)) {
+      destructor(r.output);
+      return 0;
+    } else {
+      destructor(r.output);
+      return 1;
+    }
+
+  } else {
+    mpc_err_delete(r.error);
+    return 1;
+  }
+
+}
+
+int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*),
+  mpc_dtor_t destructor,
+  void(*printer)(const void*)) {
+
+  mpc_result_t r;
+  if (mpc_parse("<test>", s, p, &r)) {
+
+    if (tester(r.output, d)) {
+      destructor(r.output);
+      return 1;
+    } else {
+      printf("Got "); printer(r.output); printf("\n");
+      printf("Expected "); printer(d); printf("\n");
+      destructor(r.output);
+      return 0;
+    }
+
+  } else {
+    mpc_err_print(r.error);
+    mpc_err_delete(r.error);
+    return 0;
+
+  }
+
+}
+
+
+/*
+** AST
+*/
+
+static void *mpc_ast_arena_alloc(mpc_ast_arena_t *m, size_t n) {
+
+  size_t s;
+  void *p;
+  mpc_chunk_t *k = m->chunks;
+
+  n = (n + sizeof(mpc_block_t) - 1) / sizeof(mpc_block_t) * sizeof(mpc_block_t);
+
+  if (k == NULL || k->used + n > k->size) {
+    s = k ? k->size * 2 : MPC_ARENA_CHUNK_MIN;
+    while (s < n) { s *= 2; }
+    k = malloc(sizeof(mpc_chunk_t) + s);
+    k->next = m->chunks;
+    k->size = s;
+    k->used = 0;
+    m->chunks = k;
+  }
+
+  p = (char*)(k + 1) + k->used;
+  k->used += n;
+  return p;
+}
+
+static char *mpc_ast_arena_str(mpc_ast_arena_t *m, const char *x, size_t n) {
+  char *y = mpc_ast_arena_alloc(m, n + 1);
+  memcpy(y, x, n);
+  y[n] = '\0';
+  return y;
+}
+
+static void mpc_ast_arena_delete(mpc_ast_arena_t *m) {
+  mpc_chunk_t *k;
+  while (m->chunks) {
+    k = m->chunks->next;
+    free(m->chunks);
+    m->chunks = k;
+  }
+  free(m);
+}
+
+static void mpc_ast_arena_release(mpc_ast_arena_t *m) {
+  if (m->nodes || mpc_atomic_add(&m->refs, -1) == 0) { mpc_ast_arena_delete(m); }
+}
+
+/* Made on the first node, so parses building no tree pay nothing */
+static mpc_ast_arena_t *mpc_input_ast(mpc_input_t *i) {
+  if (i->ast == NULL) {
+    i->ast = calloc(1, sizeof(mpc_ast_arena_t));
+    i->ast->refs = 1;
+  }
+  return i->ast;
+}
+
+/*
+** A tag is the rules a node was built by, joined
+** by `|` as in `expr|number|regex`. A node outside
+** a parse owns its tag. In a parse tags are kept
+** in the tree's arena and interned, so nodes tagged
+** alike share one string, and wrapping a node in a
+** rule looks up the wrapped tag before building it.
+** Each tag is then built once a parse, rather than
+** copied again for every node a rule wraps.
+*/
+
+typedef struct mpc_tag_t {
+  struct mpc_tag_t *link;
+  const char *tail;
+  unsigned long hash;
+  size_t len;
+  char name[1];
+} mpc_tag_t;
+
+static mpc_tag_t *mpc_tag_of(const char *x) {
+  return (mpc_tag_t*)(x - offsetof(mpc_tag_t, name));
+}
+
+/* Interns the tag x, followed by a `|` if bar is set, then tail, which is NULL or interned in m */
+static char *mpc_tag_intern(mpc_ast_arena_t *m, const char *x, size_t n, int bar, const char *tail) {
+
+  size_t j, k = tail ? mpc_tag_of(tail)->len : 0;
+  unsigned long h = 5381;
+  mpc_tag_t *t;
+
+  bar = bar ? 1 : 0;
+  for (j = 0; j < n; j++) { h = h * 33 + (unsigned char)x[j]; }
+  h = (h * 33 + bar) ^ (unsigned long)((size_t)tail / sizeof(mpc_tag_t));
+
+  for (t = m->tags[h % MPC_AST_TAGS_NUM]; t; t = t->link) {
+    if (t->hash == h && t->tail == tail && t->len == n + bar + k
+    &&  memcmp(t->name, x, n) == 0 && (!bar || t->name[n] == '|')) { return t->name; }
+  }
+
+  t = mpc_ast_arena_alloc(m, sizeof(mpc_tag_t) + n + bar + k);
+  t->link = m->tags[h % MPC_AST_TAGS_NUM];
+  m->tags[h % MPC_AST_TAGS_NUM] = t;
+  t->tail = tail;
+  t->hash = h;
+  t->len = n + bar + k;
+  memcpy(t->name, x, n);
+  if (bar) { t->name[n] = '|'; }
+  if (k) { memcpy(t->name + n + bar, tail, k); }
+  t->name[n + bar + k] = '\0';
+  return t->name;
+}
+
+/* A tag for a node in m, or one of its own for a node outside a parse */
+static char *mpc_tag_new(mpc_ast_arena_t *m, const char *x) {
+  char *y;
+  if (m) { return mpc_tag_intern(m, x, strlen(x), 0, NULL); }
+  y = malloc(strlen(x) + 1);
+  strcpy(y, x);
+  return y;
+}
+
+char *mpc_ast_get_tag(mpc_ast_t *a) {
+  return mpc_tag_new(NULL, a->tag);
+}
+
+/*
+** Trees are as deep as their input is nested, so
+** like the parser they are walked over an explicit
+** stack rather than by recursion. An entry holds a
+** node, the node it pairs with when two trees are
+** walked together, and its depth.
+*/
+
+typedef struct {
+  mpc_ast_t *a;
+  mpc_ast_t *b;
+  int d;
+} mpc_ast_walk_t;
+
+typedef struct {
+  int num;
+  int slots;
+  mpc_ast_walk_t *walks;
+} mpc_ast_stack_t;
+
+static void mpc_ast_stack_push(mpc_ast_stack_t *s, mpc_ast_t *a, mpc_ast_t *b, int d) {
+  if (s->num == s->slots) {
+    s->slots = s->slots ? s->slots * 2 : 64;
+    s->walks = realloc(s->walks, sizeof(mpc_ast_walk_t) * s->slots);
+  }
+  s->walks[s->num].a = a;
+  s->walks[s->num].b = b;
+  s->walks[s->num].d = d;
+  s->num++;
+}
+
+static mpc_ast_walk_t mpc_ast_stack_pop(mpc_ast_stack_t *s) {
+  return s->walks[--s->num];
+}
+
+static void mpc_ast_delete_no_children(mpc_ast_t *a);
+
+void mpc_ast_delete(mpc_ast_t *a) {
+
+  int i;
+  mpc_ast_stack_t s = { 0, 0, NULL };
+
+  while (1) {
+
+    if (a != NULL && a->refs > 1) {
+      a->refs--;
+    } else if (a != NULL && a->arena && a->arena->nodes) {
+      if (a->arena->root == a) { mpc_ast_arena_delete(a->arena); }
+    } else if (a != NULL) {
+      for (i = 0; i < a->children_num; i++) {
+        mpc_ast_stack_push(&s, a->children[i], NULL, 0);
+      }
+      mpc_ast_delete_no_children(a);
+    }
+
+    if (s.num == 0) { break; }
+    a = mpc_ast_stack_pop(&s).a;
+  }
+
+  free(s.walks);
+}
+
+static void mpc_ast_delete_no_children(mpc_ast_t *a) {
+  if (a->arena && a->arena->nodes) { return; }
+  free(a->children);
+  if (a->arena) { mpc_ast_arena_release(a->arena); } else { free(a->tag); }
+  free(a->contents);
+  free(a);
+}
+
+static mpc_ast_t *mpc_ast_node(mpc_ast_arena_t *m, char *tag, const char *contents) {
+
+  mpc_ast_t *a;
+
+  if (m == NULL || !m->nodes) {
+    a = malloc(sizeof(mpc_ast_t));
+    a->contents = malloc(strlen(contents) + 1);
+    strcpy(a->contents, contents);
+    if (m) { mpc_atomic_add(&m->refs, 1); }
+  } else {
+    a = mpc_ast_arena_alloc(m, sizeof(mpc_ast_t));
+    a->contents = mpc_ast_arena_str(m, contents, strlen(contents));
+  }
+
+  a->tag = tag;
+  a->state = mpc_state_new();
+  a->children_num = 0;
+  a->children = NULL;
+  a->rules = 0;
+  a->arena = m;
+  a->refs = 1;
+  return a;
+}
+
+static mpc_ast_t *mpc_ast_new_in(mpc_ast_arena_t *m, const char *tag, const char *contents) {
+  return mpc_ast_node(m, mpc_tag_new(m, tag), contents);
+}
+
+mpc_ast_t *mpc_ast_new(const char *tag, const char *contents) {
+  return mpc_ast_new_in(NULL, tag, contents);
+}
+
+/*
+** Makes room for n children. Arena nodes cannot
+** realloc, so their arrays are sized in powers of
+** two and only move when the count passes one.
+*/
+
+static void mpc_ast_children_reserve(mpc_ast_t *r, int n) {
+
+  int slots = 1;
+  mpc_ast_t **children;
+
+  if (r->arena == NULL || !r->arena->nodes) {
+    r->children = realloc(r->children, sizeof(mpc_ast_t*) * n);
+    return;
+  }
+
+  while (slots < r->children_num) { slots *= 2; }
+  if (r->children_num > 0 && n <= slots) { return; }
+
+  while (slots < n) { slots *= 2; }
+  children = mpc_ast_arena_alloc(r->arena, sizeof(mpc_ast_t*) * slots);
+  if (r->children_num) { memcpy(children, r->children, sizeof(mpc_ast_t*) * r->children_num); }
+  r->children = children;
+}
+
+/*
+** A packrat memo holds its trees alongside the
+** parse instead of copying them, so a node can have
+** more than one holder. Before a node is changed it
+** is copied if shared, and the copy's children each
+** gain a holder. Changes only reach a node through
+** its parents, so owning the path down to a node is
+** enough for it to be safe to change.
+*/
+
+static mpc_ast_t *mpc_ast_own(mpc_ast_t *a) {
+
+  int i;
+  mpc_ast_t *r;
+
+  if (a == NULL || a->refs == 1) { return a; }
+
+  r = mpc_ast_node(a->arena, a->arena ? a->tag : mpc_tag_new(NULL, a->tag), a->contents);
+  r->state = a->state;
+  r->rules = a->rules;
+  if (a->children_num) { mpc_ast_children_reserve(r, a->children_num); }
+  r->children_num = a->children_num;
+  for (i = 0; i < a->children_num; i++) {
+    r->children[i] = a->children[i];
+    r->children[i]->refs++;
+  }
+  a->refs--;
+  return r;
+}
+
+mpc_ast_t *mpc_ast_build(int n, const char *tag, ...) {
+
+  mpc_ast_t *a = mpc_ast_new(tag, "");
+
+  int i;
+  va_list va;
+  va_start(va, tag);
+
+  for (i = 0; i < n; i++) {
+    mpc_ast_add_child(a, va_arg(va, mpc_ast_t*));
+  }
+
+  va_end(va);
+
+  return a;
+
+}
+
+mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a) {
+
+  mpc_ast_t *r;
+
+  if (a == NULL) { return a; }
+  if (a->children_num == 0) { return a; }
+  if (a->children_num == 1) { return a; }
+
+  r = mpc_ast_new_in(a->arena, ">", "");
+  mpc_ast_add_child(r, a);
+  return r;
+}
+
+int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b) {
+
+  int i, eq = 1;
+  mpc_ast_stack_t s = { 0, 0, NULL };
+  mpc_ast_walk_t w;
+
+  while (1) {
+
+    eq = strcmp(a->tag, b->tag) == 0
+      && strcmp(a->contents, b->contents) == 0
+      && a->children_num == b->children_num;
+
+    if (!eq) { break; }
+
+    for (i = 0; i < a->children_num; i++) {
+      mpc_ast_stack_push(&s, a->children[i], b->children[i], 0);
+    }
+
+    if (s.num == 0) { break; }
+    w = mpc_ast_stack_pop(&s);
+    a = w.a;
+    b = w.b;
+  }
+
+  free(s.walks);
+  return eq;
+}
+
+mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a) {
+  r = mpc_ast_own(r);
+  mpc_ast_children_reserve(r, r->children_num + 1);
+  r->children_num++;
+  r->children[r->children_num-1] = a;
+  return r;
+}
+
+mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t) {
+  if (a == NULL) { return a; }
+  a = mpc_ast_own(a);
+  if (a->arena) {
+    a->tag = mpc_tag_intern(a->arena, t, strlen(t), 1, a->tag);
+    return a;
+  }
+  a->tag = realloc(a->tag, strlen(t) + 1 + strlen(a->tag) + 1);
+  memmove(a->tag + strlen(t) + 1, a->tag, strlen(a->tag)+1);
+  memmove(a->tag, t, strlen(t));
+  memmove(a->tag + strlen(t), "|", 1);
+  return a;
+}
+
+mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t) {
+  if (a == NULL) { return a; }
+  a = mpc_ast_own(a);
+  if (a->arena) {
+    a->tag = mpc_tag_intern(a->arena, t, strlen(t)-1, 0, a->tag);
+    return a;
+  }
+  a->tag = realloc(a->tag, (strlen(t)-1) + strlen(a->tag) + 1);
+  memmove(a->tag + (strlen(t)-1), a->tag, strlen(a->tag)+1);
+  memmove(a->tag, t, (strlen(t)-1));
+  return a;
+}
+
+mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t) {
+  a = mpc_ast_own(a);
+  if (a->arena) {
+    a->tag = mpc_tag_new(a->arena, t);
+    return a;
+  }
+  a->tag = realloc(a->tag, strlen(t) + 1);
+  strcpy(a->tag, t);
+  return a;
+}
+
+mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s) {
+  if (a == NULL) { return a; }
+  a = mpc_ast_own(a);
+  a->state = s;
+  return a;
+}
+
+/* A copy of one node with room for its children, which are left to fill */
+static mpc_ast_t *mpc_ast_copy_node(mpc_ast_arena_t *m, mpc_ast_t *a) {
+  mpc_ast_t *r = mpc_ast_node(m, (m && m == a->arena) ? a->tag : mpc_tag_new(m, a->tag), a->contents);
+  r->state = a->state;
+  r->rules = a->rules;
+  if (a->children_num) { mpc_ast_children_reserve(r, a->children_num); }
+  r->children_num = a->children_num;
+  return r;
+}
+
+/* Copies into the arena m, or onto the heap when it is NULL */
+static mpc_ast_t *mpc_ast_copy_in(mpc_ast_arena_t *m, mpc_ast_t *a) {
+
+  int i;
+  mpc_ast_t *r, *b, *c;
+  mpc_ast_stack_t s = { 0, 0, NULL };
+  mpc_ast_walk_t w;
+
+  if (a == NULL) { return a; }
+
+  r = b = mpc_ast_copy_node(m, a);
+
+  while (1) {
+
+    for (i = 0; i < a->children_num; i++) {
+      c = a->children[i] ? mpc_ast_copy_node(m, a->children[i]) : NULL;
+      b->children[i] = c;
+      if (c && c->children_num) { mpc_ast_stack_push(&s, a->children[i], c, 0); }
+    }
+
+    if (s.num == 0) { break; }
+    w = mpc_ast_stack_pop(&s);
+    a = w.a;
+    b = w.b;
+  }
+
+  free(s.walks);
+  return r;
+}
+
+/* Copies of heap nodes share their tag arena */
+mpc_ast_t *mpc_ast_copy(mpc_ast_t *a) {
+  return mpc_ast_copy_in((a && a->arena && !a->arena->nodes) ? a->arena : NULL, a);
+}
+
+static void mpc_ast_print_depth(mpc_ast_t *a, int d, FILE *fp) {
+
+  int i;
+  mpc_ast_stack_t s = { 0, 0, NULL };
+  mpc_ast_walk_t w;
+
+  while (1) {
+
+    if (a == NULL) {
+      fprintf(fp, "NULL\n");
+    } else {
+
+      for (i = 0; i < d; i++) { fprintf(fp, "  "); }
+
+      if (strlen(a->contents)) {
+        fprintf(fp, "%s:%lu:%lu '%s'\n", a->tag,
+          (long unsigned int)(a->state.row+1),
+          (long unsigned int)(a->state.col+1),
+          a->contents);
+      } else {
+        fprintf(fp, "%s \n", a->tag);
+      }
+
+      /* Pushed last to first so the first child is printed next */
+      for (i = a->children_num - 1; i >= 0; i--) {
+        mpc_ast_stack_push(&s, a->children[i], NULL, d+1);
+      }
+    }
+
+    if (s.num == 0) { break; }
+    w = mpc_ast_stack_pop(&s);
+    a = w.a;
+    d = w.d;
+  }
+
+  free(s.walks);
+}
+
+void mpc_ast_print(mpc_ast_t *a) {
+  mpc_ast_print_depth(a, 0, stdout);
+}
+
+void mpc_ast_print_to(mpc_ast_t *a, FILE *fp) {
+  mpc_ast_print_depth(a, 0, fp);
+}
+
+int mpc_ast_get_index(mpc_ast_t *ast, const char *tag) {
+  return mpc_ast_get_index_lb(ast, tag, 0);
+}
+
+int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb) {
+  int i;
+
+  for(i=lb; i<ast->children_num; i++) {
+    if(strcmp(ast->children[i]->tag, tag) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag) {
+  return mpc_ast_get_child_lb(ast, tag, 0);
+}
+
+mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb) {
+  int i;
+
+  for(i=lb; i<ast->children_num; i++) {
+    if(strcmp(ast->children[i]->tag, tag) == 0) {
+      return ast->children[i];
+    }
+  }
+
+  return NULL;
+}
+
+mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
+                                       mpc_ast_trav_order_t order)
+{
+  mpc_ast_trav_t *trav, *n_trav;
+  mpc_ast_t *cnode = ast;
+
+  /* Create the traversal structure */
+  trav = malloc(sizeof(mpc_ast_trav_t));
+  trav->curr_node = cnode;
+  trav->parent = NULL;
+  trav->curr_child = 0;
+  trav->order = order;
+
+  /* Get start node */
+  switch(order) {
+    case mpc_ast_trav_order_pre:
+      /* Nothing else is needed for pre order start */
+      break;
+
+    case mpc_ast_trav_order_post:
+      while(cnode->children_num > 0) {
+        cnode = cnode->children[0];
+
+        n_trav = malloc(sizeof(mpc_ast_trav_t));
+        n_trav->curr_node = cnode;
+        n_trav->parent = trav;
+        n_trav->curr_child = 0;
+        n_trav->order = order;
+
+        trav = n_trav;
+      }
+
+      break;
+
+    default:
+      /* Unreachable, but compiler complaints */
+      break;
+  }
+
+  return trav;
+}
+
+mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav) {
+  mpc_ast_trav_t *n_trav, *to_free;
+  mpc_ast_t *ret = NULL;
+  int cchild;
+
+  /* The end of traversal was reached */
+  if(*trav == NULL) return NULL;
+
+  switch((*trav)->order) {
+    case mpc_ast_trav_order_pre:
+      ret = (*trav)->curr_node;
+
+      /* If there aren't any more children, go up */
+      while(*trav != NULL &&
+        (*trav)->curr_child >= (*trav)->curr_node->children_num)
+      {
+        to_free = *trav;
+        *trav = (*trav)->parent;
+        free(to_free);
+      }
+
+      /* If trav is NULL, the end was reached */
+      if(*trav == NULL) {
+        break;
+      }
+
+      /* Go to next child */
+      n_trav = malloc(sizeof(mpc_ast_trav_t));
+
+      cchild = (*trav)->curr_child;
+      n_trav->curr_node = (*trav)->curr_node->children[cchild];
+      n_trav->parent = *trav;
+      n_trav->curr_child = 0;
+      n_trav->order = (*trav)->order;
+
+      (*trav)->curr_child++;
+      *trav = n_trav;
+
+      break;
+
+    case mpc_ast_trav_order_post:
+      ret = (*trav)->curr_node;
+
+      /* Move up tree to the parent If the parent doesn't have any more nodes,
+       * then this is the current node. If it does, move down to its left most
+       * child. Also, free the previous traversal node */
+      to_free = *trav;
+      *trav = (*trav)->parent;
+      free(to_free);
+
+      if(*trav == NULL)
+        break;
+
+      /* Next child */
+      (*trav)->curr_child++;
+
+      /* If there aren't any more children, this is the next node */
+      if((*trav)->curr_child >= (*trav)->curr_node->children_num) {
+        break;
+      }
+
+      /* If there are still more children, find the leftmost child from this
+       * node */
+      while((*trav)->curr_node->children_num > 0) {
+        n_trav = malloc(sizeof(mpc_ast_trav_t));
+
+        cchild = (*trav)->curr_child;
+        n_trav->curr_node = (*trav)->curr_node->children[cchild];
+        n_trav->parent = *trav;
+        n_trav->curr_child = 0;
+        n_trav->order = (*trav)->order;
+
+        *trav = n_trav;
+      }
+
+    default:
+      /* Unreachable, but compiler complaints */
+      break;
+  }
+
+  return ret;
+}
+
+void mpc_ast_traverse_free(mpc_ast_trav_t **trav) {
+  mpc_ast_trav_t *n_trav;
+
+  /* Go through parents until all are free */
+  while(*trav != NULL) {
+      n_trav = (*trav)->parent;
+      free(*trav);
+      *trav = n_trav;
+  }
+}
+
+static mpc_val_t *mpc_ast_fold(mpc_ast_arena_t *m, int n, mpc_val_t **xs) {
+
+  int i, j, k = 0;
+  mpc_ast_t** as = (mpc_ast_t**)xs;
+  mpc_ast_t *r;
+
+  if (n == 0) { return NULL; }
+  if (n == 1) { return xs[0]; }
+  if (n == 2 && xs[1] == NULL) { return xs[0]; }
+  if (n == 2 && xs[0] == NULL) { return xs[1]; }
+
+  r = mpc_ast_new_in(m, ">", "");
+
+  for (i = 0; i < n; i++) {
+    if (as[i] == NULL) { continue; }
+    k += as[i]->children_num >= 2 ? as[i]->children_num : 1;
+  }
+  if (k) { mpc_ast_children_reserve(r, k); }
+
+  for (i = 0; i < n; i++) {
+
+    if (as[i] == NULL) { continue; }
+    as[i] = mpc_ast_own(as[i]);
+
+    if        (as[i] && as[i]->children_num == 0) {
+      mpc_ast_add_child(r, as[i]);
+    } else if (as[i] && as[i]->children_num == 1) {
+      as[i]->children[0] = mpc_ast_own(as[i]->children[0]);
+      as[i]->children[0]->rules |= as[i]->rules;
+      mpc_ast_add_child(r, mpc_ast_add_root_tag(as[i]->children[0], as[i]->tag));
+      mpc_ast_delete_no_children(as[i]);
+    } else if (as[i] && as[i]->children_num >= 2) {
+      for (j = 0; j < as[i]->children_num; j++) {
+        mpc_ast_add_child(r, as[i]->children[j]);
+      }
+      mpc_ast_delete_no_children(as[i]);
+    }
+
+  }
+
+  if (r->children_num) {
+    r->state = r->children[0]->state;
+  }
+
+  return r;
+}
+
+mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **xs) {
+  return mpc_ast_fold(NULL, n, xs);
+}
+
+mpc_val_t *mpcf_str_ast(mpc_val_t *c) {
+  mpc_ast_t *a = mpc_ast_new("", c);
+  free(c);
+  return a;
+}
+
+mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs) {
+  mpc_state_t *s = ((mpc_state_t**)xs)[0];
+  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
+  (void)n;
+  a = mpc_ast_state(a, *s);
+  free(s);
+  return a;
+}
+
+mpc_parser_t *mpca_state(mpc_parser_t *a) {
+  return mpc_and(2, mpcf_state_ast, mpc_state(), a, free);
+}
+
+mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t) {
+  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_tag, (void*)t);
+}
+
+mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t) {
+  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_add_tag, (void*)t);
+}
+
+mpc_parser_t *mpca_root(mpc_parser_t *a) {
+  return mpc_apply(a, (mpc_apply_t)mpc_ast_add_root);
+}
+
+mpc_parser_t *mpca_not(mpc_parser_t *a) { return mpc_not(a, (mpc_dtor_t)mpc_ast_delete); }
+mpc_parser_t *mpca_maybe(mpc_parser_t *a) { return mpc_maybe(a); }
+mpc_parser_t *mpca_many(mpc_parser_t *a) { return mpc_many(mpcf_fold_ast, a); }
+mpc_parser_t *mpca_many1(mpc_parser_t *a) { return mpc_many1(mpcf_fold_ast, a); }
+mpc_parser_t *mpca_count(int n, mpc_parser_t *a) { return mpc_count(n, mpcf_fold_ast, a, (mpc_dtor_t)mpc_ast_delete); }
+
+mpc_parser_t *mpca_or(int n, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+
+  p->type = MPC_TYPE_OR;
+  p->data.or.n = n;
+  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.or.dispatch = NULL;
+
+  va_start(va, n);
+  for (i = 0; i < n; i++) {
+    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  va_end(va);
+
+  return p;
+
+}
+
+mpc_parser_t *mpca_and(int n, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+
+  p->type = MPC_TYPE_AND;
+  p->data.and.n = n;
+  p->data.and.f = mpcf_fold_ast;
+  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
+
+  va_start(va, n);
+  for (i = 0; i < n; i++) {
+    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  for (i = 0; i < (n-1); i++) {
+    p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete;
+  }
+  va_end(va);
+
+  return p;
+}
+
+mpc_parser_t *mpca_total(mpc_parser_t *a) { return mpc_total(a, (mpc_dtor_t)mpc_ast_delete); }
+mpc_parser_t *mpca_packrat(mpc_parser_t *a) { return mpc_packrat(a, (mpc_copy_t)mpc_ast_copy, (mpc_dtor_t)mpc_ast_delete); }
+
+/*
+** Grammar Parser
+*/
+
+/*
+** This is another interesting bootstrapping.
+**
+** Having a general purpose AST type allows
+** users to specify the grammar alone and
+** let all fold rules be automatically taken
+** care of by existing functions.
+**
+** You don't get to control the type spat
+** out but this means you can make a nice
+** parser to take in some grammar in nice
+** syntax and spit out a parser that works.
+**
+** The grammar for this looks surprisingly
+** like regex but the main difference is that
+** it is now whitespace insensitive and the
+** base type takes literals of some form.
+*/
+
+/*
+**
+**  ### Grammar Grammar
+**
+**      <grammar> : (<term> "|" <grammar>) | <term>
+**
+**      <term> : <factor>*
+**
+**      <factor> : <base>
+**               | <base> "*"
+**               | <base> "+"
+**               | <base> "?"
+**               | <base> "{" <digits> "}"
+**
+**      <base> : "<" (<digits> | <ident>) ">"
+**             | <string_lit>
+**             | <char_lit>
+**             | <regex_lit> <regex_mode>
+**             | "(" <grammar> ")"
+*/
+
+typedef struct {
+  va_list *va;
+  int parsers_num;
+  mpc_parser_t **parsers;
+  int flags;
+} mpca_grammar_st_t;
+
+static mpc_val_t *mpcaf_grammar_or(int n, mpc_val_t **xs) {
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  else { return mpca_or(2, xs[0], xs[1]); }
+}
+
+static mpc_val_t *mpcaf_grammar_and(int n, mpc_val_t **xs) {
+  int i;
+  mpc_parser_t *p = mpc_pass();
+  for (i = 0; i < n; i++) {
+    if (xs[i] != NULL) { p = mpca_and(2, p, xs[i]); }
+  }
+  return p;
+}
+
+static mpc_val_t *mpcaf_grammar_repeat(int n, mpc_val_t **xs) {
+  int num;
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { free(xs[1]); return mpca_many(xs[0]); }; break;
+    case '+': { free(xs[1]); return mpca_many1(xs[0]); }; break;
+    case '?': { free(xs[1]); return mpca_maybe(xs[0]); }; break;
+    case '!': { free(xs[1]); return mpca_not(xs[0]); }; break;
+    default:
+      num = *((int*)xs[1]);
+      free(xs[1]);
+  }
+  return mpca_count(num, xs[0]);
+}
+
+static mpc_val_t *mpcaf_grammar_string(mpc_val_t *x, void *s) {
+  mpca_grammar_st_t *st = s;
+  char *y = mpcf_unescape(x);
+  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_string(y) : mpc_tok(mpc_string(y));
+  free(y);
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "string"));
+}
+
+static mpc_val_t *mpcaf_grammar_char(mpc_val_t *x, void *s) {
+  mpca_grammar_st_t *st = s;
+  char *y = mpcf_unescape(x);
+  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_char(y[0]) : mpc_tok(mpc_char(y[0]));
+  free(y);
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "char"));
+}
+
+static mpc_val_t *mpcaf_fold_regex(int n, mpc_val_t **xs) {
+  char *y = xs[0];
+  char *m = xs[1];
+  mpca_grammar_st_t *st = xs[2];
+  mpc_parser_t *p;
+  int mode = MPC_RE_DEFAULT;
+
+  (void)n;
+  if (strchr(m, 'm')) { mode |= MPC_RE_MULTILINE; }
+  if (strchr(m, 's')) { mode |= MPC_RE_DOTALL; }
+  y = mpcf_unescape_regex(y);
+  p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_re_mode(y, mode) : mpc_tok(mpc_re_mode(y, mode));
+  free(y);
+  free(m);
+
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "regex"));
+}
+
+/* Should this just use `isdigit` instead? */
+static int is_number(const char* s) {
+  size_t i;
+  for (i = 0; i < strlen(s); i++) { if (!strchr("0123456789", s[i])) { return 0; } }
+  return 1;
+}
+
+static mpc_parser_t *mpca_grammar_find_parser(char *x, mpca_grammar_st_t *st) {
+
+  int i;
+  mpc_parser_t *p;
+
+  /* Case of Number */
+  if (is_number(x)) {
+
+    i = strtol(x, NULL, 10);
+
+    while (st->parsers_num <= i) {
+      st->parsers_num++;
+      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
+      st->parsers[st->parsers_num-1] = va_arg(*st->va, mpc_parser_t*);
+      if (st->parsers[st->parsers_num-1] == NULL) {
+        return mpc_failf("No Parser in position %i! Only supplied %i Parsers!", i, st->parsers_num);
+      }
+    }
+
+    return st->parsers[st->parsers_num-1];
+
+  /* Case of Identifier */
+  } else {
+
+    /* Search Existing Parsers */
+    for (i = 0; i < st->parsers_num; i++) {
+      mpc_parser_t *q = st->parsers[i];
+      if (q == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
+      if (q->name && strcmp(q->name, x) == 0) { return q; }
+    }
+
+    /* Search New Parsers */
+    while (1) {
+
+      p = va_arg(*st->va, mpc_parser_t*);
+
+      st->parsers_num++;
+      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
+      st->parsers[st->parsers_num-1] = p;
+
+      if (p == NULL || p->name == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
+      if (p->name && strcmp(p->name, x) == 0) { return p; }
+
+    }
+
+  }
+
+}
+
+/*
+** Rule IDs are the position of a parser in the argument list of the last
+** mpca_lang (or mpca_grammar) call that used it, or -1 if none has. Each ID
+** that fits in an unsigned long also gives a bit, which is set in the
+** `rules` field of every AST node that rule produced.
+**
+** Parsers are read from the argument list as the grammar first names them,
+** so IDs are only given once the whole grammar has been read, by which time
+** every parser it uses is known.
+*/
+
+static void mpca_grammar_ids(mpca_grammar_st_t *st) {
+  int i;
+  for (i = 0; i < st->parsers_num; i++) {
+    if (st->parsers[i]) { st->parsers[i]->id = i; }
+  }
+}
+
+int mpca_rule_id(mpc_parser_t *p) {
+  return p->id;
+}
+
+unsigned long mpca_rule_bit(mpc_parser_t *p) {
+  if (p->id < 0 || p->id >= (int)(sizeof(unsigned long) * 8)) { return 0; }
+  return 1ul << p->id;
+}
+
+/*
+** Tags the output of a named rule with its name and sets the bit for its
+** rule ID, so a node can be classified without searching the tag string.
+*/
+
+static mpc_val_t *mpcaf_grammar_tag(mpc_val_t *x, void *p) {
+  mpc_ast_t *a = mpc_ast_add_tag(x, ((mpc_parser_t*)p)->name);
+  if (a) { a->rules |= mpca_rule_bit(p); }
+  return a;
+}
+
+static mpc_val_t *mpcaf_grammar_id(mpc_val_t *x, void *s) {
+
+  mpca_grammar_st_t *st = s;
+  mpc_parser_t *p = mpca_grammar_find_parser(x, st);
+  free(x);
+
+  if (p->name) {
+    return mpca_state(mpca_root(mpc_apply_to(p, mpcaf_grammar_tag, p)));
+  } else {
+    return mpca_state(mpca_root(p));
+  }
+}
+
+mpc_parser_t *mpca_grammar_st(const char *grammar, mpca_grammar_st_t *st) {
+
+  char *err_msg;
+  mpc_parser_t *err_out;
+  mpc_result_t r;
+  mpc_parser_t *GrammarTotal, *Grammar, *Term, *Factor, *Base;
+
+  GrammarTotal = mpc_new("grammar_total");
+  Grammar = mpc_new("grammar");
+  Term = mpc_new("term");
+  Factor = mpc_new("factor");
+  Base = mpc_new("base");
+
+  mpc_define(GrammarTotal,
+    mpc_predictive(mpc_total(Grammar, mpc_soft_delete))
+  );
+
+  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
+    Term,
+    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
+    mpc_soft_delete
+  ));
+
+  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
+
+  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
+    Base,
+      mpc_or(6,
+        mpc_sym("*"),
+        mpc_sym("+"),
+        mpc_sym("?"),
+        mpc_sym("!"),
+        mpc_tok_brackets(mpc_int(), free),
+        mpc_pass()),
+    mpc_soft_delete
+  ));
+
+  mpc_define(Base, mpc_or(5,
+    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
+    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
+    mpc_tok(mpc_and(3, mpcaf_fold_regex, mpc_regex_lit(), mpc_many(mpcf_strfold, mpc_oneof("ms")), mpc_lift_val(st), free, free)),
+    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
+    mpc_tok_parens(Grammar, mpc_soft_delete)
+  ));
+
+  mpc_optimise(GrammarTotal);
+  mpc_optimise(Grammar);
+  mpc_optimise(Factor);
+  mpc_optimise(Term);
+  mpc_optimise(Base);
+
+  if(!mpc_parse("<mpc_grammar_compiler>", grammar, GrammarTotal, &r)) {
+    err_msg = mpc_err_string(r.error);
+    err_out = mpc_failf("Invalid Grammar: %s", err_msg);
+    mpc_err_delete(r.error);
+    free(err_msg);
+    r.output = err_out;
+  }
+
+  mpc_cleanup(5, GrammarTotal, Grammar, Term, Factor, Base);
+
+  mpca_grammar_ids(st);
+  mpc_optimise(r.output);
+
+  return (st->flags & MPCA_LANG_PREDICTIVE) ? mpc_predictive(r.output) : r.output;
+
+}
+
+mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...) {
+  mpca_grammar_st_t st;
+  mpc_parser_t *res;
+  va_list va;
+  va_start(va, grammar);
+
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+
+  res = mpca_grammar_st(grammar, &st);
+  free(st.parsers);
+  va_end(va);
+  return res;
+}
+
+typedef struct {
+  char *ident;
+  char *name;
+  mpc_parser_t *grammar;
+} mpca_stmt_t;
+
+static mpc_val_t *mpca_stmt_afold(int n, mpc_val_t **xs) {
+  mpca_stmt_t *stmt = malloc(sizeof(mpca_stmt_t));
+  stmt->ident = ((char**)xs)[0];
+  stmt->name = ((char**)xs)[1];
+  stmt->grammar = ((mpc_parser_t**)xs)[3];
+  (void) n;
+  free(((char**)xs)[2]);
+  free(((char**)xs)[4]);
+
+  return stmt;
+}
+
+static mpc_val_t *mpca_stmt_fold(int n, mpc_val_t **xs) {
+
+  int i;
+  mpca_stmt_t **stmts = malloc(sizeof(mpca_stmt_t*) * (n+1));
+
+  for (i = 0; i < n; i++) {
+    stmts[i] = xs[i];
+  }
+  stmts[n] = NULL;
+
+  return stmts;
+}
+
+static void mpca_stmt_list_delete(mpc_val_t *x) {
+
+  mpca_stmt_t **stmts = x;
+
+  while(*stmts) {
+    mpca_stmt_t *stmt = *stmts;
+    free(stmt->ident);
+    free(stmt->name);
+    mpc_soft_delete(stmt->grammar);
+    free(stmt);
+    stmts++;
+  }
+  free(x);
+
+}
+
+static mpc_val_t *mpca_stmt_list_apply_to(mpc_val_t *x, void *s) {
+
+  mpca_grammar_st_t *st = s;
+  mpca_stmt_t *stmt;
+  mpca_stmt_t **stmts = x;
+  mpc_parser_t *left;
+  mpc_parser_t **lefts;
+  int i, n = 0;
+
+  while (stmts[n]) { n++; }
+  lefts = malloc(sizeof(mpc_parser_t*) * (n + 1));
+
+  for (i = 0; i < n; i++) {
+    stmt = stmts[i];
+    left = mpca_grammar_find_parser(stmt->ident, st);
+    if (st->flags & MPCA_LANG_PREDICTIVE) { stmt->grammar = mpc_predictive(stmt->grammar); }
+    if (stmt->name) { stmt->grammar = mpc_expect(stmt->grammar, stmt->name); }
+    if (st->flags & MPCA_LANG_PACKRAT) { stmt->grammar = mpca_packrat(stmt->grammar); }
+    if (st->flags & MPCA_LANG_ARENA) { left->arena = 1; }
+    mpc_optimise(stmt->grammar);
+    mpc_define(left, stmt->grammar);
+    lefts[i] = left;
+    free(stmt->ident);
+    free(stmt->name);
+    free(stmt);
+  }
+
+  mpca_grammar_ids(st);
+
+  /* Dispatch tables need every rule defined, so build them again */
+  for (i = 0; i < n; i++) { mpc_optimise(lefts[i]); }
+
+  free(lefts);
+  free(x);
+
+  return NULL;
+}
+
+static mpc_err_t *mpca_lang_st(mpc_input_t *i, mpca_grammar_st_t *st) {
+
+  mpc_result_t r;
+  mpc_err_t *e;
+  mpc_parser_t *Lang, *Stmt, *Grammar, *Term, *Factor, *Base;
+
+  Lang    = mpc_new("lang");
+  Stmt    = mpc_new("stmt");
+  Grammar = mpc_new("grammar");
+  Term    = mpc_new("term");
+  Factor  = mpc_new("factor");
+  Base    = mpc_new("base");
+
+  mpc_define(Lang, mpc_apply_to(
+    mpc_total(mpc_predictive(mpc_many(mpca_stmt_fold, Stmt)), mpca_stmt_list_delete),
+    mpca_stmt_list_apply_to, st
+  ));
+
+  mpc_define(Stmt, mpc_and(5, mpca_stmt_afold,
+    mpc_tok(mpc_ident()), mpc_maybe(mpc_tok(mpc_string_lit())), mpc_sym(":"), Grammar, mpc_sym(";"),
+    free, free, free, mpc_soft_delete
+  ));
+
+  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
+      Term,
+      mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
+      mpc_soft_delete
+  ));
+
+  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
+
+  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
+    Base,
+      mpc_or(6,
+        mpc_sym("*"),
+        mpc_sym("+"),
+        mpc_sym("?"),
+        mpc_sym("!"),
+        mpc_tok_brackets(mpc_int(), free),
+        mpc_pass()),
+    mpc_soft_delete
+  ));
+
+  mpc_define(Base, mpc_or(5,
+    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
+    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
+    mpc_tok(mpc_and(3, mpcaf_fold_regex, mpc_regex_lit(), mpc_many(mpcf_strfold, mpc_oneof("ms")), mpc_lift_val(st), free, free)),
+    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
+    mpc_tok_parens(Grammar, mpc_soft_delete)
+  ));
+
+  mpc_optimise(Lang);
+  mpc_optimise(Stmt);
+  mpc_optimise(Grammar);
+  mpc_optimise(Term);
+  mpc_optimise(Factor);
+  mpc_optimise(Base);
+
+  if (!mpc_parse_input(i, Lang, &r)) {
+    e = r.error;
+  } else {
+    e = NULL;
+  }
+
+  mpc_cleanup(6, Lang, Stmt, Grammar, Term, Factor, Base);
+
+  return e;
+}
+
+mpc_err_t *mpca_lang_file(int flags, FILE *f, ...) {
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;
+  va_start(va, f);
+
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+
+  i = mpc_input_new_map("<mpca_lang_file>", f);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang_pipe(int flags, FILE *p, ...) {
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;
+  va_start(va, p);
+
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+
+  i = mpc_input_new_pipe("<mpca_lang_pipe>", p);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang(int flags, const char *language, ...) {
+
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;
+  va_start(va, language);
+
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+
+  i = mpc_input_new_string("<mpca_lang>", language);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...) {
+
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;
+
+  FILE *f = fopen(filename, "rb");
+
+  if (f == NULL) {
+    err = mpc_err_file(filename, "Unable to open file!");
+    return err;
+  }
+
+  va_start(va, filename);
+
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+
+  i = mpc_input_new_map(filename, f);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+
+  free(st.parsers);
+  va_end(va);
+
+  fclose(f);
+
+  return err;
+}
+
+static int mpc_nodecount_unretained(mpc_parser_t* p, int force) {
+
+  int i, total;
+
+  if (p->retained && !force) { return 0; }
+
+  if (p->type == MPC_TYPE_EXPECT) { return 1 + mpc_nodecount_unretained(p->data.expect.x, 0); }
+
+  if (p->type == MPC_TYPE_APPLY)    { return 1 + mpc_nodecount_unretained(p->data.apply.x, 0); }
+  if (p->type == MPC_TYPE_APPLY_TO) { return 1 + mpc_nodecount_unretained(p->data.apply_to.x, 0); }
+  if (p->type == MPC_TYPE_PREDICT)  { return 1 + mpc_nodecount_unretained(p->data.predict.x, 0); }
+  if (p->type == MPC_TYPE_PACKRAT)  { return 1 + mpc_nodecount_unretained(p->data.packrat.x, 0); }
+  if (p->type == MPC_TYPE_DFA)      { return 1 + mpc_nodecount_unretained(p->data.dfa.x, 0); }
+  if (p->type == MPC_TYPE_CLASS)    { return 1 + mpc_nodecount_unretained(p->data.cls.x, 0); }
+  if (p->type == MPC_TYPE_SPAN)     { return 1 + mpc_nodecount_unretained(p->data.span.x, 0); }
+
+  if (p->type == MPC_TYPE_CHECK)    { return 1 + mpc_nodecount_unretained(p->data.check.x, 0); }
+  if (p->type == MPC_TYPE_CHECK_WITH) { return 1 + mpc_nodecount_unretained(p->data.check_with.x, 0); }
+
+  if (p->type == MPC_TYPE_NOT)   { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
+  if (p->type == MPC_TYPE_MAYBE) { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
+
+  if (p->type == MPC_TYPE_MANY)  { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_MANY1) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_COUNT) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+
+  if (p->type == MPC_TYPE_OR) {
+    total = 1;
+    for(i = 0; i < p->data.or.n; i++) {
+      total += mpc_nodecount_unretained(p->data.or.xs[i], 0);
+    }
+    return total;
+  }
+
+  if (p->type == MPC_TYPE_AND) {
+    total = 1;
+    for(i = 0; i < p->data.and.n; i++) {
+      total += mpc_nodecount_unretained(p->data.and.xs[i], 0);
+    }
+    return total;
+  }
+
+  return 1;
+
+}
+
+/*
+** Collects every parser reachable from p, following
+** retained parsers too. Each is visited once, as
+** grammars are usually recursive.
+*/
+
+static void mpc_reachable(mpc_parser_t *p, mpc_parser_t ***seen, int *seen_num) {
+
+  int i;
+
+  for (i = 0; i < *seen_num; i++) {
+    if ((*seen)[i] == p) { return; }
+  }
+
+  (*seen_num)++;
+  *seen = realloc(*seen, sizeof(mpc_parser_t*) * (*seen_num));
+  (*seen)[*seen_num-1] = p;
+
+  switch (p->type) {
+    case MPC_TYPE_PACKRAT:    mpc_reachable(p->data.packrat.x, seen, seen_num); break;
+    case MPC_TYPE_EXPECT:     mpc_reachable(p->data.expect.x, seen, seen_num); break;
+    case MPC_TYPE_APPLY:      mpc_reachable(p->data.apply.x, seen, seen_num); break;
+    case MPC_TYPE_APPLY_TO:   mpc_reachable(p->data.apply_to.x, seen, seen_num); break;
+    case MPC_TYPE_PREDICT:    mpc_reachable(p->data.predict.x, seen, seen_num); break;
+    case MPC_TYPE_CHECK:      mpc_reachable(p->data.check.x, seen, seen_num); break;
+    case MPC_TYPE_CHECK_WITH: mpc_reachable(p->data.check_with.x, seen, seen_num); break;
+    case MPC_TYPE_DFA:        mpc_reachable(p->data.dfa.x, seen, seen_num); break;
+    case MPC_TYPE_SPAN:       mpc_reachable(p->data.span.x, seen, seen_num); break;
+    case MPC_TYPE_CLASS:      mpc_reachable(p->data.cls.x, seen, seen_num); break;
+
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_MAYBE:
+      mpc_reachable(p->data.not.x, seen, seen_num);
+      break;
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      mpc_reachable(p->data.repeat.x, seen, seen_num);
+      break;
+
+    case MPC_TYPE_OR:
+      for (i = 0; i < p->data.or.n; i++) {
+        mpc_reachable(p->data.or.xs[i], seen, seen_num);
+      }
+      break;
+
+    case MPC_TYPE_AND:
+      for (i = 0; i < p->data.and.n; i++) {
+        mpc_reachable(p->data.and.xs[i], seen, seen_num);
+      }
+      break;
+
+    default: break;
+  }
+
+}
+
+/* Named parsers that have been called, busiest first */
+static int mpc_profile_cmp(const void *a, const void *b) {
+  const mpc_prof_t *x = (*(mpc_parser_t* const*)a)->prof;
+  const mpc_prof_t *y = (*(mpc_parser_t* const*)b)->prof;
+  if (x->ticks != y->ticks) { return x->ticks < y->ticks ? 1 : -1; }
+  if (x->calls != y->calls) { return x->calls < y->calls ? 1 : -1; }
+  return 0;
+}
+
+static int mpc_profiled(mpc_parser_t *p, mpc_parser_t ***named) {
+
+  mpc_parser_t **seen = NULL;
+  int i, seen_num = 0, n = 0;
+
+  mpc_reachable(p, &seen, &seen_num);
+
+  *named = malloc(sizeof(mpc_parser_t*) * seen_num);
+  for (i = 0; i < seen_num; i++) {
+    if (seen[i]->prof && seen[i]->prof->calls > 0) { (*named)[n++] = seen[i]; }
+  }
+  free(seen);
+
+  qsort(*named, n, sizeof(mpc_parser_t*), mpc_profile_cmp);
+  return n;
+}
+
+static double mpc_profile_ms(long ticks) {
+  return 1000.0 * ticks / CLOCKS_PER_SEC;
+}
+
+void mpc_stats(mpc_parser_t* p) {
+
+  mpc_parser_t **seen = NULL, **named;
+  mpc_prof_t *q;
+  int i, seen_num = 0, n;
+  long hits = 0, misses = 0;
+
+  printf("Stats\n");
+  printf("=====\n");
+  printf("Node Count: %i\n", mpc_nodecount_unretained(p, 1));
+
+  mpc_reachable(p, &seen, &seen_num);
+  for (i = 0; i < seen_num; i++) {
+    if (seen[i]->type != MPC_TYPE_PACKRAT) { continue; }
+    hits += seen[i]->data.packrat.hits;
+    misses += seen[i]->data.packrat.misses;
+  }
+  free(seen);
+
+  if (hits + misses > 0) {
+    printf("Memo Lookups: %li\n", hits + misses);
+    printf("Memo Hit Rate: %.1f%%\n", 100.0 * hits / (hits + misses));
+  }
+
+  n = mpc_profiled(p, &named);
+
+  if (n > 0) {
+    printf("\n%-20s %10s %10s %10s %12s %10s %10s\n",
+      "Rule", "Calls", "Successes", "Failures", "Bytes", "Rewinds", "Time (ms)");
+    for (i = 0; i < n; i++) {
+      q = named[i]->prof;
+      printf("%-20s %10li %10li %10li %12li %10li %10.3f\n",
+        named[i]->name, q->calls, q->successes, q->failures,
+        q->bytes, q->rewinds, mpc_profile_ms(q->ticks));
+    }
+  }
+
+  free(named);
+}
+
+void mpc_stats_csv(mpc_parser_t *p, FILE *f) {
+
+  mpc_parser_t **named;
+  mpc_prof_t *q;
+  int i, n = mpc_profiled(p, &named);
+
+  fprintf(f, "rule,calls,successes,failures,bytes,rewinds,ms\n");
+  for (i = 0; i < n; i++) {
+    q = named[i]->prof;
+    fprintf(f, "%s,%li,%li,%li,%li,%li,%.3f\n",
+      named[i]->name, q->calls, q->successes, q->failures,
+      q->bytes, q->rewinds, mpc_profile_ms(q->ticks));
+  }
+
+  free(named);
+}
+
+/*
+** FIRST sets
+**
+** For an `or` with a few alternatives the optimiser
+** works out, for each alternative, which next bytes
+** it could possibly succeed on. This is the FIRST set
+** of the alternative, or every byte if it can succeed
+** without consuming anything. From these it builds a
+** 256 entry table mapping each byte to a bitmask of
+** the alternatives worth trying, and at parse time the
+** `or` skips straight past the others.
+**
+** Undefined parsers, since they may be defined later,
+** and left recursion are taken to match any byte. A
+** skipped alternative would only have failed, so the
+** `or` notes them in the failure log to run if the
+** parse fails, see mpc_err_skip.
+*/
+
+enum {
+  MPC_FIRST_DEPTH_MAX = 64,
+  MPC_FIRST_STEPS_MAX = 4096,
+  MPC_DISPATCH_MAX = 32
+};
+
+typedef struct {
+  mpc_parser_t *path[MPC_FIRST_DEPTH_MAX];
+  int depth;
+  int steps;
+} mpc_first_t;
+
+/* Adds FIRST(p) to set. Returns 1 if p may succeed without consuming. */
+static int mpc_first(mpc_parser_t *p, unsigned char *set, mpc_first_t *st) {
+
+  int j, x = 0;
+  char c;
+
+  for (j = 0; j < st->depth; j++) {
+    if (st->path[j] == p) { break; }
+  }
+
+  if (j < st->depth || st->depth == MPC_FIRST_DEPTH_MAX || st->steps++ >= MPC_FIRST_STEPS_MAX) {
+    memset(set, 0xFF, 32);
+    return 1;
+  }
+
+  st->path[st->depth++] = p;
+
+  switch (p->type) {
+
+    case MPC_TYPE_FAIL: break;
+
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_SATISFY:
+      memset(set, 0xFF, 32);
+      break;
+
+    case MPC_TYPE_SINGLE:
+      mpc_set_add(set, (unsigned char)p->data.single.x);
+      break;
+
+    case MPC_TYPE_RANGE:
+      for (j = 1; j < 256; j++) {
+        c = (char)j;
+        if (c >= p->data.range.x && c <= p->data.range.y) { mpc_set_add(set, j); }
+      }
+      break;
+
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+      mpc_set_union(set, p->data.string.set);
+      break;
+
+    case MPC_TYPE_CLASS:
+      mpc_set_union(set, p->data.cls.set);
+      break;
+
+    case MPC_TYPE_STRING:
+      if (p->data.string.x[0] == '\0') { x = 1; break; }
+      mpc_set_add(set, (unsigned char)p->data.string.x[0]);
+      break;
+
+    case MPC_TYPE_EXPECT:     x = mpc_first(p->data.expect.x, set, st); break;
+    case MPC_TYPE_APPLY:      x = mpc_first(p->data.apply.x, set, st); break;
+    case MPC_TYPE_APPLY_TO:   x = mpc_first(p->data.apply_to.x, set, st); break;
+    case MPC_TYPE_CHECK:      x = mpc_first(p->data.check.x, set, st); break;
+    case MPC_TYPE_CHECK_WITH: x = mpc_first(p->data.check_with.x, set, st); break;
+    case MPC_TYPE_PREDICT:    x = mpc_first(p->data.predict.x, set, st); break;
+    case MPC_TYPE_PACKRAT:    x = mpc_first(p->data.packrat.x, set, st); break;
+    case MPC_TYPE_DFA:        x = mpc_first(p->data.dfa.x, set, st); break;
+    case MPC_TYPE_SPAN:       x = mpc_first(p->data.span.x, set, st); break;
+
+    case MPC_TYPE_MAYBE:
+      mpc_first(p->data.not.x, set, st);
+      x = 1;
+      break;
+
+    case MPC_TYPE_MANY:
+      mpc_first(p->data.repeat.x, set, st);
+      x = 1;
+      break;
+
+    case MPC_TYPE_MANY1:
+      x = mpc_first(p->data.repeat.x, set, st);
+      break;
+
+    case MPC_TYPE_COUNT:
+      x = p->data.repeat.n == 0 || mpc_first(p->data.repeat.x, set, st);
+      break;
+
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) {
+        x = mpc_first(p->data.or.xs[j], set, st) || x;
+      }
+      x = x || p->data.or.n == 0;
+      break;
+
+    case MPC_TYPE_AND:
+      x = 1;
+      for (j = 0; j < p->data.and.n && x; j++) {
+        x = mpc_first(p->data.and.xs[j], set, st);
+      }
+      break;
+
+    /* These consume nothing */
+
+    case MPC_TYPE_PASS:
+    case MPC_TYPE_LIFT:
+    case MPC_TYPE_LIFT_VAL:
+    case MPC_TYPE_STATE:
+    case MPC_TYPE_ANCHOR:
+    case MPC_TYPE_SOI:
+    case MPC_TYPE_EOI:
+    case MPC_TYPE_NOT:
+      x = 1;
+      break;
+
+    /* Undefined parsers may be defined later */
+
+    default:
+      memset(set, 0xFF, 32);
+      x = 1;
+      break;
+  }
+
+  st->depth--;
+  return x;
+}
+
+/*
+** Whether p is sure to note a failure, at or after
+** where it started, whenever it fails. Parsers which
+** never fail are too. Where it can't tell it says no.
+*/
+
+static int mpc_errs(mpc_parser_t *p, mpc_first_t *st) {
+
+  int j, x = 0;
+
+  for (j = 0; j < st->depth; j++) {
+    if (st->path[j] == p) { return 0; }
+  }
+
+  if (st->depth == MPC_FIRST_DEPTH_MAX || st->steps++ >= MPC_FIRST_STEPS_MAX) { return 0; }
+
+  st->path[st->depth++] = p;
+
+  switch (p->type) {
+
+    case MPC_TYPE_FAIL:
+    case MPC_TYPE_EXPECT:
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_PASS:
+    case MPC_TYPE_LIFT:
+    case MPC_TYPE_LIFT_VAL:
+    case MPC_TYPE_STATE:
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_MANY:
+      x = 1;
+      break;
+
+    case MPC_TYPE_APPLY:      x = mpc_errs(p->data.apply.x, st); break;
+    case MPC_TYPE_APPLY_TO:   x = mpc_errs(p->data.apply_to.x, st); break;
+    case MPC_TYPE_CHECK:      x = mpc_errs(p->data.check.x, st); break;
+    case MPC_TYPE_CHECK_WITH: x = mpc_errs(p->data.check_with.x, st); break;
+    case MPC_TYPE_PREDICT:    x = mpc_errs(p->data.predict.x, st); break;
+    case MPC_TYPE_PACKRAT:    x = mpc_errs(p->data.packrat.x, st); break;
+    case MPC_TYPE_DFA:        x = mpc_errs(p->data.dfa.x, st); break;
+    case MPC_TYPE_CLASS:      x = mpc_errs(p->data.cls.x, st); break;
+    case MPC_TYPE_SPAN:       x = mpc_errs(p->data.span.x, st); break;
+    case MPC_TYPE_MANY1:      x = mpc_errs(p->data.repeat.x, st); break;
+
+    case MPC_TYPE_COUNT:
+      x = p->data.repeat.n == 0 || mpc_errs(p->data.repeat.x, st);
+      break;
+
+    case MPC_TYPE_OR:
+      x = p->data.or.n == 0;
+      for (j = 0; j < p->data.or.n && !x; j++) {
+        x = mpc_errs(p->data.or.xs[j], st);
+      }
+      break;
+
+    case MPC_TYPE_AND:
+      x = 1;
+      for (j = 0; j < p->data.and.n && x; j++) {
+        x = mpc_errs(p->data.and.xs[j], st);
+      }
+      break;
+
+    /* Byte parsers fail quietly, and undefined parsers may be defined later */
+
+    default: break;
+  }
+
+  st->depth--;
+  return x;
+}
+
+static int mpc_errs_of(mpc_parser_t *p) {
+  mpc_first_t st;
+  st.depth = 0;
+  st.steps = 0;
+  return mpc_errs(p, &st);
+}
+
+static void mpc_optimise_dispatch(mpc_parser_t *p) {
+
+  int j, c, partial = 0;
+  unsigned char set[32];
+  unsigned long *d;
+  mpc_first_t st;
+
+  free(p->data.or.dispatch);
+  p->data.or.dispatch = NULL;
+  p->data.or.errs = 0;
+
+  if (p->data.or.n < 2 || p->data.or.n > MPC_DISPATCH_MAX) { return; }
+
+  d = calloc(256, sizeof(unsigned long));
+  st.steps = 0;
+
+  for (j = 0; j < p->data.or.n; j++) {
+    memset(set, 0, sizeof(set));
+    st.depth = 0;
+    if (mpc_first(p->data.or.xs[j], set, &st)) { memset(set, 0xFF, sizeof(set)); }
+    for (c = 0; c < 256; c++) {
+      if (mpc_set_has(set, c)) { d[c] |= 1ul << j; } else { partial = 1; }
+    }
+  }
+
+  /* Not worth a table if every alternative is always tried */
+  if (!partial || st.steps > MPC_FIRST_STEPS_MAX) { free(d); return; }
+
+  p->data.or.dispatch = d;
+
+  for (j = 0; j < p->data.or.n; j++) {
+    if (mpc_errs_of(p->data.or.xs[j])) { p->data.or.errs |= 1ul << j; }
+  }
+}
+
+/*
+** Regular Expression DFAs
+**
+** The combinators built by `mpc_re` are PEG like:
+** choices are ordered and repeats are greedy and never
+** give anything back. A DFA taking the longest match
+** gives the same result only when no choice has to be
+** undone later, so a part of a regex is compiled only
+** when, looking at the next byte alone:
+**
+**   - the alternatives of an `or` can't both start, and
+**     only the last one may match nothing
+**   - a repeat can't both go round again and finish a
+**     match of its body
+**   - in a sequence, nothing that can continue one part
+**     can also start the next
+**
+** A `count` is also left alone where its failure would
+** be seen, as it can fail part way through without going
+** back to where it started, unlike a sequence. Anchors,
+** lookahead and anything not built by `mpc_re` aren't
+** compiled either. Those parts keep their
+** combinators and the largest parts that do pass are
+** wrapped in a DFA node, which still holds the original
+** combinators to run on streamed input and to produce
+** the error messages when a parse fails.
+**
+** The DFA itself comes from a Thompson NFA by subset
+** construction, over classes of bytes which no part of
+** the regex tells apart.
+*/
+
+enum {
+  MPC_DFA_NFA_MAX = 1024,
+  MPC_DFA_STATES_MAX = 1024
+};
+
+typedef struct {
+  unsigned char first[32];
+  unsigned char next[32];
+  int nullable;
+  int partial;
+} mpc_dfa_info_t;
+
+/* Can p be replaced by a DFA? Fills in its FIRST and follow-on sets. */
+static int mpc_dfa_check(mpc_parser_t *p, mpc_dfa_info_t *r) {
+
+  int j;
+  mpc_dfa_info_t c;
+  mpc_first_t st;
+
+  memset(r, 0, sizeof(mpc_dfa_info_t));
+
+  if (p->retained) { return 0; }
+
+  switch (p->type) {
+
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_SINGLE:
+    case MPC_TYPE_RANGE:
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_CLASS:
+    case MPC_TYPE_STRING:
+      st.depth = 0;
+      st.steps = 0;
+      r->nullable = mpc_first(p, r->first, &st);
+      break;
+
+    case MPC_TYPE_LIFT:
+      if (p->data.lift.lf != mpcf_ctor_str) { return 0; }
+      r->nullable = 1;
+      break;
+
+    case MPC_TYPE_EXPECT:
+      return mpc_dfa_check(p->data.expect.x, r);
+
+    case MPC_TYPE_SPAN:
+      return mpc_dfa_check(p->data.span.x, r);
+
+    case MPC_TYPE_MAYBE:
+      if (p->data.not.lf != mpcf_ctor_str
+      || !mpc_dfa_check(p->data.not.x, r)
+      ||  r->partial) { return 0; }
+      r->nullable = 1;
+      break;
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      if (p->data.repeat.f != mpcf_strfold
+      || !mpc_dfa_check(p->data.repeat.x, r)) { return 0; }
+      if (p->type == MPC_TYPE_COUNT && p->data.repeat.n == 0) {
+        memset(r, 0, sizeof(mpc_dfa_info_t));
+        r->nullable = 1;
+        break;
+      }
+      if (p->type == MPC_TYPE_COUNT && p->data.repeat.n == 1) { break; }
+      if (r->nullable || r->partial || !mpc_set_disjoint(r->next, r->first)) { return 0; }
+      mpc_set_union(r->next, r->first);
+      r->nullable = p->type == MPC_TYPE_MANY;
+      r->partial = p->type == MPC_TYPE_COUNT;
+      break;
+
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) {
+        if (!mpc_dfa_check(p->data.or.xs[j], &c)
+        ||  !mpc_set_disjoint(r->first, c.first)
+        ||  r->nullable || c.partial) { return 0; }
+        mpc_set_union(r->first, c.first);
+        mpc_set_union(r->next, c.next);
+        r->nullable = c.nullable;
+      }
+      break;
+
+    case MPC_TYPE_AND:
+      if (p->data.and.f != mpcf_strfold) { return 0; }
+      r->nullable = 1;
+      for (j = 0; j < p->data.and.n; j++) {
+        if (!mpc_dfa_check(p->data.and.xs[j], &c)
+        ||  !mpc_set_disjoint(r->next, c.first)) { return 0; }
+        if (r->nullable) { mpc_set_union(r->first, c.first); }
+        if (c.nullable) {
+          mpc_set_union(r->next, c.first);
+          mpc_set_union(r->next, c.next);
+        } else {
+          memcpy(r->next, c.next, 32);
+        }
+        r->nullable = r->nullable && c.nullable;
+      }
+      break;
+
+    default: return 0;
+  }
+
+  if (r->nullable) { mpc_set_union(r->next, r->first); }
+  return 1;
+}
+
+typedef struct {
+  unsigned char set[32];
+  int out;
+  int eps[2];
+} mpc_nfa_node_t;
+
+typedef struct {
+  int num;
+  mpc_nfa_node_t nodes[MPC_DFA_NFA_MAX];
+} mpc_nfa_t;
+
+static int mpc_nfa_node(mpc_nfa_t *n) {
+  mpc_nfa_node_t *x;
+  if (n->num == MPC_DFA_NFA_MAX) { return -1; }
+  x = &n->nodes[n->num];
+  memset(x->set, 0, 32);
+  x->out = -1;
+  x->eps[0] = -1;
+  x->eps[1] = -1;
+  return n->num++;
+}
+
+/* Builds p starting from the unused node s. Returns its end node or -1 if too big. */
+static int mpc_nfa_build(mpc_nfa_t *n, mpc_parser_t *p, int s) {
+
+  int j, e, t, u;
+  mpc_first_t st;
+  const char *x;
+
+  if (s == -1) { return -1; }
+
+  switch (p->type) {
+
+    case MPC_TYPE_STRING:
+      for (x = p->data.string.x; *x && s != -1; x++) {
+        e = mpc_nfa_node(n);
+        mpc_set_add(n->nodes[s].set, (unsigned char)*x);
+        n->nodes[s].out = e;
+        s = e;
+      }
+      return s;
+
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_SINGLE:
+    case MPC_TYPE_RANGE:
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_CLASS:
+      e = mpc_nfa_node(n);
+      st.depth = 0;
+      st.steps = 0;
+      mpc_first(p, n->nodes[s].set, &st);
+      n->nodes[s].out = e;
+      return e;
+
+    case MPC_TYPE_LIFT: return s;
+    case MPC_TYPE_EXPECT: return mpc_nfa_build(n, p->data.expect.x, s);
+    case MPC_TYPE_SPAN: return mpc_nfa_build(n, p->data.span.x, s);
+
+    case MPC_TYPE_MAYBE:
+      t = mpc_nfa_node(n);
+      e = mpc_nfa_node(n);
+      n->nodes[s].eps[0] = t;
+      n->nodes[s].eps[1] = e;
+      u = mpc_nfa_build(n, p->data.not.x, t);
+      if (u == -1 || e == -1) { return -1; }
+      n->nodes[u].eps[0] = e;
+      return e;
+
+    case MPC_TYPE_MANY:
+      t = mpc_nfa_node(n);
+      e = mpc_nfa_node(n);
+      n->nodes[s].eps[0] = t;
+      n->nodes[s].eps[1] = e;
+      u = mpc_nfa_build(n, p->data.repeat.x, t);
+      if (u == -1 || e == -1) { return -1; }
+      n->nodes[u].eps[0] = s;
+      return e;
+
+    case MPC_TYPE_MANY1:
+      u = mpc_nfa_build(n, p->data.repeat.x, s);
+      e = mpc_nfa_node(n);
+      if (u == -1 || e == -1) { return -1; }
+      n->nodes[u].eps[0] = s;
+      n->nodes[u].eps[1] = e;
+      return e;
+
+    case MPC_TYPE_COUNT:
+      for (j = 0; j < p->data.repeat.n; j++) {
+        s = mpc_nfa_build(n, p->data.repeat.x, s);
+      }
+      return s;
+
+    case MPC_TYPE_AND:
+      for (j = 0; j < p->data.and.n; j++) {
+        s = mpc_nfa_build(n, p->data.and.xs[j], s);
+      }
+      return s;
+
+    case MPC_TYPE_OR:
+      e = mpc_nfa_node(n);
+      for (j = 0; j < p->data.or.n && s != -1 && e != -1; j++) {
+        t = mpc_nfa_node(n);
+        u = j < p->data.or.n - 1 ? mpc_nfa_node(n) : -1;
+        n->nodes[s].eps[0] = t;
+        n->nodes[s].eps[1] = u;
+        t = mpc_nfa_build(n, p->data.or.xs[j], t);
+        if (t == -1) { return -1; }
+        n->nodes[t].eps[0] = e;
+        s = u;
+      }
+      return e;
+
+    default: return -1;
+  }
+}
+
+static void mpc_nfa_closure(mpc_nfa_t *n, unsigned char *set, int *stack) {
+
+  int j, k, num = 0;
+
+  for (j = 0; j < n->num; j++) {
+    if (mpc_set_has(set, j)) { stack[num++] = j; }
+  }
+
+  while (num > 0) {
+    j = stack[--num];
+    for (k = 0; k < 2; k++) {
+      if (n->nodes[j].eps[k] != -1 && !mpc_set_has(set, n->nodes[j].eps[k])) {
+        mpc_set_add(set, n->nodes[j].eps[k]);
+        stack[num++] = n->nodes[j].eps[k];
+      }
+    }
+  }
+}
+
+static mpc_dfa_t *mpc_dfa_build(mpc_parser_t *p) {
+
+  int j, k, c, m, start, end, width, found;
+  int cls[256], split[512], reps[256];
+  int *stack;
+  unsigned char *states, *set;
+  mpc_nfa_t *n;
+  mpc_dfa_t *d;
+
+  n = malloc(sizeof(mpc_nfa_t));
+  n->num = 0;
+  start = mpc_nfa_node(n);
+  end = mpc_nfa_build(n, p, start);
+  if (end == -1) { free(n); return NULL; }
+
+  /* Split bytes into classes by the node sets they are in */
+
+  d = malloc(sizeof(mpc_dfa_t));
+  d->classes = 1;
+  for (c = 0; c < 256; c++) { cls[c] = 0; }
+
+  for (j = 0; j < n->num; j++) {
+    if (n->nodes[j].out == -1) { continue; }
+    for (k = 0; k < 2 * d->classes; k++) { split[k] = -1; }
+    m = 0;
+    for (c = 0; c < 256; c++) {
+      k = 2 * cls[c] + mpc_set_has(n->nodes[j].set, c);
+      if (split[k] == -1) { split[k] = m++; }
+      cls[c] = split[k];
+    }
+    d->classes = m;
+  }
+
+  for (c = 255; c >= 0; c--) {
+    d->cls[c] = (unsigned char)cls[c];
+    reps[cls[c]] = c;
+  }
+
+  /* Subset construction, with state 0 as the empty set */
+
+  width = (n->num + 7) / 8;
+  stack = malloc(sizeof(int) * n->num);
+  states = calloc(2, width);
+  mpc_set_add(states + width, start);
+  mpc_nfa_closure(n, states + width, stack);
+  d->num = 2;
+  d->trans = malloc(sizeof(unsigned short) * 2 * d->classes);
+  set = malloc(width);
+
+  for (j = 0; j < d->num; j++) {
+    for (k = 0; k < d->classes; k++) {
+
+      memset(set, 0, width);
+      for (m = 0; m < n->num; m++) {
+        if (mpc_set_has(states + j * width, m) && n->nodes[m].out != -1
+        &&  mpc_set_has(n->nodes[m].set, reps[k])) {
+          mpc_set_add(set, n->nodes[m].out);
+        }
+      }
+      mpc_nfa_closure(n, set, stack);
+
+      found = -1;
+      for (m = 0; m < d->num && found == -1; m++) {
+        if (memcmp(states + m * width, set, width) == 0) { found = m; }
+      }
+
+      if (found == -1) {
+        if (d->num == MPC_DFA_STATES_MAX) {
+          free(states); free(set); free(stack); free(n);
+          free(d->trans); free(d);
+          return NULL;
+        }
+        found = d->num++;
+        states = realloc(states, d->num * width);
+        memcpy(states + found * width, set, width);
+        d->trans = realloc(d->trans, sizeof(unsigned short) * d->num * d->classes);
+      }
+
+      d->trans[j * d->classes + k] = (unsigned short)found;
+    }
+  }
+
+  d->accept = malloc(d->num);
+  for (j = 0; j < d->num; j++) {
+    d->accept[j] = (char)mpc_set_has(states + j * width, end);
+  }
+
+  free(states); free(set); free(stack); free(n);
+  return d;
+}
+
+static void mpc_re_dfa(mpc_parser_t *p) {
+
+  int j;
+  mpc_dfa_info_t r;
+  mpc_dfa_t *d;
+  mpc_parser_t *x;
+
+  switch (p->type) {
+
+    /* Single bytes gain nothing from a DFA */
+
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+    case MPC_TYPE_OR:
+    case MPC_TYPE_AND:
+      if (mpc_dfa_check(p, &r) && !r.partial && (d = mpc_dfa_build(p)) != NULL) {
+        x = malloc(sizeof(mpc_parser_t));
+        memcpy(x, p, sizeof(mpc_parser_t));
+        x->name = NULL;
+        p->type = MPC_TYPE_DFA;
+        p->data.dfa.x = x;
+        p->data.dfa.d = d;
+        p->data.dfa.errs = mpc_errs_of(x);
+        return;
+      }
+      break;
+
+    default: break;
+  }
+
+  if (p->retained) { return; }
+
+  switch (p->type) {
+    case MPC_TYPE_EXPECT:   mpc_re_dfa(p->data.expect.x); break;
+    case MPC_TYPE_APPLY:    mpc_re_dfa(p->data.apply.x); break;
+    case MPC_TYPE_APPLY_TO: mpc_re_dfa(p->data.apply_to.x); break;
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_MAYBE:    mpc_re_dfa(p->data.not.x); break;
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:    mpc_re_dfa(p->data.repeat.x); break;
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) { mpc_re_dfa(p->data.or.xs[j]); }
+      break;
+    case MPC_TYPE_AND:
+      for (j = 0; j < p->data.and.n; j++) { mpc_re_dfa(p->data.and.xs[j]); }
+      break;
+    default: break;
+  }
+}
+
+/*
+** Alternatives which each match a single byte, like
+** `mpc_char` and `mpc_oneof`, are merged into a class
+** node testing one bitmap. The class keeps them to run
+** when its failures are needed, so errors come out
+** the same.
+*/
+
+static int mpc_class_of(mpc_parser_t *p, unsigned char *set) {
+
+  mpc_first_t st;
+
+  if (p->retained) { return 0; }
+
+  switch (p->type) {
+    case MPC_TYPE_EXPECT: return mpc_class_of(p->data.expect.x, set);
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_SINGLE:
+    case MPC_TYPE_RANGE:
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_CLASS:
+      st.depth = 0;
+      st.steps = 0;
+      mpc_first(p, set, &st);
+      return 1;
+    default: return 0;
+  }
+}
+
+static void mpc_optimise_class(mpc_parser_t *p) {
+
+  int j, k, m;
+  unsigned char set[32];
+  mpc_parser_t *t, *c;
+
+  for (j = 0; j < p->data.or.n; j++) {
+
+    memset(set, 0, sizeof(set));
+    for (k = j; k < p->data.or.n && mpc_class_of(p->data.or.xs[k], set); k++);
+    m = k - j;
+    if (m < 2) { continue; }
+
+    t = mpc_undefined();
+    t->type = MPC_TYPE_OR;
+
+    if (m == p->data.or.n) {
+      t->data = p->data;
+      p->type = MPC_TYPE_CLASS;
+      p->data.cls.x = t;
+      p->data.cls.errs = mpc_errs_of(t);
+      memcpy(p->data.cls.set, set, sizeof(set));
+      return;
+    }
+
+    t->data.or.n = m;
+    t->data.or.xs = malloc(sizeof(mpc_parser_t*) * m);
+    t->data.or.dispatch = NULL;
+    memcpy(t->data.or.xs, p->data.or.xs + j, sizeof(mpc_parser_t*) * m);
+
+    c = mpc_undefined();
+    c->type = MPC_TYPE_CLASS;
+    c->data.cls.x = t;
+    c->data.cls.errs = mpc_errs_of(t);
+    memcpy(c->data.cls.set, set, sizeof(set));
+
+    p->data.or.xs[j] = c;
+    memmove(p->data.or.xs + j + 1, p->data.or.xs + k, sizeof(mpc_parser_t*) * (p->data.or.n - k));
+    p->data.or.n -= m - 1;
+  }
+}
+
+/*
+** A many of a class folded with `mpcf_strfold` becomes
+** a span node which takes the whole run in one go. The
+** ranges making up the class are kept for SSE2 when
+** there are at most four of them.
+*/
+
+static void mpc_optimise_span(mpc_parser_t *p) {
+
+  int c, lo;
+  unsigned char set[32];
+  mpc_parser_t *t;
+
+  memset(set, 0, sizeof(set));
+  if (!mpc_class_of(p->data.repeat.x, set)) { return; }
+
+  t = mpc_undefined();
+  t->type = p->type;
+  t->data = p->data;
+
+  p->type = MPC_TYPE_SPAN;
+  p->data.span.x = t;
+  p->data.span.n = 0;
+  p->data.span.errs = mpc_errs_of(t->data.repeat.x);
+  memcpy(p->data.span.set, set, sizeof(set));
+
+  for (c = 1; c < 256; c++) {
+    if (!mpc_set_has(set, c)) { continue; }
+    for (lo = c; c < 255 && mpc_set_has(set, c + 1); c++);
+    if (p->data.span.n == 4) { p->data.span.n = 0; return; }
+    p->data.span.lo[p->data.span.n] = (unsigned char)lo;
+    p->data.span.hi[p->data.span.n] = (unsigned char)c;
+    p->data.span.n++;
+  }
+}
+
+static void mpc_optimise_unretained(mpc_parser_t *p, int force) {
+
+  int i, n, m;
+  mpc_parser_t *t;
+
+  if (p->retained && !force) { return; }
+
+  /* Optimise Subexpressions */
+
+  if (p->type == MPC_TYPE_EXPECT)     { mpc_optimise_unretained(p->data.expect.x, 0); }
+  if (p->type == MPC_TYPE_APPLY)      { mpc_optimise_unretained(p->data.apply.x, 0); }
+  if (p->type == MPC_TYPE_APPLY_TO)   { mpc_optimise_unretained(p->data.apply_to.x, 0); }
+  if (p->type == MPC_TYPE_CHECK)      { mpc_optimise_unretained(p->data.check.x, 0); }
+  if (p->type == MPC_TYPE_CHECK_WITH) { mpc_optimise_unretained(p->data.check_with.x, 0); }
+  if (p->type == MPC_TYPE_PREDICT)    { mpc_optimise_unretained(p->data.predict.x, 0); }
+  if (p->type == MPC_TYPE_PACKRAT)    { mpc_optimise_unretained(p->data.packrat.x, 0); }
+  if (p->type == MPC_TYPE_DFA)        { mpc_optimise_unretained(p->data.dfa.x, 0); }
+  if (p->type == MPC_TYPE_NOT)        { mpc_optimise_unretained(p->data.not.x, 0); }
+  if (p->type == MPC_TYPE_MAYBE)      { mpc_optimise_unretained(p->data.not.x, 0); }
+  if (p->type == MPC_TYPE_MANY)       { mpc_optimise_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_MANY1)      { mpc_optimise_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_COUNT)      { mpc_optimise_unretained(p->data.repeat.x, 0); }
+
+  if (p->type == MPC_TYPE_OR) {
+    for(i = 0; i < p->data.or.n; i++) {
+      mpc_optimise_unretained(p->data.or.xs[i], 0);
+    }
+  }
+
+  if (p->type == MPC_TYPE_AND) {
+    for(i = 0; i < p->data.and.n; i++) {
+      mpc_optimise_unretained(p->data.and.xs[i], 0);
+    }
+  }
+
+  /* Perform optimisations */
+
+  while (1) {
+
+    /* Merge rhs `or` */
+    if (p->type == MPC_TYPE_OR
+    &&  p->data.or.xs[p->data.or.n-1]->type == MPC_TYPE_OR
+    && !p->data.or.xs[p->data.or.n-1]->retained) {
+      t = p->data.or.xs[p->data.or.n-1];
+      n = p->data.or.n; m = t->data.or.n;
+      p->data.or.n = n + m - 1;
+      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
+      memmove(p->data.or.xs + n - 1, t->data.or.xs, m * sizeof(mpc_parser_t*));
+      free(t->data.or.xs); free(t->data.or.dispatch); free(t->name); free(t);
+      continue;
+    }
+
+    /* Merge lhs `or` */
+    if (p->type == MPC_TYPE_OR
+    &&  p->data.or.xs[0]->type == MPC_TYPE_OR
+    && !p->data.or.xs[0]->retained) {
+      t = p->data.or.xs[0];
+      n = p->data.or.n; m = t->data.or.n;
+      p->data.or.n = n + m - 1;
+      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
+      memmove(p->data.or.xs + m, p->data.or.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
+      memmove(p->data.or.xs, t->data.or.xs, m * sizeof(mpc_parser_t*));
+      free(t->data.or.xs); free(t->data.or.dispatch); free(t->name); free(t);
+      continue;
+    }
+
+    /* Remove ast `pass` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.n == 2
+    &&  p->data.and.xs[0]->type == MPC_TYPE_PASS
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.f == mpcf_fold_ast) {
+      t = p->data.and.xs[1];
+      mpc_delete(p->data.and.xs[0]);
+      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
+      memcpy(p, t, sizeof(mpc_parser_t));
+      free(t);
+      continue;
+    }
+
+    /* Merge ast lhs `and` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.f == mpcf_fold_ast
+    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.xs[0]->data.and.f == mpcf_fold_ast) {
+      t = p->data.and.xs[0];
+      n = p->data.and.n; m = t->data.and.n;
+      p->data.and.n = n + m - 1;
+      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
+      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
+      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
+      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
+      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
+      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
+      continue;
+    }
+
+    /* Merge ast rhs `and` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.f == mpcf_fold_ast
+    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
+    && !p->data.and.xs[p->data.and.n-1]->retained
+    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_fold_ast) {
+      t = p->data.and.xs[p->data.and.n-1];
+      n = p->data.and.n; m = t->data.and.n;
+      p->data.and.n = n + m - 1;
+      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
+      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
+      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
+      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
+      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
+      continue;
+    }
+
+    /* Remove re `lift` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.n == 2
+    &&  p->data.and.xs[0]->type == MPC_TYPE_LIFT
+    &&  p->data.and.xs[0]->data.lift.lf == mpcf_ctor_str
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.f == mpcf_strfold) {
+      t = p->data.and.xs[1];
+      mpc_delete(p->data.and.xs[0]);
+      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
+      memcpy(p, t, sizeof(mpc_parser_t));
+      free(t);
+      continue;
+    }
+
+    /* Merge re lhs `and` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.f == mpcf_strfold
+    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.xs[0]->data.and.f == mpcf_strfold) {
+      t = p->data.and.xs[0];
+      n = p->data.and.n; m = t->data.and.n;
+      p->data.and.n = n + m - 1;
+      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
+      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
+      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
+      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
+      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
+      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
+      continue;
+    }
+
+    /* Merge re rhs `and` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.f == mpcf_strfold
+    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
+    && !p->data.and.xs[p->data.and.n-1]->retained
+    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_strfold) {
+      t = p->data.and.xs[p->data.and.n-1];
+      n = p->data.and.n; m = t->data.and.n;
+      p->data.and.n = n + m - 1;
+      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
+      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
+      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
+      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
+      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
+      continue;
+    }
+
+    break;
+
+  }
+
+  if (p->type == MPC_TYPE_OR) { mpc_optimise_class(p); }
+
+  if ((p->type == MPC_TYPE_MANY || p->type == MPC_TYPE_MANY1)
+  &&  p->data.repeat.f == mpcf_strfold) { mpc_optimise_span(p); }
+  if (p->type == MPC_TYPE_OR) { mpc_optimise_dispatch(p); }
+
+}
+
+/*
+** Once optimised a parser is frozen. Parsing never
+** writes to a parser, besides adding each parse's
+** memo and profile counts once it is done, which is
+** done atomically, so one frozen grammar can
+** be shared by any number of threads, each parsing
+** its own input. Defining or optimising it again
+** would race with them and is refused.
+*/
+
+void mpc_optimise(mpc_parser_t *p) {
+  if (p->frozen) { return; }
+  mpc_optimise_unretained(p, 1);
+  p->frozen = 1;
+}
+
@@ -1,822 +1,3591 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include "mpc.h"
-
-// Test Git
-// Windows compiler preprocessor
-#ifdef _WIN32
-#include <string.h>
-
-static char input[2048];
-
-// Fake readline function
-char* readline(char* prompt) {
-    fputs(prompt, stdout);
-    fgets(buffer, 2048, stdin);
-    char* cpy = malloc(strlen(buffer)+1);
-    strcpy(cpy, buffer);
-    cpy[strlen(cpy) - 1] = '\0';
-    return cpy;
-}
-
-void add_history(char* unused) {}
-#else
-#include <editline/readline.h>
-#endif
-
-// Declaration
-// Forward Declarations
-struct lval;
-struct lenv;
-typedef struct lval lval;
-typedef struct lenv lenv;
-typedef lval*(*lbuiltin)(lenv*, lval*);
-
-// Create Enumeration of Possible lval Types
-enum LVAL_TYPE
-{
-    LVAL_NUM,
-    LVAL_ERR,
-    LVAL_SYM,
-    LVAL_SEXPR,
-    LVAL_QEXPR,
-    LVAL_FUNC
-};
-
-// Create Enumeration of Possible Error Types
-enum LERR_TYPE
-{
-    LERR_DIV_ZERO,
-    LERR_BAD_OP,
-    LERR_BAD_NUM
-};
-
-// Our defined structs
-typedef struct lval
-{
-    enum LVAL_TYPE type;
-    long num;
-    char* err;
-    char* sym;
-
-    /* Function */
-    lbuiltin builtin_func;
-    lenv* env;
-    lval* formals;
-    lval* body;
-
-    /* Expression */
-    int count;
-    struct lval** cell;
-} lval;
-
-struct lenv {
-    // Parent environment
-    lenv* parent;
-    int count;
-    char **syms;
-    lval **vals;
-};
-
-#define LASSERT(args, cond, fmt, ...) \
-    if (!(cond)) { \
-        lval* err = lval_err(fmt, ##__VA_ARGS__); \
-        lval_del(args);  \
-        return err; \
-    }
-
-#define LASSERT_TYPE(func, args, index, expect) \
-    LASSERT(args, args->cell[index]->type == expect, \
-        "Function '%s' passed incorrect type for argument %i. " \
-        "Got %s, Expected %s.", \
-        func, index, ltype_name(args->cell[index]->type), ltype_name(expect))
-
-#define LASSERT_NUM(func, args, num) \
-    LASSERT(args, args->count == num, \
-        "Function '%s' passed incorrect number of arguments. " \
-        "Got %i, Expected %i.", \
-        func, args->count, num)
-
-#define LASSERT_NOT_EMPTY(func, args, index) \
-    LASSERT(args, args->cell[index]->count != 0, \
-        "Function '%s' passed {} for argument %i", \
-        func, index)
-
-lval* builtin_eval(lenv* e, lval* a);
-lval* builtin_var(lenv* env, lval* a, char* func);
-lval* lval_add(lval* v, lval* x);
-lval* lval_copy(lval* v);
-lval* lval_eval(lenv* e, lval* v);
-void lval_print(lval* v);
-lval* lval_eval_sexpr(lenv* e, lval* v);
-void lenv_del(lenv* e);
-lenv* lenv_new(void);
-lval* builtin(lval* a, char* func);
-lval* lval_pop(lval* v, int index);
-
-char* ltype_name(enum LVAL_TYPE t) {
-    switch(t) {
-        case LVAL_FUNC: return "Function";
-        case LVAL_NUM: return "Number";
-        case LVAL_ERR: return "Error";
-        case LVAL_SYM: return "Symbol";
-        case LVAL_SEXPR: return "S-Expression";
-        case LVAL_QEXPR: return "Q-Expression";
-        default: return "Unknown";
-    }
-}
-
-// Construct a pointer to a new Number lval
-lval* lval_num(long x)
-{
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_NUM;
-    v->num = x;
-    return v;
-}
-
-// Construct a pointer to a new Error lval
-lval* lval_err(char* fmt, ...)
-{
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_ERR;
-
-    va_list va;
-    va_start(va, fmt);
-
-    v->err = malloc(512);
-
-    // printf the error string with a maximum 511 characters to err
-    vsnprintf(v->err, 511, fmt, va);
-
-    // Reallocate to number of bytes actually used
-    v->err = realloc(v->err, strlen(v->err) + 1);
-    va_end(va);
-    return v;
-}
-
-// Construct a pointer to a new Symbol lval
-lval* lval_sym(char* s) {
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_SYM;
-    v->sym = malloc(strlen(s) + 1);
-    strcpy(v->sym, s);
-    return v;
-}
-
-lval* lval_func(lbuiltin func) {
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_FUNC;
-    v->builtin_func = func;
-    return v;
-}
-
-lval* lval_lambda(lval* formals, lval* body) {
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_FUNC;
-
-    v->builtin_func = NULL;
-
-    v->env = lenv_new();
-
-    v->formals = formals;
-    v->body = body;
-    return v;
-}
-
-lenv* lenv_new(void) {
-    lenv* e = malloc(sizeof(lenv));
-    e->parent = NULL;
-    e->count = 0;
-    e->syms = NULL;
-    e->vals = NULL;
-    return e;
-}
-
-lenv* lenv_copy(lenv* v) {
-    lenv* e = malloc(sizeof(lenv));
-
-    e->parent = v->parent;
-    e->count = v->count;
-    e->syms = malloc(sizeof(char*) * e->count);
-    for (int i = 0; i < e->count; i++) {
-        e->syms[i] = malloc(strlen(v->syms[i]) + 1);
-        strcpy(e->syms[i], v->syms[i]);
-    }
-
-    e->vals = malloc(sizeof(lval*) * e->count);
-    for (int i = 0; i < e->count; i++) {
-        e->vals[i] = lval_copy(v->vals[i]);
-    }
-
-    return e;
-}
-
-// Free memory from lval
-void lval_del(lval* v) {
-    switch (v->type) {
-        case LVAL_NUM: 
-            break;
-        case LVAL_FUNC:
-            if (!v->builtin_func) {
-                lenv_del(v->env);
-                lval_del(v->formals);
-                lval_del(v->body);
-            }
-            break;
-        case LVAL_ERR:  
-            free(v->err); 
-            break;
-        case LVAL_SYM:  
-            free(v->sym); 
-            break;
-        case LVAL_SEXPR:
-        case LVAL_QEXPR:
-            for (int i = 0; i < v-> count; i++) {
-                lval_del(v->cell[i]);
-            }
-            free(v->cell);
-        break;
-    }
-
-    free(v);
-}
-
-// Free memory from lenv
-void lenv_del(lenv* e) {
-    for (int i = 0; i < e->count; i++) {
-        free(e->syms[i]);
-        lval_del(e->vals[i]);
-    }
-
-    free(e->syms);
-    free(e->vals);
-    free(e);
-}
-
-lval* lenv_get(lenv* e, lval* k) {
-    for (int i = 0; i < e->count; i++) {
-        if (strcmp(e->syms[i], k->sym) == 0) {
-            return lval_copy(e->vals[i]);
-        }
-    }
-
-    // If no symbol found, check parent environment, otherwise return lval error
-    if (e->parent) {
-        return lenv_get(e->parent, k);
-    } else {
-        return lval_err("unbound symbol '%s'!", k->sym);
-    }
-
-}
-
-// Define local variable
-void lenv_put(lenv* e, lval* k, lval* v) {
-    for (int i = 0; i < e->count; i++) {
-        // If variable is found, delete item at that position
-        // Replace with a copy of user-supplied one.
-        if (strcmp(e->syms[i], k->sym) == 0) {
-            lval_del(e->vals[i]);
-            e->vals[i] = lval_copy(v);
-            return;
-        }
-    }
-
-    e->count++;
-    e->vals = realloc(e->vals, sizeof(lval*) * e->count);
-    e->syms = realloc(e->syms, sizeof(char*) * e->count);
-
-    e->vals[e->count - 1] = lval_copy(v);
-    e->syms[e->count - 1] = malloc(strlen(k->sym) + 1);
-    strcpy(e->syms[e->count - 1], k->sym);
-}
-
-// Define global variable
-void lenv_def(lenv* e, lval* symbol, lval* value) {
-    // Iterate to the environment which has no parent
-    while (e->parent) {
-        e = e->parent;
-    }
-
-    lenv_put(e, symbol, value);
-}
-
-// Construct a pointer to a new SExpression lval
-lval* lval_sexpr(void) {
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_SEXPR;
-    v->count = 0;
-    v->cell = NULL;
-    return v;
-}
-
-// Construct a pointer to a new Q-Expression lval
-lval* lval_qexpr(void) {
-    lval* v = malloc(sizeof(lval));
-    v->type = LVAL_QEXPR;
-    v->count = 0;
-    v->cell = NULL;
-    return v;
-}
-
-lval* lval_read_num(mpc_ast_t* t) {
-    errno = 0;
-    long x = strtol(t->contents, NULL, 10);
-    return errno != ERANGE ? lval_num(x) : lval_err("invalid number");
-}
-
-// Convert AST to an expression tree
-lval* lval_read(mpc_ast_t* abstract_syntax_tree) {
-    if (strstr(abstract_syntax_tree->tag, "number")) return lval_read_num(abstract_syntax_tree); 
-    if (strstr(abstract_syntax_tree->tag, "symbol")) return lval_sym(abstract_syntax_tree->contents);
-
-    lval* x = NULL;
-    if (strcmp(abstract_syntax_tree->tag, ">") == 0) x = lval_sexpr();
-    if (strstr(abstract_syntax_tree->tag, "sexpr")) x = lval_sexpr();
-    if (strstr(abstract_syntax_tree->tag, "qexpr")) x = lval_qexpr();
-
-    for (int i = 0; i < abstract_syntax_tree->children_num; i++) {
-        if (strcmp(abstract_syntax_tree->children[i]->contents, "(") == 0) continue;
-        if (strcmp(abstract_syntax_tree->children[i]->contents, ")") == 0) continue;
-        if (strcmp(abstract_syntax_tree->children[i]->contents, "{") == 0) continue;
-        if (strcmp(abstract_syntax_tree->children[i]->contents, "}") == 0) continue; 
-        if (strcmp(abstract_syntax_tree->children[i]->tag, "regex") == 0) continue;
-        x = lval_add(x, lval_read(abstract_syntax_tree->children[i]));
-    }
-
-    return x;
-}
-
-// Insert Lisp value x to Lisp value v
-lval* lval_add(lval* v, lval* x) {
-    v->count++;
-    v->cell = realloc(v->cell, sizeof(lval*) * v->count);
-    v->cell[v->count-1] = x;
-    return v;
-}
-
-lval* lval_call(lenv* env, lval* f, lval* a) {
-    if (f->builtin_func) {
-        return f->builtin_func(env, a);
-    }
-
-    // Record Argument Counts
-    int given = a->count;
-    int total = f->formals->count;
-
-    // While arguments still remain to be processed
-    while (a->count) {
-        // if re're ran out of formal arguments to bind
-        if (f->formals->count == 0) {
-            lval_del(a);
-            return lval_err(
-                "Function passed too many parguments. "
-                "Got %i, Expected %i.", given, total);
-        }
-
-        // Pop the first symbol from the formals
-        lval* sym = lval_pop(f->formals, 0);
-
-        // Pop the next argument from the list
-        lval* val = lval_pop(a, 0);
-
-        // Bind a copy into the function's environment
-        lenv_put(f->env, sym, val);
-
-        lval_del(sym);
-        lval_del(val);
-    }
-
-    // Argument list is now bound so can be cleaned up
-    lval_del(a);
-
-    // If all formals have been bound evaluate
-    if (f->formals->count == 0) {
-        // Set environment parent to evaluation environment
-        f->env->parent = env;
-
-        // Evaluate and return
-        return builtin_eval(
-            f->env, lval_add(lval_sexpr(), lval_copy(f->body))
-        );
-    }
-    else {
-        // Otherwise return partially evaluated function
-        return lval_copy(f);
-    }
-}
-
-void lval_expr_print(lval* v, char open, char close) {
-    putchar(open);
-    for (int i = 0; i < v->count; i++) {
-        lval_print(v->cell[i]);
-
-        if (i != (v->count - 1)) {
-            putchar(' ');
-        }
-    }
-
-    putchar(close);
-}
-
-void lval_print(lval* v)
-{
-    switch (v->type)
-    {
-        case LVAL_NUM:
-            printf("%li", v->num);
-            break;
-        case LVAL_ERR:
-            printf("Error: %s", v->err); 
-            break;
-        case LVAL_SYM:
-            printf("%s", v->sym);
-            break;
-        case LVAL_SEXPR:
-            lval_expr_print(v, '(', ')');
-            break;
-        case LVAL_QEXPR:
-            lval_expr_print(v, '{', '}');
-            break;
-        case LVAL_FUNC:
-            if (v->builtin_func) {
-                printf("<builtin>");
-            } else {
-                printf("(\\ "); lval_print(v->formals);
-                putchar(' '); lval_print(v->body); putchar(')');
-            }
-            break;
-        default:
-            break;
-    }
-}
-
-void lval_println(lval* v)
-{
-    lval_print(v);
-    putchar('\n');
-}
-
-// Evaluate Lisp values tree
-lval* lval_eval(lenv* env, lval* v) {
-    if (v->type == LVAL_SYM) {
-        lval* x = lenv_get(env, v);
-        lval_del(v);
-        return x;
-    }
-
-    if (v->type == LVAL_SEXPR) {
-        return lval_eval_sexpr(env, v);
-    }
-
-    return v;
-}
-
-// Get child lval at specified index from passed in lval
-lval* lval_pop(lval* v, int index) {
-    lval* x = v->cell[index];
-    memmove(&v->cell[index], &v->cell[index+1], sizeof(lval*) * (v->count - index - 1));
-
-    v->count--;
-    v->cell = realloc(v->cell, sizeof(lval*) * v->count);
-
-    return x;
-}
-
-// Get child lval at specified index and free delete parent lval
-lval* lval_take(lval* v, int index) {
-    lval* x = lval_pop(v, index);
-    lval_del(v);
-    return x;
-}
-
-lval* builtin_operation(lenv* environment, lval* a, char* operation) {
-    for (int i = 0; i < a->count; i++) {
-        LASSERT_TYPE(operation, a, i, LVAL_NUM);
-    }
-
-    // Pop the first element
-    lval* x = lval_pop(a, 0);
-
-    // If no arguments and sub then perform unary operation
-    if ((strcmp(operation, "-") ==0) && a->count == 0) {
-        x-> num = -x->num;
-    }
-
-    while (a->count > 0) {
-        lval* y = lval_pop(a, 0);
-
-        if (strcmp(operation, "+") == 0) x->num += y->num;
-        if (strcmp(operation, "-") == 0) x->num -= y->num;
-        if (strcmp(operation, "*") == 0) x->num *= y->num;
-        if (strcmp(operation, "/") == 0) {
-            if (y->num == 0) {
-                lval_del(x);
-                lval_del(y);
-                x = lval_err("Division by Zero!");
-                break;
-            }
-            x->num /= y->num;
-        }
-
-        lval_del(y);
-    }
-
-    lval_del(a);
-    return x;
-}
-
-lval* lval_eval_sexpr(lenv* environment, lval* v) {
-    for (int i = 0; i < v->count; i++) {
-        v->cell[i] = lval_eval(environment, v->cell[i]); 
-    }
-
-    for (int i = 0; i < v->count; i++) {
-        if (v->cell[i]->type == LVAL_ERR) {
-            return lval_take(v, i);
-        }
-    }
-
-    if (v->count == 0) return v;
-    
-    if (v->count == 1) return lval_take(v, 0);
-
-    // Ensure first element is a function after evaluation
-    lval* lval_func = lval_pop(v, 0);
-    if (lval_func->type != LVAL_FUNC) {
-        lval* err = lval_err(
-            "S-Expression starts with incorrect type. "
-            "Got %s, Expected %s.",
-            ltype_name(lval_func->type), ltype_name(LVAL_FUNC)
-        );
-        lval_del(lval_func);
-        lval_del(v);
-        return err;
-    }
-
-    lval* result = lval_call(environment, lval_func, v);
-    lval_del(lval_func);
-    return result;
-}
-
-lval* builtin_head(lenv* e, lval* a) {
-    LASSERT_NUM("head", a, 1);
-    LASSERT_TYPE("head", a, 0, LVAL_QEXPR);
-    LASSERT_NOT_EMPTY("head", a, 0);
-
-    // Take the first argument
-    lval* v = lval_take(a, 0);
-
-    // Delete all elemenents that are not head and return
-    while (v->count > 1) {
-        lval_del(lval_pop(v, 1));
-    }
-    return v;
-}
-
-lval* builtin_tail(lenv* e, lval* a) {
-    LASSERT_NUM("tail", a, 1);
-    LASSERT_TYPE("tail", a, 0, LVAL_QEXPR);
-    LASSERT_NOT_EMPTY("tail", a, 0);
-
-    // Take first argument and only argument from a as a contains only one qexpr
-    lval* v = lval_take(a, 0);
-
-    // Delete first element and return
-    lval_del(lval_pop(v, 0));
-    return v;
-}
-
-lval* builtin_list(lenv* e, lval* a) {
-    a->type = LVAL_QEXPR;
-    return a;
-}
-
-lval* builtin_eval(lenv* e, lval* a) {
-    LASSERT_NUM("eval", a, 1);
-    LASSERT_TYPE("eval", a, 0, LVAL_QEXPR);
-
-    lval* v = lval_take(a, 0);
-    v->type = LVAL_SEXPR;
-    return lval_eval(e, v);
-}
-
-lval* builtin_lambda(lenv* e, lval* a) {
-    LASSERT_NUM("\\", a, 2);
-    LASSERT_TYPE("\\", a, 0, LVAL_QEXPR);
-    LASSERT_TYPE("\\", a, 1, LVAL_QEXPR);
-
-    for (int i = 0; i < a->cell[0]->count; i++) {
-        LASSERT(a, (a->cell[0]->cell[i]->type == LVAL_SYM),
-            "Cannot define non-symbol. Got %s, Expected %s",
-            ltype_name(a->cell[0]->cell[i]->type), ltype_name(LVAL_SYM));
-    }
-
-    lval* formals = lval_pop(a, 0);
-    lval* body = lval_pop(a, 0);
-    lval_del(a);
-
-    return lval_lambda(formals, body);
-}
-
-lval* lval_join(lval* x, lval* y) {
-    while (y->count) {
-        x = lval_add(x, lval_pop(y, 0));
-    }
-
-    lval_del(y);
-    return x;
-}
-
-// join {1 2 3} {4 5 6} {7 8}
-// {1 2 3 4 5 6 7 8}
-lval* builtin_join(lenv* e, lval* a) {
-    for (int i = 0; i < a->count; i++) {
-        LASSERT_TYPE("join", a, i, LVAL_QEXPR);
-    }
-
-    lval* x = lval_pop(a, 0);
-
-    while (a->count) {
-        x = lval_join(x, lval_pop(a, 0));
-    }
-
-    lval_del(a);
-    return x;
-}
-
-lval* builtin_add(lenv* e, lval* a) {
-    return builtin_operation(e, a, "+");
-}
-
-lval* builtin_subtract(lenv* e, lval* a) {
-    return builtin_operation(e, a, "-");
-}
-
-lval* builtin_multiply(lenv* e, lval* a) {
-    return builtin_operation(e, a, "*");
-}
-
-lval* builtin_divide(lenv* e, lval* a) {
-    return builtin_operation(e, a, "/");
-}
-
-lval* builtin_def(lenv* e, lval* a) {
-    return builtin_var(e, a, "def");
-}
-
-lval* builtin_put(lenv* e, lval* a) {
-    return builtin_var(e, a, "=");
-}
-
-lval* builtin_var(lenv* env, lval* a, char* func) {
-    LASSERT_TYPE(func, a, 0, LVAL_QEXPR);
-
-    lval* syms = a->cell[0];
-    for (int i = 0; i < syms->count; i++) {
-        LASSERT(a, (syms->cell[i]->type == LVAL_SYM),
-            "Function '%s' cannot define non-symbol. "
-            "Got %s, Expected %s.", func,
-            ltype_name(syms->cell[i]->type),
-            ltype_name(LVAL_SYM));
-    }
-
-    LASSERT(a, (syms->count == a->count-1), 
-        "Function '%s' passed too many arguments for symbols. "
-        "Got %i, Expected %i.", func, syms->count, a->count-1);
-
-    for (int i = 0; i < syms->count; i++) {
-        // If 'def', define the variable globally
-        if (strcmp(func, "def") == 0) {
-            lenv_def(env, syms->cell[i], a->cell[i+1]);
-        }
-
-        // If '=' define the variable locally according to passed in env
-        if (strcmp(func, "=") == 0) {
-            lenv_put(env, syms->cell[i], a->cell[i+1]);
-        }
-    }
-
-    lval_del(a);
-    return lval_sexpr();
-}
-
-void lenv_add_builtin(lenv* e, char* name, lbuiltin func) {
-    lval* symbol = lval_sym(name);
-    lval* func_def = lval_func(func);
-    lenv_put(e, symbol, func_def);
-    lval_del(symbol);
-    lval_del(func_def);
-}
-
-void lenv_add_builtins(lenv* environment) {
-    lenv_add_builtin(environment, "list", builtin_list);
-    lenv_add_builtin(environment, "head", builtin_head);
-    lenv_add_builtin(environment, "tail", builtin_tail);
-    lenv_add_builtin(environment, "join", builtin_join);
-    lenv_add_builtin(environment, "eval", builtin_eval);
-    lenv_add_builtin(environment, "def", builtin_def);
-    lenv_add_builtin(environment, "=", builtin_put);
-    lenv_add_builtin(environment, "\\", builtin_lambda);
-
-    lenv_add_builtin(environment, "+", builtin_add);
-    lenv_add_builtin(environment, "-", builtin_subtract);
-    lenv_add_builtin(environment, "*", builtin_multiply);
-    lenv_add_builtin(environment, "/", builtin_divide);
-}
-
-lval* lval_copy(lval* v) {
-    lval* x = malloc(sizeof(lval));
-    x->type = v->type;
-
-    switch(v->type) {
-        case LVAL_FUNC: 
-            if (v->builtin_func) {
-                x->builtin_func = v->builtin_func; 
-            } else {
-                x->builtin_func = NULL;
-                x->env = lenv_copy(v->env);
-                x->formals = lval_copy(v->formals);
-                x->body = lval_copy(v->body);
-            }
-            break;
-        case LVAL_NUM: x->num = v->num; break;
-
-        case LVAL_ERR:
-            x->err = malloc(strlen(v->err) + 1);
-            strcpy(x->err, v->err);
-            break;
-        case LVAL_SYM:
-            x->sym = malloc(strlen(v->sym) + 1);
-            strcpy(x->sym, v->sym);
-            break;
-        case LVAL_SEXPR:
-        case LVAL_QEXPR:
-            x->count = v->count;
-            x->cell = malloc(sizeof(lval*) * v->count);
-            for (int i = 0; i < x->count; i++) {
-                x->cell[i] = lval_copy(v->cell[i]);
-            }
-            break;
-    }
-
-    return x;
-}
-
-int main(int argc, char **argv)
-{
-    puts("Keii Version 0.0.1");
-    puts("Press Ctrl + C to exit\n");
-
-    /* Create Parser */
-    mpc_parser_t *number = mpc_new("number");
-    mpc_parser_t *symbol= mpc_new("symbol");
-    mpc_parser_t *sexpr = mpc_new("sexpr");
-    mpc_parser_t *qexpr = mpc_new("qexpr");
-    mpc_parser_t *expr = mpc_new("expr");
-    mpc_parser_t *lispy = mpc_new("lispy");
-
-    /* Defind the language */
-    mpca_lang(MPCA_LANG_DEFAULT,
-        "                                                           \
-            number: /-?[0-9]+/;                                     \
-            symbol: /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/;               \
-            sexpr: '(' <expr>* ')';                                 \
-            qexpr: '{' <expr>* '}';                                 \
-            expr: <number> | <symbol> | <sexpr> | <qexpr> ;         \
-            lispy: /^/ <expr>* /$/;                                 \
-        ",
-              number, symbol, sexpr, qexpr, expr, lispy);
-
-    // Initialise root environment with builtin functions
-    lenv* e = lenv_new();
-    lenv_add_builtins(e);
-
-    while (1)
-    {
-        char* input = readline("keii> ");
-        add_history(input);
-
-        mpc_result_t r;
-        if (mpc_parse("<stdin>", input, lispy, &r))
-        {
-            lval* x = lval_eval(e, lval_read(r.output));
-            lval_println(x);
-            lval_del(x);
-
-            mpc_ast_delete(r.output);
-        }
-        else
-        {
-            mpc_err_print(r.error);
-            mpc_err_delete(r.error);
-        }
-
-        free(input);
-    }
-
-    lenv_del(e);
-    mpc_cleanup(6, number, symbol, sexpr, qexpr, expr, lispy);
-
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "mpc.h"
+
+// x86 SIMD kernels are compiled per target and picked at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEII_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Test Git
+// Windows compiler preprocessor
+#ifdef _WIN32
+#include <string.h>
+
+static char input[2048];
+
+// Fake readline function
+char* readline(char* prompt) {
+    fputs(prompt, stdout);
+    fgets(buffer, 2048, stdin);
+    char* cpy = malloc(strlen(buffer)+1);
+    strcpy(cpy, buffer);
+    cpy[strlen(cpy) - 1] = '\0';
+    return cpy;
+}
+
+void add_history(char* unused) {}
+#else
+#include <editline/readline.h>
+#endif
+
+// Declaration
+// Forward Declarations
+struct lval;
+struct lenv;
+struct lvec;
+struct lseq;
+struct lrope;
+struct lhamt;
+typedef struct lval lval;
+typedef struct lenv lenv;
+typedef struct lvec lvec;
+typedef struct lseq lseq;
+typedef struct lrope lrope;
+typedef struct lhamt lhamt;
+typedef lval*(*lbuiltin)(lenv*, lval*);
+
+// Create Enumeration of Possible lval Types
+enum LVAL_TYPE
+{
+    LVAL_NUM,
+    LVAL_DBL,
+    LVAL_ERR,
+    LVAL_SYM,
+    LVAL_SEXPR,
+    LVAL_QEXPR,
+    LVAL_FUNC,
+    LVAL_VEC,
+    LVAL_SEQ,
+    LVAL_STR,
+    LVAL_MAP
+};
+
+// Element types of a numeric vector buffer
+enum LVEC_TYPE
+{
+    LVEC_INT,
+    LVEC_DBL
+};
+
+// Kinds of lazy sequence
+enum LSEQ_TYPE
+{
+    LSEQ_RANGE,
+    LSEQ_STREAM,
+    LSEQ_MAP,
+    LSEQ_FILTER
+};
+
+// Strings up to this many bytes are stored inside their rope leaf
+#define LROPE_INLINE 23
+
+// Create Enumeration of Possible Error Types
+enum LERR_TYPE
+{
+    LERR_DIV_ZERO,
+    LERR_BAD_OP,
+    LERR_BAD_NUM
+};
+
+// Our defined structs
+typedef struct lval
+{
+    enum LVAL_TYPE type;
+    long num;
+    double dbl;
+    char* err;
+    char* sym;
+
+    /* Function */
+    lbuiltin builtin_func;
+    lenv* env;
+    lval* formals;
+    lval* body;
+
+    /* Expression */
+    int count;
+    struct lval** cell;
+
+    /* Vector, a view of vec_count elements from vec_start */
+    lvec* vec;
+    long vec_start;
+    long vec_count;
+
+    /* Sequence */
+    lseq* seq;
+
+    /* String */
+    lrope* str;
+
+    /* Map, with its number of keys */
+    lhamt* map;
+    long map_count;
+} lval;
+
+// Contiguous numeric buffer, shared by vectors and their slices
+struct lvec {
+    int refs;
+    enum LVEC_TYPE type;
+    long count;
+    int64_t* ints;
+    double* dbls;
+};
+
+// Lazy sequence state. Elements are computed one at a time as the
+// sequence is consumed, so only the current state is ever held.
+struct lseq {
+    enum LSEQ_TYPE type;
+
+    /* Range, counting from next up to (or down to) end */
+    long next;
+    long end;
+    long step;
+
+    /* Stream, the last element produced and whether it has been */
+    lval* value;
+    int started;
+
+    /* Stream, Map and Filter function, Map and Filter source */
+    lval* func;
+    lseq* src;
+};
+
+// Bytes shared by every rope leaf sliced from them
+typedef struct {
+    int refs;
+    char data[];
+} lstrbuf;
+
+// Immutable string rope, shared by reference count. A leaf holds len
+// bytes, inline when short and otherwise as a slice of a shared buffer.
+// Any other node is the concatenation of left and right.
+struct lrope {
+    int refs;
+    long len;
+    int depth;
+
+    /* Leaf */
+    lstrbuf* buf;
+    const char* bytes;
+    char small[LROPE_INLINE];
+
+    /* Concatenation */
+    lrope* left;
+    lrope* right;
+};
+
+// Key/value pair in a map, shared by every map that holds it
+typedef struct {
+    int refs;
+    uint32_t hash;
+    lval* key;
+    lval* val;
+} lmap_entry;
+
+// Persistent hash array mapped trie node, shared by reference count.
+// Slots are picked by 5 bits of a key's hash at each level; datamap marks
+// the slots holding an entry and nodemap those holding a child node, each
+// packed in slot order. Nodes are never changed once built.
+struct lhamt {
+    int refs;
+    uint32_t datamap;
+    uint32_t nodemap;
+    int ndata;
+    int nnodes;
+    lmap_entry** data;
+    lhamt** nodes;
+};
+
+struct lenv {
+    // Parent environment
+    lenv* parent;
+    int count;
+    char **syms;
+    lval **vals;
+};
+
+#define LASSERT(args, cond, fmt, ...) \
+    if (!(cond)) { \
+        lval* err = lval_err(fmt, ##__VA_ARGS__); \
+        lval_del(args);  \
+        return err; \
+    }
+
+#define LASSERT_TYPE(func, args, index, expect) \
+    LASSERT(args, args->cell[index]->type == expect, \
+        "Function '%s' passed incorrect type for argument %i. " \
+        "Got %s, Expected %s.", \
+        func, index, ltype_name(args->cell[index]->type), ltype_name(expect))
+
+#define LASSERT_NUM(func, args, num) \
+    LASSERT(args, args->count == num, \
+        "Function '%s' passed incorrect number of arguments. " \
+        "Got %i, Expected %i.", \
+        func, args->count, num)
+
+#define LASSERT_NOT_EMPTY(func, args, index) \
+    LASSERT(args, args->cell[index]->count != 0, \
+        "Function '%s' passed {} for argument %i", \
+        func, index)
+
+lval* builtin_eval(lenv* e, lval* a);
+lval* builtin_var(lenv* env, lval* a, char* func);
+lval* lval_add(lval* v, lval* x);
+lval* lval_copy(lval* v);
+void lval_del(lval* v);
+lval* lval_eval(lenv* e, lval* v);
+void lval_print(lval* v);
+lval* lval_eval_sexpr(lenv* e, lval* v);
+void lenv_del(lenv* e);
+lenv* lenv_new(void);
+lval* builtin(lval* a, char* func);
+lval* lval_pop(lval* v, int index);
+lval* builtin_operation(lenv* environment, lval* a, char* operation);
+lval* builtin_vec_operation(lenv* e, lval* a, char* operation);
+lval* lseq_next(lenv* e, lseq* s);
+
+char* ltype_name(enum LVAL_TYPE t) {
+    switch(t) {
+        case LVAL_FUNC: return "Function";
+        case LVAL_NUM: return "Number";
+        case LVAL_DBL: return "Double";
+        case LVAL_ERR: return "Error";
+        case LVAL_SYM: return "Symbol";
+        case LVAL_SEXPR: return "S-Expression";
+        case LVAL_QEXPR: return "Q-Expression";
+        case LVAL_VEC: return "Vector";
+        case LVAL_SEQ: return "Sequence";
+        case LVAL_STR: return "String";
+        case LVAL_MAP: return "Map";
+        default: return "Unknown";
+    }
+}
+
+// Construct a pointer to a new Number lval
+lval* lval_num(long x)
+{
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_NUM;
+    v->num = x;
+    return v;
+}
+
+// Construct a pointer to a new Double lval
+lval* lval_dbl(double x)
+{
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_DBL;
+    v->dbl = x;
+    return v;
+}
+
+// Construct a pointer to a new Error lval
+lval* lval_err(char* fmt, ...)
+{
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_ERR;
+
+    va_list va;
+    va_start(va, fmt);
+
+    v->err = malloc(512);
+
+    // printf the error string with a maximum 511 characters to err
+    vsnprintf(v->err, 511, fmt, va);
+
+    // Reallocate to number of bytes actually used
+    v->err = realloc(v->err, strlen(v->err) + 1);
+    va_end(va);
+    return v;
+}
+
+// Construct a pointer to a new Symbol lval
+lval* lval_sym(char* s) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_SYM;
+    v->sym = malloc(strlen(s) + 1);
+    strcpy(v->sym, s);
+    return v;
+}
+
+lval* lval_func(lbuiltin func) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_FUNC;
+    v->builtin_func = func;
+    return v;
+}
+
+lval* lval_lambda(lval* formals, lval* body) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_FUNC;
+
+    v->builtin_func = NULL;
+
+    v->env = lenv_new();
+
+    v->formals = formals;
+    v->body = body;
+    return v;
+}
+
+// Construct a new unshared vector buffer of count elements
+lvec* lvec_new(enum LVEC_TYPE type, long count) {
+    lvec* b = malloc(sizeof(lvec));
+    b->refs = 1;
+    b->type = type;
+    b->count = count;
+    b->ints = NULL;
+    b->dbls = NULL;
+    if (type == LVEC_INT) b->ints = malloc(sizeof(int64_t) * (count ? count : 1));
+    if (type == LVEC_DBL) b->dbls = malloc(sizeof(double) * (count ? count : 1));
+    return b;
+}
+
+// Drop one reference to a vector buffer
+void lvec_release(lvec* b) {
+    if (--b->refs == 0) {
+        free(b->ints);
+        free(b->dbls);
+        free(b);
+    }
+}
+
+// Construct a pointer to a new Vector lval viewing part of a buffer.
+// Takes over the caller's reference to the buffer.
+lval* lval_vec(lvec* b, long start, long count) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_VEC;
+    v->vec = b;
+    v->vec_start = start;
+    v->vec_count = count;
+    return v;
+}
+
+lseq* lseq_new(enum LSEQ_TYPE type) {
+    lseq* s = malloc(sizeof(lseq));
+    s->type = type;
+    s->next = 0;
+    s->end = 0;
+    s->step = 0;
+    s->value = NULL;
+    s->started = 0;
+    s->func = NULL;
+    s->src = NULL;
+    return s;
+}
+
+void lseq_del(lseq* s) {
+    if (s->value) lval_del(s->value);
+    if (s->func) lval_del(s->func);
+    if (s->src) lseq_del(s->src);
+    free(s);
+}
+
+// Copy a sequence's state, so the copy and the original advance separately
+lseq* lseq_copy(lseq* s) {
+    lseq* x = lseq_new(s->type);
+    x->next = s->next;
+    x->end = s->end;
+    x->step = s->step;
+    x->started = s->started;
+    if (s->value) x->value = lval_copy(s->value);
+    if (s->func) x->func = lval_copy(s->func);
+    if (s->src) x->src = lseq_copy(s->src);
+    return x;
+}
+
+// Construct a pointer to a new Sequence lval, which takes over s
+lval* lval_seq(lseq* s) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_SEQ;
+    v->seq = s;
+    return v;
+}
+
+lrope* lrope_retain(lrope* r) {
+    r->refs++;
+    return r;
+}
+
+// Drop one reference to a rope node
+void lrope_release(lrope* r) {
+    if (--r->refs > 0) return;
+
+    if (r->left) {
+        lrope_release(r->left);
+        lrope_release(r->right);
+    } else if (r->buf && --r->buf->refs == 0) {
+        free(r->buf);
+    }
+    free(r);
+}
+
+// Construct a leaf holding a copy of n bytes from s
+lrope* lrope_new(const char* s, long n) {
+    lrope* r = malloc(sizeof(lrope));
+    r->refs = 1;
+    r->len = n;
+    r->depth = 0;
+    r->left = NULL;
+    r->right = NULL;
+
+    if (n <= LROPE_INLINE) {
+        r->buf = NULL;
+        memcpy(r->small, s, n);
+        r->bytes = r->small;
+    } else {
+        r->buf = malloc(sizeof(lstrbuf) + n);
+        r->buf->refs = 1;
+        memcpy(r->buf->data, s, n);
+        r->bytes = r->buf->data;
+    }
+    return r;
+}
+
+// Construct a leaf viewing n bytes of another leaf from start. Short
+// slices are copied inline rather than keeping a large buffer alive.
+lrope* lrope_slice(lrope* leaf, long start, long n) {
+    if (n <= LROPE_INLINE || !leaf->buf) {
+        return lrope_new(leaf->bytes + start, n);
+    }
+
+    lrope* r = lrope_new("", 0);
+    r->len = n;
+    r->buf = leaf->buf;
+    r->buf->refs++;
+    r->bytes = leaf->bytes + start;
+    return r;
+}
+
+// Construct the concatenation of two ropes, taking over both references
+lrope* lrope_node(lrope* left, lrope* right) {
+    lrope* r = malloc(sizeof(lrope));
+    r->refs = 1;
+    r->len = left->len + right->len;
+    r->depth = 1 + (left->depth > right->depth ? left->depth : right->depth);
+    r->buf = NULL;
+    r->bytes = NULL;
+    r->left = left;
+    r->right = right;
+    return r;
+}
+
+// The children of a node, retained, with the node itself released
+void lrope_open(lrope* r, lrope** left, lrope** right) {
+    *left = lrope_retain(r->left);
+    *right = lrope_retain(r->right);
+    lrope_release(r);
+}
+
+// (l (rl rr)) to ((l rl) rr)
+lrope* lrope_rotate_left(lrope* r) {
+    lrope *l, *rhs, *rl, *rr;
+    lrope_open(r, &l, &rhs);
+    lrope_open(rhs, &rl, &rr);
+    return lrope_node(lrope_node(l, rl), rr);
+}
+
+// ((ll lr) r) to (ll (lr r))
+lrope* lrope_rotate_right(lrope* r) {
+    lrope *lhs, *rhs, *ll, *lr;
+    lrope_open(r, &lhs, &rhs);
+    lrope_open(lhs, &ll, &lr);
+    return lrope_node(ll, lrope_node(lr, rhs));
+}
+
+lrope* lrope_concat(lrope* a, lrope* b);
+
+// Join a shorter rope b onto the right spine of a taller rope a, keeping
+// the result height balanced the way an AVL tree join does
+lrope* lrope_join_right(lrope* a, lrope* b) {
+    lrope *l, *c;
+    lrope_open(a, &l, &c);
+
+    lrope* t = c->depth <= b->depth + 1 ? lrope_node(c, b) : lrope_join_right(c, b);
+    if (t->depth <= l->depth + 1) {
+        return lrope_node(l, t);
+    }
+    if (t->left->depth > t->right->depth) {
+        t = lrope_rotate_right(t);
+    }
+    return lrope_rotate_left(lrope_node(l, t));
+}
+
+lrope* lrope_join_left(lrope* a, lrope* b) {
+    lrope *c, *r;
+    lrope_open(b, &c, &r);
+
+    lrope* t = c->depth <= a->depth + 1 ? lrope_node(a, c) : lrope_join_left(a, c);
+    if (t->depth <= r->depth + 1) {
+        return lrope_node(t, r);
+    }
+    if (t->right->depth > t->left->depth) {
+        t = lrope_rotate_left(t);
+    }
+    return lrope_rotate_right(lrope_node(t, r));
+}
+
+// Concatenate two ropes, taking over both references. Work is
+// proportional to the difference in their depths.
+lrope* lrope_concat(lrope* a, lrope* b) {
+    if (a->len == 0) {
+        lrope_release(a);
+        return b;
+    }
+    if (b->len == 0) {
+        lrope_release(b);
+        return a;
+    }
+
+    // Short leaves are merged into one inline leaf
+    if (!a->left && !b->left && a->len + b->len <= LROPE_INLINE) {
+        lrope* r = lrope_new(a->bytes, a->len);
+        memcpy(r->small + a->len, b->bytes, b->len);
+        r->len += b->len;
+        lrope_release(a);
+        lrope_release(b);
+        return r;
+    }
+
+    if (a->depth > b->depth + 1) return lrope_join_right(a, b);
+    if (b->depth > a->depth + 1) return lrope_join_left(a, b);
+    return lrope_node(a, b);
+}
+
+// The bytes from start to end of a rope, sharing its leaves
+lrope* lrope_sub(lrope* r, long start, long end) {
+    if (start == 0 && end == r->len) {
+        return lrope_retain(r);
+    }
+    if (!r->left) {
+        return lrope_slice(r, start, end - start);
+    }
+
+    long mid = r->left->len;
+    if (end <= mid) return lrope_sub(r->left, start, end);
+    if (start >= mid) return lrope_sub(r->right, start - mid, end - mid);
+    return lrope_concat(lrope_sub(r->left, start, mid), lrope_sub(r->right, 0, end - mid));
+}
+
+// Copy the bytes of a rope into out, which must have room for them
+void lrope_write(lrope* r, char* out) {
+    while (r->left) {
+        lrope_write(r->left, out);
+        out += r->left->len;
+        r = r->right;
+    }
+    memcpy(out, r->bytes, r->len);
+}
+
+// The bytes of a rope as a new null terminated string
+char* lrope_flatten(lrope* r) {
+    char* s = malloc(r->len + 1);
+    lrope_write(r, s);
+    s[r->len] = '\0';
+    return s;
+}
+
+// The leaf of a rope holding byte pos, with *start set to its offset
+lrope* lrope_leaf_at(lrope* r, long pos, long* start) {
+    *start = 0;
+    while (r->left) {
+        if (pos < r->left->len) {
+            r = r->left;
+        } else {
+            *start += r->left->len;
+            pos -= r->left->len;
+            r = r->right;
+        }
+    }
+    return r;
+}
+
+// Three-way compare of the bytes of two ropes, like memcmp with the
+// shorter one ordering first. Runs over matching stretches of leaves
+// rather than flattening either rope.
+int lrope_cmp(lrope* a, lrope* b) {
+    long n = a->len < b->len ? a->len : b->len;
+    for (long pos = 0; pos < n && a != b;) {
+        long sa, sb;
+        lrope* la = lrope_leaf_at(a, pos, &sa);
+        lrope* lb = lrope_leaf_at(b, pos, &sb);
+        long k = n - pos;
+        if (la->len - (pos - sa) < k) k = la->len - (pos - sa);
+        if (lb->len - (pos - sb) < k) k = lb->len - (pos - sb);
+
+        int c = memcmp(la->bytes + (pos - sa), lb->bytes + (pos - sb), k);
+        if (c) return c;
+        pos += k;
+    }
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+// Construct a pointer to a new String lval, which takes over r
+lval* lval_str(lrope* r) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_STR;
+    v->str = r;
+    return v;
+}
+
+lmap_entry* lmap_entry_new(uint32_t hash, lval* key, lval* val) {
+    lmap_entry* x = malloc(sizeof(lmap_entry));
+    x->refs = 1;
+    x->hash = hash;
+    x->key = key;
+    x->val = val;
+    return x;
+}
+
+void lmap_entry_release(lmap_entry* x) {
+    if (--x->refs == 0) {
+        lval_del(x->key);
+        lval_del(x->val);
+        free(x);
+    }
+}
+
+lhamt* lhamt_new(uint32_t datamap, uint32_t nodemap, int ndata, int nnodes) {
+    lhamt* n = malloc(sizeof(lhamt));
+    n->refs = 1;
+    n->datamap = datamap;
+    n->nodemap = nodemap;
+    n->ndata = ndata;
+    n->nnodes = nnodes;
+    n->data = ndata ? malloc(sizeof(lmap_entry*) * ndata) : NULL;
+    n->nodes = nnodes ? malloc(sizeof(lhamt*) * nnodes) : NULL;
+    return n;
+}
+
+lhamt* lhamt_retain(lhamt* n) {
+    n->refs++;
+    return n;
+}
+
+// Drop one reference to a trie node
+void lhamt_release(lhamt* n) {
+    if (--n->refs > 0) return;
+
+    for (int i = 0; i < n->ndata; i++) {
+        lmap_entry_release(n->data[i]);
+    }
+    for (int i = 0; i < n->nnodes; i++) {
+        lhamt_release(n->nodes[i]);
+    }
+    free(n->data);
+    free(n->nodes);
+    free(n);
+}
+
+// Whether a value can be used as a map key
+int lval_is_key(lval* k) {
+    return k->type == LVAL_NUM || k->type == LVAL_SYM || k->type == LVAL_STR;
+}
+
+uint32_t lhash_bytes(uint32_t h, const char* s, long n) {
+    for (long i = 0; i < n; i++) {
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t lhash_rope(uint32_t h, lrope* r) {
+    while (r->left) {
+        h = lhash_rope(h, r->left);
+        r = r->right;
+    }
+    return lhash_bytes(h, r->bytes, r->len);
+}
+
+// FNV-1a over the key's bytes, seeded by type so 1, '1' and "1" differ
+uint32_t lval_hash(lval* k) {
+    uint32_t h = 2166136261u ^ (uint32_t)k->type;
+    switch (k->type) {
+        case LVAL_NUM: return lhash_bytes(h, (const char*)&k->num, sizeof(k->num));
+        case LVAL_SYM: return lhash_bytes(h, k->sym, strlen(k->sym));
+        case LVAL_STR: return lhash_rope(h, k->str);
+        default: return h;
+    }
+}
+
+int lval_key_eq(lval* x, lval* y) {
+    if (x->type != y->type) return 0;
+    switch (x->type) {
+        case LVAL_NUM: return x->num == y->num;
+        case LVAL_SYM: return strcmp(x->sym, y->sym) == 0;
+        case LVAL_STR:
+            return x->str->len == y->str->len && lrope_cmp(x->str, y->str) == 0;
+        default: return 0;
+    }
+}
+
+// Each trie level uses 5 bits of the hash. Past the last level, entries
+// whose hashes are all equal sit together in a collision node.
+#define LHAMT_BITS 5
+#define LHAMT_COLLIDES(shift) ((shift) >= 32)
+
+uint32_t lhamt_bit(uint32_t hash, int shift) {
+    return (uint32_t)1 << ((hash >> shift) & 31);
+}
+
+int lhamt_index(uint32_t map, uint32_t bit) {
+    return __builtin_popcount(map & (bit - 1));
+}
+
+lmap_entry* lhamt_find(lhamt* n, uint32_t hash, lval* key, int shift) {
+    while (!LHAMT_COLLIDES(shift)) {
+        uint32_t bit = lhamt_bit(hash, shift);
+        if (n->datamap & bit) {
+            lmap_entry* x = n->data[lhamt_index(n->datamap, bit)];
+            return x->hash == hash && lval_key_eq(x->key, key) ? x : NULL;
+        }
+        if (!(n->nodemap & bit)) return NULL;
+
+        n = n->nodes[lhamt_index(n->nodemap, bit)];
+        shift += LHAMT_BITS;
+    }
+
+    for (int i = 0; i < n->ndata; i++) {
+        if (lval_key_eq(n->data[i]->key, key)) return n->data[i];
+    }
+    return NULL;
+}
+
+// A copy of a node with one data slot at index replaced, inserted or
+// removed, and the same for one child slot. Everything else is shared.
+lhamt* lhamt_edit(lhamt* n, uint32_t datamap, uint32_t nodemap,
+    int data_at, lmap_entry* data, int data_op,
+    int node_at, lhamt* node, int node_op) {
+
+    lhamt* x = lhamt_new(datamap, nodemap, n->ndata + (data_op > 0) - (data_op < 0),
+        n->nnodes + (node_op > 0) - (node_op < 0));
+
+    for (int i = 0, j = 0; i <= n->ndata; i++) {
+        if (i == data_at && data_op >= 0 && data) x->data[j++] = data;
+        if (i == n->ndata) break;
+        if (i == data_at && data_op <= 0) continue;
+        x->data[j++] = n->data[i];
+        n->data[i]->refs++;
+    }
+    for (int i = 0, j = 0; i <= n->nnodes; i++) {
+        if (i == node_at && node_op >= 0 && node) x->nodes[j++] = node;
+        if (i == n->nnodes) break;
+        if (i == node_at && node_op <= 0) continue;
+        x->nodes[j++] = lhamt_retain(n->nodes[i]);
+    }
+    return x;
+}
+
+// A node holding two entries whose hashes agree below shift
+lhamt* lhamt_pair(lmap_entry* a, lmap_entry* b, int shift) {
+    if (LHAMT_COLLIDES(shift)) {
+        lhamt* n = lhamt_new(0, 0, 2, 0);
+        n->data[0] = a;
+        n->data[1] = b;
+        return n;
+    }
+
+    uint32_t abit = lhamt_bit(a->hash, shift);
+    uint32_t bbit = lhamt_bit(b->hash, shift);
+    if (abit == bbit) {
+        lhamt* n = lhamt_new(0, abit, 0, 1);
+        n->nodes[0] = lhamt_pair(a, b, shift + LHAMT_BITS);
+        return n;
+    }
+
+    lhamt* n = lhamt_new(abit | bbit, 0, 2, 0);
+    n->data[abit < bbit ? 0 : 1] = a;
+    n->data[abit < bbit ? 1 : 0] = b;
+    return n;
+}
+
+// A new trie with x set, taking over the reference to x. added is set
+// when the key was not there before.
+lhamt* lhamt_assoc(lhamt* n, lmap_entry* x, int shift, int* added) {
+    if (LHAMT_COLLIDES(shift)) {
+        for (int i = 0; i < n->ndata; i++) {
+            if (lval_key_eq(n->data[i]->key, x->key)) {
+                *added = 0;
+                return lhamt_edit(n, 0, 0, i, x, 0, -1, NULL, 0);
+            }
+        }
+        *added = 1;
+        return lhamt_edit(n, 0, 0, n->ndata, x, 1, -1, NULL, 0);
+    }
+
+    uint32_t bit = lhamt_bit(x->hash, shift);
+    int di = lhamt_index(n->datamap, bit);
+    int ni = lhamt_index(n->nodemap, bit);
+
+    if (n->datamap & bit) {
+        lmap_entry* old = n->data[di];
+        if (old->hash == x->hash && lval_key_eq(old->key, x->key)) {
+            *added = 0;
+            return lhamt_edit(n, n->datamap, n->nodemap, di, x, 0, -1, NULL, 0);
+        }
+
+        // Two keys in one slot move down into a child node together
+        *added = 1;
+        old->refs++;
+        lhamt* child = lhamt_pair(old, x, shift + LHAMT_BITS);
+        return lhamt_edit(n, n->datamap & ~bit, n->nodemap | bit, di, NULL, -1, ni, child, 1);
+    }
+
+    if (n->nodemap & bit) {
+        lhamt* child = lhamt_assoc(n->nodes[ni], x, shift + LHAMT_BITS, added);
+        return lhamt_edit(n, n->datamap, n->nodemap, -1, NULL, 0, ni, child, 0);
+    }
+
+    *added = 1;
+    return lhamt_edit(n, n->datamap | bit, n->nodemap, di, x, 1, -1, NULL, 0);
+}
+
+// A new trie without key, or n itself retained when key is not there
+lhamt* lhamt_dissoc(lhamt* n, uint32_t hash, lval* key, int shift) {
+    if (LHAMT_COLLIDES(shift)) {
+        for (int i = 0; i < n->ndata; i++) {
+            if (lval_key_eq(n->data[i]->key, key)) {
+                return lhamt_edit(n, 0, 0, i, NULL, -1, -1, NULL, 0);
+            }
+        }
+        return lhamt_retain(n);
+    }
+
+    uint32_t bit = lhamt_bit(hash, shift);
+    int di = lhamt_index(n->datamap, bit);
+    int ni = lhamt_index(n->nodemap, bit);
+
+    if (n->datamap & bit) {
+        lmap_entry* old = n->data[di];
+        if (old->hash != hash || !lval_key_eq(old->key, key)) return lhamt_retain(n);
+        return lhamt_edit(n, n->datamap & ~bit, n->nodemap, di, NULL, -1, -1, NULL, 0);
+    }
+
+    if (!(n->nodemap & bit)) return lhamt_retain(n);
+
+    lhamt* child = lhamt_dissoc(n->nodes[ni], hash, key, shift + LHAMT_BITS);
+    if (child == n->nodes[ni]) {
+        lhamt_release(child);
+        return lhamt_retain(n);
+    }
+
+    // A child left with a single entry is pulled back up into this node,
+    // so each trie has one shape for its set of keys
+    if (child->nnodes == 0 && child->ndata == 1) {
+        lmap_entry* x = child->data[0];
+        x->refs++;
+        lhamt_release(child);
+        return lhamt_edit(n, n->datamap | bit, n->nodemap & ~bit, di, x, 1, ni, NULL, -1);
+    }
+    return lhamt_edit(n, n->datamap, n->nodemap, -1, NULL, 0, ni, child, 0);
+}
+
+// Visit every entry of a trie in slot order
+void lhamt_each(lhamt* n, void (*f)(lmap_entry*, void*), void* ctx) {
+    for (int i = 0; i < n->ndata; i++) {
+        f(n->data[i], ctx);
+    }
+    for (int i = 0; i < n->nnodes; i++) {
+        lhamt_each(n->nodes[i], f, ctx);
+    }
+}
+
+// Construct a pointer to a new Map lval, which takes over root
+lval* lval_map(lhamt* root, long count) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_MAP;
+    v->map = root;
+    v->map_count = count;
+    return v;
+}
+
+lenv* lenv_new(void) {
+    lenv* e = malloc(sizeof(lenv));
+    e->parent = NULL;
+    e->count = 0;
+    e->syms = NULL;
+    e->vals = NULL;
+    return e;
+}
+
+lenv* lenv_copy(lenv* v) {
+    lenv* e = malloc(sizeof(lenv));
+
+    e->parent = v->parent;
+    e->count = v->count;
+    e->syms = malloc(sizeof(char*) * e->count);
+    for (int i = 0; i < e->count; i++) {
+        e->syms[i] = malloc(strlen(v->syms[i]) + 1);
+        strcpy(e->syms[i], v->syms[i]);
+    }
+
+    e->vals = malloc(sizeof(lval*) * e->count);
+    for (int i = 0; i < e->count; i++) {
+        e->vals[i] = lval_copy(v->vals[i]);
+    }
+
+    return e;
+}
+
+// Free memory from lval
+void lval_del(lval* v) {
+    switch (v->type) {
+        case LVAL_NUM: 
+        case LVAL_DBL:
+            break;
+        case LVAL_FUNC:
+            if (!v->builtin_func) {
+                lenv_del(v->env);
+                lval_del(v->formals);
+                lval_del(v->body);
+            }
+            break;
+        case LVAL_ERR:  
+            free(v->err); 
+            break;
+        case LVAL_SYM:  
+            free(v->sym); 
+            break;
+        case LVAL_VEC:
+            lvec_release(v->vec);
+            break;
+        case LVAL_SEQ:
+            lseq_del(v->seq);
+            break;
+        case LVAL_STR:
+            lrope_release(v->str);
+            break;
+        case LVAL_MAP:
+            lhamt_release(v->map);
+            break;
+        case LVAL_SEXPR:
+        case LVAL_QEXPR:
+            for (int i = 0; i < v-> count; i++) {
+                lval_del(v->cell[i]);
+            }
+            free(v->cell);
+        break;
+    }
+
+    free(v);
+}
+
+// Free memory from lenv
+void lenv_del(lenv* e) {
+    for (int i = 0; i < e->count; i++) {
+        free(e->syms[i]);
+        lval_del(e->vals[i]);
+    }
+
+    free(e->syms);
+    free(e->vals);
+    free(e);
+}
+
+lval* lenv_get(lenv* e, lval* k) {
+    for (int i = 0; i < e->count; i++) {
+        if (strcmp(e->syms[i], k->sym) == 0) {
+            return lval_copy(e->vals[i]);
+        }
+    }
+
+    // If no symbol found, check parent environment, otherwise return lval error
+    if (e->parent) {
+        return lenv_get(e->parent, k);
+    } else {
+        return lval_err("unbound symbol '%s'!", k->sym);
+    }
+
+}
+
+// Define local variable
+void lenv_put(lenv* e, lval* k, lval* v) {
+    for (int i = 0; i < e->count; i++) {
+        // If variable is found, delete item at that position
+        // Replace with a copy of user-supplied one.
+        if (strcmp(e->syms[i], k->sym) == 0) {
+            lval_del(e->vals[i]);
+            e->vals[i] = lval_copy(v);
+            return;
+        }
+    }
+
+    e->count++;
+    e->vals = realloc(e->vals, sizeof(lval*) * e->count);
+    e->syms = realloc(e->syms, sizeof(char*) * e->count);
+
+    e->vals[e->count - 1] = lval_copy(v);
+    e->syms[e->count - 1] = malloc(strlen(k->sym) + 1);
+    strcpy(e->syms[e->count - 1], k->sym);
+}
+
+// Define global variable
+void lenv_def(lenv* e, lval* symbol, lval* value) {
+    // Iterate to the environment which has no parent
+    while (e->parent) {
+        e = e->parent;
+    }
+
+    lenv_put(e, symbol, value);
+}
+
+// Construct a pointer to a new SExpression lval
+lval* lval_sexpr(void) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_SEXPR;
+    v->count = 0;
+    v->cell = NULL;
+    return v;
+}
+
+// Construct a pointer to a new Q-Expression lval
+lval* lval_qexpr(void) {
+    lval* v = malloc(sizeof(lval));
+    v->type = LVAL_QEXPR;
+    v->count = 0;
+    v->cell = NULL;
+    return v;
+}
+
+lval* lval_read_num(char* s) {
+    errno = 0;
+
+    // A fraction or exponent makes the literal a Double
+    if (strpbrk(s, ".eE")) {
+        double d = strtod(s, NULL);
+        return errno != ERANGE ? lval_dbl(d) : lval_err("invalid number");
+    }
+
+    long x = strtol(s, NULL, 10);
+    return errno != ERANGE ? lval_num(x) : lval_err("invalid number");
+}
+
+// Rule bits mpc gave the grammar's rules, looked up in main once mpca_lang
+// has defined them, so each node can be classified with a bit test
+enum { LRULE_NUMBER, LRULE_STRING, LRULE_SYMBOL, LRULE_SEXPR, LRULE_QEXPR, LRULE_COUNT };
+
+static unsigned long lrules[LRULE_COUNT];
+
+#define LRULE(r) (lrules[LRULE_##r])
+
+// Convert AST to an expression tree
+lval* lval_read(mpc_ast_t* abstract_syntax_tree) {
+    unsigned long rules = abstract_syntax_tree->rules;
+    if (rules & LRULE(NUMBER)) return lval_read_num(abstract_syntax_tree->contents); 
+    if (rules & LRULE(STRING)) {
+        char* s = abstract_syntax_tree->contents;
+        return lval_str(lrope_new(s, strlen(s)));
+    }
+    if (rules & LRULE(SYMBOL)) return lval_sym(abstract_syntax_tree->contents);
+
+    // The root ">" node belongs to no rule and reads as an sexpr
+    lval* x = (rules & LRULE(QEXPR)) ? lval_qexpr() : lval_sexpr();
+
+    for (int i = 0; i < abstract_syntax_tree->children_num; i++) {
+        // Bracket and anchor leaves belong to no rule, unlike a string "("
+        if (!abstract_syntax_tree->children[i]->rules) continue;
+        x = lval_add(x, lval_read(abstract_syntax_tree->children[i]));
+    }
+
+    return x;
+}
+
+// Direct reader
+//
+// Builds lvals straight from the input text, making the same choices the
+// mpc grammar in main makes: an expression is tried as a number, string,
+// symbol, sexpr then qexpr, and each token is followed by any whitespace.
+// Any input it cannot read is left to mpc, which reports the error.
+
+#define LREAD_MAX_DEPTH 10000
+
+typedef struct {
+    const char* s;
+    int depth;
+} lreader;
+
+int lread_is_symbol_char(char c) {
+    return c && (isalnum((unsigned char)c) || strchr("_+-*/\\=<>!&", c));
+}
+
+void lread_whitespace(lreader* r) {
+    while (*r->s && strchr(" \f\n\r\t\v", *r->s)) r->s++;
+}
+
+// Length of the number at s, or 0 if there is none, matching
+// /-?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?/
+long lread_number_len(const char* s) {
+    const char* p = s;
+    if (*p == '-') p++;
+    if (!isdigit((unsigned char)*p)) return 0;
+    while (isdigit((unsigned char)*p)) p++;
+
+    if (p[0] == '.' && isdigit((unsigned char)p[1])) {
+        p++;
+        while (isdigit((unsigned char)*p)) p++;
+    }
+
+    if (*p == 'e' || *p == 'E') {
+        const char* q = p + 1;
+        if (*q == '-' || *q == '+') q++;
+        if (isdigit((unsigned char)*q)) {
+            while (isdigit((unsigned char)*q)) q++;
+            p = q;
+        }
+    }
+
+    return p - s;
+}
+
+lval* lread_exprs(lreader* r, lval* x, char close);
+
+lval* lread_expr(lreader* r) {
+    const char* start = r->s;
+    lval* x = NULL;
+
+    long n = lread_number_len(start);
+    if (n) {
+        char* text = malloc(n + 1);
+        memcpy(text, start, n);
+        text[n] = '\0';
+        x = lval_read_num(text);
+        free(text);
+        r->s += n;
+    } else if (*start == '"') {
+        // Same escapes as mpc_string_lit, unescaped the same way
+        const char* p = start + 1;
+        while (*p && *p != '"') {
+            p += (p[0] == '\\' && p[1]) ? 2 : 1;
+        }
+        if (*p != '"') return NULL;
+
+        char* body = malloc(p - start);
+        memcpy(body, start + 1, p - start - 1);
+        body[p - start - 1] = '\0';
+        body = mpcf_unescape(body);
+        x = lval_str(lrope_new(body, strlen(body)));
+        free(body);
+        r->s = p + 1;
+    } else if (lread_is_symbol_char(*start)) {
+        const char* p = start;
+        while (lread_is_symbol_char(*p)) p++;
+
+        char* name = malloc(p - start + 1);
+        memcpy(name, start, p - start);
+        name[p - start] = '\0';
+        x = lval_sym(name);
+        free(name);
+        r->s = p;
+    } else if (*start == '(' || *start == '{') {
+        if (++r->depth > LREAD_MAX_DEPTH) return NULL;
+        r->s++;
+        lread_whitespace(r);
+        x = *start == '(' ? lread_exprs(r, lval_sexpr(), ')') : lread_exprs(r, lval_qexpr(), '}');
+        r->depth--;
+        if (!x) return NULL;
+        r->s++;
+    } else {
+        return NULL;
+    }
+
+    lread_whitespace(r);
+    return x;
+}
+
+// Read expressions into x up to the close character, which is left
+// unread. Deletes x and returns NULL on any error. The cells grow by
+// doubling rather than one lval_add realloc per element.
+lval* lread_exprs(lreader* r, lval* x, char close) {
+    int capacity = 0;
+    while (*r->s != close) {
+        lval* y = lread_expr(r);
+        if (!y) {
+            lval_del(x);
+            return NULL;
+        }
+
+        if (x->count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            x->cell = realloc(x->cell, sizeof(lval*) * capacity);
+        }
+        x->cell[x->count++] = y;
+    }
+
+    return x;
+}
+
+// Read a whole line of input as an S-Expression, or NULL if it is not
+// valid Keii
+lval* lval_read_input(const char* input) {
+    lreader r = { input, 0 };
+    lread_whitespace(&r);
+    return lread_exprs(&r, lval_sexpr(), '\0');
+}
+
+// File loader
+//
+// Reads a file one top-level expression at a time through a buffer that
+// only holds the expression being read. Read bytes are dropped from the
+// front before more are appended, so memory stays bounded by the largest
+// single expression rather than the whole file.
+
+#define LLOAD_CHUNK 65536
+
+typedef struct {
+    FILE* f;
+    char* buf;
+    long pos;
+    long len;
+    long cap;
+    long line;
+    long nul;
+    int eof;
+} lloader;
+
+lloader* lloader_new(FILE* f) {
+    lloader* l = malloc(sizeof(lloader));
+    l->f = f;
+    l->cap = LLOAD_CHUNK + 1;
+    l->buf = malloc(l->cap);
+    l->buf[0] = '\0';
+    l->pos = 0;
+    l->len = 0;
+    l->line = 1;
+    l->nul = -1;
+    l->eof = 0;
+    return l;
+}
+
+void lloader_del(lloader* l) {
+    free(l->buf);
+    free(l);
+}
+
+// Drop the read bytes and append at least a chunk more. The read size
+// grows with the unread part, so an expression larger than a chunk is
+// scanned a logarithmic number of times rather than once per chunk.
+void lloader_fill(lloader* l) {
+    l->len -= l->pos;
+    memmove(l->buf, l->buf + l->pos, l->len);
+    l->pos = 0;
+
+    long want = l->len > LLOAD_CHUNK ? l->len : LLOAD_CHUNK;
+    if (l->len + want + 1 > l->cap) {
+        l->cap = l->len + want + 1;
+        l->buf = realloc(l->buf, l->cap);
+    }
+
+    size_t n = fread(l->buf + l->len, 1, want, l->f);
+    if (n == 0) l->eof = 1;
+
+    // The reader stops at a NUL byte as if the buffer ended there
+    char* z = memchr(l->buf + l->len, '\0', n);
+    if (z) l->nul = z - l->buf;
+    l->len += n;
+    l->buf[l->len] = '\0';
+}
+
+// Mark the bytes up to end as read, counting lines for error messages
+void lloader_advance(lloader* l, const char* end) {
+    const char* p = l->buf + l->pos;
+    while ((p = memchr(p, '\n', end - p))) {
+        l->line++;
+        p++;
+    }
+    l->pos = end - l->buf;
+}
+
+// An Error at the first NUL byte in the buffer, which the reader cannot
+// read past
+lval* lloader_nul(lloader* l, char* filename) {
+    lloader_advance(l, l->buf + l->nul);
+    return lval_err("%s:%ld: unexpected NUL byte", filename, l->line);
+}
+
+// The next top-level expression, NULL at the end of the file, or an
+// Error if the rest of the file is not valid Keii.
+lval* lloader_next(lloader* l, char* filename) {
+    while (1) {
+        lreader r = { l->buf + l->pos, 0 };
+        lread_whitespace(&r);
+        lloader_advance(l, r.s);
+
+        if (*r.s == '\0') {
+            if (l->nul >= 0) return lloader_nul(l, filename);
+            if (l->eof) return NULL;
+            lloader_fill(l);
+            continue;
+        }
+
+        lval* x = lread_expr(&r);
+
+        // An expression that reaches the end of the buffer may continue
+        // past it, as may one that failed on an unclosed list or string.
+        // If the buffer ends at a NUL byte, no more of the file can help.
+        if (*r.s == '\0' || (!x && *r.s == '"')) {
+            if (l->nul >= 0) {
+                if (x) lval_del(x);
+                return lloader_nul(l, filename);
+            }
+            if (!l->eof) {
+                if (x) lval_del(x);
+                lloader_fill(l);
+                continue;
+            }
+        }
+
+        // Report the line the form started on, not where the reader gave up
+        if (!x) {
+            long line = l->line;
+            lloader_advance(l, r.s);
+            return lval_err("%s:%ld: could not read expression", filename, line);
+        }
+
+        lloader_advance(l, r.s);
+        return x;
+    }
+}
+
+// Insert Lisp value x to Lisp value v
+lval* lval_add(lval* v, lval* x) {
+    v->count++;
+    v->cell = realloc(v->cell, sizeof(lval*) * v->count);
+    v->cell[v->count-1] = x;
+    return v;
+}
+
+lval* lval_call(lenv* env, lval* f, lval* a) {
+    if (f->builtin_func) {
+        return f->builtin_func(env, a);
+    }
+
+    // Record Argument Counts
+    int given = a->count;
+    int total = f->formals->count;
+
+    // While arguments still remain to be processed
+    while (a->count) {
+        // if re're ran out of formal arguments to bind
+        if (f->formals->count == 0) {
+            lval_del(a);
+            return lval_err(
+                "Function passed too many parguments. "
+                "Got %i, Expected %i.", given, total);
+        }
+
+        // Pop the first symbol from the formals
+        lval* sym = lval_pop(f->formals, 0);
+
+        // Pop the next argument from the list
+        lval* val = lval_pop(a, 0);
+
+        // Bind a copy into the function's environment
+        lenv_put(f->env, sym, val);
+
+        lval_del(sym);
+        lval_del(val);
+    }
+
+    // Argument list is now bound so can be cleaned up
+    lval_del(a);
+
+    // If all formals have been bound evaluate
+    if (f->formals->count == 0) {
+        // Set environment parent to evaluation environment
+        f->env->parent = env;
+
+        // Evaluate and return
+        return builtin_eval(
+            f->env, lval_add(lval_sexpr(), lval_copy(f->body))
+        );
+    }
+    else {
+        // Otherwise return partially evaluated function
+        return lval_copy(f);
+    }
+}
+
+void lval_expr_print(lval* v, char open, char close) {
+    putchar(open);
+    for (int i = 0; i < v->count; i++) {
+        lval_print(v->cell[i]);
+
+        if (i != (v->count - 1)) {
+            putchar(' ');
+        }
+    }
+
+    putchar(close);
+}
+
+// Print a double with the fewest significant digits that read back as
+// the same value, keeping a '.0' on whole values so they stay Doubles
+void lval_dbl_print(double x) {
+    char buf[32];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(buf, sizeof(buf), "%.*g", precision, x);
+        if (strtod(buf, NULL) == x) break;
+    }
+
+    if (!strpbrk(buf, ".eE")) strcat(buf, ".0");
+    fputs(buf, stdout);
+}
+
+// Doubles that overflow to inf or nan have no form the reader accepts,
+// so arithmetic turns them into an error rather than return them
+lval* lval_dbl_finite(lval* x) {
+    if (isfinite(x->dbl)) return x;
+    lval_del(x);
+    return lval_err("Double overflow!");
+}
+
+void lval_vec_print(lval* v) {
+    putchar('[');
+    for (long i = 0; i < v->vec_count; i++) {
+        if (v->vec->type == LVEC_DBL) {
+            lval_dbl_print(v->vec->dbls[v->vec_start + i]);
+        } else {
+            printf("%lli", (long long)v->vec->ints[v->vec_start + i]);
+        }
+
+        if (i != (v->vec_count - 1)) {
+            putchar(' ');
+        }
+    }
+
+    putchar(']');
+}
+
+void lval_str_print(lval* v) {
+    // mpcf_escape frees the string it is given
+    char* escaped = mpcf_escape(lrope_flatten(v->str));
+    printf("\"%s\"", escaped);
+    free(escaped);
+}
+
+void lval_map_print_entry(lmap_entry* x, void* first) {
+    if (!*(int*)first) putchar(' ');
+    *(int*)first = 0;
+    lval_print(x->key);
+    putchar(' ');
+    lval_print(x->val);
+}
+
+void lval_map_print(lval* v) {
+    int first = 1;
+    printf("#{");
+    lhamt_each(v->map, lval_map_print_entry, &first);
+    putchar('}');
+}
+
+void lval_print(lval* v)
+{
+    switch (v->type)
+    {
+        case LVAL_NUM:
+            printf("%li", v->num);
+            break;
+        case LVAL_DBL:
+            lval_dbl_print(v->dbl);
+            break;
+        case LVAL_ERR:
+            printf("Error: %s", v->err); 
+            break;
+        case LVAL_SYM:
+            printf("%s", v->sym);
+            break;
+        case LVAL_SEXPR:
+            lval_expr_print(v, '(', ')');
+            break;
+        case LVAL_QEXPR:
+            lval_expr_print(v, '{', '}');
+            break;
+        case LVAL_VEC:
+            lval_vec_print(v);
+            break;
+        case LVAL_SEQ:
+            printf("<sequence>");
+            break;
+        case LVAL_STR:
+            lval_str_print(v);
+            break;
+        case LVAL_MAP:
+            lval_map_print(v);
+            break;
+        case LVAL_FUNC:
+            if (v->builtin_func) {
+                printf("<builtin>");
+            } else {
+                printf("(\\ "); lval_print(v->formals);
+                putchar(' '); lval_print(v->body); putchar(')');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void lval_println(lval* v)
+{
+    lval_print(v);
+    putchar('\n');
+}
+
+// Evaluate Lisp values tree
+lval* lval_eval(lenv* env, lval* v) {
+    if (v->type == LVAL_SYM) {
+        lval* x = lenv_get(env, v);
+        lval_del(v);
+        return x;
+    }
+
+    if (v->type == LVAL_SEXPR) {
+        return lval_eval_sexpr(env, v);
+    }
+
+    return v;
+}
+
+// Get child lval at specified index from passed in lval
+lval* lval_pop(lval* v, int index) {
+    lval* x = v->cell[index];
+    memmove(&v->cell[index], &v->cell[index+1], sizeof(lval*) * (v->count - index - 1));
+
+    v->count--;
+    v->cell = realloc(v->cell, sizeof(lval*) * v->count);
+
+    return x;
+}
+
+// Get child lval at specified index and free delete parent lval
+lval* lval_take(lval* v, int index) {
+    lval* x = lval_pop(v, index);
+    lval_del(v);
+    return x;
+}
+
+lval* builtin_operation(lenv* environment, lval* a, char* operation) {
+    int dbl = 0;
+    for (int i = 0; i < a->count; i++) {
+        if (a->cell[i]->type == LVAL_VEC) {
+            return builtin_vec_operation(environment, a, operation);
+        }
+        if (a->cell[i]->type == LVAL_DBL) dbl = 1;
+    }
+
+    for (int i = 0; i < a->count; i++) {
+        LASSERT(a, a->cell[i]->type == LVAL_NUM || a->cell[i]->type == LVAL_DBL,
+            "Function '%s' passed incorrect type for argument %i. "
+            "Got %s, Expected %s or %s.",
+            operation, i, ltype_name(a->cell[i]->type),
+            ltype_name(LVAL_NUM), ltype_name(LVAL_DBL));
+    }
+
+    // A single Double argument makes the whole operation Double
+    if (dbl) {
+        for (int i = 0; i < a->count; i++) {
+            if (a->cell[i]->type == LVAL_NUM) {
+                a->cell[i]->type = LVAL_DBL;
+                a->cell[i]->dbl = a->cell[i]->num;
+            }
+        }
+    }
+
+    // Pop the first element
+    lval* x = lval_pop(a, 0);
+
+    // If no arguments and sub then perform unary operation
+    if ((strcmp(operation, "-") ==0) && a->count == 0) {
+        if (dbl) {
+            x->dbl = -x->dbl;
+        } else {
+            x-> num = -x->num;
+        }
+    }
+
+    while (a->count > 0) {
+        lval* y = lval_pop(a, 0);
+
+        if (dbl) {
+            if (strcmp(operation, "/") == 0 && y->dbl == 0) {
+                lval_del(x);
+                lval_del(y);
+                x = lval_err("Division by Zero!");
+                break;
+            }
+
+            if (strcmp(operation, "+") == 0) x->dbl += y->dbl;
+            if (strcmp(operation, "-") == 0) x->dbl -= y->dbl;
+            if (strcmp(operation, "*") == 0) x->dbl *= y->dbl;
+            if (strcmp(operation, "/") == 0) x->dbl /= y->dbl;
+
+            lval_del(y);
+            continue;
+        }
+
+        if (strcmp(operation, "+") == 0) x->num += y->num;
+        if (strcmp(operation, "-") == 0) x->num -= y->num;
+        if (strcmp(operation, "*") == 0) x->num *= y->num;
+        if (strcmp(operation, "/") == 0) {
+            if (y->num == 0 || (y->num == -1 && x->num == LONG_MIN)) {
+                int zero = y->num == 0;
+                lval_del(x);
+                lval_del(y);
+                x = lval_err(zero ? "Division by Zero!" : "Division overflow!");
+                break;
+            }
+            x->num /= y->num;
+        }
+
+        lval_del(y);
+    }
+
+    lval_del(a);
+    return x->type == LVAL_DBL ? lval_dbl_finite(x) : x;
+}
+
+lval* lval_eval_sexpr(lenv* environment, lval* v) {
+    for (int i = 0; i < v->count; i++) {
+        v->cell[i] = lval_eval(environment, v->cell[i]); 
+    }
+
+    for (int i = 0; i < v->count; i++) {
+        if (v->cell[i]->type == LVAL_ERR) {
+            return lval_take(v, i);
+        }
+    }
+
+    if (v->count == 0) return v;
+    
+    if (v->count == 1) return lval_take(v, 0);
+
+    // Ensure first element is a function after evaluation
+    lval* lval_func = lval_pop(v, 0);
+    if (lval_func->type != LVAL_FUNC) {
+        lval* err = lval_err(
+            "S-Expression starts with incorrect type. "
+            "Got %s, Expected %s.",
+            ltype_name(lval_func->type), ltype_name(LVAL_FUNC)
+        );
+        lval_del(lval_func);
+        lval_del(v);
+        return err;
+    }
+
+    lval* result = lval_call(environment, lval_func, v);
+    lval_del(lval_func);
+    return result;
+}
+
+#define LASSERT_LIST(func, args, index) \
+    LASSERT(args, args->cell[index]->type == LVAL_QEXPR || args->cell[index]->type == LVAL_SEQ, \
+        "Function '%s' passed incorrect type for argument %i. " \
+        "Got %s, Expected %s or %s.", \
+        func, index, ltype_name(args->cell[index]->type), \
+        ltype_name(LVAL_QEXPR), ltype_name(LVAL_SEQ))
+
+lval* builtin_head(lenv* e, lval* a) {
+    LASSERT_NUM("head", a, 1);
+    LASSERT_LIST("head", a, 0);
+
+    // The head of a sequence is its next element, in a list like for {}
+    if (a->cell[0]->type == LVAL_SEQ) {
+        lval* x = lseq_next(e, a->cell[0]->seq);
+        LASSERT(a, x != NULL, "Function 'head' passed {} for argument 0");
+        lval_del(a);
+        return x->type == LVAL_ERR ? x : lval_add(lval_qexpr(), x);
+    }
+
+    LASSERT_NOT_EMPTY("head", a, 0);
+
+    // Take the first argument
+    lval* v = lval_take(a, 0);
+
+    // Delete all elemenents that are not head and return
+    while (v->count > 1) {
+        lval_del(lval_pop(v, 1));
+    }
+    return v;
+}
+
+lval* builtin_tail(lenv* e, lval* a) {
+    LASSERT_NUM("tail", a, 1);
+    LASSERT_LIST("tail", a, 0);
+
+    // The tail of a sequence is the same sequence advanced by one
+    if (a->cell[0]->type == LVAL_SEQ) {
+        lval* x = lseq_next(e, a->cell[0]->seq);
+        LASSERT(a, x != NULL, "Function 'tail' passed {} for argument 0");
+        if (x->type == LVAL_ERR) {
+            lval_del(a);
+            return x;
+        }
+        lval_del(x);
+        return lval_take(a, 0);
+    }
+
+    LASSERT_NOT_EMPTY("tail", a, 0);
+
+    // Take first argument and only argument from a as a contains only one qexpr
+    lval* v = lval_take(a, 0);
+
+    // Delete first element and return
+    lval_del(lval_pop(v, 0));
+    return v;
+}
+
+lval* builtin_list(lenv* e, lval* a) {
+    a->type = LVAL_QEXPR;
+    return a;
+}
+
+lval* builtin_eval(lenv* e, lval* a) {
+    LASSERT_NUM("eval", a, 1);
+    LASSERT_TYPE("eval", a, 0, LVAL_QEXPR);
+
+    lval* v = lval_take(a, 0);
+    v->type = LVAL_SEXPR;
+    return lval_eval(e, v);
+}
+
+// Evaluate each expression of a file in turn, printing any errors. Only
+// an unreadable file or expression stops the load.
+lval* builtin_load(lenv* e, lval* a) {
+    LASSERT_NUM("load", a, 1);
+    LASSERT_TYPE("load", a, 0, LVAL_STR);
+
+    char* filename = lrope_flatten(a->cell[0]->str);
+    lval_del(a);
+
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        lval* err = lval_err("Could not load file '%s'", filename);
+        free(filename);
+        return err;
+    }
+
+    lloader* l = lloader_new(f);
+    lval* x;
+    while ((x = lloader_next(l, filename))) {
+        if (x->type == LVAL_ERR) break;
+
+        x = lval_eval(e, x);
+        if (x->type == LVAL_ERR) lval_println(x);
+        lval_del(x);
+        x = NULL;
+    }
+
+    lloader_del(l);
+    fclose(f);
+    free(filename);
+    return x ? x : lval_sexpr();
+}
+
+lval* builtin_lambda(lenv* e, lval* a) {
+    LASSERT_NUM("\\", a, 2);
+    LASSERT_TYPE("\\", a, 0, LVAL_QEXPR);
+    LASSERT_TYPE("\\", a, 1, LVAL_QEXPR);
+
+    for (int i = 0; i < a->cell[0]->count; i++) {
+        LASSERT(a, (a->cell[0]->cell[i]->type == LVAL_SYM),
+            "Cannot define non-symbol. Got %s, Expected %s",
+            ltype_name(a->cell[0]->cell[i]->type), ltype_name(LVAL_SYM));
+    }
+
+    lval* formals = lval_pop(a, 0);
+    lval* body = lval_pop(a, 0);
+    lval_del(a);
+
+    return lval_lambda(formals, body);
+}
+
+// Move the cells of y onto the end of x, which must already have room
+// for them, and delete the emptied y
+lval* lval_join(lval* x, lval* y) {
+    if (y->count) {
+        memcpy(&x->cell[x->count], y->cell, sizeof(lval*) * y->count);
+        x->count += y->count;
+    }
+
+    free(y->cell);
+    free(y);
+    return x;
+}
+
+// join {1 2 3} {4 5 6} {7 8}
+// {1 2 3 4 5 6 7 8}
+lval* builtin_join(lenv* e, lval* a) {
+    for (int i = 0; i < a->count; i++) {
+        LASSERT_TYPE("join", a, i, LVAL_QEXPR);
+    }
+
+    // Size the result once so every argument is a single memcpy
+    int total = 0;
+    for (int i = 0; i < a->count; i++) {
+        total += a->cell[i]->count;
+    }
+
+    lval* x = lval_pop(a, 0);
+    if (total > x->count) {
+        x->cell = realloc(x->cell, sizeof(lval*) * total);
+    }
+
+    for (int i = 0; i < a->count; i++) {
+        x = lval_join(x, a->cell[i]);
+    }
+
+    a->count = 0;
+    lval_del(a);
+    return x;
+}
+
+// Call f with args, leaving f itself untouched. lval_call binds
+// arguments into a lambda's formals, so lambdas are called on a copy.
+lval* lval_apply(lenv* e, lval* f, lval* args) {
+    if (f->builtin_func) {
+        return lval_call(e, f, args);
+    }
+
+    lval* g = lval_copy(f);
+    lval* result = lval_call(e, g, args);
+    lval_del(g);
+    return result;
+}
+
+// Delete the cells of v from index onwards along with v itself
+void lval_del_from(lval* v, int index) {
+    for (int i = index; i < v->count; i++) {
+        lval_del(v->cell[i]);
+    }
+
+    free(v->cell);
+    free(v);
+}
+
+// Sequences
+
+// Produce the next element of a sequence, advancing it. Returns NULL once
+// the sequence is exhausted, or an Error raised computing the element.
+lval* lseq_next(lenv* e, lseq* s) {
+    switch (s->type) {
+        case LSEQ_RANGE: {
+            if (s->step > 0 ? s->next >= s->end : s->next <= s->end) return NULL;
+            lval* x = lval_num(s->next);
+
+            // The distance left is measured unsigned, so a step that would
+            // pass the end lands on it instead of overflowing near LONG_MAX
+            unsigned long left = s->step > 0
+                ? (unsigned long)s->end - (unsigned long)s->next
+                : (unsigned long)s->next - (unsigned long)s->end;
+            unsigned long stride = s->step > 0
+                ? (unsigned long)s->step
+                : 0UL - (unsigned long)s->step;
+            s->next = left > stride ? s->next + s->step : s->end;
+            return x;
+        }
+
+        case LSEQ_STREAM:
+            // Each element is f applied to the one before, starting at the seed
+            if (s->started && s->value->type != LVAL_ERR) {
+                s->value = lval_apply(e, s->func, lval_add(lval_sexpr(), s->value));
+            }
+            s->started = 1;
+            return lval_copy(s->value);
+
+        case LSEQ_MAP: {
+            lval* x = lseq_next(e, s->src);
+            if (!x || x->type == LVAL_ERR) return x;
+            return lval_apply(e, s->func, lval_add(lval_sexpr(), x));
+        }
+
+        case LSEQ_FILTER:
+            while (1) {
+                lval* x = lseq_next(e, s->src);
+                if (!x || x->type == LVAL_ERR) return x;
+
+                lval* keep = lval_apply(e, s->func, lval_add(lval_sexpr(), lval_copy(x)));
+                if (keep->type != LVAL_NUM) {
+                    lval* err = keep->type == LVAL_ERR ? keep : lval_err(
+                        "Function 'filter' predicate returned incorrect type. "
+                        "Got %s, Expected %s.",
+                        ltype_name(keep->type), ltype_name(LVAL_NUM));
+                    if (err != keep) lval_del(keep);
+                    lval_del(x);
+                    return err;
+                }
+
+                long k = keep->num;
+                lval_del(keep);
+                if (k) return x;
+                lval_del(x);
+            }
+    }
+
+    return NULL;
+}
+
+// range 0 5
+// <sequence> of 0 1 2 3 4
+// range 10 0 -3
+// <sequence> of 10 7 4 1
+lval* builtin_range(lenv* e, lval* a) {
+    LASSERT(a, a->count == 2 || a->count == 3,
+        "Function 'range' passed incorrect number of arguments. "
+        "Got %i, Expected 2 or 3.", a->count);
+    for (int i = 0; i < a->count; i++) {
+        LASSERT_TYPE("range", a, i, LVAL_NUM);
+    }
+    LASSERT(a, a->count == 2 || a->cell[2]->num != 0,
+        "Function 'range' passed 0 for step");
+
+    lseq* s = lseq_new(LSEQ_RANGE);
+    s->next = a->cell[0]->num;
+    s->end = a->cell[1]->num;
+    s->step = a->count == 3 ? a->cell[2]->num : 1;
+    lval_del(a);
+    return lval_seq(s);
+}
+
+// stream (\ {x} {* x 2}) 1
+// <sequence> of 1 2 4 8 ...
+lval* builtin_stream(lenv* e, lval* a) {
+    LASSERT_NUM("stream", a, 2);
+    LASSERT_TYPE("stream", a, 0, LVAL_FUNC);
+
+    lseq* s = lseq_new(LSEQ_STREAM);
+    s->func = lval_pop(a, 0);
+    s->value = lval_take(a, 0);
+    return lval_seq(s);
+}
+
+// take 3 (range 0 100)
+// {0 1 2}
+lval* builtin_take(lenv* e, lval* a) {
+    LASSERT_NUM("take", a, 2);
+    LASSERT_TYPE("take", a, 0, LVAL_NUM);
+    LASSERT_LIST("take", a, 1);
+    LASSERT(a, a->cell[0]->num >= 0,
+        "Function 'take' passed negative count %li", a->cell[0]->num);
+
+    long n = a->cell[0]->num;
+    lval* xs = a->cell[1];
+    if (xs->type == LVAL_QEXPR) {
+        xs = lval_take(a, 1);
+        while (xs->count > n) {
+            lval_del(xs->cell[--xs->count]);
+        }
+        return xs;
+    }
+
+    lval* q = lval_qexpr();
+    for (long i = 0; i < n; i++) {
+        lval* x = lseq_next(e, xs->seq);
+        if (!x) break;
+        if (x->type == LVAL_ERR) {
+            lval_del(q);
+            lval_del(a);
+            return x;
+        }
+        lval_add(q, x);
+    }
+
+    lval_del(a);
+    return q;
+}
+
+// Wrap a sequence argument in a lazy Map or Filter of it
+lval* lval_seq_wrap(enum LSEQ_TYPE type, lval* f, lval* src) {
+    lseq* s = lseq_new(type);
+    s->func = f;
+    s->src = src->seq;
+    free(src);
+    return lval_seq(s);
+}
+
+// The list argument is owned by the builtin, so map and filter write their
+// results back into its cell array instead of building a new list. A chain
+// like (map f (filter g xs)) therefore reuses one array all the way through.
+// Over a sequence they return a new lazy sequence instead.
+
+// map (\ {x} {* x 2}) {1 2 3}
+// {2 4 6}
+lval* builtin_map(lenv* e, lval* a) {
+    LASSERT_NUM("map", a, 2);
+    LASSERT_TYPE("map", a, 0, LVAL_FUNC);
+    LASSERT_LIST("map", a, 1);
+
+    lval* f = lval_pop(a, 0);
+    lval* q = lval_take(a, 0);
+    if (q->type == LVAL_SEQ) {
+        return lval_seq_wrap(LSEQ_MAP, f, q);
+    }
+
+    for (int i = 0; i < q->count; i++) {
+        lval* x = lval_apply(e, f, lval_add(lval_sexpr(), q->cell[i]));
+        if (x->type == LVAL_ERR) {
+            for (int j = 0; j < i; j++) {
+                lval_del(q->cell[j]);
+            }
+            lval_del_from(q, i + 1);
+            lval_del(f);
+            return x;
+        }
+        q->cell[i] = x;
+    }
+
+    lval_del(f);
+    return q;
+}
+
+// filter (\ {x} {- x 2}) {1 2 3}
+// {1 3}
+lval* builtin_filter(lenv* e, lval* a) {
+    LASSERT_NUM("filter", a, 2);
+    LASSERT_TYPE("filter", a, 0, LVAL_FUNC);
+    LASSERT_LIST("filter", a, 1);
+
+    lval* f = lval_pop(a, 0);
+    lval* q = lval_take(a, 0);
+    if (q->type == LVAL_SEQ) {
+        return lval_seq_wrap(LSEQ_FILTER, f, q);
+    }
+
+    // Kept elements are compacted to the front as we go
+    int kept = 0;
+    for (int i = 0; i < q->count; i++) {
+        lval* x = lval_apply(e, f, lval_add(lval_sexpr(), lval_copy(q->cell[i])));
+        if (x->type != LVAL_NUM && x->type != LVAL_ERR) {
+            lval* err = lval_err(
+                "Function 'filter' predicate returned incorrect type. "
+                "Got %s, Expected %s.",
+                ltype_name(x->type), ltype_name(LVAL_NUM));
+            lval_del(x);
+            x = err;
+        }
+        if (x->type == LVAL_ERR) {
+            for (int j = 0; j < kept; j++) {
+                lval_del(q->cell[j]);
+            }
+            lval_del_from(q, i);
+            lval_del(f);
+            return x;
+        }
+
+        if (x->num) {
+            q->cell[kept++] = q->cell[i];
+        } else {
+            lval_del(q->cell[i]);
+        }
+        lval_del(x);
+    }
+
+    q->count = kept;
+    lval_del(f);
+    return q;
+}
+
+lval* builtin_fold(lenv* e, lval* a, char* func) {
+    int right = strcmp(func, "foldr") == 0;
+    LASSERT_NUM(func, a, 3);
+    LASSERT_TYPE(func, a, 0, LVAL_FUNC);
+
+    // foldr needs the last element first, so it cannot consume a sequence
+    if (right) {
+        LASSERT_TYPE(func, a, 2, LVAL_QEXPR);
+    } else {
+        LASSERT_LIST(func, a, 2);
+    }
+
+    lval* f = lval_pop(a, 0);
+    lval* acc = lval_pop(a, 0);
+    lval* q = lval_take(a, 0);
+
+    if (q->type == LVAL_SEQ) {
+        lval* x;
+        while (acc->type != LVAL_ERR && (x = lseq_next(e, q->seq))) {
+            if (x->type == LVAL_ERR) {
+                lval_del(acc);
+                acc = x;
+                break;
+            }
+            acc = lval_apply(e, f, lval_add(lval_add(lval_sexpr(), acc), x));
+        }
+
+        lval_del(q);
+        lval_del(f);
+        return acc;
+    }
+
+    // Elements are handed to f one at a time from the folding end
+    int n = q->count;
+    for (int k = 0; k < n; k++) {
+        int i = right ? n - 1 - k : k;
+        lval* args = right
+            ? lval_add(lval_add(lval_sexpr(), q->cell[i]), acc)
+            : lval_add(lval_add(lval_sexpr(), acc), q->cell[i]);
+
+        acc = lval_apply(e, f, args);
+        if (acc->type == LVAL_ERR) {
+            // Delete the elements f has not been given
+            if (right) {
+                q->count = i;
+                lval_del_from(q, 0);
+            } else {
+                lval_del_from(q, i + 1);
+            }
+            lval_del(f);
+            return acc;
+        }
+    }
+
+    q->count = 0;
+    lval_del_from(q, 0);
+    lval_del(f);
+    return acc;
+}
+
+// foldl (\ {acc x} {- acc x}) 0 {1 2 3}
+// -6
+lval* builtin_foldl(lenv* e, lval* a) {
+    return builtin_fold(e, a, "foldl");
+}
+
+// foldr (\ {x acc} {- x acc}) 0 {1 2 3}
+// 2
+lval* builtin_foldr(lenv* e, lval* a) {
+    return builtin_fold(e, a, "foldr");
+}
+
+lval* builtin_len(lenv* e, lval* a) {
+    LASSERT_NUM("len", a, 1);
+
+    if (a->cell[0]->type == LVAL_STR) {
+        lval* x = lval_num(a->cell[0]->str->len);
+        lval_del(a);
+        return x;
+    }
+
+    LASSERT_LIST("len", a, 0);
+
+    // A sequence is counted by running it
+    if (a->cell[0]->type == LVAL_SEQ) {
+        long n = 0;
+        lval* x;
+        while ((x = lseq_next(e, a->cell[0]->seq))) {
+            if (x->type == LVAL_ERR) {
+                lval_del(a);
+                return x;
+            }
+            lval_del(x);
+            n++;
+        }
+        lval_del(a);
+        return lval_num(n);
+    }
+
+    lval* x = lval_num(a->cell[0]->count);
+    lval_del(a);
+    return x;
+}
+
+// Strings
+
+// concat "foo" "bar" "baz"
+// "foobarbaz"
+lval* builtin_concat(lenv* e, lval* a) {
+    for (int i = 0; i < a->count; i++) {
+        LASSERT_TYPE("concat", a, i, LVAL_STR);
+    }
+
+    lrope* r = lrope_new("", 0);
+    for (int i = 0; i < a->count; i++) {
+        r = lrope_concat(r, lrope_retain(a->cell[i]->str));
+    }
+
+    lval_del(a);
+    return lval_str(r);
+}
+
+// substring "hello world" 6 11
+// "world"
+lval* builtin_substring(lenv* e, lval* a) {
+    LASSERT_NUM("substring", a, 3);
+    LASSERT_TYPE("substring", a, 0, LVAL_STR);
+    LASSERT_TYPE("substring", a, 1, LVAL_NUM);
+    LASSERT_TYPE("substring", a, 2, LVAL_NUM);
+
+    lrope* r = a->cell[0]->str;
+    long start = a->cell[1]->num;
+    long end = a->cell[2]->num;
+    LASSERT(a, start >= 0 && start <= end && end <= r->len,
+        "Function 'substring' range %li to %li out of range. Length %li.",
+        start, end, r->len);
+
+    lval* x = lval_str(lrope_sub(r, start, end));
+    lval_del(a);
+    return x;
+}
+
+// split "a,b,,c" ","
+// {"a" "b" "" "c"}
+// split "hello" 2
+// {"he" "llo"}
+lval* builtin_split(lenv* e, lval* a) {
+    LASSERT_NUM("split", a, 2);
+    LASSERT_TYPE("split", a, 0, LVAL_STR);
+    LASSERT(a, a->cell[1]->type == LVAL_STR || a->cell[1]->type == LVAL_NUM,
+        "Function 'split' passed incorrect type for argument 1. "
+        "Got %s, Expected %s or %s.",
+        ltype_name(a->cell[1]->type), ltype_name(LVAL_STR), ltype_name(LVAL_NUM));
+
+    lrope* r = a->cell[0]->str;
+
+    // Splitting at a position only walks one path down the rope
+    if (a->cell[1]->type == LVAL_NUM) {
+        long at = a->cell[1]->num;
+        LASSERT(a, at >= 0 && at <= r->len,
+            "Function 'split' index %li out of range. Length %li.", at, r->len);
+        lval* q = lval_qexpr();
+        lval_add(q, lval_str(lrope_sub(r, 0, at)));
+        lval_add(q, lval_str(lrope_sub(r, at, r->len)));
+        lval_del(a);
+        return q;
+    }
+
+    // Finding separators means reading every byte, but the pieces are
+    // still slices of the original rope
+    LASSERT(a, a->cell[1]->str->len > 0,
+        "Function 'split' passed \"\" for argument 1");
+    char* s = lrope_flatten(r);
+    char* sep = lrope_flatten(a->cell[1]->str);
+    long seplen = a->cell[1]->str->len;
+    lval* q = lval_qexpr();
+
+    long start = 0;
+    for (char* p = strstr(s, sep); p; p = strstr(p + seplen, sep)) {
+        lval_add(q, lval_str(lrope_sub(r, start, p - s)));
+        start = p - s + seplen;
+    }
+    lval_add(q, lval_str(lrope_sub(r, start, r->len)));
+
+    free(s);
+    free(sep);
+    lval_del(a);
+    return q;
+}
+
+// Hash maps
+
+#define LASSERT_KEY(func, args, index) \
+    LASSERT(args, lval_is_key(args->cell[index]), \
+        "Function '%s' passed incorrect type for key %i. " \
+        "Got %s, Expected %s, %s or %s.", \
+        func, index, ltype_name(args->cell[index]->type), \
+        ltype_name(LVAL_NUM), ltype_name(LVAL_SYM), ltype_name(LVAL_STR))
+
+// Set k to v in map m, taking over both. The trie nodes on the path to
+// k are copied; the rest stay shared with any other copy of m.
+void lval_map_put(lval* m, lval* k, lval* v) {
+    int added;
+    lhamt* root = lhamt_assoc(m->map, lmap_entry_new(lval_hash(k), k, v), 0, &added);
+    lhamt_release(m->map);
+    m->map = root;
+    m->map_count += added;
+}
+
+// Set the key/value pairs that make up the rest of a onto m, deleting a
+lval* lval_map_put_pairs(lval* m, lval* a) {
+    while (a->count) {
+        lval* k = lval_pop(a, 0);
+        lval_map_put(m, k, lval_pop(a, 0));
+    }
+
+    lval_del(a);
+    return m;
+}
+
+// hmap "a" 1 "b" 2
+// #{"a" 1 "b" 2}
+lval* builtin_hmap(lenv* e, lval* a) {
+    LASSERT(a, a->count % 2 == 0,
+        "Function 'hmap' passed a key without a value. Got %i arguments.", a->count);
+    for (int i = 0; i < a->count; i += 2) {
+        LASSERT_KEY("hmap", a, i);
+    }
+
+    return lval_map_put_pairs(lval_map(lhamt_new(0, 0, 0, 0), 0), a);
+}
+
+// assoc (hmap "a" 1) "b" 2
+// #{"a" 1 "b" 2}
+lval* builtin_assoc(lenv* e, lval* a) {
+    LASSERT(a, a->count >= 3 && a->count % 2 == 1,
+        "Function 'assoc' passed incorrect number of arguments. "
+        "Got %i, Expected a map then key/value pairs.", a->count);
+    LASSERT_TYPE("assoc", a, 0, LVAL_MAP);
+    for (int i = 1; i < a->count; i += 2) {
+        LASSERT_KEY("assoc", a, i);
+    }
+
+    lval* m = lval_pop(a, 0);
+    return lval_map_put_pairs(m, a);
+}
+
+// dissoc (hmap "a" 1 "b" 2) "a"
+// #{"b" 2}
+lval* builtin_dissoc(lenv* e, lval* a) {
+    LASSERT(a, a->count >= 1,
+        "Function 'dissoc' passed incorrect number of arguments. "
+        "Got %i, Expected at least 1.", a->count);
+    LASSERT_TYPE("dissoc", a, 0, LVAL_MAP);
+    for (int i = 1; i < a->count; i++) {
+        LASSERT_KEY("dissoc", a, i);
+    }
+
+    lval* m = lval_pop(a, 0);
+    for (int i = 0; i < a->count; i++) {
+        lhamt* root = lhamt_dissoc(m->map, lval_hash(a->cell[i]), a->cell[i], 0);
+        if (root != m->map) m->map_count--;
+        lhamt_release(m->map);
+        m->map = root;
+    }
+
+    lval_del(a);
+    return m;
+}
+
+// get (hmap "a" 1) "a"
+// 1
+// get (hmap "a" 1) "b" 0
+// 0
+lval* builtin_get(lenv* e, lval* a) {
+    LASSERT(a, a->count == 2 || a->count == 3,
+        "Function 'get' passed incorrect number of arguments. "
+        "Got %i, Expected 2 or 3.", a->count);
+    LASSERT_TYPE("get", a, 0, LVAL_MAP);
+    LASSERT_KEY("get", a, 1);
+
+    lval* k = a->cell[1];
+    lmap_entry* x = lhamt_find(a->cell[0]->map, lval_hash(k), k, 0);
+    LASSERT(a, x || a->count == 3, "Function 'get' key not found");
+
+    lval* v = x ? lval_copy(x->val) : lval_pop(a, 2);
+    lval_del(a);
+    return v;
+}
+
+void lval_map_add_key(lmap_entry* x, void* q) {
+    lval_add(q, lval_copy(x->key));
+}
+
+lval* builtin_keys(lenv* e, lval* a) {
+    LASSERT_NUM("keys", a, 1);
+    LASSERT_TYPE("keys", a, 0, LVAL_MAP);
+
+    lval* q = lval_qexpr();
+    lhamt_each(a->cell[0]->map, lval_map_add_key, q);
+    lval_del(a);
+    return q;
+}
+
+lval* builtin_count(lenv* e, lval* a) {
+    LASSERT_NUM("count", a, 1);
+    LASSERT_TYPE("count", a, 0, LVAL_MAP);
+
+    lval* x = lval_num(a->cell[0]->map_count);
+    lval_del(a);
+    return x;
+}
+
+// Sorting
+
+// State shared by the comparisons of one sort. The first error raised by
+// a comparator is kept, and every comparison after it reports equal so
+// the sort finishes quickly.
+typedef struct {
+    lenv* env;
+    lval* cmp;
+    lval* err;
+} lsort;
+
+// Three-way compare of two list elements, negative if x orders first
+int lsort_compare(lsort* s, lval* x, lval* y) {
+    if (s->err) return 0;
+
+    if (s->cmp) {
+        lval* args = lval_add(lval_add(lval_sexpr(), lval_copy(x)), lval_copy(y));
+        lval* r = lval_apply(s->env, s->cmp, args);
+        int order = 0;
+        if (r->type == LVAL_NUM) {
+            order = (r->num > 0) - (r->num < 0);
+        } else if (r->type == LVAL_DBL) {
+            order = (r->dbl > 0) - (r->dbl < 0);
+        } else if (r->type == LVAL_ERR) {
+            s->err = r;
+            return 0;
+        } else {
+            s->err = lval_err(
+                "Function 'sort' comparator returned incorrect type. "
+                "Got %s, Expected %s or %s.",
+                ltype_name(r->type), ltype_name(LVAL_NUM), ltype_name(LVAL_DBL));
+        }
+        lval_del(r);
+        return order;
+    }
+
+    if (x->type == LVAL_SYM) {
+        return strcmp(x->sym, y->sym);
+    }
+
+    if (x->type == LVAL_STR) {
+        return lrope_cmp(x->str, y->str);
+    }
+
+    // Mixed Numbers and Doubles compare by value
+    if (x->type == LVAL_NUM && y->type == LVAL_NUM) {
+        return (x->num > y->num) - (x->num < y->num);
+    }
+    double a = x->type == LVAL_DBL ? x->dbl : (double)x->num;
+    double b = y->type == LVAL_DBL ? y->dbl : (double)y->num;
+    return (a > b) - (a < b);
+}
+
+void lsort_insertion(lsort* s, lval** v, long n) {
+    for (long i = 1; i < n; i++) {
+        lval* x = v[i];
+        long j = i;
+        while (j > 0 && lsort_compare(s, x, v[j-1]) < 0) {
+            v[j] = v[j-1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+void lsort_sift_down(lsort* s, lval** v, long root, long n) {
+    lval* x = v[root];
+    while (2 * root + 1 < n) {
+        long child = 2 * root + 1;
+        if (child + 1 < n && lsort_compare(s, v[child], v[child+1]) < 0) child++;
+        if (lsort_compare(s, x, v[child]) >= 0) break;
+        v[root] = v[child];
+        root = child;
+    }
+    v[root] = x;
+}
+
+void lsort_heap(lsort* s, lval** v, long n) {
+    for (long i = n / 2 - 1; i >= 0; i--) {
+        lsort_sift_down(s, v, i, n);
+    }
+    for (long end = n - 1; end > 0; end--) {
+        lval* t = v[0]; v[0] = v[end]; v[end] = t;
+        lsort_sift_down(s, v, 0, end);
+    }
+}
+
+// Quicksort on a median of three pivot, switching to heapsort once
+// depth runs out and to insertion sort for short ranges
+void lsort_intro(lsort* s, lval** v, long n, int depth) {
+    while (n > 16) {
+        if (depth-- == 0) {
+            lsort_heap(s, v, n);
+            return;
+        }
+
+        long mid = n / 2;
+        lval* t;
+        if (lsort_compare(s, v[mid], v[0]) < 0) { t = v[mid]; v[mid] = v[0]; v[0] = t; }
+        if (lsort_compare(s, v[n-1], v[0]) < 0) { t = v[n-1]; v[n-1] = v[0]; v[0] = t; }
+        if (lsort_compare(s, v[n-1], v[mid]) < 0) { t = v[n-1]; v[n-1] = v[mid]; v[mid] = t; }
+
+        // Hoare partition around the median, moved to the front. The
+        // bounds checks keep an inconsistent comparator inside the range.
+        t = v[mid]; v[mid] = v[0]; v[0] = t;
+        lval* pivot = v[0];
+        long i = -1, j = n;
+        while (1) {
+            do i++; while (i < n - 1 && lsort_compare(s, v[i], pivot) < 0);
+            do j--; while (j > 0 && lsort_compare(s, v[j], pivot) > 0);
+            if (i >= j) break;
+            t = v[i]; v[i] = v[j]; v[j] = t;
+        }
+
+        // Recurse into the smaller side and loop on the larger one
+        long left = j + 1;
+        if (left < n - left) {
+            lsort_intro(s, v, left, depth);
+            v += left;
+            n -= left;
+        } else {
+            lsort_intro(s, v + left, n - left, depth);
+            n = left;
+        }
+    }
+
+    lsort_insertion(s, v, n);
+}
+
+// LSD radix sort of a list of Numbers a byte at a time, on unboxed keys.
+// Flipping the sign bit makes negative numbers order before positive ones.
+void lsort_radix(lval* q) {
+    long n = q->count;
+    uint64_t* keys = malloc(sizeof(uint64_t) * n * 2);
+    uint64_t* from = keys;
+    uint64_t* to = keys + n;
+    long counts[8][256] = {{0}};
+
+    for (long i = 0; i < n; i++) {
+        uint64_t k = (uint64_t)q->cell[i]->num ^ ((uint64_t)1 << 63);
+        from[i] = k;
+        for (int b = 0; b < 8; b++) {
+            counts[b][(k >> (8 * b)) & 0xff]++;
+        }
+    }
+
+    for (int b = 0; b < 8; b++) {
+        // A byte every key shares does not reorder anything
+        if (counts[b][(from[0] >> (8 * b)) & 0xff] == n) continue;
+
+        long offset = 0;
+        for (int d = 0; d < 256; d++) {
+            long c = counts[b][d];
+            counts[b][d] = offset;
+            offset += c;
+        }
+        for (long i = 0; i < n; i++) {
+            to[counts[b][(from[i] >> (8 * b)) & 0xff]++] = from[i];
+        }
+
+        uint64_t* t = from; from = to; to = t;
+    }
+
+    // Number cells hold nothing but the value, so they are refilled in order
+    for (long i = 0; i < n; i++) {
+        q->cell[i]->num = (long)(from[i] ^ ((uint64_t)1 << 63));
+    }
+
+    free(keys);
+}
+
+// sort {3 1 2}
+// {1 2 3}
+// sort {"pear" "apple" "fig"}
+// {"apple" "fig" "pear"}
+// sort {1 2 3} (\ {a b} {- b a})
+// {3 2 1}
+lval* builtin_sort(lenv* e, lval* a) {
+    LASSERT(a, a->count == 1 || a->count == 2,
+        "Function 'sort' passed incorrect number of arguments. "
+        "Got %i, Expected 1 or 2.", a->count);
+    LASSERT_TYPE("sort", a, 0, LVAL_QEXPR);
+    if (a->count == 2) {
+        LASSERT_TYPE("sort", a, 1, LVAL_FUNC);
+    }
+
+    lsort s = { e, NULL, NULL };
+    if (a->count == 2) s.cmp = lval_pop(a, 1);
+
+    lval* q = a->cell[0];
+    int ints = 1, nums = 1, syms = 1, strs = 1;
+    for (int i = 0; i < q->count; i++) {
+        enum LVAL_TYPE t = q->cell[i]->type;
+        ints = ints && t == LVAL_NUM;
+        nums = nums && (t == LVAL_NUM || t == LVAL_DBL);
+        syms = syms && t == LVAL_SYM;
+        strs = strs && t == LVAL_STR;
+    }
+    if (!s.cmp) {
+        LASSERT(a, nums || syms || strs,
+            "Function 'sort' cannot order a mix of element types without a comparator. "
+            "Expected all %s, all %s or all %s.",
+            ltype_name(LVAL_NUM), ltype_name(LVAL_SYM), ltype_name(LVAL_STR));
+    }
+
+    q = lval_take(a, 0);
+    if (q->count < 2) {
+        if (s.cmp) lval_del(s.cmp);
+        return q;
+    }
+
+    if (!s.cmp && ints) {
+        lsort_radix(q);
+        return q;
+    }
+
+    int depth = 0;
+    for (long n = q->count; n > 1; n >>= 1) depth += 2;
+    lsort_intro(&s, q->cell, q->count, depth);
+
+    if (s.cmp) lval_del(s.cmp);
+    if (s.err) {
+        lval_del(q);
+        return s.err;
+    }
+    return q;
+}
+
+// Vector kernels
+//
+// Elementwise kernels take a step of 1 for a vector operand or 0 for a
+// scalar operand broadcast across the vector. Each kernel has a portable
+// version, and SSE2/AVX versions where the instruction set has a packed
+// form of the operation; lvec_kernels_get picks the widest one the
+// running CPU supports.
+
+typedef void(*lvec_int_binop)(int64_t*, const int64_t*, int, const int64_t*, int, long);
+typedef int64_t(*lvec_int_reduce)(const int64_t*, long);
+typedef void(*lvec_dbl_binop)(double*, const double*, int, const double*, int, long);
+typedef double(*lvec_dbl_reduce)(const double*, long);
+
+typedef struct {
+    lvec_int_binop add_int;
+    lvec_int_binop sub_int;
+    lvec_int_reduce sum_int;
+    lvec_int_reduce min_int;
+    lvec_int_reduce max_int;
+
+    lvec_dbl_binop add_dbl;
+    lvec_dbl_binop sub_dbl;
+    lvec_dbl_binop mul_dbl;
+    lvec_dbl_binop div_dbl;
+    lvec_dbl_reduce sum_dbl;
+    lvec_dbl_reduce min_dbl;
+    lvec_dbl_reduce max_dbl;
+    double (*dot_dbl)(const double*, const double*, long);
+} lvec_kernels;
+
+// Signed overflow wraps like the SIMD versions instead of being undefined
+static void lvec_add_int(int64_t* out, const int64_t* a, int as, const int64_t* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = (int64_t)((uint64_t)a[i*as] + (uint64_t)b[i*bs]);
+}
+
+static void lvec_sub_int(int64_t* out, const int64_t* a, int as, const int64_t* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = (int64_t)((uint64_t)a[i*as] - (uint64_t)b[i*bs]);
+}
+
+static void lvec_mul_int(int64_t* out, const int64_t* a, int as, const int64_t* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = (int64_t)((uint64_t)a[i*as] * (uint64_t)b[i*bs]);
+}
+
+static void lvec_div_int(int64_t* out, const int64_t* a, int as, const int64_t* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = a[i*as] / b[i*bs];
+}
+
+static int64_t lvec_sum_int(const int64_t* xs, long n) {
+    uint64_t s = 0;
+    for (long i = 0; i < n; i++) s += (uint64_t)xs[i];
+    return (int64_t)s;
+}
+
+static int64_t lvec_min_int(const int64_t* xs, long n) {
+    int64_t m = xs[0];
+    for (long i = 1; i < n; i++) if (xs[i] < m) m = xs[i];
+    return m;
+}
+
+static int64_t lvec_max_int(const int64_t* xs, long n) {
+    int64_t m = xs[0];
+    for (long i = 1; i < n; i++) if (xs[i] > m) m = xs[i];
+    return m;
+}
+
+static void lvec_add_dbl(double* out, const double* a, int as, const double* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = a[i*as] + b[i*bs];
+}
+
+static void lvec_sub_dbl(double* out, const double* a, int as, const double* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = a[i*as] - b[i*bs];
+}
+
+static void lvec_mul_dbl(double* out, const double* a, int as, const double* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = a[i*as] * b[i*bs];
+}
+
+static void lvec_div_dbl(double* out, const double* a, int as, const double* b, int bs, long n) {
+    for (long i = 0; i < n; i++) out[i] = a[i*as] / b[i*bs];
+}
+
+static double lvec_sum_dbl(const double* xs, long n) {
+    double s = 0;
+    for (long i = 0; i < n; i++) s += xs[i];
+    return s;
+}
+
+static double lvec_min_dbl(const double* xs, long n) {
+    double m = xs[0];
+    for (long i = 1; i < n; i++) if (xs[i] < m) m = xs[i];
+    return m;
+}
+
+static double lvec_max_dbl(const double* xs, long n) {
+    double m = xs[0];
+    for (long i = 1; i < n; i++) if (xs[i] > m) m = xs[i];
+    return m;
+}
+
+static double lvec_dot_dbl(const double* xs, const double* ys, long n) {
+    double s = 0;
+    for (long i = 0; i < n; i++) s += xs[i] * ys[i];
+    return s;
+}
+
+#ifdef KEII_SIMD_X86
+
+// Only a stride 0 operand is broadcast, as an empty view has no element 0
+#define LVEC_BINOP_SIMD(name, isa, elem_t, vec_t, width, set1, load, store, op, tail) \
+    __attribute__((target(isa))) \
+    static void name(elem_t* out, const elem_t* a, int as, const elem_t* b, int bs, long n) { \
+        long i = 0; \
+        vec_t va = set1(as ? 0 : a[0]), vb = set1(bs ? 0 : b[0]); \
+        for (; i + width <= n; i += width) { \
+            if (as) va = load((const void*)(a + i)); \
+            if (bs) vb = load((const void*)(b + i)); \
+            store((void*)(out + i), op(va, vb)); \
+        } \
+        tail(out + i, a + i*as, as, b + i*bs, bs, n - i); \
+    }
+
+LVEC_BINOP_SIMD(lvec_add_int_sse2, "sse2", int64_t, __m128i, 2, _mm_set1_epi64x,
+    _mm_loadu_si128, _mm_storeu_si128, _mm_add_epi64, lvec_add_int)
+LVEC_BINOP_SIMD(lvec_sub_int_sse2, "sse2", int64_t, __m128i, 2, _mm_set1_epi64x,
+    _mm_loadu_si128, _mm_storeu_si128, _mm_sub_epi64, lvec_sub_int)
+LVEC_BINOP_SIMD(lvec_add_int_avx2, "avx2", int64_t, __m256i, 4, _mm256_set1_epi64x,
+    _mm256_loadu_si256, _mm256_storeu_si256, _mm256_add_epi64, lvec_add_int)
+LVEC_BINOP_SIMD(lvec_sub_int_avx2, "avx2", int64_t, __m256i, 4, _mm256_set1_epi64x,
+    _mm256_loadu_si256, _mm256_storeu_si256, _mm256_sub_epi64, lvec_sub_int)
+
+LVEC_BINOP_SIMD(lvec_add_dbl_sse2, "sse2", double, __m128d, 2, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, lvec_add_dbl)
+LVEC_BINOP_SIMD(lvec_sub_dbl_sse2, "sse2", double, __m128d, 2, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd, lvec_sub_dbl)
+LVEC_BINOP_SIMD(lvec_mul_dbl_sse2, "sse2", double, __m128d, 2, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, lvec_mul_dbl)
+LVEC_BINOP_SIMD(lvec_div_dbl_sse2, "sse2", double, __m128d, 2, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd, _mm_div_pd, lvec_div_dbl)
+LVEC_BINOP_SIMD(lvec_add_dbl_avx, "avx", double, __m256d, 4, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, lvec_add_dbl)
+LVEC_BINOP_SIMD(lvec_sub_dbl_avx, "avx", double, __m256d, 4, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd, lvec_sub_dbl)
+LVEC_BINOP_SIMD(lvec_mul_dbl_avx, "avx", double, __m256d, 4, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, lvec_mul_dbl)
+LVEC_BINOP_SIMD(lvec_div_dbl_avx, "avx", double, __m256d, 4, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd, lvec_div_dbl)
+
+__attribute__((target("sse2")))
+static int64_t lvec_sum_int_sse2(const int64_t* xs, long n) {
+    long i = 0;
+    int64_t lanes[2];
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)(xs + i)));
+    }
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    return (int64_t)((uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lvec_sum_int(xs + i, n - i));
+}
+
+__attribute__((target("avx2")))
+static int64_t lvec_sum_int_avx2(const int64_t* xs, long n) {
+    long i = 0;
+    int64_t lanes[4];
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i*)(xs + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i*)(xs + i + 4)));
+    }
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+    uint64_t s = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+    return (int64_t)(s + (uint64_t)lvec_sum_int(xs + i, n - i));
+}
+
+// SSE2 has no 64-bit lane compare (pcmpgtq is SSE4.2) and nothing before
+// AVX-512 has a 64-bit min/max, so the compare and blend start at AVX2
+__attribute__((target("avx2")))
+static int64_t lvec_minmax_int_avx2(const int64_t* xs, long n, int want_max) {
+    long i = 4;
+    int64_t lanes[4];
+    if (n < 8) return want_max ? lvec_max_int(xs, n) : lvec_min_int(xs, n);
+
+    __m256i m = _mm256_loadu_si256((const __m256i*)xs);
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(xs + i));
+        __m256i gt = want_max ? _mm256_cmpgt_epi64(x, m) : _mm256_cmpgt_epi64(m, x);
+        m = _mm256_blendv_epi8(m, x, gt);
+    }
+    _mm256_storeu_si256((__m256i*)lanes, m);
+
+    int64_t r = lanes[0];
+    for (int k = 1; k < 4; k++) {
+        if (want_max ? lanes[k] > r : lanes[k] < r) r = lanes[k];
+    }
+    for (; i < n; i++) {
+        if (want_max ? xs[i] > r : xs[i] < r) r = xs[i];
+    }
+    return r;
+}
+
+static int64_t lvec_min_int_avx2(const int64_t* xs, long n) { return lvec_minmax_int_avx2(xs, n, 0); }
+static int64_t lvec_max_int_avx2(const int64_t* xs, long n) { return lvec_minmax_int_avx2(xs, n, 1); }
+
+// Double reductions keep one partial result per lane, so sums may
+// round differently from a left-to-right scalar loop
+__attribute__((target("sse2")))
+static double lvec_sum_dbl_sse2(const double* xs, long n) {
+    long i = 0;
+    double lanes[2];
+    __m128d acc = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_loadu_pd(xs + i));
+    _mm_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lvec_sum_dbl(xs + i, n - i);
+}
+
+__attribute__((target("avx")))
+static double lvec_sum_dbl_avx(const double* xs, long n) {
+    long i = 0;
+    double lanes[4];
+    __m256d acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_loadu_pd(xs + i));
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lvec_sum_dbl(xs + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static double lvec_dot_dbl_sse2(const double* xs, const double* ys, long n) {
+    long i = 0;
+    double lanes[2];
+    __m128d acc = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(xs + i), _mm_loadu_pd(ys + i)));
+    }
+    _mm_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lvec_dot_dbl(xs + i, ys + i, n - i);
+}
+
+__attribute__((target("avx")))
+static double lvec_dot_dbl_avx(const double* xs, const double* ys, long n) {
+    long i = 0;
+    double lanes[4];
+    __m256d acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(xs + i), _mm256_loadu_pd(ys + i)));
+    }
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lvec_dot_dbl(xs + i, ys + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static double lvec_minmax_dbl_sse2(const double* xs, long n, int want_max) {
+    long i = 2;
+    double lanes[2];
+    if (n < 4) return want_max ? lvec_max_dbl(xs, n) : lvec_min_dbl(xs, n);
+
+    __m128d m = _mm_loadu_pd(xs);
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(xs + i);
+        m = want_max ? _mm_max_pd(m, x) : _mm_min_pd(m, x);
+    }
+    _mm_storeu_pd(lanes, m);
+
+    double r = want_max ? (lanes[1] > lanes[0] ? lanes[1] : lanes[0])
+                        : (lanes[1] < lanes[0] ? lanes[1] : lanes[0]);
+    for (; i < n; i++) {
+        if (want_max ? xs[i] > r : xs[i] < r) r = xs[i];
+    }
+    return r;
+}
+
+__attribute__((target("avx")))
+static double lvec_minmax_dbl_avx(const double* xs, long n, int want_max) {
+    long i = 4;
+    double lanes[4];
+    if (n < 8) return want_max ? lvec_max_dbl(xs, n) : lvec_min_dbl(xs, n);
+
+    __m256d m = _mm256_loadu_pd(xs);
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(xs + i);
+        m = want_max ? _mm256_max_pd(m, x) : _mm256_min_pd(m, x);
+    }
+    _mm256_storeu_pd(lanes, m);
+
+    double r = lanes[0];
+    for (int k = 1; k < 4; k++) {
+        if (want_max ? lanes[k] > r : lanes[k] < r) r = lanes[k];
+    }
+    for (; i < n; i++) {
+        if (want_max ? xs[i] > r : xs[i] < r) r = xs[i];
+    }
+    return r;
+}
+
+static double lvec_min_dbl_sse2(const double* xs, long n) { return lvec_minmax_dbl_sse2(xs, n, 0); }
+static double lvec_max_dbl_sse2(const double* xs, long n) { return lvec_minmax_dbl_sse2(xs, n, 1); }
+static double lvec_min_dbl_avx(const double* xs, long n) { return lvec_minmax_dbl_avx(xs, n, 0); }
+static double lvec_max_dbl_avx(const double* xs, long n) { return lvec_minmax_dbl_avx(xs, n, 1); }
+
+#endif
+
+lvec_kernels* lvec_kernels_get(void) {
+    static lvec_kernels k;
+    static int resolved = 0;
+    if (resolved) return &k;
+
+    k.add_int = lvec_add_int;
+    k.sub_int = lvec_sub_int;
+    k.sum_int = lvec_sum_int;
+    k.min_int = lvec_min_int;
+    k.max_int = lvec_max_int;
+    k.add_dbl = lvec_add_dbl;
+    k.sub_dbl = lvec_sub_dbl;
+    k.mul_dbl = lvec_mul_dbl;
+    k.div_dbl = lvec_div_dbl;
+    k.sum_dbl = lvec_sum_dbl;
+    k.min_dbl = lvec_min_dbl;
+    k.max_dbl = lvec_max_dbl;
+    k.dot_dbl = lvec_dot_dbl;
+
+#ifdef KEII_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        k.add_int = lvec_add_int_sse2;
+        k.sub_int = lvec_sub_int_sse2;
+        k.sum_int = lvec_sum_int_sse2;
+        k.add_dbl = lvec_add_dbl_sse2;
+        k.sub_dbl = lvec_sub_dbl_sse2;
+        k.mul_dbl = lvec_mul_dbl_sse2;
+        k.div_dbl = lvec_div_dbl_sse2;
+        k.sum_dbl = lvec_sum_dbl_sse2;
+        k.min_dbl = lvec_min_dbl_sse2;
+        k.max_dbl = lvec_max_dbl_sse2;
+        k.dot_dbl = lvec_dot_dbl_sse2;
+    }
+    if (__builtin_cpu_supports("avx")) {
+        k.add_dbl = lvec_add_dbl_avx;
+        k.sub_dbl = lvec_sub_dbl_avx;
+        k.mul_dbl = lvec_mul_dbl_avx;
+        k.div_dbl = lvec_div_dbl_avx;
+        k.sum_dbl = lvec_sum_dbl_avx;
+        k.min_dbl = lvec_min_dbl_avx;
+        k.max_dbl = lvec_max_dbl_avx;
+        k.dot_dbl = lvec_dot_dbl_avx;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        k.add_int = lvec_add_int_avx2;
+        k.sub_int = lvec_sub_int_avx2;
+        k.sum_int = lvec_sum_int_avx2;
+        k.min_int = lvec_min_int_avx2;
+        k.max_int = lvec_max_int_avx2;
+    }
+#endif
+
+    resolved = 1;
+    return &k;
+}
+
+// First element of the part of the buffer a vector lval views
+int64_t* lval_vec_ints(lval* v) {
+    return v->vec->ints + v->vec_start;
+}
+
+double* lval_vec_dbls(lval* v) {
+    return v->vec->dbls + v->vec_start;
+}
+
+// Convert a vector to Double elements, deleting the original
+lval* lval_vec_to_dbl(lval* v) {
+    if (v->vec->type == LVEC_DBL) return v;
+
+    lvec* b = lvec_new(LVEC_DBL, v->vec_count);
+    int64_t* xs = lval_vec_ints(v);
+    for (long i = 0; i < b->count; i++) {
+        b->dbls[i] = (double)xs[i];
+    }
+
+    lval_del(v);
+    return lval_vec(b, 0, b->count);
+}
+
+// Whether a number or vector operand holds Doubles
+int lval_is_dbl(lval* v) {
+    return v->type == LVAL_DBL || (v->type == LVAL_VEC && v->vec->type == LVEC_DBL);
+}
+
+// Elementwise operation on Double vectors and/or scalars, deleting both
+lval* lval_vec_binop_dbl(lval* x, lval* y, char* operation) {
+    if (x->type == LVAL_VEC) x = lval_vec_to_dbl(x);
+    if (y->type == LVAL_VEC) y = lval_vec_to_dbl(y);
+
+    long n = x->type == LVAL_VEC ? x->vec_count : y->vec_count;
+    double xk = x->type == LVAL_DBL ? x->dbl : x->type == LVAL_NUM ? (double)x->num : 0;
+    double yk = y->type == LVAL_DBL ? y->dbl : y->type == LVAL_NUM ? (double)y->num : 0;
+    const double* a = x->type == LVAL_VEC ? lval_vec_dbls(x) : &xk;
+    const double* b = y->type == LVAL_VEC ? lval_vec_dbls(y) : &yk;
+    int as = x->type == LVAL_VEC;
+    int bs = y->type == LVAL_VEC;
+
+    if (strcmp(operation, "/") == 0) {
+        for (long i = 0; i < (bs ? n : 1); i++) {
+            if (b[i] == 0) {
+                lval_del(x);
+                lval_del(y);
+                return lval_err("Division by Zero!");
+            }
+        }
+    }
+
+    lval* out;
+    if (as && x->vec->refs == 1) {
+        out = x;
+    } else if (bs && y->vec->refs == 1) {
+        out = y;
+    } else {
+        out = lval_vec(lvec_new(LVEC_DBL, n), 0, n);
+    }
+
+    lvec_kernels* k = lvec_kernels_get();
+    double* o = lval_vec_dbls(out);
+    if (strcmp(operation, "+") == 0) k->add_dbl(o, a, as, b, bs, n);
+    if (strcmp(operation, "-") == 0) k->sub_dbl(o, a, as, b, bs, n);
+    if (strcmp(operation, "*") == 0) k->mul_dbl(o, a, as, b, bs, n);
+    if (strcmp(operation, "/") == 0) k->div_dbl(o, a, as, b, bs, n);
+
+    if (out != x) lval_del(x);
+    if (out != y) lval_del(y);
+
+    for (long i = 0; i < n; i++) {
+        if (!isfinite(o[i])) {
+            lval_del(out);
+            return lval_err("Double overflow!");
+        }
+    }
+    return out;
+}
+
+// Apply operation to a pair of numbers and/or vectors, deleting both.
+// A vector that is not shared with any other value is reused for the result.
+lval* lval_vec_binop(lval* x, lval* y, char* operation) {
+    if (x->type != LVAL_VEC && y->type != LVAL_VEC) {
+        lval* a = lval_add(lval_add(lval_sexpr(), x), y);
+        return builtin_operation(NULL, a, operation);
+    }
+
+    if (x->type == LVAL_VEC && y->type == LVAL_VEC && x->vec_count != y->vec_count) {
+        lval* err = lval_err("Vector length mismatch. Got %li and %li.",
+            x->vec_count, y->vec_count);
+        lval_del(x);
+        lval_del(y);
+        return err;
+    }
+
+    if (lval_is_dbl(x) || lval_is_dbl(y)) {
+        return lval_vec_binop_dbl(x, y, operation);
+    }
+
+    long n = x->type == LVAL_VEC ? x->vec_count : y->vec_count;
+    int64_t xk = x->type == LVAL_NUM ? x->num : 0;
+    int64_t yk = y->type == LVAL_NUM ? y->num : 0;
+    const int64_t* a = x->type == LVAL_VEC ? lval_vec_ints(x) : &xk;
+    const int64_t* b = y->type == LVAL_VEC ? lval_vec_ints(y) : &yk;
+    int as = x->type == LVAL_VEC;
+    int bs = y->type == LVAL_VEC;
+
+    // Integer division traps on a zero divisor and on INT64_MIN / -1
+    if (strcmp(operation, "/") == 0) {
+        for (long i = 0; i < n; i++) {
+            int64_t p = a[i*as], q = b[i*bs];
+            if (q == 0 || (q == -1 && p == INT64_MIN)) {
+                lval_del(x);
+                lval_del(y);
+                return lval_err(q == 0 ? "Division by Zero!" : "Division overflow!");
+            }
+        }
+    }
+
+    lval* out;
+    if (as && x->vec->refs == 1) {
+        out = x;
+    } else if (bs && y->vec->refs == 1) {
+        out = y;
+    } else {
+        out = lval_vec(lvec_new(LVEC_INT, n), 0, n);
+    }
+
+    lvec_kernels* k = lvec_kernels_get();
+    int64_t* o = lval_vec_ints(out);
+    if (strcmp(operation, "+") == 0) k->add_int(o, a, as, b, bs, n);
+    if (strcmp(operation, "-") == 0) k->sub_int(o, a, as, b, bs, n);
+    if (strcmp(operation, "*") == 0) lvec_mul_int(o, a, as, b, bs, n);
+    if (strcmp(operation, "/") == 0) lvec_div_int(o, a, as, b, bs, n);
+
+    if (out != x) lval_del(x);
+    if (out != y) lval_del(y);
+    return out;
+}
+
+// Elementwise arithmetic where at least one argument is a vector
+lval* builtin_vec_operation(lenv* e, lval* a, char* operation) {
+    for (int i = 0; i < a->count; i++) {
+        enum LVAL_TYPE t = a->cell[i]->type;
+        LASSERT(a, t == LVAL_NUM || t == LVAL_DBL || t == LVAL_VEC,
+            "Function '%s' passed incorrect type for argument %i. "
+            "Got %s, Expected %s, %s or %s.",
+            operation, i, ltype_name(t),
+            ltype_name(LVAL_NUM), ltype_name(LVAL_DBL), ltype_name(LVAL_VEC));
+    }
+
+    lval* x = lval_pop(a, 0);
+
+    // If no arguments and sub then negate
+    if ((strcmp(operation, "-") == 0) && a->count == 0) {
+        x = lval_vec_binop(lval_num(0), x, operation);
+    }
+
+    while (a->count > 0 && x->type != LVAL_ERR) {
+        x = lval_vec_binop(x, lval_pop(a, 0), operation);
+    }
+
+    lval_del(a);
+    return x;
+}
+
+// vec {1 2 3}
+// [1 2 3]
+// vec {1 2.5}
+// [1.0 2.5]
+lval* builtin_vec(lenv* e, lval* a) {
+    LASSERT_NUM("vec", a, 1);
+    LASSERT_TYPE("vec", a, 0, LVAL_QEXPR);
+
+    lval* q = a->cell[0];
+    int dbl = 0;
+    for (int i = 0; i < q->count; i++) {
+        LASSERT(a, q->cell[i]->type == LVAL_NUM || q->cell[i]->type == LVAL_DBL,
+            "Function 'vec' passed incorrect type for element %i. "
+            "Got %s, Expected %s or %s.",
+            i, ltype_name(q->cell[i]->type), ltype_name(LVAL_NUM), ltype_name(LVAL_DBL));
+        if (q->cell[i]->type == LVAL_DBL) dbl = 1;
+    }
+
+    lvec* b = lvec_new(dbl ? LVEC_DBL : LVEC_INT, q->count);
+    for (int i = 0; i < q->count; i++) {
+        if (dbl) {
+            b->dbls[i] = q->cell[i]->type == LVAL_DBL ? q->cell[i]->dbl : (double)q->cell[i]->num;
+        } else {
+            b->ints[i] = q->cell[i]->num;
+        }
+    }
+
+    lval_del(a);
+    return lval_vec(b, 0, b->count);
+}
+
+lval* builtin_vec_list(lenv* e, lval* a) {
+    LASSERT_NUM("vec-list", a, 1);
+    LASSERT_TYPE("vec-list", a, 0, LVAL_VEC);
+
+    lval* v = a->cell[0];
+    lval* q = lval_qexpr();
+    q->count = v->vec_count;
+    q->cell = malloc(sizeof(lval*) * q->count);
+    for (int i = 0; i < q->count; i++) {
+        q->cell[i] = v->vec->type == LVEC_DBL
+            ? lval_dbl(lval_vec_dbls(v)[i])
+            : lval_num(lval_vec_ints(v)[i]);
+    }
+
+    lval_del(a);
+    return q;
+}
+
+lval* builtin_vec_len(lenv* e, lval* a) {
+    LASSERT_NUM("vec-len", a, 1);
+    LASSERT_TYPE("vec-len", a, 0, LVAL_VEC);
+
+    lval* x = lval_num(a->cell[0]->vec_count);
+    lval_del(a);
+    return x;
+}
+
+lval* builtin_vec_get(lenv* e, lval* a) {
+    LASSERT_NUM("vec-get", a, 2);
+    LASSERT_TYPE("vec-get", a, 0, LVAL_VEC);
+    LASSERT_TYPE("vec-get", a, 1, LVAL_NUM);
+
+    lval* v = a->cell[0];
+    long i = a->cell[1]->num;
+    LASSERT(a, i >= 0 && i < v->vec_count,
+        "Function 'vec-get' index %li out of range. Length %li.",
+        i, v->vec_count);
+
+    lval* x = v->vec->type == LVEC_DBL
+        ? lval_dbl(lval_vec_dbls(v)[i])
+        : lval_num(lval_vec_ints(v)[i]);
+    lval_del(a);
+    return x;
+}
+
+// vec-slice [1 2 3 4] 1 3
+// [2 3]
+lval* builtin_vec_slice(lenv* e, lval* a) {
+    LASSERT_NUM("vec-slice", a, 3);
+    LASSERT_TYPE("vec-slice", a, 0, LVAL_VEC);
+    LASSERT_TYPE("vec-slice", a, 1, LVAL_NUM);
+    LASSERT_TYPE("vec-slice", a, 2, LVAL_NUM);
+
+    lval* v = a->cell[0];
+    long start = a->cell[1]->num;
+    long end = a->cell[2]->num;
+    LASSERT(a, start >= 0 && start <= end && end <= v->vec_count,
+        "Function 'vec-slice' range %li to %li out of range. Length %li.",
+        start, end, v->vec_count);
+
+    // The slice shares the buffer rather than copying it
+    v->vec->refs++;
+    lval* x = lval_vec(v->vec, v->vec_start + start, end - start);
+    lval_del(a);
+    return x;
+}
+
+lval* builtin_vec_reduce(lval* a, char* func) {
+    LASSERT_NUM(func, a, 1);
+    LASSERT_TYPE(func, a, 0, LVAL_VEC);
+
+    lval* v = a->cell[0];
+    lvec_kernels* k = lvec_kernels_get();
+    if (v->vec->type == LVEC_DBL) {
+        double* xs = lval_vec_dbls(v);
+        if (strcmp(func, "sum") == 0) {
+            lval* x = lval_dbl(k->sum_dbl(xs, v->vec_count));
+            lval_del(a);
+            return lval_dbl_finite(x);
+        }
+
+        LASSERT(a, v->vec_count != 0, "Function '%s' passed [] for argument 0", func);
+        double r = strcmp(func, "min") == 0
+            ? k->min_dbl(xs, v->vec_count)
+            : k->max_dbl(xs, v->vec_count);
+        lval_del(a);
+        return lval_dbl(r);
+    }
+
+    if (strcmp(func, "sum") == 0) {
+        lval* x = lval_num(k->sum_int(lval_vec_ints(v), v->vec_count));
+        lval_del(a);
+        return x;
+    }
+
+    LASSERT(a, v->vec_count != 0, "Function '%s' passed [] for argument 0", func);
+    int64_t r = strcmp(func, "min") == 0
+        ? k->min_int(lval_vec_ints(v), v->vec_count)
+        : k->max_int(lval_vec_ints(v), v->vec_count);
+    lval_del(a);
+    return lval_num(r);
+}
+
+lval* builtin_sum(lenv* e, lval* a) {
+    return builtin_vec_reduce(a, "sum");
+}
+
+lval* builtin_min(lenv* e, lval* a) {
+    return builtin_vec_reduce(a, "min");
+}
+
+lval* builtin_max(lenv* e, lval* a) {
+    return builtin_vec_reduce(a, "max");
+}
+
+lval* builtin_dot(lenv* e, lval* a) {
+    LASSERT_NUM("dot", a, 2);
+    LASSERT_TYPE("dot", a, 0, LVAL_VEC);
+    LASSERT_TYPE("dot", a, 1, LVAL_VEC);
+    LASSERT(a, a->cell[0]->vec_count == a->cell[1]->vec_count,
+        "Vector length mismatch. Got %li and %li.",
+        a->cell[0]->vec_count, a->cell[1]->vec_count);
+
+    if (lval_is_dbl(a->cell[0]) || lval_is_dbl(a->cell[1])) {
+        a->cell[0] = lval_vec_to_dbl(a->cell[0]);
+        a->cell[1] = lval_vec_to_dbl(a->cell[1]);
+        lval* x = lval_dbl(lvec_kernels_get()->dot_dbl(
+            lval_vec_dbls(a->cell[0]), lval_vec_dbls(a->cell[1]), a->cell[0]->vec_count));
+        lval_del(a);
+        return lval_dbl_finite(x);
+    }
+
+    int64_t* xs = lval_vec_ints(a->cell[0]);
+    int64_t* ys = lval_vec_ints(a->cell[1]);
+    uint64_t s = 0;
+    for (long i = 0; i < a->cell[0]->vec_count; i++) {
+        s += (uint64_t)xs[i] * (uint64_t)ys[i];
+    }
+
+    lval_del(a);
+    return lval_num((int64_t)s);
+}
+
+lval* builtin_add(lenv* e, lval* a) {
+    return builtin_operation(e, a, "+");
+}
+
+lval* builtin_subtract(lenv* e, lval* a) {
+    return builtin_operation(e, a, "-");
+}
+
+lval* builtin_multiply(lenv* e, lval* a) {
+    return builtin_operation(e, a, "*");
+}
+
+lval* builtin_divide(lenv* e, lval* a) {
+    return builtin_operation(e, a, "/");
+}
+
+lval* builtin_def(lenv* e, lval* a) {
+    return builtin_var(e, a, "def");
+}
+
+lval* builtin_put(lenv* e, lval* a) {
+    return builtin_var(e, a, "=");
+}
+
+lval* builtin_var(lenv* env, lval* a, char* func) {
+    LASSERT_TYPE(func, a, 0, LVAL_QEXPR);
+
+    lval* syms = a->cell[0];
+    for (int i = 0; i < syms->count; i++) {
+        LASSERT(a, (syms->cell[i]->type == LVAL_SYM),
+            "Function '%s' cannot define non-symbol. "
+            "Got %s, Expected %s.", func,
+            ltype_name(syms->cell[i]->type),
+            ltype_name(LVAL_SYM));
+    }
+
+    LASSERT(a, (syms->count == a->count-1), 
+        "Function '%s' passed too many arguments for symbols. "
+        "Got %i, Expected %i.", func, syms->count, a->count-1);
+
+    for (int i = 0; i < syms->count; i++) {
+        // If 'def', define the variable globally
+        if (strcmp(func, "def") == 0) {
+            lenv_def(env, syms->cell[i], a->cell[i+1]);
+        }
+
+        // If '=' define the variable locally according to passed in env
+        if (strcmp(func, "=") == 0) {
+            lenv_put(env, syms->cell[i], a->cell[i+1]);
+        }
+    }
+
+    lval_del(a);
+    return lval_sexpr();
+}
+
+void lenv_add_builtin(lenv* e, char* name, lbuiltin func) {
+    lval* symbol = lval_sym(name);
+    lval* func_def = lval_func(func);
+    lenv_put(e, symbol, func_def);
+    lval_del(symbol);
+    lval_del(func_def);
+}
+
+void lenv_add_builtins(lenv* environment) {
+    lenv_add_builtin(environment, "list", builtin_list);
+    lenv_add_builtin(environment, "head", builtin_head);
+    lenv_add_builtin(environment, "tail", builtin_tail);
+    lenv_add_builtin(environment, "join", builtin_join);
+    lenv_add_builtin(environment, "len", builtin_len);
+    lenv_add_builtin(environment, "map", builtin_map);
+    lenv_add_builtin(environment, "filter", builtin_filter);
+    lenv_add_builtin(environment, "foldl", builtin_foldl);
+    lenv_add_builtin(environment, "foldr", builtin_foldr);
+    lenv_add_builtin(environment, "sort", builtin_sort);
+    lenv_add_builtin(environment, "range", builtin_range);
+    lenv_add_builtin(environment, "stream", builtin_stream);
+    lenv_add_builtin(environment, "take", builtin_take);
+
+    lenv_add_builtin(environment, "concat", builtin_concat);
+    lenv_add_builtin(environment, "substring", builtin_substring);
+    lenv_add_builtin(environment, "split", builtin_split);
+
+    lenv_add_builtin(environment, "hmap", builtin_hmap);
+    lenv_add_builtin(environment, "get", builtin_get);
+    lenv_add_builtin(environment, "assoc", builtin_assoc);
+    lenv_add_builtin(environment, "dissoc", builtin_dissoc);
+    lenv_add_builtin(environment, "keys", builtin_keys);
+    lenv_add_builtin(environment, "count", builtin_count);
+    lenv_add_builtin(environment, "eval", builtin_eval);
+    lenv_add_builtin(environment, "load", builtin_load);
+    lenv_add_builtin(environment, "def", builtin_def);
+    lenv_add_builtin(environment, "=", builtin_put);
+    lenv_add_builtin(environment, "\\", builtin_lambda);
+
+    lenv_add_builtin(environment, "+", builtin_add);
+    lenv_add_builtin(environment, "-", builtin_subtract);
+    lenv_add_builtin(environment, "*", builtin_multiply);
+    lenv_add_builtin(environment, "/", builtin_divide);
+
+    lenv_add_builtin(environment, "vec", builtin_vec);
+    lenv_add_builtin(environment, "vec-list", builtin_vec_list);
+    lenv_add_builtin(environment, "vec-len", builtin_vec_len);
+    lenv_add_builtin(environment, "vec-get", builtin_vec_get);
+    lenv_add_builtin(environment, "vec-slice", builtin_vec_slice);
+    lenv_add_builtin(environment, "sum", builtin_sum);
+    lenv_add_builtin(environment, "min", builtin_min);
+    lenv_add_builtin(environment, "max", builtin_max);
+    lenv_add_builtin(environment, "dot", builtin_dot);
+}
+
+lval* lval_copy(lval* v) {
+    lval* x = malloc(sizeof(lval));
+    x->type = v->type;
+
+    switch(v->type) {
+        case LVAL_FUNC: 
+            if (v->builtin_func) {
+                x->builtin_func = v->builtin_func; 
+            } else {
+                x->builtin_func = NULL;
+                x->env = lenv_copy(v->env);
+                x->formals = lval_copy(v->formals);
+                x->body = lval_copy(v->body);
+            }
+            break;
+        case LVAL_NUM: x->num = v->num; break;
+        case LVAL_DBL: x->dbl = v->dbl; break;
+
+        // Vectors are immutable once shared, so copies share the buffer
+        case LVAL_VEC:
+            x->vec = v->vec;
+            x->vec->refs++;
+            x->vec_start = v->vec_start;
+            x->vec_count = v->vec_count;
+            break;
+        case LVAL_SEQ:
+            x->seq = lseq_copy(v->seq);
+            break;
+
+        // Ropes are immutable, so copies share them
+        case LVAL_STR:
+            x->str = lrope_retain(v->str);
+            break;
+
+        // Maps are persistent, so copies share the whole trie
+        case LVAL_MAP:
+            x->map = lhamt_retain(v->map);
+            x->map_count = v->map_count;
+            break;
+
+        case LVAL_ERR:
+            x->err = malloc(strlen(v->err) + 1);
+            strcpy(x->err, v->err);
+            break;
+        case LVAL_SYM:
+            x->sym = malloc(strlen(v->sym) + 1);
+            strcpy(x->sym, v->sym);
+            break;
+        case LVAL_SEXPR:
+        case LVAL_QEXPR:
+            x->count = v->count;
+            x->cell = malloc(sizeof(lval*) * v->count);
+            for (int i = 0; i < x->count; i++) {
+                x->cell[i] = lval_copy(v->cell[i]);
+            }
+            break;
+    }
+
+    return x;
+}
+
+int main(int argc, char **argv)
+{
+    /* Create Parser */
+    mpc_parser_t *number = mpc_new("number");
+    mpc_parser_t *string = mpc_new("string");
+    mpc_parser_t *symbol= mpc_new("symbol");
+    mpc_parser_t *sexpr = mpc_new("sexpr");
+    mpc_parser_t *qexpr = mpc_new("qexpr");
+    mpc_parser_t *expr = mpc_new("expr");
+    mpc_parser_t *lispy = mpc_new("lispy");
+
+    /* Strings reuse mpc's literal parser, unescaped into an AST leaf */
+    mpc_define(string, mpc_tok(mpc_apply(
+        mpc_apply(mpc_string_lit(), mpcf_unescape), mpcf_str_ast)));
+
+    /* Defind the language */
+    mpca_lang(MPCA_LANG_ARENA,
+        "                                                           \
+            number: /-?[0-9]+(\\.[0-9]+)?([eE][-+]?[0-9]+)?/;       \
+            symbol: /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/;               \
+            sexpr: '(' <expr>* ')';                                 \
+            qexpr: '{' <expr>* '}';                                 \
+            expr: <number> | <string> | <symbol>                    \
+                | <sexpr> | <qexpr> ;                               \
+            lispy: /^/ <expr>* /$/;                                 \
+        ",
+              number, string, symbol, sexpr, qexpr, expr, lispy);
+
+    lrules[LRULE_NUMBER] = mpca_rule_bit(number);
+    lrules[LRULE_STRING] = mpca_rule_bit(string);
+    lrules[LRULE_SYMBOL] = mpca_rule_bit(symbol);
+    lrules[LRULE_SEXPR] = mpca_rule_bit(sexpr);
+    lrules[LRULE_QEXPR] = mpca_rule_bit(qexpr);
+
+    // Initialise root environment with builtin functions
+    lenv* e = lenv_new();
+    lenv_add_builtins(e);
+
+    // Given files, run each of them in turn instead of the prompt
+    for (int i = 1; i < argc; i++)
+    {
+        lval* args = lval_add(lval_sexpr(), lval_str(lrope_new(argv[i], strlen(argv[i]))));
+        lval* x = builtin_load(e, args);
+        if (x->type == LVAL_ERR) lval_println(x);
+        lval_del(x);
+    }
+
+    if (argc == 1)
+    {
+        puts("Keii Version 0.0.1");
+        puts("Press Ctrl + C to exit\n");
+    }
+
+    while (argc == 1)
+    {
+        char* input = readline("keii> ");
+        if (!input) break;
+        add_history(input);
+
+        // mpc only runs when the direct reader rejects the input, to
+        // report where it went wrong
+        lval* x = lval_read_input(input);
+        if (!x)
+        {
+            mpc_result_t r;
+            if (mpc_parse("<stdin>", input, lispy, &r))
+            {
+                x = lval_read(r.output);
+                mpc_ast_delete(r.output);
+            }
+            else
+            {
+                mpc_err_print(r.error);
+                mpc_err_delete(r.error);
+            }
+        }
+
+        if (x)
+        {
+            x = lval_eval(e, x);
+            lval_println(x);
+            lval_del(x);
+        }
+
+        free(input);
+    }
+
+    lenv_del(e);
+    mpc_cleanup(7, number, string, symbol, sexpr, qexpr, expr, lispy);
+
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*
+** Parses a corpus with several grammars under each mpca_lang flag
+** combination and each kind of input, and checks every AST and error
+** against a plain string parse, with no flags besides predictive.
+** The plain results are printed, so they can be diffed against
+** tests/mpc_test.out, which was produced by the engine before any of
+** its optimisations.
+**
+** Inputs nested 50 deep are printed like the corpus. Inputs nested
+** 100000 deep are only compared between the flags, as the original
+** engine stops at a recursion depth of 1000, so their lines in
+** tests/mpc_test.out come from this engine.
+**
+**   cc -std=c99 -I. tests/mpc_test.c mpc.c -lm -o mpc_test
+**   ./mpc_test | diff tests/mpc_test.out -
+*/
+
+#include "mpc.h"
+
+#define TEST_PARSERS_MAX 10
+
+typedef struct {
+  const char *names[TEST_PARSERS_MAX];
+  const char *lang;
+  int backtracks;
+  const char *inputs[16];
+} test_grammar_t;
+
+static const test_grammar_t test_grammars[] = {
+
+  { { "number", "string", "symbol", "sexpr", "qexpr", "expr", "lispy" },
+    " number : /-?[0-9]+(\\.[0-9]+)?([eE][-+]?[0-9]+)?/ ;     "
+    " string : /\"(\\\\.|[^\"])*\"/ ;                          "
+    " symbol : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;              "
+    " sexpr  : '(' <expr>* ')' ;                               "
+    " qexpr  : '{' <expr>* '}' ;                               "
+    " expr   : <number> | <string> | <symbol>                  "
+    "        | <sexpr> | <qexpr> ;                             "
+    " lispy  : /^/ <expr>* /$/ ;                               ",
+    0,
+    { "(+ 1 2)", "{1 2 3}", "(def {add} (\\ {a b} {+ a b}))",
+      "(* 1.5 -2e3 4.25E-1)", "\"a \\\"quoted\\\" string\" sym",
+      "", "   \n\t ", "(+ 1", ")", "(+ 1 2))", "{1 (2 [3])}",
+      "(a\n  (b\n    c)\n", "(- -1 -x)", "\"open", NULL } },
+
+  { { "value", "product", "expression", "maths" },
+    " value      : /[0-9]+/ | '(' <expression> ')' ;              "
+    " product    : <value> (('*' | '/') <value>)* ;               "
+    " expression : <product> (('+' | '-') <product>)* ;           "
+    " maths      : /^/ <expression> /$/ ;                         ",
+    0,
+    { "1+2*3", "(1+2)*3", "1 + 2 * (3 - 4) / 5", "((((7))))",
+      "1+", "2*(3", "abc", "", "12 34", NULL } },
+
+  { { "ident", "number", "str", "call", "expr", "assign", "stmt", "prog" },
+    " ident         : /[a-zA-Z_][a-zA-Z0-9_]*/ ;                       "
+    " number \"number\" : /[0-9]+/ ;                                   "
+    " str           : /\"[^\"]*\"/ ;                                   "
+    " call          : <ident> '(' (<expr> (',' <expr>)*)? ')' ;        "
+    " expr          : <call> | <ident> | <number> | <str> ;            "
+    " assign        : <ident> '=' <expr> ';' ;                         "
+    " stmt          : <assign> | <call> ';' | \"return\" <expr>? ';' ; "
+    " prog          : /^/ <stmt>* /$/ ;                                ",
+    1,
+    { "x = 1;", "f(a, g(b), 3);", "return;", "return f(x);",
+      "x = \"s\"; y = x; z = f(x, y, \"t\");", "x = ;", "f(a,;",
+      "x = 1 y = 2;", "return return;", "f();g(h());", NULL } },
+
+  { { "hex", "date", "colour", "pets", "dot", "word", "digits", "item", "items" },
+    " hex    : /0[xX][0-9a-fA-F]+/ ;                      "
+    " date   : /[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]/ ; "
+    " colour : /colou?r/ ;                                "
+    " pets   : /(cat|dog)s?/ ;                            "
+    " dot    : /a.c/ ;                                    "
+    " word   : /[^ \\t\\n0-9]+/ ;                         "
+    " digits : /[0-9]+/ ;                                 "
+    " item   : <hex> | <date> | <colour> | <pets>         "
+    "        | <dot> | <word> | <digits> ;                "
+    " items  : /^/ <item>* /$/ ;                          ",
+    1,
+    { "0x1F 2024-01-31 color colour cats dog abc a-c",
+      "0xZZ", "2024-1-31", "cat5 12 x", "\t\n", "colr", "a\nc", NULL } },
+
+  { { "letter", "pair", "nondigit", "seq" },
+    " letter   : /[a-z]/ ;                           "
+    " pair     : <letter>{2} ;                       "
+    " nondigit : /[0-9]/! /./ ;                      "
+    " seq      : /^/ (<pair> ',')* <nondigit>+ /$/ ; ",
+    1,
+    { "ab,cd,X", "ab,X!", "a,X", "ab,cd,", "ab,1", "!?", NULL } }
+};
+
+/* The last rule of a grammar is the one parsed */
+static const char *test_grammar_top(const test_grammar_t *g) {
+  int i = 0;
+  while (i + 1 < TEST_PARSERS_MAX && g->names[i + 1]) { i++; }
+  return g->names[i];
+}
+
+#define TEST_GRAMMARS_NUM ((int)(sizeof(test_grammars) / sizeof(test_grammars[0])))
+
+static const int test_flags[] = {
+  MPCA_LANG_DEFAULT,
+  MPCA_LANG_PREDICTIVE,
+  MPCA_LANG_PACKRAT,
+  MPCA_LANG_ARENA,
+  MPCA_LANG_PACKRAT | MPCA_LANG_ARENA,
+  MPCA_LANG_PREDICTIVE | MPCA_LANG_PACKRAT | MPCA_LANG_ARENA
+};
+
+#define TEST_FLAGS_NUM ((int)(sizeof(test_flags) / sizeof(test_flags[0])))
+
+enum { TEST_STRING, TEST_FILE, TEST_PIPE, TEST_KINDS_NUM };
+
+static const char *test_kinds[] = { "string", "file", "pipe" };
+
+static int test_failures = 0;
+
+typedef struct {
+  int num;
+  mpc_parser_t *parsers[TEST_PARSERS_MAX];
+} test_lang_t;
+
+static void test_lang_delete(test_lang_t *l);
+
+static int test_lang_new(test_lang_t *l, const test_grammar_t *g, int flags) {
+
+  mpc_err_t *e;
+  mpc_parser_t **p = l->parsers;
+  int i;
+
+  for (i = 0; i < TEST_PARSERS_MAX; i++) {
+    p[i] = g->names[i] ? mpc_new(g->names[i]) : NULL;
+    if (p[i]) { l->num = i + 1; }
+  }
+
+  e = mpca_lang(flags, g->lang, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], p[9]);
+  if (e != NULL) {
+    mpc_err_print(e);
+    mpc_err_delete(e);
+    test_lang_delete(l);
+    return 0;
+  }
+  return 1;
+}
+
+static void test_lang_delete(test_lang_t *l) {
+  int i;
+  for (i = 0; i < l->num; i++) {
+    mpc_undefine(l->parsers[i]);
+  }
+  for (i = 0; i < l->num; i++) {
+    mpc_delete(l->parsers[i]);
+  }
+}
+
+static mpc_parser_t *test_lang_top(test_lang_t *l) {
+  return l->parsers[l->num - 1];
+}
+
+static int test_parse(mpc_parser_t *p, const char *input, int kind, mpc_result_t *r) {
+
+  FILE *f;
+  int x;
+
+  if (kind == TEST_STRING) { return mpc_parse("<test>", input, p, r); }
+
+  f = tmpfile();
+  fputs(input, f);
+  rewind(f);
+  x = kind == TEST_FILE ? mpc_parse_file("<test>", f, p, r) : mpc_parse_pipe("<test>", f, p, r);
+  fclose(f);
+  return x;
+}
+
+/* An AST as printed by mpc_ast_print, or the text of an error */
+static char *test_result_string(int ok, mpc_result_t *r) {
+
+  FILE *f;
+  long n;
+  char *s;
+
+  if (!ok) {
+    s = mpc_err_string(r->error);
+    mpc_err_delete(r->error);
+    return s;
+  }
+
+  f = tmpfile();
+  mpc_ast_print_to(r->output, f);
+  mpc_ast_delete(r->output);
+  n = ftell(f);
+  rewind(f);
+  s = malloc(n + 1);
+  n = (long)fread(s, 1, n, f);
+  s[n] = '\0';
+  fclose(f);
+  return s;
+}
+
+/*
+** Predictive parsing changes what a grammar accepts, so flags with
+** MPCA_LANG_PREDICTIVE are checked against a predictive plain parse.
+** Grammars that need backtracking are not parsed predictively.
+*/
+
+static int test_predictive(int flags) {
+  return (flags & MPCA_LANG_PREDICTIVE) != 0;
+}
+
+static void test_corpus(void) {
+
+  test_lang_t base[2], l;
+  mpc_result_t r;
+  char *expected[2], *got;
+  const test_grammar_t *g;
+  int gi, fi, k, j, m, ok, modes;
+
+  for (gi = 0; gi < TEST_GRAMMARS_NUM; gi++) {
+
+    g = &test_grammars[gi];
+    modes = g->backtracks ? 1 : 2;
+    if (!test_lang_new(&base[0], g, MPCA_LANG_DEFAULT)) { test_failures++; continue; }
+    if (modes == 2 && !test_lang_new(&base[1], g, MPCA_LANG_PREDICTIVE)) { modes = 1; test_failures++; }
+
+    for (j = 0; g->inputs[j]; j++) {
+
+      printf("== %s %i\n", test_grammar_top(g), j);
+      for (m = 0; m < modes; m++) {
+        ok = test_parse(test_lang_top(&base[m]), g->inputs[j], TEST_STRING, &r);
+        expected[m] = test_result_string(ok, &r);
+        printf("%s%s\n", m ? "-- predictive\n" : "", expected[m]);
+      }
+
+      for (fi = 0; fi < TEST_FLAGS_NUM; fi++) {
+
+        m = test_predictive(test_flags[fi]);
+        if (m >= modes) { continue; }
+        if (!test_lang_new(&l, g, test_flags[fi])) { test_failures++; continue; }
+
+        for (k = 0; k < TEST_KINDS_NUM; k++) {
+          ok = test_parse(test_lang_top(&l), g->inputs[j], k, &r);
+          got = test_result_string(ok, &r);
+          if (strcmp(expected[m], got) != 0) {
+            fprintf(stderr, "FAIL %s input %i, flags %i, %s input:\n%s\nexpected:\n%s\n",
+              g->names[l.num - 1], j, test_flags[fi], test_kinds[k], got, expected[m]);
+            test_failures++;
+          }
+          free(got);
+        }
+
+        test_lang_delete(&l);
+      }
+
+      for (m = 0; m < modes; m++) { free(expected[m]); }
+    }
+
+    for (m = 0; m < modes; m++) { test_lang_delete(&base[m]); }
+  }
+}
+
+static char *test_nested(const char *open, const char *leaf, const char *close, int depth) {
+
+  size_t no = strlen(open), nl = strlen(leaf), nc = strlen(close);
+  char *s = malloc(depth * (no + nc) + nl + 1);
+  char *t = s;
+  int i;
+
+  for (i = 0; i < depth; i++) { memcpy(t, open, no); t += no; }
+  memcpy(t, leaf, nl); t += nl;
+  for (i = 0; i < depth; i++) { memcpy(t, close, nc); t += nc; }
+  *t = '\0';
+  return s;
+}
+
+static int test_depth(mpc_ast_t *a) {
+  int d = 0;
+  while (a->children_num > 0) {
+    a = a->children[a->children_num > 1 ? 1 : 0];
+    d++;
+  }
+  return d;
+}
+
+/*
+** Nested trees are compared with mpc_ast_eq. Only shallow ones are
+** printed, as printing is quadratic in the depth and the original
+** engine could not parse deep ones anyway.
+*/
+
+#define TEST_PRINT_DEPTH_MAX 50
+
+static void test_deep(int gi, const char *open, const char *leaf, const char *close, int depth) {
+
+  test_lang_t base[2], l;
+  mpc_result_t r, q[2];
+  char *input = test_nested(open, leaf, close, depth);
+  char *expected[2] = { NULL, NULL }, *got;
+  const test_grammar_t *g = &test_grammars[gi];
+  int fi, m, ok, bok[2], modes = g->backtracks ? 1 : 2;
+
+  printf("== %s nested %i '%s'%s\n", test_grammar_top(g), depth, open,
+    close[0] ? "" : " unclosed");
+
+  for (m = 0; m < modes; m++) {
+    if (!test_lang_new(&base[m], g, m ? MPCA_LANG_PREDICTIVE : MPCA_LANG_DEFAULT)) {
+      test_failures++;
+      modes = m;
+      break;
+    }
+    bok[m] = test_parse(test_lang_top(&base[m]), input, TEST_STRING, &q[m]);
+    if (bok[m] && depth > TEST_PRINT_DEPTH_MAX) {
+      printf("%sdepth %i\n", m ? "-- predictive\n" : "", test_depth(q[m].output));
+    } else if (bok[m]) {
+      ok = test_parse(test_lang_top(&base[m]), input, TEST_STRING, &r);
+      got = test_result_string(ok, &r);
+      printf("%s%s\n", m ? "-- predictive\n" : "", got);
+      free(got);
+    } else {
+      expected[m] = test_result_string(0, &q[m]);
+      printf("%s%s\n", m ? "-- predictive\n" : "", expected[m]);
+    }
+  }
+
+  for (fi = 0; fi < TEST_FLAGS_NUM; fi++) {
+
+    m = test_predictive(test_flags[fi]);
+    if (m >= modes || test_flags[fi] == (m ? MPCA_LANG_PREDICTIVE : MPCA_LANG_DEFAULT)) { continue; }
+    if (!test_lang_new(&l, g, test_flags[fi])) { test_failures++; continue; }
+
+    ok = test_parse(test_lang_top(&l), input, TEST_STRING, &r);
+    if (ok != bok[m]) {
+      fprintf(stderr, "FAIL %s nested %i, flags %i: %s\n", g->names[l.num - 1], depth,
+        test_flags[fi], ok ? "parsed" : "failed");
+      if (ok) { mpc_ast_delete(r.output); } else { mpc_err_delete(r.error); }
+      test_failures++;
+    } else if (ok) {
+      if (!mpc_ast_eq(q[m].output, r.output)) {
+        fprintf(stderr, "FAIL %s nested %i, flags %i: trees differ\n",
+          g->names[l.num - 1], depth, test_flags[fi]);
+        test_failures++;
+      }
+      mpc_ast_delete(r.output);
+    } else {
+      got = test_result_string(0, &r);
+      if (strcmp(expected[m], got) != 0) {
+        fprintf(stderr, "FAIL %s nested %i, flags %i:\n%s\nexpected:\n%s\n",
+          g->names[l.num - 1], depth, test_flags[fi], got, expected[m]);
+        test_failures++;
+      }
+      free(got);
+    }
+
+    test_lang_delete(&l);
+  }
+
+  for (m = 0; m < modes; m++) {
+    if (bok[m]) { mpc_ast_delete(q[m].output); }
+    free(expected[m]);
+    test_lang_delete(&base[m]);
+  }
+  free(input);
+}
+
+int main(void) {
+
+  test_corpus();
+
+  test_deep(0, "(", "a", ")", 50);
+  test_deep(0, "(", "a", "", 50);
+  test_deep(1, "(", "1", ")", 50);
+  test_deep(1, "(", "1", "", 50);
+
+  test_deep(0, "(", "a", ")", 100000);
+  test_deep(0, "(", "a", "", 100000);
+  test_deep(0, "{(", "1", ")}", 100000);
+  test_deep(1, "(", "1", ")", 100000);
+  test_deep(1, "(", "1", "", 100000);
+
+  if (test_failures > 0) {
+    fprintf(stderr, "%i failures\n", test_failures);
+    return 1;
+  }
+  return 0;
+}
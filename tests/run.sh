@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# Runs the tests from the top of the tree:
+#
+#   sh tests/run.sh ./keii
+#
+# Each tests/*.lspy is typed into the prompt of the given keii one line
+# at a time, and what it prints is diffed against the matching .out file.
+# tests/mpc_test.c is then built with $CC and its output diffed against
+# tests/mpc_test.out.
+#
+
+keii=${1:-./keii}
+cc=${CC:-cc}
+tmp=${TMPDIR:-/tmp}/keii-tests.$$
+failed=0
+
+mkdir -p "$tmp" || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+for t in tests/*.lspy; do
+  "$keii" < "$t" 2>&1 | sed -e '1,3d' -e 's/^keii> //' > "$tmp/out"
+  if diff -u "${t%.lspy}.out" "$tmp/out"; then
+    echo "PASS $t"
+  else
+    echo "FAIL $t"
+    failed=1
+  fi
+done
+
+if $cc -std=c99 -O2 -I. tests/mpc_test.c mpc.c -lm -o "$tmp/mpc_test" &&
+   "$tmp/mpc_test" > "$tmp/out" && diff -u tests/mpc_test.out "$tmp/out"; then
+  echo "PASS tests/mpc_test.c"
+else
+  echo "FAIL tests/mpc_test.c"
+  failed=1
+fi
+
+exit $failed